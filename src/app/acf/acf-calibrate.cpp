@@ -0,0 +1,223 @@
+/*! -*-c++-*-
+  @file   acf-calibrate.cpp
+  @brief  Soft cascade calibration for ACF detection models.
+
+  Each window sized positive sample is evaluated w/ no early rejection and the
+  partial scores after every tree are recorded.  For positives that pass the
+  final detection threshold, the rejection trace is set to a low quantile
+  (the minimum by default) of the partial scores at each stage, so that
+  (1-quantile) of the positives survive each stage.  The trace is stored in
+  the output model (Classifier::rejection) and used by the detector for early
+  rejection in place of the constant cascade threshold.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/core/drishti_stdlib_string.h" // android workaround
+#include "drishti/acf/ACF.h"
+#include "drishti/core/LazyParallelResource.h"
+#include "drishti/core/Logger.h"
+#include "drishti/core/Parallel.h"
+#include "drishti/core/make_unique.h"
+#include "drishti/core/drishti_cereal_pba.h"
+#include "drishti/testlib/drishti_cli.h"
+
+#include "videoio/VideoSourceCV.h"
+
+#include "cxxopts.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using AcfPtr = std::unique_ptr<drishti::acf::Detector>;
+
+int gauze_main(int argc, char** argv)
+{
+    const auto argumentCount = argc;
+
+    // Instantiate line logger:
+    auto logger = drishti::core::Logger::create("acf-calibrate");
+
+    // ############################
+    // ### Command line parsing ###
+    // ############################
+
+    std::string sInput, sOutput, sModel;
+    double quantile = 0.0;
+    int threads = -1;
+
+    cxxopts::Options options("acf-calibrate", "Soft cascade calibration for ACF models");
+
+    // clang-format off
+    options.add_options()
+        ("i,input", "Input positive samples (window sized images)", cxxopts::value<std::string>(sInput))
+        ("o,output", "Output model file (CPB)", cxxopts::value<std::string>(sOutput))
+        ("m,model", "Input model file", cxxopts::value<std::string>(sModel))
+        ("q,quantile", "Fraction of positives rejected per stage [0,1)", cxxopts::value<double>(quantile))
+        ("t,threads", "Thread count", cxxopts::value<int>(threads))
+        ("h,help", "Print help message");
+    // clang-format on
+
+    options.parse(argc, argv);
+
+    if ((argumentCount <= 1) || options.count("help"))
+    {
+        std::cout << options.help({ "" }) << std::endl;
+        return 0;
+    }
+
+    // ############################################
+    // ### Command line argument error checking ###
+    // ############################################
+
+    if (sModel.empty() || !drishti::cli::file::exists(sModel))
+    {
+        logger->error("Must specify a valid model file");
+        return 1;
+    }
+
+    if (sInput.empty())
+    {
+        logger->error("Must specify input positive samples");
+        return 1;
+    }
+
+    if (sOutput.empty())
+    {
+        logger->error("Must specify output CPB file");
+        return 1;
+    }
+
+    if ((quantile < 0.0) || (quantile >= 1.0))
+    {
+        logger->error("Quantile must be in the range [0,1)");
+        return 1;
+    }
+
+    drishti::acf::Detector acf(sModel);
+    if (!acf.good())
+    {
+        logger->error("Failed to deserialize ACF archive: {}", sModel);
+        return 1;
+    }
+
+    const double cascThr = *acf.opts.cascThr;
+    const auto winSize = acf.getWindowSize();
+
+    // ##########################################
+    // ### Collect partial scores (per tree)  ###
+    // ##########################################
+
+    auto video = drishti::videoio::VideoSourceCV::create(sInput);
+
+    drishti::core::LazyParallelResource<std::thread::id, AcfPtr> manager = [&]() {
+        return drishti::core::make_unique<drishti::acf::Detector>(sModel);
+    };
+
+    std::mutex mutex;
+    std::size_t total = 0;
+    std::vector<std::vector<float>> traces;
+
+    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+        auto& detector = manager[std::this_thread::get_id()];
+
+        auto frame = (*video)(i);
+        const auto& image = frame.image;
+        if (image.empty() || (image.size() != winSize))
+        {
+            return;
+        }
+
+        cv::Mat imageRGB;
+        switch (image.channels())
+        {
+            case 1:
+                cv::cvtColor(image, imageRGB, cv::COLOR_GRAY2RGB);
+                break;
+            case 3:
+                cv::cvtColor(image, imageRGB, cv::COLOR_BGR2RGB);
+                break;
+            case 4:
+                cv::cvtColor(image, imageRGB, cv::COLOR_BGRA2RGB);
+                break;
+        }
+
+        std::vector<float> trace;
+        const float score = detector->evaluate(imageRGB, &trace);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        total++;
+        if (score > cascThr)
+        {
+            traces.push_back(trace);
+        }
+    };
+
+    cv::parallel_for_({ 0, static_cast<int>(video->count()) }, harness, std::max(threads, -1));
+
+    if (traces.empty())
+    {
+        logger->error("No positive samples passed the detection threshold ({} total)", total);
+        return 1;
+    }
+
+    logger->info("Calibrating with {} / {} positive samples", traces.size(), total);
+
+    // ##########################################
+    // ### Compute the rejection trace        ###
+    // ##########################################
+
+    // Windows are rejected at stage t when h <= rejection[t], so the trace is placed just below
+    // the selected partial score, and positives at the quantile are retained.
+    const int nTrees = static_cast<int>(traces.front().size());
+    const std::size_t index = std::min(static_cast<std::size_t>(quantile * traces.size()), traces.size() - 1);
+
+    std::vector<float> partials(traces.size());
+    std::vector<float> rejection(nTrees);
+    for (int t = 0; t < nTrees; t++)
+    {
+        for (std::size_t j = 0; j < traces.size(); j++)
+        {
+            partials[j] = traces[j][t];
+        }
+        std::nth_element(partials.begin(), partials.begin() + index, partials.end());
+        rejection[t] = std::nextafter(partials[index], -std::numeric_limits<float>::infinity());
+    }
+
+    // The final stage must not reject windows that pass the detection threshold:
+    rejection.back() = std::min(rejection.back(), static_cast<float>(cascThr));
+
+    acf.clf.rejection = rejection;
+    save_cpb(sOutput, acf);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        return gauze_main(argc, argv);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Unknown exception";
+    }
+
+    return 0;
+}
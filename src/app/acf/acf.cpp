@@ -11,7 +11,6 @@
 // Local includes:
 #include "drishti/core/drishti_stdlib_string.h" // android workaround
 #include "drishti/acf/ACF.h"
-#include "drishti/core/LazyParallelResource.h"
 #include "drishti/core/Line.h"
 #include "drishti/core/Logger.h"
 #include "drishti/core/Parallel.h"
@@ -80,6 +79,7 @@ static std::vector<cv::Mat> cropNegatives(const cv::Mat& I,
 class Resizer
 {
 public:
+    Resizer() = default;
     Resizer(cv::Mat& image, const cv::Size& winSize, int width = -1)
     {
         if ((width >= 0) && !image.empty())
@@ -267,46 +267,45 @@ int gauze_main(int argc, char** argv)
         video = drishti::videoio::VideoSourceCV::create(sInput);
     }
 
-    // Allocate resource manager:
+    // Allocate a single detector, shared by all threads (see the batched detection below):
 
-    drishti::core::LazyParallelResource<std::thread::id, AcfPtr> manager = [&]() {
-        AcfPtr acf = drishti::core::make_unique<drishti::acf::Detector>(sModel);
-        if (acf.get() && acf->good())
-        {
-            // Cofigure parameters:
-            acf->setDoNonMaximaSuppression(doNms);
+    AcfPtr detector = drishti::core::make_unique<drishti::acf::Detector>(sModel);
+    if (!(detector && detector->good()))
+    {
+        logger->error("Failed to deserialize ACF archive: {}", sModel);
+        return 1;
+    }
 
-            // Cascade threhsold adjustment:
-            if (cascCal != 0.f)
-            {
-                drishti::acf::Detector::Modify dflt;
-                dflt.cascThr = { "cascThr", -1.0 };
-                dflt.cascCal = { "cascCal", cascCal };
-                acf->acfModify(dflt);
-            }
-        }
-        else
-        {
-            acf.release();
-        }
+    // Cofigure parameters:
+    detector->setDoNonMaximaSuppression(doNms);
 
-        return acf;
-    };
+    // Cascade threhsold adjustment:
+    if (cascCal != 0.f)
+    {
+        drishti::acf::Detector::Modify dflt;
+        dflt.cascThr = { "cascThr", -1.0 };
+        dflt.cascCal = { "cascCal", cascCal };
+        detector->acfModify(dflt);
+    }
 
-    std::size_t total = 0;
+    const auto winSize = detector->getWindowSize();
 
-    std::vector<std::pair<std::string, float>> scores;
+    std::size_t total = 0;
 
-    // Parallel loop:
-    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
-        // Get thread specific segmenter lazily:
-        auto& detector = manager[std::this_thread::get_id()];
-        assert(detector);
-        const auto winSize = detector->getWindowSize();
+    // Input frame and detection results:
+    struct Job
+    {
+        drishti::videoio::VideoSourceCV::Frame frame;
+        Resizer resizer;
+        std::vector<double> scores;
+        std::vector<cv::Rect> objects;
+    };
 
-        // Load current image
-        auto frame = (*video)(i);
-        const auto& image = frame.image;
+    // Load current image, and evaluate it directly if it matches the detection window:
+    auto load = [&](Job& job, int i) {
+        job = {};
+        job.frame = (*video)(i);
+        const auto& image = job.frame.image;
 
         //cv::imwrite("/tmp/i.png", image);
 
@@ -326,106 +325,130 @@ int gauze_main(int argc, char** argv)
                     break;
             }
 
-            std::vector<double> scores;
-            std::vector<cv::Rect> objects;
             if (image.size() == winSize)
             {
                 const float score = detector->evaluate(imageRGB);
-                scores.push_back(score);
-                objects.push_back(cv::Rect({ 0, 0 }, image.size()));
+                job.scores.push_back(score);
+                job.objects.push_back(cv::Rect({ 0, 0 }, image.size()));
             }
             else
             {
-                Resizer resizer(imageRGB, detector->getWindowSize(), minWidth);
-                (*detector)(resizer, objects, &scores);
-                resizer(objects);
+                job.resizer = Resizer(imageRGB, winSize, minWidth);
+            }
+        }
+    };
+
+    // Search all resized images in a single batch (empty images are skipped):
+    auto detect = [&](std::vector<Job>& jobs) {
+        std::vector<cv::Mat> images(jobs.size());
+        for (int i = 0; i < jobs.size(); i++)
+        {
+            images[i] = jobs[i].resizer.reduced;
+        }
+
+        std::vector<std::vector<double>> scores;
+        std::vector<std::vector<cv::Rect>> objects;
+        (*detector)(images, objects, &scores);
+
+        for (int i = 0; i < jobs.size(); i++)
+        {
+            if (!images[i].empty())
+            {
+                jobs[i].objects = objects[i];
+                jobs[i].scores = scores[i];
+                jobs[i].resizer(jobs[i].objects);
 
                 if (doSingleDetection)
                 {
-                    chooseBest(objects, scores);
+                    chooseBest(jobs[i].objects, jobs[i].scores);
                 }
             }
+        }
+    };
 
-            if (!doPositiveOnly || (objects.size() > 0))
-            {
-                // Construct valid filename with no extension:
-                std::string base = drishti::core::basename(frame.name);
-                std::string filename = sOutput + "/" + base;
+    auto save = [&](const Job& job) {
+        if (!doPositiveOnly || (job.objects.size() > 0))
+        {
+            // Construct valid filename with no extension:
+            std::string base = drishti::core::basename(job.frame.name);
+            std::string filename = sOutput + "/" + base;
 
-                float maxScore = -1e6f;
-                auto iter = std::max_element(scores.begin(), scores.end());
-                if (iter != scores.end())
-                {
-                    maxScore = *iter;
-                }
+            float maxScore = -1e6f;
+            auto iter = std::max_element(job.scores.begin(), job.scores.end());
+            if (iter != job.scores.end())
+            {
+                maxScore = *iter;
+            }
 
-                if (doScoreLog)
-                {
-                    logger->info("SCORE: {} = {}", filename, maxScore);
-                }
-                else
-                {
-                    logger->info("{}/{} {} = {}; score = {}", ++total, video->count(), frame.name, objects.size(), maxScore);
-                }
+            if (doScoreLog)
+            {
+                logger->info("SCORE: {} = {}", filename, maxScore);
+            }
+            else
+            {
+                logger->info("{}/{} {} = {}; score = {}", ++total, video->count(), job.frame.name, job.objects.size(), maxScore);
+            }
 
-                if (doNegatives)
+            if (doNegatives)
+            {
+                auto iter = landmarks.find(filename); // find landmarks by name
+                if (iter != landmarks.end())
                 {
-                    auto iter = landmarks.find(filename); // find landmarks by name
-                    if (iter != landmarks.end())
+                    auto negatives = cropNegatives(job.frame.image, winSize, cropPad, job.objects, iter->second);
+                    for (int j = 0; j < negatives.size(); j++)
                     {
-                        auto negatives = cropNegatives(image, winSize, cropPad, objects, iter->second);
-                        for (int j = 0; j < negatives.size(); j++)
-                        {
-                            std::stringstream ss;
-                            ss << filename << std::setw(2) << std::setfill('0') << j << ".png";
-                            cv::imwrite(ss.str(), negatives[j]);
-                        }
+                        std::stringstream ss;
+                        ss << filename << std::setw(2) << std::setfill('0') << j << ".png";
+                        cv::imwrite(ss.str(), negatives[j]);
                     }
-
-                    return; // don't do metadata logging
                 }
 
-                // Save detection results in JSON:
-                if (!writeAsJson(filename + ".json", objects))
-                {
-                    logger->error("Failed to write: {}.json", filename);
-                }
+                return; // don't do metadata logging
+            }
 
-                if (doBox && !writeAsText(filename + ".roi", objects))
-                {
-                    logger->error("Failed to write: {}.box", filename);
-                }
+            // Save detection results in JSON:
+            if (!writeAsJson(filename + ".json", job.objects))
+            {
+                logger->error("Failed to write: {}.json", filename);
+            }
 
-                if (doAnnotation || doWindow)
-                {
-                    cv::Mat canvas = image.clone();
-                    drawObjects(canvas, objects);
+            if (doBox && !writeAsText(filename + ".roi", job.objects))
+            {
+                logger->error("Failed to write: {}.box", filename);
+            }
 
-                    if (doAnnotation)
-                    {
-                        cv::imwrite(filename + "_objects.jpg", canvas);
-                    }
+            if (doAnnotation || doWindow)
+            {
+                cv::Mat canvas = job.frame.image.clone();
+                drawObjects(canvas, job.objects);
+
+                if (doAnnotation)
+                {
+                    cv::imwrite(filename + "_objects.jpg", canvas);
+                }
 
 #if defined(DRISHTI_USE_IMSHOW)
-                    if (doWindow)
-                    {
-                        glfw::destroyWindow("acf");
-                        glfw::imshow("acf", canvas);
-                        glfw::waitKey(1);
-                    }
-#endif
+                if (doWindow)
+                {
+                    glfw::destroyWindow("acf");
+                    glfw::imshow("acf", canvas);
+                    glfw::waitKey(1);
                 }
+#endif
             }
         }
     };
 
     if (threads == 1 || threads == 0 || doWindow || !video->isRandomAccess())
     {
+        std::vector<Job> jobs(1);
         auto count = video->count();
         for (int i = 0; (i < count); i++)
         {
             // Increment manually, to check for end of file:
-            harness({ i, i + 1 });
+            load(jobs[0], i);
+            detect(jobs);
+            save(jobs[0]);
             if (!video->good())
             {
                 break;
@@ -434,7 +457,27 @@ int gauze_main(int argc, char** argv)
     }
     else
     {
-        cv::parallel_for_({ 0, static_cast<int>(video->count()) }, harness, std::max(threads, -1));
+        // Frames are loaded and saved in parallel, and detected in batches (a few frames per thread):
+        const int count = static_cast<int>(video->count());
+        const int batchSize = std::max(cv::getNumThreads(), 1) * 4;
+
+        std::vector<Job> jobs;
+        for (int b = 0; b < count; b += batchSize)
+        {
+            jobs.resize(std::min(batchSize, count - b));
+
+            drishti::core::ParallelHomogeneousLambda loader = [&](int i) {
+                load(jobs[i], b + i);
+            };
+            cv::parallel_for_({ 0, static_cast<int>(jobs.size()) }, loader, std::max(threads, -1));
+
+            detect(jobs);
+
+            drishti::core::ParallelHomogeneousLambda saver = [&](int i) {
+                save(jobs[i]);
+            };
+            cv::parallel_for_({ 0, static_cast<int>(jobs.size()) }, saver, std::max(threads, -1));
+        }
     }
 
     return 0;
@@ -18,6 +18,10 @@ void loadJSON(const std::string& filename, drishti::dlib::Recipe& recipe)
 
         recipe.do_pca = json["do_pca"].get<bool>();
         recipe.do_affine = json["do_affine"].get<bool>();
+        if (json.count("do_bilinear")) // optional (older recipes)
+        {
+            recipe.do_bilinear = json["do_bilinear"].get<bool>();
+        }
         recipe.do_interpolate = json["do_interpolate"].get<bool>();
         recipe.npd = json["npd"].get<bool>();
         recipe.lambda = json["lambda"].get<float>();
@@ -29,6 +33,14 @@ void loadJSON(const std::string& filename, drishti::dlib::Recipe& recipe)
         recipe.features = json["features"].get<int>();
         recipe.oversampling = json["oversampling"].get<int>();
         recipe.splits = json["splits"].get<int>();
+        if (json.count("histogram_bins")) // optional (older recipes)
+        {
+            recipe.histogram_bins = json["histogram_bins"].get<int>();
+        }
+        if (json.count("histogram_splits")) // optional (older recipes)
+        {
+            recipe.histogram_splits = json["histogram_splits"].get<int>();
+        }
         recipe.trees_per_level = json["trees_per_level"].get<int>();
         recipe.width = json["width"].get<int>();
         recipe.dimensions = json["dimensions"].get<std::vector<int>>();
@@ -48,6 +60,7 @@ void saveJSON(const std::string& filename, const drishti::dlib::Recipe& recipe)
 
         json["do_pca"] = recipe.do_pca;
         json["do_affine"] = recipe.do_affine;
+        json["do_bilinear"] = recipe.do_bilinear;
         json["do_interpolate"] = recipe.do_interpolate;
         json["npd"] = recipe.npd;
         json["lambda"] = recipe.lambda;
@@ -59,6 +72,8 @@ void saveJSON(const std::string& filename, const drishti::dlib::Recipe& recipe)
         json["features"] = recipe.features;
         json["oversampling"] = recipe.oversampling;
         json["splits"] = recipe.splits;
+        json["histogram_bins"] = recipe.histogram_bins;
+        json["histogram_splits"] = recipe.histogram_splits;
         json["trees_per_level"] = recipe.trees_per_level;
         json["width"] = recipe.width;
         json["dimensions"] = recipe.dimensions;
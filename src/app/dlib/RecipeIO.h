@@ -22,6 +22,7 @@ DRISHTI_BEGIN_NAMESPACE(dlib)
 struct Recipe
 {
     bool do_affine = false;
+    bool do_bilinear = false;
     bool do_interpolate = false;
     bool npd = false;
     float lambda = 0.1;
@@ -33,6 +34,8 @@ struct Recipe
     int features = 2048;
     int oversampling = 8;
     int splits = 512;
+    int histogram_bins = 0; // histogram split search w/ this many bins (0: random thresholds)
+    int histogram_splits = 0; // pixel pairs per split w/ the histogram split search (0: splits)
     int trees_per_level = 512;
     int width = 0;
     bool do_pca = true;
@@ -48,9 +51,12 @@ struct Recipe
         os << "feature_pool_size: " << features << std::endl;
         os << "lambda: " << lambda << std::endl;
         os << "num_test_splits: " << splits << std::endl;
+        os << "num_histogram_bins: " << histogram_bins << std::endl;
+        os << "num_histogram_test_splits: " << histogram_splits << std::endl;
         os << "feature_pool_region_padding: " << padding << std::endl;
         os << "use npd: " << npd << std::endl;
         os << "affine: " << do_affine << std::endl;
+        os << "bilinear: " << do_bilinear << std::endl;
         os << "interpolated: " << do_interpolate << std::endl;
     }
 };
@@ -34,6 +34,7 @@ typedef unsigned char boolean;
 #include "drishti/core/Line.h"
 #include "drishti/ml/shape_predictor_archive.h"
 #include "drishti/ml/shape_predictor_trainer.h"
+#include "drishti/ml/shape_predictor_flat.h"
 #include "drishti/geometry/Ellipse.h"
 #include "drishti/core/drishti_stdlib_string.h"
 #include "drishti/core/drishti_cereal_pba.h"
@@ -103,6 +104,8 @@ int gauze_main(int argc, char* argv[])
     bool do_thumbs = false;
     bool do_verbose = false;
     bool do_silent = false;
+    float earlyExitTolerance = 0.f;
+    int imagesPerShard = 0;
 
     drishti::dlib::Recipe recipe;
 
@@ -124,6 +127,8 @@ int gauze_main(int argc, char* argv[])
         ( "model", "Model file", cxxopts::value<std::string>(sModel))
         ( "thumbs", "dump thumbnails of width n", cxxopts::value<bool>(do_thumbs))        
         ( "roi", "exclusion roi (x,y,w,h) normalized cs", cxxopts::value<std::string>(sRoi))
+        ( "early_exit", "Learn an early exit threshold on the test set w/ this relative error tolerance", cxxopts::value<float>(earlyExitTolerance))
+        ( "shards", "Out-of-core training w/ this many images per shard (stored in the output directory)", cxxopts::value<int>(imagesPerShard))
 
         // Regression parameters:
         ( "recipe", "Cascaded pose regression training recipe", cxxopts::value<std::string>(sRecipe))
@@ -185,9 +190,12 @@ int gauze_main(int argc, char* argv[])
         logger->info("feature_pool_size: {}", recipe.features);
         logger->info("lambda: {}", recipe.lambda);
         logger->info("num_test_splits: {}", recipe.splits);
+        logger->info("num_histogram_bins: {}", recipe.histogram_bins);
+        logger->info("num_histogram_test_splits: {}", recipe.histogram_splits);
         logger->info("feature_pool_region_padding: {}", recipe.padding);
         logger->info("use npd: {}", recipe.npd);
         logger->info("affine: {}", recipe.do_affine);
+        logger->info("bilinear: {}", recipe.do_bilinear);
         logger->info("interpolated: {}", recipe.do_interpolate);
     }
 
@@ -232,6 +240,8 @@ int gauze_main(int argc, char* argv[])
     trainer.set_feature_pool_size(recipe.features);
     trainer.set_lambda(recipe.lambda);                    // feature separation (not learning rate)
     trainer.set_num_test_splits(recipe.splits);
+    trainer.set_num_histogram_bins(recipe.histogram_bins); // best threshold per split feature (0: random)
+    trainer.set_num_histogram_test_splits(recipe.histogram_splits);
     trainer.set_feature_pool_region_padding(recipe.padding);
 
     // new parameters
@@ -243,6 +253,7 @@ int gauze_main(int argc, char* argv[])
     trainer.set_ellipse_count(recipe.ellipse_count);
     trainer.set_do_npd(recipe.npd);
     trainer.set_do_affine(recipe.do_affine);
+    trainer.set_do_bilinear(recipe.do_bilinear);
     trainer.set_roi(roi);
     trainer.set_do_line_indexed(recipe.do_interpolate);
     
@@ -265,7 +276,38 @@ int gauze_main(int argc, char* argv[])
     }
 
     //_SP::shape_predictor sp;
-    _SP::shape_predictor sp = trainer.train(images_train, faces_train);
+    _SP::shape_predictor sp;
+    if(imagesPerShard > 0)
+    {
+        if(sOutput.empty())
+        {
+            logger->error("Must specify an output directory for out-of-core training.");
+            return 1;
+        }
+        if(recipe.do_bilinear)
+        {
+            logger->error("Out-of-core training doesn't support bilinear sampling.");
+            return 1;
+        }
+
+        // The training samples are stored next to the image shards:
+        const std::string sShards = sOutput + "/train";
+        {
+            _SP::sharded_image_store::writer writer(sShards, imagesPerShard);
+            writer.setStreamLogger(logger);
+            for(int i = 0; i < images_train.size(); i++)
+            {
+                auto& src = images_train[i];
+                writer.add(cv::Mat(src.nr(), src.nc(), CV_8UC1, (void*)&src[0][0], src.width_step()), faces_train[i]);
+            }
+            writer.close();
+        }
+        sp = trainer.train(_SP::sharded_image_store(sShards), sShards);
+    }
+    else
+    {
+        sp = trainer.train(images_train, faces_train);
+    }
     if(do_verbose)
     {
         logger->info("Done training...");
@@ -279,7 +321,19 @@ int gauze_main(int argc, char* argv[])
         logger->info("Saving to ...{}", sModel);
     }
     
-    save_cpb(sModel, sp);
+    auto saveModel = [&]()
+    {
+        if(sModel.find(".spf") != std::string::npos)
+        {
+            drishti::ml::shape_predictor_flat::save(sp, sModel); // flat (memory mappable) format
+        }
+        else
+        {
+            save_cpb(sModel, sp);
+        }
+    };
+
+    saveModel();
     sp.populate_f16(); // populate half precision leaf nodes
 
     if(do_verbose)
@@ -306,6 +360,19 @@ int gauze_main(int argc, char* argv[])
         {
             logger->info("Mean testing error: {}", test_error);
         }
+
+        if(earlyExitTolerance > 0.f)
+        {
+            // Adaptive cascade early exit, see shape_predictor::m_early_exit_threshold
+            sp.m_early_exit_threshold = sp.learn_early_exit_threshold(images_test, faces_test, earlyExitTolerance);
+            saveModel();
+
+            test_error = test_shape_predictor(sp, images_test, faces_test, test_iod);
+            if(do_verbose)
+            {
+                logger->info("Early exit threshold: {} mean testing error: {}", sp.m_early_exit_threshold, test_error);
+            }
+        }
     }
 
     return 0;
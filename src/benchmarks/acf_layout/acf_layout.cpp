@@ -0,0 +1,185 @@
+/*! -*-c++-*-
+  @file   acf_layout.cpp
+  @author David Hirvonen
+  @brief  Benchmark ACF tree traversal w/ separate vs interleaved node tables.
+
+  \copyright Copyright 2014-2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_acf_layout <face_detector.cpb> <image.png>
+
+  Both evaluators are single threaded scalar loops over the first pyramid
+  level, so the difference is due to the memory layout of the trees alone.
+
+*/
+
+#include "drishti/acf/ACF.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/highgui.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using Node = drishti::acf::Detector::Classifier::Node;
+
+struct Scan
+{
+    const float* chns = nullptr;
+    std::vector<uint32_t> cids;
+    std::vector<uint32_t> offsets;
+    float cascThr = 0.f;
+};
+
+// Reference: separate fids, thrs and hs tables (depth 2)
+static float evaluateTables(const Scan& scan, const cv::Mat& fids, const cv::Mat& thrs, const cv::Mat& hs, uint32_t index)
+{
+    const int nTrees = fids.rows, nTreeNodes = fids.cols;
+    const uint32_t* pFids = fids.ptr<uint32_t>();
+    const float* pThrs = thrs.ptr<float>();
+    const float* pHs = hs.ptr<float>();
+
+    float h = 0.f;
+    for (int t = 0; t < nTrees; t++)
+    {
+        uint32_t offset = t * nTreeNodes, k = offset, k0 = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            const float ftr = scan.chns[index + scan.cids[pFids[k]]];
+            k = (ftr < pThrs[k]) ? 1 : 2;
+            k0 = k += k0 * 2;
+            k += offset;
+        }
+        h += pHs[k];
+        if (h <= scan.cascThr)
+        {
+            break;
+        }
+    }
+    return h;
+}
+
+// Interleaved {fid, value} nodes w/ cache line aligned trees (depth 2)
+static float evaluateNodes(const Scan& scan, const Node* nodes, int nTrees, int nTreeNodes, uint32_t index)
+{
+    float h = 0.f;
+    for (int t = 0; t < nTrees; t++)
+    {
+        uint32_t offset = t * nTreeNodes, k = offset, k0 = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            const Node& node = nodes[k];
+            const float ftr = scan.chns[index + scan.cids[node.fid]];
+            k = (ftr < node.value) ? 1 : 2;
+            k0 = k += k0 * 2;
+            k += offset;
+        }
+        h += nodes[k].value;
+        if (h <= scan.cascThr)
+        {
+            break;
+        }
+    }
+    return h;
+}
+
+template <typename Evaluator>
+static double benchmark(const Scan& scan, Evaluator&& evaluator, std::vector<float>& scores, int iterations)
+{
+    scores.resize(scan.offsets.size());
+    auto tic = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (std::size_t j = 0; j < scan.offsets.size(); j++)
+        {
+            scores[j] = evaluator(scan.offsets[j]);
+        }
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - tic).count();
+    return elapsed / double(iterations * scan.offsets.size());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <face_detector.cpb> <image.png>" << std::endl;
+        return 1;
+    }
+
+    drishti::acf::Detector detector(argv[1]);
+    if (!detector.good() || detector.clf.treeDepth != 2)
+    {
+        std::cerr << "Failed to load depth 2 detector: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    cv::Mat image = cv::imread(argv[2], cv::IMREAD_COLOR), rgb;
+    if (image.empty())
+    {
+        std::cerr << "Failed to read image: " << argv[2] << std::endl;
+        return 1;
+    }
+    cv::cvtColor(image, rgb, cv::COLOR_BGR2RGB);
+    rgb.convertTo(rgb, CV_32FC3, 1.0 / 255.0);
+
+    drishti::acf::Detector::Pyramid P;
+    detector.setIsTranspose(true);
+    detector.computePyramid(MatP(rgb.t()), P);
+
+    // Column major window geometry (see Detector::createDetector()):
+    const MatP& I = P.data[0][0];
+    const int shrink = detector.opts.pPyramid->pChns->shrink;
+    const int stride = detector.opts.stride;
+    const cv::Size modelDsPad = detector.opts.modelDsPad;
+    const int modelHt = modelDsPad.width / shrink, modelWd = modelDsPad.height / shrink;
+    const int height = I.size().width, width = I.size().height;
+    const int rowStride = static_cast<int>(I[0].step1());
+    const int height1 = static_cast<int>(std::ceil(float(height * shrink - modelDsPad.width + 1) / stride));
+    const int width1 = static_cast<int>(std::ceil(float(width * shrink - modelDsPad.height + 1) / stride));
+
+    Scan scan;
+    scan.chns = I[0].ptr<float>();
+    scan.cascThr = static_cast<float>(*detector.opts.cascThr);
+    for (int z = 0; z < I.channels(); z++)
+    {
+        for (int c = 0; c < modelWd; c++)
+        {
+            for (int r = 0; r < modelHt; r++)
+            {
+                scan.cids.push_back(z * width * height + c * height + r);
+            }
+        }
+    }
+    for (int c = 0; c < width1; c++)
+    {
+        for (int r = 0; r < height1; r++)
+        {
+            scan.offsets.push_back((r * stride / shrink) + (c * stride / shrink) * rowStride);
+        }
+    }
+
+    const auto& clf = detector.clf;
+    const auto& nodes = clf.getPackedNodes(CV_32FC1);
+
+    const int iterations = 20;
+    std::vector<float> scoresTables, scoresNodes;
+    double nsTables = benchmark(scan, [&](uint32_t index) { return evaluateTables(scan, clf.fids, clf.thrs, clf.hs, index); }, scoresTables, iterations);
+    double nsNodes = benchmark(scan, [&](uint32_t index) { return evaluateNodes(scan, nodes.ptr(), clf.fids.rows, nodes.nTreeNodes, index); }, scoresNodes, iterations);
+
+    std::cout << "windows: " << scan.offsets.size() << " trees: " << clf.fids.rows << std::endl;
+    std::cout << "tables: " << nsTables << " ns/window" << std::endl;
+    std::cout << "nodes: " << nsNodes << " ns/window" << std::endl;
+    std::cout << "speedup: " << (nsTables / nsNodes) << "x" << std::endl;
+
+    if (scoresTables != scoresNodes)
+    {
+        std::cerr << "Score mismatch between tree layouts" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
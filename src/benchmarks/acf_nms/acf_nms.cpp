@@ -0,0 +1,106 @@
+/*! -*-c++-*-
+  @file   acf_nms.cpp
+  @brief  Benchmark ACF bounding box non maxima suppression for dense (crowd) detections.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_acf_nms [iterations]
+
+  Random detections (w/ a crowd like density of positions over 3 octaves
+  of scale) are suppressed w/ each Detector::bbNms type ('max', 'maxg',
+  'ms' and 'cover') for 1k, 10k and 100k boxes.  The pairwise (O(n^2))
+  'max' loop is timed for comparison up to 10k boxes, and the bucketed
+  'max' and 'maxg' results are checked for equality w/ it.  The time per
+  call is reported in milliseconds (median of the iterations).  The
+  detections and the pairwise nms are shared w/ the ACF unit tests (see
+  acf/ut/test-nms-reference.h).
+
+*/
+
+#include "drishti/acf/ACF.h"
+#include "drishti/acf/ut/test-nms-reference.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Detection = drishti::acf::Detector::Detection;
+using DetectionVec = drishti::acf::Detector::DetectionVec;
+
+static double median(std::vector<double> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+static bool isEqual(const DetectionVec& a, const DetectionVec& b)
+{
+    return (a.size() == b.size()) && std::equal(a.begin(), a.end(), b.begin(), [](const Detection& x, const Detection& y) {
+        return (x.roi == y.roi) && (x.score == y.score);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 5;
+    const int maxPairwise = 10000;
+
+    cv::RNG rng(0);
+
+    drishti::acf::Detector detector;
+
+    auto measure = [&](const std::function<void()>& nms) {
+        std::vector<double> elapsed;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto tic = std::chrono::high_resolution_clock::now();
+            nms();
+            elapsed.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count());
+        }
+        return median(elapsed) * 1e3;
+    };
+
+    int status = 0;
+    for (int n : { 1000, 10000, 100000 })
+    {
+        const DetectionVec bbs = randomDetections(n, rng);
+
+        std::cout << "boxes: " << std::setw(6) << n << std::fixed << std::setprecision(2);
+
+        for (const auto& type : { "max", "maxg", "ms", "cover" })
+        {
+            drishti::acf::Detector::Options::Nms pNms;
+            pNms.type = { "type", std::string(type) };
+            pNms.overlap = { "overlap", 0.5 };
+
+            DetectionVec suppressed;
+            const double elapsed = measure([&]() { detector.bbNms(bbs, pNms, suppressed); });
+            std::cout << "  " << type << ": " << std::setw(8) << elapsed << " ms (" << suppressed.size() << ")";
+
+            const bool greedy = (*pNms.type == "maxg");
+            if ((greedy || (*pNms.type == "max")) && (n <= maxPairwise) && !isEqual(suppressed, nmsPairwise(bbs, 0.5, greedy)))
+            {
+                std::cerr << "bbNms " << type << " differs from the pairwise nms for " << n << " boxes" << std::endl;
+                status = 1;
+            }
+        }
+
+        if (n <= maxPairwise)
+        {
+            DetectionVec suppressed;
+            const double elapsed = measure([&]() { suppressed = nmsPairwise(bbs, 0.5, false); });
+            std::cout << "  pairwise max: " << std::setw(8) << elapsed << " ms";
+        }
+        std::cout << std::endl;
+    }
+
+    return status;
+}
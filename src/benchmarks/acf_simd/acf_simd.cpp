@@ -0,0 +1,147 @@
+/*! -*-c++-*-
+  @file   acf_simd.cpp
+  @brief  Benchmark ACF toolbox kernels for each SIMD backend (see acf/toolbox/simd.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_acf_simd [iterations]
+
+  Each toolbox kernel is run single threaded on random 640x480 and 1920x1080
+  inputs w/ every SIMD backend supported by the CPU, and the throughput is
+  reported in megapixels per second (median of the iterations).  The output of
+  each backend is checked against the scalar output.
+
+*/
+
+#include "drishti/acf/ACF.h"
+#include "drishti/acf/MatP.h"
+#include "drishti/acf/toolbox/simd.hpp"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Toolbox declarations:
+void convBox(float* I, float* O, int h, int w, int d, int r, int s);
+void convTri(float* I, float* O, int h, int w, int d, int r, int s);
+void convTri1(float* I, float* O, int h, int w, int d, float p, int s);
+void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full);
+void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full);
+
+namespace simd = drishti::acf::simd;
+
+struct Kernel
+{
+    std::string name;
+    std::function<void()> run;
+    std::function<cv::Mat()> output; // for validation
+};
+
+static double median(std::vector<double> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 20;
+
+    const std::vector<cv::Size> sizes = { { 640, 480 }, { 1920, 1080 } };
+
+    std::vector<simd::Isa> isas;
+    for (auto isa : { simd::kScalar, simd::kSSE, simd::kAVX2, simd::kAVX512 })
+    {
+        if (simd::getKernels(isa))
+        {
+            isas.push_back(isa);
+        }
+    }
+
+    cv::setNumThreads(0);
+
+    int status = 0;
+    for (const auto& size : sizes)
+    {
+        // Column major toolbox layout: h = image rows, w = image columns
+        const int h = size.height, w = size.width, bin = 4, nOrients = 6;
+
+        cv::Mat3f rgb(size);
+        cv::randu(rgb, cv::Scalar::all(0.f), cv::Scalar::all(1.f));
+        MatP I(rgb.t()), J;
+
+        cv::Mat1f gray(w, h), smooth(w, h), M(w, h), O(w, h), Mk(w, h), Ok(w, h);
+        cv::Mat1f H(nOrients * (w / bin), h / bin);
+        cv::randu(gray, 0.f, 1.f);
+        gradMag(gray.ptr<float>(), M.ptr<float>(), O.ptr<float>(), h, w, 1, false);
+
+        auto getJ = [&]() { return J.base().clone(); };
+        auto getSmooth = [&]() { return cv::Mat(smooth.clone()); };
+
+        const std::vector<Kernel> kernels = {
+            { "rgbConvert(luv)", [&]() { drishti::acf::Detector::rgbConvert(I, J, "luv", true); }, getJ },
+            { "imResample(1/2)", [&]() { imResample(I, J, { h / 2, w / 2 }, 1.0); }, getJ },
+            { "convTri1(p=2)", [&]() { convTri1(gray.ptr<float>(), smooth.ptr<float>(), h, w, 1, 2.f, 1); }, getSmooth },
+            { "convTri(r=5)", [&]() { convTri(gray.ptr<float>(), smooth.ptr<float>(), h, w, 1, 5, 1); }, getSmooth },
+            { "convBox(r=2)", [&]() { convBox(gray.ptr<float>(), smooth.ptr<float>(), h, w, 1, 2, 1); }, getSmooth },
+            { "gradMag", [&]() { gradMag(gray.ptr<float>(), Mk.ptr<float>(), Ok.ptr<float>(), h, w, 1, false); }, [&]() {
+                 cv::Mat MO;
+                 cv::vconcat(Mk, Ok, MO);
+                 return MO;
+             } },
+            { "gradHist", [&]() {
+                 H.setTo(0.f);
+                 gradHist(M.ptr<float>(), O.ptr<float>(), H.ptr<float>(), h, w, bin, nOrients, 1, false);
+             },
+              [&]() { return cv::Mat(H.clone()); } }
+        };
+
+        std::cout << size.width << "x" << size.height << std::endl;
+        for (const auto& kernel : kernels)
+        {
+            cv::Mat golden;
+            std::cout << "  " << std::left << std::setw(18) << kernel.name << std::right;
+            for (auto isa : isas)
+            {
+                simd::setIsa(isa);
+
+                kernel.run(); // warm up
+                const cv::Mat output = kernel.output();
+
+                std::vector<double> elapsed;
+                for (int i = 0; i < iterations; i++)
+                {
+                    auto tic = std::chrono::high_resolution_clock::now();
+                    kernel.run();
+                    elapsed.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count());
+                }
+
+                if (golden.empty())
+                {
+                    golden = output;
+                }
+                else if (cv::norm(golden, output, cv::NORM_INF) != 0.0)
+                {
+                    std::cerr << kernel.name << ": " << simd::getIsaName(isa) << " output differs from scalar" << std::endl;
+                    status = 1;
+                }
+
+                const double mpps = double(size.area()) / median(elapsed) * 1e-6;
+                std::cout << "  " << simd::getIsaName(isa) << ": " << std::fixed << std::setprecision(1) << std::setw(7) << mpps << " MP/s";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    simd::setIsa(simd::getBestIsa());
+
+    return status;
+}
@@ -0,0 +1,119 @@
+/*! -*-c++-*-
+  @file   shape_predictor_histogram.cpp
+  @brief  Benchmark shape_predictor_trainer split search: random thresholds vs. histogram splits.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_shape_predictor_histogram [iterations]
+
+  A shape predictor w/ deep trees is trained on synthetic landmark images
+  (four bright squares on noise), so that the split search dominates the
+  feature extraction.  The same trainer is run w/ random thresholds, w/ the
+  histogram split search for the same number of pixel pairs per node, and
+  w/ the histogram split search for a quarter of them (see
+  set_num_histogram_test_splits()).  The training time is reported in
+  seconds (median of the iterations), along w/ the mean landmark error on
+  the training images.
+
+*/
+
+#include "drishti/ml/shape_predictor.h"
+#include "drishti/ml/shape_predictor_trainer.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+static double median(std::vector<double> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 5;
+    const int images = 64, splits = 40;
+
+    cv::RNG rng(0);
+
+    std::vector<cv::Mat1b> crops(images);
+    std::vector<std::vector<dlib::full_object_detection>> objects(images);
+    for (int i = 0; i < images; i++)
+    {
+        crops[i].create(64, 64);
+        rng.fill(crops[i], cv::RNG::UNIFORM, 0, 64);
+
+        const long x = rng.uniform(8, 24), y = rng.uniform(8, 24);
+        const std::vector<dlib::point> parts = { { x + 8, y + 8 }, { x + 24, y + 8 }, { x + 8, y + 24 }, { x + 24, y + 24 } };
+        for (const auto& p : parts)
+        {
+            crops[i](cv::Rect(int(p.x()) - 2, int(p.y()) - 2, 5, 5)).setTo(255);
+        }
+        objects[i].assign(1, dlib::full_object_detection(dlib::rectangle(0, 0, 63, 63), parts));
+    }
+    const std::vector<dlib::cv_image<uint8_t>> imgs(crops.begin(), crops.end());
+
+    auto error = [&](const drishti::ml::shape_predictor& predictor) {
+        double sum = 0.0;
+        int count = 0;
+        for (int i = 0; i < images; i++)
+        {
+            const auto& truth = objects[i][0];
+            const auto shape = predictor(imgs[i], truth.get_rect());
+            for (unsigned long j = 0; j < truth.num_parts(); j++, count++)
+            {
+                sum += dlib::length(shape.part(j) - truth.part(j));
+            }
+        }
+        return sum / count;
+    };
+
+    struct Mode
+    {
+        const char* name;
+        unsigned long bins;
+        unsigned long splits;
+    };
+
+    const Mode modes[] = {
+        { "random thresholds", 0, 0 },
+        { "histogram", 64, 0 },
+        { "histogram (1/4 splits)", 64, splits / 4 }
+    };
+
+    for (const auto& mode : modes)
+    {
+        drishti::ml::shape_predictor_trainer trainer;
+        trainer.set_cascade_depth(4);
+        trainer.set_num_trees_per_cascade_level(50);
+        trainer.set_tree_depth(4);
+        trainer.set_oversampling_amount(20);
+        trainer.set_feature_pool_size(100);
+        trainer.set_num_test_splits(splits);
+        trainer.set_num_histogram_bins(mode.bins);
+        trainer.set_num_histogram_test_splits(mode.splits);
+
+        std::vector<double> elapsed;
+        double landmarkError = 0.0;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto tic = std::chrono::high_resolution_clock::now();
+            const auto predictor = trainer.train(imgs, objects);
+            elapsed.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count());
+            landmarkError = error(predictor);
+        }
+
+        std::cout << std::setw(24) << mode.name << std::fixed << std::setprecision(3)
+                  << "  training: " << std::setw(8) << median(elapsed) << " s"
+                  << "  error: " << std::setw(6) << landmarkError << " pixels" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*! -*-c++-*-
+  @file   shape_predictor_quickscorer.cpp
+  @brief  Benchmark shape_predictor forest evaluation: tree traversal vs. impl::quick_scorer.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_shape_predictor_quickscorer [iterations]
+
+  The exit leaves of one random cascade stage (500 trees over a 400 pixel
+  feature pool) are computed for random pixel values w/ a range of tree
+  depths, using both the root to leaf traversal and the branch free
+  bitvector evaluation.  The time per stage is reported in microseconds
+  (median of the iterations), and the leaves of both evaluators are checked
+  for equality.  Leaf accumulation is the same for both, and is not timed.
+
+*/
+
+#include "drishti/ml/shape_predictor.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using drishti::ml::impl::quick_scorer;
+using drishti::ml::impl::regression_tree;
+
+static double median(std::vector<double> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 200;
+    const int trees = 500, features = 400, samples = 64;
+
+    cv::RNG rng(0);
+
+    // Pixel values for a few faces (one row each):
+    cv::Mat1f values(samples, features);
+    rng.fill(values, cv::RNG::UNIFORM, 0.f, 256.f);
+
+    int status = 0;
+    for (const bool do_npd : { false, true })
+    {
+        std::cout << (do_npd ? "npd" : "difference") << std::endl;
+        for (int depth = 2; depth <= 5; depth++)
+        {
+            std::vector<regression_tree> forest(trees);
+            for (auto& tree : forest)
+            {
+                for (int k = 0; k < (1 << depth) - 1; k++)
+                {
+                    const auto idx1 = static_cast<unsigned short>(rng.uniform(0, features));
+                    const auto idx2 = static_cast<unsigned short>(rng.uniform(0, features));
+                    tree.splits.emplace_back(idx1, idx2, do_npd ? rng.uniform(-0.5f, 0.5f) : rng.uniform(-64.f, 64.f));
+                }
+            }
+
+            const quick_scorer scorer(forest);
+
+            std::vector<unsigned long> traversal(trees * samples), scored(trees * samples);
+            std::vector<uint64_t> bits;
+
+            auto measure = [&](const std::function<void(int)>& stage) {
+                std::vector<double> elapsed;
+                for (int i = 0; i < iterations; i++)
+                {
+                    const int sample = i % samples;
+                    auto tic = std::chrono::high_resolution_clock::now();
+                    stage(sample);
+                    elapsed.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count());
+                }
+                return median(elapsed) * 1e6;
+            };
+
+            const double tTraversal = measure([&](int sample) {
+                const float* x = values.ptr<float>(sample);
+                for (int t = 0; t < trees; t++)
+                {
+                    traversal[sample * trees + t] = forest[t].leaf(x, 1, do_npd);
+                }
+            });
+
+            const double tScorer = measure([&](int sample) {
+                scorer(values.ptr<float>(sample), 1, do_npd, bits);
+                for (int t = 0; t < trees; t++)
+                {
+                    scored[sample * trees + t] = quick_scorer::exit_leaf(bits[t]);
+                }
+            });
+
+            if (traversal != scored)
+            {
+                std::cerr << "depth " << depth << ": quick_scorer leaves differ from tree traversal" << std::endl;
+                status = 1;
+            }
+
+            std::cout << "  depth: " << depth << std::fixed << std::setprecision(2)
+                      << "  traversal: " << std::setw(8) << tTraversal << " us/stage"
+                      << "  quick_scorer: " << std::setw(8) << tScorer << " us/stage"
+                      << "  speedup: " << std::setw(5) << (tTraversal / tScorer) << std::endl;
+        }
+    }
+
+    return status;
+}
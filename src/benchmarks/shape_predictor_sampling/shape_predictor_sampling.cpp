@@ -0,0 +1,110 @@
+/*! -*-c++-*-
+  @file   shape_predictor_sampling.cpp
+  @brief  Benchmark shape_predictor feature pixel sampling (see ml/shape_predictor_sampling.h).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_shape_predictor_sampling [iterations]
+
+  The pose indexed features of one cascade stage are sampled from a random
+  face crop for a range of feature pool sizes, w/ nearest and bilinear
+  sampling, using both the scalar loop and the vectorized path.  The time per
+  stage is reported in microseconds (median of the iterations), and the
+  vectorized output is checked against the scalar output.
+
+*/
+
+#include "drishti/ml/shape_predictor.h"
+#include "drishti/ml/shape_predictor_sampling.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using drishti::ml::impl::feature_pixel_sampler;
+
+static double median(std::vector<double> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 1000;
+    const int landmarks = 68;
+
+    cv::RNG rng(0);
+
+    cv::Mat1b crop(256, 256);
+    rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+    const dlib::rectangle rect(16, 16, 240, 240);
+
+    // Anchor (landmark) locations + deltas in the normalized shape space, and the shape similarity transform:
+    std::vector<float> shape(landmarks * 2);
+    rng.fill(shape, cv::RNG::UNIFORM, 0.1f, 0.9f);
+    const float tform[4] = { 1.05f, -0.1f, 0.1f, 1.05f };
+
+    std::cout << "cv::SIMD128: " << feature_pixel_sampler::has_simd() << std::endl;
+
+    int status = 0;
+    for (const bool bilinear : { false, true })
+    {
+        const feature_pixel_sampler sampler(crop, rect, bilinear);
+
+        std::cout << (bilinear ? "bilinear" : "nearest") << std::endl;
+        for (const int features : { 128, 256, 512, 1024, 2048 })
+        {
+            std::vector<float> x(features), y(features), dx(features), dy(features);
+            for (int i = 0; i < features; i++)
+            {
+                const int anchor = rng.uniform(0, landmarks);
+                x[i] = shape[anchor * 2 + 0];
+                y[i] = shape[anchor * 2 + 1];
+                dx[i] = rng.uniform(-0.1f, 0.1f);
+                dy[i] = rng.uniform(-0.1f, 0.1f);
+            }
+
+            std::vector<float> scalar(features), simd(features);
+            auto measure = [&](void (feature_pixel_sampler::*sample)(int, const float*, const float*, const float*, const float*, const float*, float*) const, std::vector<float>& values) {
+                std::vector<double> elapsed;
+                (sampler.*sample)(features, x.data(), y.data(), dx.data(), dy.data(), tform, values.data()); // warm up
+                for (int i = 0; i < iterations; i++)
+                {
+                    auto tic = std::chrono::high_resolution_clock::now();
+                    (sampler.*sample)(features, x.data(), y.data(), dx.data(), dy.data(), tform, values.data());
+                    elapsed.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count());
+                }
+                return median(elapsed) * 1e6;
+            };
+
+            const double tScalar = measure(&feature_pixel_sampler::sample_scalar, scalar);
+            const double tSimd = measure(&feature_pixel_sampler::sample_simd, simd);
+
+            // Single vs double precision can only change rounding ties (nearest) or the last bits (bilinear):
+            int mismatches = 0;
+            for (int i = 0; i < features; i++)
+            {
+                mismatches += (std::abs(scalar[i] - simd[i]) > (bilinear ? 0.05f : 0.f));
+            }
+            if (mismatches > features / 100)
+            {
+                std::cerr << "features " << features << ": " << mismatches << " vectorized samples differ from scalar" << std::endl;
+                status = 1;
+            }
+
+            std::cout << "  features: " << std::setw(4) << features << std::fixed << std::setprecision(2)
+                      << "  scalar: " << std::setw(7) << tScalar << " us/stage"
+                      << "  simd: " << std::setw(7) << tSimd << " us/stage"
+                      << "  speedup: " << std::setw(5) << (tScalar / tSimd) << std::endl;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,133 @@
+/*! -*-c++-*-
+  @file   xgboost_forest.cpp
+  @brief  Benchmark CPR stage regression: XGBooster prediction vs. ml::RegressionForest.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_xgboost_forest [iterations]
+
+  One CPR like stage (5 regressors of 128 depth 5 trees over 256 pixel
+  difference features) is trained on random data, and the stage is
+  evaluated for random feature vectors w/ one XGBooster prediction per
+  regressor (a DMatrix is built per call) and w/ a single pass of the
+  compiled RegressionForest.  The time per stage is reported in microseconds
+  (median of the iterations), and the predictions are checked for equality
+  (up to the float summation order).  Requires a full (non min size) build for
+  training.
+
+*/
+
+#include "drishti/ml/XGBooster.h"
+#include "drishti/ml/RegressionForest.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+static double median(std::vector<double> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 200;
+    const int outputs = 5, samples = 1024, features = 256, queries = 64;
+
+    cv::RNG rng(0);
+
+    auto randomFeatures = [&](std::vector<float>& x) {
+        for (auto& value : x)
+        {
+            value = float(rng.uniform(-255, 256)) / 255.f; // normalized pixel difference
+        }
+    };
+
+    MatrixType<float> X(samples, std::vector<float>(features));
+    for (auto& x : X)
+    {
+        randomFeatures(x);
+    }
+
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 128;
+    recipe.maxDepth = 5;
+
+    std::vector<std::shared_ptr<drishti::ml::XGBooster>> boosters;
+    drishti::ml::RegressionForest forest;
+    for (int k = 0; k < outputs; k++)
+    {
+        std::vector<float> y(samples);
+        for (int i = 0; i < samples; i++)
+        {
+            y[i] = (X[i][k] - X[i][k + outputs]) + rng.uniform(-0.1f, 0.1f);
+        }
+
+        boosters.push_back(std::make_shared<drishti::ml::XGBooster>(recipe));
+        boosters.back()->train(X, y);
+        if (forest.add(*boosters.back()) != k)
+        {
+            std::cerr << "RegressionForest doesn't match XGBooster output " << k << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<float>> Q(queries, std::vector<float>(features));
+    for (auto& q : Q)
+    {
+        randomFeatures(q);
+    }
+
+    std::vector<float> reference(queries * outputs), compiled(queries * outputs);
+
+    auto measure = [&](const std::function<void(int)>& stage) {
+        std::vector<double> elapsed;
+        for (int i = 0; i < iterations; i++)
+        {
+            const int query = i % queries;
+            auto tic = std::chrono::high_resolution_clock::now();
+            stage(query);
+            elapsed.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count());
+        }
+        return median(elapsed) * 1e6;
+    };
+
+    const double tBooster = measure([&](int query) {
+        for (int k = 0; k < outputs; k++)
+        {
+            reference[query * outputs + k] = (*boosters[k])(Q[query]);
+        }
+    });
+
+    const double tForest = measure([&](int query) {
+        forest(Q[query].data(), &compiled[query * outputs]);
+    });
+
+    int status = 0;
+    for (std::size_t i = 0; i < reference.size(); i++)
+    {
+        if (std::abs(reference[i] - compiled[i]) > 1e-4f)
+        {
+            std::cerr << "RegressionForest prediction " << compiled[i] << " differs from XGBooster " << reference[i] << std::endl;
+            status = 1;
+            break;
+        }
+    }
+
+    std::cout << "trees: " << forest.trees() << std::fixed << std::setprecision(2)
+              << "  XGBooster: " << std::setw(8) << tBooster << " us/stage"
+              << "  RegressionForest: " << std::setw(8) << tForest << " us/stage"
+              << "  speedup: " << std::setw(6) << (tBooster / tForest) << std::endl;
+
+    return status;
+}
@@ -13,6 +13,7 @@
 #include "drishti/acf/ACFIO.h"
 
 #include "drishti/core/IndentingOStreamBuffer.h"
+#include "drishti/core/Parallel.h"
 
 #include <iomanip>
 
@@ -114,7 +115,7 @@ cv::Mat cvt8UC3To32FC3(const cv::Mat& I)
     return If;
 }
 
-float Detector::evaluate(const cv::Mat& I) const
+float Detector::evaluate(const cv::Mat& I, std::vector<float>* trace) const
 {
     cv::Mat It = m_isTranspose ? I : I.t();
     cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
@@ -123,14 +124,66 @@ float Detector::evaluate(const cv::Mat& I) const
     computeChannels(Itf, Ip);
 
     auto& pPyramid = *(opts.pPyramid);
-    return evaluate(Ip, *(pPyramid.pChns->shrink), *(opts.modelDsPad), *(opts.stride));
+    return evaluate(Ip, *(pPyramid.pChns->shrink), *(opts.modelDsPad), *(opts.stride), trace);
+}
+
+const std::shared_ptr<PyramidWorkspace>& Detector::getWorkspace()
+{
+    if (!m_workspace)
+    {
+        m_workspace = std::make_shared<PyramidWorkspace>();
+    }
+    return m_workspace;
+}
+
+// Transpose and convert the input to planar 32F (or 8U for the fixed point pipeline), reusing the
+// workspace buffers if provided:
+void Detector::prepareInput(const cv::Mat& I, MatP& Ip, PyramidWorkspace* workspace) const
+{
+    const int depth = m_doFixedPoint ? CV_8U : CV_32F;
+    const double scale = m_doFixedPoint ? 255.0 : (1.0 / 255.0);
+    if (!workspace)
+    {
+        cv::Mat It = m_isTranspose ? I : I.t(), Itc = It;
+        if (It.depth() != depth)
+        {
+            It.convertTo(Itc, CV_MAKETYPE(depth, It.channels()), scale);
+        }
+        Ip = MatP(Itc);
+        return;
+    }
+
+    cv::Mat It = I;
+    if (!m_isTranspose)
+    {
+        cv::transpose(I, workspace->transposed);
+        It = workspace->transposed;
+    }
+    if (It.depth() != depth)
+    {
+        It.convertTo(workspace->converted, CV_MAKETYPE(depth, It.channels()), scale);
+        It = workspace->converted;
+    }
+
+    if (It.channels() == 1)
+    {
+        Ip = MatP(It);
+    }
+    else
+    {
+        workspace->input.create(It.size(), depth, It.channels());
+        for (int i = 0; i < It.channels(); i++)
+        {
+            cv::extractChannel(It, workspace->input[i], i);
+        }
+        Ip = workspace->input;
+    }
 }
 
 int Detector::operator()(const cv::Mat& I, std::vector<cv::Rect>& objects, std::vector<double>* scores)
 {
-    cv::Mat It = m_isTranspose ? I : I.t();
-    cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
-    MatP Ip(Itf);
+    MatP Ip;
+    prepareInput(I, Ip, getWorkspace().get());
     return (*this)(Ip, objects, scores);
 }
 
@@ -138,24 +191,23 @@ int Detector::operator()(const cv::Mat& I, std::vector<cv::Rect>& objects, std::
  * Compute pyramid from input image
  */
 
-void Detector::computePyramid(const cv::Mat& I, Pyramid& P)
+void Detector::computePyramid(const cv::Mat& I, Pyramid& P, PyramidWorkspace* workspace)
 {
-    cv::Mat It = m_isTranspose ? I : I.t();
-    cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
-    MatP Ip(Itf);
-    computePyramid(Ip, P);
+    MatP Ip;
+    prepareInput(I, Ip, workspace);
+    computePyramid(Ip, P, workspace);
 }
 
-void Detector::computePyramid(const MatP& Ip, Pyramid& P)
+void Detector::computePyramid(const MatP& Ip, Pyramid& P, PyramidWorkspace* workspace)
 {
-    CV_Assert(Ip[0].depth() == CV_32F);
+    CV_Assert(m_doFixedPoint ? (Ip[0].depth() == CV_8U || Ip[0].depth() == CV_16U) : (Ip[0].depth() == CV_32F));
 
     auto& pPyramid = *(opts.pPyramid);
     auto pad = *(pPyramid.pad);
     auto modelDsPad = *(opts.modelDsPad);
     auto modelDs = *(opts.modelDs);
 
-    chnsPyramid(Ip, &opts.pPyramid.get(), P, true);
+    chnsPyramid(Ip, &opts.pPyramid.get(), P, true, {}, workspace);
 }
 
 /*
@@ -245,9 +297,9 @@ void Detector::computeChannels(const MatP& Ip, MatP& Ip2, MatLoggerType pLogger)
 
 int Detector::operator()(const MatP& IpTranspose, std::vector<cv::Rect>& objects, std::vector<double>* scores)
 {
-    // Create features:
+    // Create features (the pyramid is local, so the planes can come from the workspace):
     Pyramid P;
-    chnsPyramid(IpTranspose, &opts.pPyramid.get(), P, true);
+    chnsPyramid(IpTranspose, &opts.pPyramid.get(), P, true, {}, getWorkspace().get());
 
     if (m_logger)
     {
@@ -269,6 +321,83 @@ int Detector::operator()(const Pyramid& P, std::vector<cv::Rect>& objects, std::
 {
     auto& pPyramid = *(opts.pPyramid);
     auto shrink = *(pPyramid.pChns->shrink);
+    auto modelDsPad = *(opts.modelDsPad);
+
+    std::vector<DetectionVec> levels;
+    if (m_doParallelScales)
+    {
+        acfDetect(P, shrink, modelDsPad, *(opts.stride), *(opts.cascThr), levels);
+    }
+    else
+    {
+        levels.resize(P.nScales);
+        for (int i = 0; i < P.nScales; i++)
+        {
+            // ROI fields indicates row major storage, else column major:
+            if (P.rois.size() > i)
+            {
+                acfDetect1(P.data[i][0], P.rois[i], shrink, modelDsPad, *(opts.stride), *(opts.cascThr), levels[i]);
+            }
+            else
+            {
+                acfDetect1(P.data[i][0], {}, shrink, modelDsPad, *(opts.stride), *(opts.cascThr), levels[i]);
+            }
+        }
+    }
+
+    collectDetections(P, levels, objects, scores);
+    return 0;
+}
+
+int Detector::operator()(const std::vector<cv::Mat>& images, std::vector<RectVec>& objects, std::vector<RealVec>* scores)
+{
+    auto& pPyramid = *(opts.pPyramid);
+    auto shrink = *(pPyramid.pChns->shrink);
+    auto modelDsPad = *(opts.modelDsPad);
+
+    // Each pyramid needs its own workspace, since they are computed concurrently:
+    while (m_batchWorkspaces.size() < images.size())
+    {
+        m_batchWorkspaces.push_back(std::make_shared<PyramidWorkspace>());
+    }
+
+    std::vector<Pyramid> P(images.size());
+    core::ParallelHomogeneousLambda harness = [&](int i) {
+        if (!images[i].empty())
+        {
+            computePyramid(images[i], P[i], m_batchWorkspaces[i].get());
+        }
+    };
+    cv::parallel_for_({ 0, int(images.size()) }, harness);
+
+    std::vector<const Pyramid*> pyramids(P.size());
+    for (std::size_t i = 0; i < P.size(); i++)
+    {
+        pyramids[i] = &P[i];
+    }
+
+    std::vector<std::vector<DetectionVec>> levels;
+    acfDetect(pyramids, shrink, modelDsPad, *(opts.stride), *(opts.cascThr), levels);
+
+    objects.clear();
+    objects.resize(images.size());
+    if (scores)
+    {
+        scores->clear();
+        scores->resize(images.size());
+    }
+    for (std::size_t i = 0; i < images.size(); i++)
+    {
+        collectDetections(P[i], levels[i], objects[i], scores ? &(*scores)[i] : nullptr);
+    }
+
+    return 0;
+}
+
+// Map the per level windows to input coordinates w/ optional NMS:
+void Detector::collectDetections(const Pyramid& P, std::vector<DetectionVec>& levels, RectVec& objects, RealVec* scores)
+{
+    auto& pPyramid = *(opts.pPyramid);
     auto pad = *(pPyramid.pad);
     auto modelDsPad = *(opts.modelDsPad);
     auto modelDs = *(opts.modelDs);
@@ -277,17 +406,7 @@ int Detector::operator()(const Pyramid& P, std::vector<cv::Rect>& objects, std::
     std::vector<Detection> bbs;
     for (int i = 0; i < P.nScales; i++)
     {
-        DetectionVec ds;
-
-        // ROI fields indicates row major storage, else column major:
-        if (P.rois.size() > i)
-        {
-            acfDetect1(P.data[i][0], P.rois[i], shrink, modelDsPad, *(opts.stride), *(opts.cascThr), ds);
-        }
-        else
-        {
-            acfDetect1(P.data[i][0], {}, shrink, modelDsPad, *(opts.stride), *(opts.cascThr), ds);
-        }
+        auto& ds = levels[i];
 
         // Scale up the detections
         for (auto& bb : ds)
@@ -339,8 +458,6 @@ int Detector::operator()(const Pyramid& P, std::vector<cv::Rect>& objects, std::
             }
         }
     }
-
-    return 0;
 }
 
 // (((((((((((((((((((( ostream ))))))))))))))))))))
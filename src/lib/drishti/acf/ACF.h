@@ -20,6 +20,7 @@
 #include "drishti/acf/drishti_acf.h"
 #include "drishti/acf/ACFField.h"
 #include "drishti/acf/MatP.h"
+#include "drishti/acf/PyramidWorkspace.h"
 #include "drishti/core/IndentingOStreamBuffer.h"
 #include "drishti/core/Logger.h"
 
@@ -290,6 +291,35 @@ public:
         cv::Mat thrsU8; // prescaled threshold (x255) for uint8_t input
         const cv::Mat& getScaledThresholds(int type) const;
 
+        // Interleaved node storage used for detection (see pack()).  Each tree is
+        // stored in a cache line aligned block of nTreeNodes nodes, indexed like
+        // the fids, thrs and hs tables above.
+        struct Node
+        {
+            uint32_t fid; // feature id (split nodes only)
+            float value;  // split threshold or leaf value
+        };
+
+        struct Nodes
+        {
+            cv::Mat data; // 64 byte aligned view of the Node array (shared on copy)
+            int nTreeNodes = 0;
+
+            const Node* ptr() const { return data.empty() ? nullptr : reinterpret_cast<const Node*>(data.ptr()); }
+        };
+
+        Nodes nodes;   // float thresholds
+        Nodes nodesU8; // prescaled thresholds for uint8_t input
+
+        // Build the interleaved tables from fids, thrs, thrsU8 and hs (call after any update):
+        void pack();
+        const Nodes& getPackedNodes(int type) const;
+
+        // Soft cascade rejection trace [1 x nWeak] (see acf-calibrate).  A window is rejected
+        // at tree t when the partial score falls below rejection[t].  If empty, the constant
+        // cascThr is used at every stage.
+        std::vector<float> rejection;
+
         template <class Archive>
         void serialize(Archive& ar, const uint32_t version);
     };
@@ -325,6 +355,11 @@ public:
 
     static int chnsCompute(const MatP& I, const Options::Pyramid::Chns& pChns, Channels& chns, bool isInit = false, MatLoggerType pLogger = {});
 
+    // Fixed point chnsCompute() for uint8_t RGB (or Q14 uint16_t, see rgbConvertFixed()) input
+    // w/ uint8_t output channels scaled by 255, i.e., the Classifier::thrsU8 format.  Supports
+    // the luv and orig color spaces and hard spatial binning w/o hog normalization.
+    static int chnsComputeFixed(const MatP& I, const Options::Pyramid::Chns& pChns, Channels& chns, MatLoggerType pLogger = {});
+
     // see chnsPyramid()
     // OUTPUTS
     //  pyramid      - output struct
@@ -379,8 +414,11 @@ public:
     }
 
     // (((( Compute pyramid ))))
-    void computePyramid(const cv::Mat& I, Pyramid& P);
-    void computePyramid(const MatP& Ip, Pyramid& P);
+    //
+    // If a workspace is provided, the pyramid planes are allocated from it and remain valid
+    // until the next call with the same workspace (see PyramidWorkspace).
+    void computePyramid(const cv::Mat& I, Pyramid& P, PyramidWorkspace* workspace = nullptr);
+    void computePyramid(const MatP& Ip, Pyramid& P, PyramidWorkspace* workspace = nullptr);
 
     static void computeChannels(const cv::Mat& I, MatP& Ip2, MatLoggerType pLogger = {});
     static void computeChannels(const MatP& Ip, MatP& Ip2, MatLoggerType pLlogger = {});
@@ -392,9 +430,15 @@ public:
     // Multiscale search:
     int operator()(const Pyramid& P, RectVec& objects, RealVec* scores = 0);
 
-    int chnsPyramid(const MatP& I, const Options::Pyramid* pPyramid, Pyramid& pyramid, bool isInit = false, MatLoggerType pLogger = {});
+    // Batched detection for images of any size: the pyramids are computed concurrently and all
+    // levels of all images are scanned in a single parallel pass w/ the shared (read only) trees,
+    // so one detector can serve a whole thread pool.  objects[i] matches operator()(images[i]).
+    int operator()(const std::vector<cv::Mat>& images, std::vector<RectVec>& objects, std::vector<RealVec>* scores = nullptr);
+
+    int chnsPyramid(const MatP& I, const Options::Pyramid* pPyramid, Pyramid& pyramid, bool isInit = false, MatLoggerType pLogger = {}, PyramidWorkspace* workspace = nullptr);
 
     static int rgbConvert(const MatP& I, MatP& J, const std::string& cs, bool useSingle, bool isLuv = false);
+    static int rgbConvertFixed(const MatP& I, MatP& J, const std::string& cs, bool isLuv = false); // uint8_t -> Q14 uint16_t
     static int getScales(int nPerOct, int nOctUp, const cv::Size& minDs, int shrink, const cv::Size& sz, RealVec& scales, Size2dVec& scaleshw);
     static int convTri(const MatP& I, MatP& J, double r = 1.0, int s = 1);
     static int gradientMag(const cv::Mat& I, cv::Mat& M, cv::Mat& O, int channel = 0, int normRad = 0, double normConst = 0.005, int full = 0, MatLoggerType logger = {});
@@ -423,11 +467,24 @@ public:
     using DetectionVec = std::vector<Detection>;
 
     void acfDetect1(const MatP& chns, const RectVec& rois, int shrink, cv::Size modelDsPad, int stride, double cascThr, DetectionVec& objects);
+
+    // Scan all pyramid levels in a single parallel pass w/ per level output:
+    void acfDetect(const Pyramid& P, int shrink, cv::Size modelDsPad, int stride, double cascThr, std::vector<DetectionVec>& objects);
+    void acfDetect(const std::vector<const Pyramid*>& P, int shrink, cv::Size modelDsPad, int stride, double cascThr, std::vector<std::vector<DetectionVec>>& objects);
     int bbNms(const DetectionVec& bbsIn, const Options::Nms& pNms, DetectionVec& bbs);
     int acfModify(const Detector::Modify& params);
 
-    float evaluate(const cv::Mat& I) const;
-    float evaluate(const MatP& I, int shrink, cv::Size modelDsPad, int stride) const;
+    // Evaluate a single window, w/ optional partial scores after each tree (no early rejection):
+    float evaluate(const cv::Mat& I, std::vector<float>* trace = nullptr) const;
+    float evaluate(const MatP& I, int shrink, cv::Size modelDsPad, int stride, std::vector<float>* trace = nullptr) const;
+
+    // Per tree rejection counts accumulated over all scanned windows:
+    struct CascadeStats
+    {
+        std::vector<std::uint64_t> rejected; // [1 x nWeak]
+        std::uint64_t accepted = 0;
+        std::uint64_t windows() const;
+    };
 
     // (((((((( I/O ))))))))
     int initializeOpts();
@@ -480,9 +537,65 @@ public:
         return m_isRowMajor;
     }
 
+    void setDoParallelScales(bool flag)
+    {
+        m_doParallelScales = flag;
+    }
+    bool getDoParallelScales() const
+    {
+        return m_doParallelScales;
+    }
+
+    // Compute the pyramid w/ the fixed point uint8_t channel pipeline (see chnsComputeFixed()):
+    void setDoFixedPoint(bool flag)
+    {
+        m_doFixedPoint = flag;
+    }
+    bool getDoFixedPoint() const
+    {
+        return m_doFixedPoint;
+    }
+
+    // Persistent pyramid buffers used for detection (created on demand, may be shared by the
+    // caller w/ a detector that isn't used concurrently):
+    void setWorkspace(const std::shared_ptr<PyramidWorkspace>& workspace)
+    {
+        m_workspace = workspace;
+    }
+    const std::shared_ptr<PyramidWorkspace>& getWorkspace();
+
+    void setDoSoftCascade(bool flag)
+    {
+        m_doSoftCascade = flag;
+    }
+    bool getDoSoftCascade() const
+    {
+        return m_doSoftCascade;
+    }
+
+    void setDoCascadeStats(bool flag)
+    {
+        m_doCascadeStats = flag;
+    }
+    bool getDoCascadeStats() const
+    {
+        return m_doCascadeStats;
+    }
+    const CascadeStats& getCascadeStats() const
+    {
+        return m_cascadeStats;
+    }
+    void resetCascadeStats()
+    {
+        m_cascadeStats = {};
+    }
+
 protected:
     using DetectionParamPtr = std::shared_ptr<DetectionParams>;
     DetectionParamPtr createDetector(const MatP& chns, const RectVec& rois, int shrink, cv::Size modelDsPad, int stride, DetectionSink* sink) const;
+    void prepareInput(const cv::Mat& I, MatP& Ip, PyramidWorkspace* workspace) const;
+    void setCascadeThresholds(DetectionParams& detector, double cascThr) const;
+    void collectDetections(const Pyramid& P, std::vector<DetectionVec>& levels, RectVec& objects, RealVec* scores);
 
     MatLoggerType m_logger;
 
@@ -494,6 +607,15 @@ protected:
     bool m_isLuv = false;
     bool m_isTranspose = false;
     bool m_isRowMajor = false;
+    bool m_doParallelScales = true; // scan all pyramid levels concurrently
+    bool m_doSoftCascade = true;     // use clf.rejection for early rejection when available
+    bool m_doCascadeStats = false;   // accumulate m_cascadeStats during detection
+    bool m_doFixedPoint = false;     // uint8_t input and channels (see chnsComputeFixed())
+
+    CascadeStats m_cascadeStats;
+
+    std::shared_ptr<PyramidWorkspace> m_workspace;
+    std::vector<std::shared_ptr<PyramidWorkspace>> m_batchWorkspaces; // one per image (see operator()(images))
 
     bool m_good = false; // serialization status
 };
@@ -57,6 +57,9 @@ int Detector::deserialize(ParserNodeDetector& detector_)
         clf.hs = clf.hs.t();
         clf.weights = clf.weights.t();
         clf.depth = clf.depth.t();
+
+        clf.thrsU8 = clf.thrs * 255.0; // precompute uint8_t thresholds
+        clf.pack();
     }
 
     {
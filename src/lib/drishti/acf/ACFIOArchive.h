@@ -94,9 +94,15 @@ void Detector::Classifier::serialize(Archive& ar, const std::uint32_t version)
     ar& losses;
     ar& treeDepth;
 
+    if (version >= 1)
+    {
+        ar& rejection; // soft cascade trace
+    }
+
     if (Archive::is_loading::value)
     {
         thrsU8 = thrs * 255.0; // precompute uint8_t thresholds
+        pack();
     }
 }
 
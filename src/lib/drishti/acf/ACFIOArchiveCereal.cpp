@@ -6,6 +6,7 @@
 #include <opencv2/opencv.hpp>
 
 CEREAL_CLASS_VERSION(drishti::acf::Detector, 1);
+CEREAL_CLASS_VERSION(drishti::acf::Detector::Classifier, 1);
 
 DRISHTI_ACF_NAMESPACE_BEGIN
 
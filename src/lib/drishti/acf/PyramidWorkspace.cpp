@@ -0,0 +1,60 @@
+/*! -*-c++-*-
+  @file   PyramidWorkspace.cpp
+  @brief  Persistent buffers for ACF channel pyramid computation.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/acf/PyramidWorkspace.h"
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+bool PyramidWorkspace::Geometry::matches(const cv::Size& size, int nPerOct, int nOctUp, int nApprox, const cv::Size& minDs, int shrink) const
+{
+    return (this->size == size) && (this->nPerOct == nPerOct) && (this->nOctUp == nOctUp) && (this->nApprox == nApprox) && (this->minDs == minDs) && (this->shrink == shrink);
+}
+
+void PyramidWorkspace::reset()
+{
+    if (m_required > m_capacity)
+    {
+        m_slab.create(1, static_cast<int>(m_required + kAlignment), CV_8UC1);
+        m_data = cv::alignPtr(m_slab.ptr(), kAlignment);
+        m_capacity = m_required;
+    }
+
+    m_offset = 0;
+    m_required = 0;
+    m_overflow = 0;
+}
+
+MatP PyramidWorkspace::allocate(const cv::Size& size, int depth, int channels)
+{
+    const std::size_t bytes = cv::alignSize(static_cast<std::size_t>(size.area()) * channels * CV_ELEM_SIZE(depth), kAlignment);
+    m_required += bytes;
+
+    MatP P;
+    if ((m_offset + bytes) <= m_capacity)
+    {
+        P.base() = cv::Mat(size.height * channels, size.width, depth, m_data + m_offset);
+        P.get().resize(channels);
+
+        cv::Rect roi({ 0, 0 }, size);
+        for (int i = 0; i < channels; i++, roi.y += roi.height)
+        {
+            P[i] = P.base()(roi);
+        }
+        m_offset += bytes;
+    }
+    else
+    {
+        P.create(size, depth, channels);
+        m_overflow++;
+    }
+
+    return P;
+}
+
+DRISHTI_ACF_NAMESPACE_END
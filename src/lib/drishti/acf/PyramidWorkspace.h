@@ -0,0 +1,86 @@
+/*! -*-c++-*-
+  @file   PyramidWorkspace.h
+  @brief  Persistent buffers for ACF channel pyramid computation.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_acf_PyramidWorkspace_h__
+#define __drishti_acf_PyramidWorkspace_h__
+
+#include "drishti/acf/drishti_acf.h"
+#include "drishti/acf/MatP.h"
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+// Buffers reused across calls to Detector::chnsPyramid() for a stream of images (i.e., video).
+//
+// Pyramid planes are carved from a single 64 byte aligned slab, which is reset at the start of
+// each frame.  The slab is sized from the previous frame, so once the input size is stable
+// (the second frame) the pyramid planes, input conversion and scale geometry need no heap
+// allocations.  Planes allocated from the slab are only valid until the next frame: a pyramid
+// computed with a workspace must be consumed (or copied) before the workspace is used again.
+//
+// A workspace is not thread safe, and should be used by one detector at a time.
+
+class PyramidWorkspace
+{
+public:
+    static const int kAlignment = 64;
+
+    // Scale geometry for a given input size and pyramid parameters (see Detector::getScales()):
+    struct Geometry
+    {
+        bool matches(const cv::Size& size, int nPerOct, int nOctUp, int nApprox, const cv::Size& minDs, int shrink) const;
+
+        // key
+        cv::Size size;
+        int nPerOct = 0;
+        int nOctUp = 0;
+        int nApprox = 0;
+        cv::Size minDs;
+        int shrink = 0;
+
+        std::vector<double> scales;
+        std::vector<cv::Size2d> scaleshw;
+        std::vector<int> isR; // 1 based indices of real scales
+        std::vector<int> isA; // 1 based indices of approximated scales
+        std::vector<int> isN; // nearest real scale for each scale
+    };
+
+    // Start a new frame, growing the slab to the previous high water mark if required:
+    void reset();
+
+    // Allocate planar storage from the slab (or the heap if the slab is exhausted):
+    MatP allocate(const cv::Size& size, int depth, int channels);
+
+    std::size_t capacity() const { return m_capacity; }
+    std::size_t getOverflowCount() const { return m_overflow; } // heap allocations since reset()
+
+    Geometry geometry; // most recent scale geometry
+
+    std::vector<MatP> scaleBuffers; // resampled images at real scales
+
+    // Input conversion buffers:
+    cv::Mat transposed;
+    cv::Mat converted;
+    MatP input;
+
+protected:
+    cv::Mat m_slab;
+    uint8_t* m_data = nullptr;
+    std::size_t m_capacity = 0;
+    std::size_t m_offset = 0;
+    std::size_t m_required = 0;
+    std::size_t m_overflow = 0;
+};
+
+DRISHTI_ACF_NAMESPACE_END
+
+#endif /* defined(__drishti_acf_PyramidWorkspace_h__) */
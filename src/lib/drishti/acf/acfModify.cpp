@@ -139,6 +139,7 @@ int Detector::acfModify(const Detector::Modify& pIn)
 
     // calibrate and rescale detector:
     clf.hs += (*params.cascCal);
+    clf.pack();
 
     if (dflt.rescale != 1.0)
     {
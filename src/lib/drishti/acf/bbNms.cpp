@@ -14,6 +14,10 @@
 #include <vector>
 #include <numeric>
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <queue>
+#include <utility>
 
 // function bbs = bbNms( bbs, varargin )
 //
@@ -43,12 +47,11 @@
 // w and w*2 are 1 unit apart), and the radii should be set accordingly.
 // radii may need to change depending on spatial and scale stride of bbs.
 //
-// Although efficient, nms is O(n^2). To speed things up for large n, can
-// divide data into two parts (according to x or y coordinate), run nms on
-// each part, combine and run nms on the result. If maxn is specified, will
-// split the data in half if n>maxn. Note that this is a heuristic and can
-// change the results of nms. Moreover, setting maxn too small will cause an
-// increase in overall performance time.
+// NOTE: All variants draw the neighbors of each bb from a uniform grid, so
+// they are sub quadratic for spatially dense (crowd) detections, and 'max'
+// and 'maxg' are identical to the pairwise loop of the original code.  The
+// original maxn heuristic (split the data in half if n>maxn, run nms on each
+// half, then on the combined result) isn't needed, so maxn is ignored.
 //
 // Finally, the bbs are optionally resized before performing nms. The
 // resizing is important as some detectors return bbs that are padded. For
@@ -65,7 +68,7 @@
 //  varargin   - additional params (struct or name/value pairs)
 //   .type       - ['max'] 'max', 'maxg', 'ms', 'cover', or 'none'
 //   .thr        - [-inf] threshold below which to discard (0 for 'ms')
-//   .maxn       - [inf] if n>maxn split and run recursively (see above)
+//   .maxn       - [inf] ignored (see above)
 //   .radii      - [.15 .15 1 1] supression radii ('ms' only, see above)
 //   .overlap    - [.5] area of overlap for bbs
 //   .ovrDnm     - ['union'] area of overlap denominator ('union' or 'min')
@@ -95,43 +98,132 @@ DRISHTI_ACF_NAMESPACE_BEGIN
 
 typedef Detector::Detection Detection;
 
-static std::vector<Detection> nmsMs(const std::vector<Detection>& bbsIn, double thr, const std::vector<double>& radii)
+// Uniform grid of axis aligned boxes [x0,x1] x [y0,y1] (closed) for sub quadratic neighbor
+// queries.  Each box is stored in every cell it overlaps, and a query reports each stored box
+// that intersects the query box exactly once (in the cell containing the top left corner of
+// the intersection).
+class BoxGrid
 {
-    return bbsIn;
-}
+public:
+    struct Box
+    {
+        double x0, y0, x1, y1;
+    };
 
-static std::vector<Detection> nmsCover(const std::vector<Detection>& bbsIn, double overlap, double ovrDnm)
-{
-    return bbsIn;
-}
+    BoxGrid(const std::vector<Box>& boxes)
+        : m_boxes(boxes)
+    {
+        if (boxes.empty())
+        {
+            return;
+        }
 
-// Note: This is very close to the opencv rectangle grouping code (need to compare the two)
-static std::vector<Detection> nmsMax(const std::vector<Detection>& bbsIn, double overlap, bool greedy, double ovrDnm)
-{
-    // for each i suppress all j st j>i and area-overlap>overlap:
+        // Cells are sized to the median box extent:
+        double x0 = boxes[0].x0, y0 = boxes[0].y0, x1 = boxes[0].x1, y1 = boxes[0].y1;
+        std::vector<double> sizes(boxes.size());
+        for (std::size_t i = 0; i < boxes.size(); i++)
+        {
+            x0 = std::min(x0, boxes[i].x0);
+            y0 = std::min(y0, boxes[i].y0);
+            x1 = std::max(x1, boxes[i].x1);
+            y1 = std::max(y1, boxes[i].y1);
+            sizes[i] = std::max(boxes[i].x1 - boxes[i].x0, boxes[i].y1 - boxes[i].y0);
+        }
+        std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
 
-    //std::cout << bbsIn.size() << std::endl;
+        m_x0 = x0;
+        m_y0 = y0;
+        m_cell = std::max(sizes[sizes.size() / 2], 1.0);
 
-    // i.e., ord = sort(bbsIn(:,5), 'descend');  bbs=bbsIn(ord,:)
-    auto ord = drishti::core::ordered(bbsIn, [](const Detection& a, const Detection& b) {
-        return a.score > b.score;
-    });
-    std::vector<Detector::Detection> bbs(bbsIn.size());
+        // Limit the number of cells to O(n) for sparse boxes:
+        const double maxCells = 4.0 * double(boxes.size()) + 16.0;
+        while (std::floor((x1 - x0) / m_cell + 1.0) * std::floor((y1 - y0) / m_cell + 1.0) > maxCells)
+        {
+            m_cell *= 2.0;
+        }
+        m_cols = int((x1 - x0) / m_cell) + 1;
+        m_rows = int((y1 - y0) / m_cell) + 1;
 
-    // Convert rois to area and tl + br corner (preserve matlab readability)
-    size_t n = bbs.size();
-    struct Roi
-    {
-        int as, xs, xe, ys, ye, kp;
-    };
-    std::vector<Roi> coords(n);
-    for (int i = 0; i < n; i++)
+        // Compressed cell lists: m_indices[m_offsets[c], m_offsets[c + 1]) are the boxes in cell c
+        m_offsets.assign(m_cols * m_rows + 1, 0);
+        for (int pass = 0; pass < 2; pass++)
+        {
+            if (pass)
+            {
+                std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
+                m_indices.resize(m_offsets.back());
+            }
+
+            for (int i = int(boxes.size()) - 1; i >= 0; i--)
+            {
+                for (int y = row(boxes[i].y0); y <= row(boxes[i].y1); y++)
+                {
+                    for (int x = col(boxes[i].x0); x <= col(boxes[i].x1); x++)
+                    {
+                        const int cell = y * m_cols + x;
+                        if (pass)
+                        {
+                            m_indices[--m_offsets[cell]] = i;
+                        }
+                        else
+                        {
+                            m_offsets[cell]++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename Visit>
+    void query(const Box& box, Visit&& visit) const
     {
-        bbs[i] = bbsIn[ord[i]];
+        if (m_boxes.empty())
+        {
+            return;
+        }
 
-        //std::cout << bbs[i].score << std::endl;
+        const int cx0 = col(box.x0), cx1 = col(box.x1), cy0 = row(box.y0), cy1 = row(box.y1);
+        for (int y = cy0; y <= cy1; y++)
+        {
+            for (int x = cx0; x <= cx1; x++)
+            {
+                const int cell = y * m_cols + x;
+                for (int k = m_offsets[cell]; k < m_offsets[cell + 1]; k++)
+                {
+                    const int j = m_indices[k];
+                    const Box& other = m_boxes[j];
+                    const double tx = std::max(box.x0, other.x0), ty = std::max(box.y0, other.y0);
+                    if ((tx <= std::min(box.x1, other.x1)) && (ty <= std::min(box.y1, other.y1)) && (col(tx) == x) && (row(ty) == y))
+                    {
+                        visit(j);
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+    int col(double x) const { return std::min(std::max(int(std::floor((x - m_x0) / m_cell)), 0), m_cols - 1); }
+    int row(double y) const { return std::min(std::max(int(std::floor((y - m_y0) / m_cell)), 0), m_rows - 1); }
+
+    const std::vector<Box>& m_boxes;
+    double m_x0 = 0.0, m_y0 = 0.0, m_cell = 1.0;
+    int m_cols = 0, m_rows = 0;
+    std::vector<int> m_offsets, m_indices;
+};
 
-        // Convenient storage of tl, br coordinates (per matlab code)
+// Convenient storage of area and tl + br corners (preserve matlab readability)
+struct Roi
+{
+    int as, xs, xe, ys, ye, kp;
+};
+
+static std::vector<Roi> getRois(const std::vector<Detection>& bbs)
+{
+    std::vector<Roi> coords(bbs.size());
+    for (std::size_t i = 0; i < bbs.size(); i++)
+    {
         coords[i].kp = 1;
         coords[i].as = bbs[i].roi.size().area();
         coords[i].xs = bbs[i].roi.x;
@@ -139,60 +231,309 @@ static std::vector<Detection> nmsMax(const std::vector<Detection>& bbsIn, double
         coords[i].xe = bbs[i].roi.br().x;
         coords[i].ye = bbs[i].roi.br().y;
     }
+    return coords;
+}
+
+static std::vector<BoxGrid::Box> getBoxes(const std::vector<Roi>& coords)
+{
+    std::vector<BoxGrid::Box> boxes(coords.size());
+    for (std::size_t i = 0; i < coords.size(); i++)
+    {
+        boxes[i] = { double(coords[i].xs), double(coords[i].ys), double(coords[i].xe), double(coords[i].ye) };
+    }
+    return boxes;
+}
+
+// Returns true if the area of overlap of two bbs is greater than overlap:
+static bool isOverlapping(const Roi& a, const Roi& b, double overlap, double ovrDnm)
+{
+    int iw = std::min(a.xe, b.xe) - std::max(a.xs, b.xs);
+    if (iw <= 0)
+    {
+        return false;
+    }
+
+    int ih = std::min(a.ye, b.ye) - std::max(a.ys, b.ys);
+    if (ih <= 0)
+    {
+        return false;
+    }
+
+    double o = (iw * ih), u = (ovrDnm) ? (a.as + b.as - o) : std::min(a.as, b.as);
+    o /= u;
 
+    return (o > overlap);
+}
+
+static std::vector<Detection> nmsMs(const std::vector<Detection>& bbsAll, double thr, const std::vector<double>& radii)
+{
+    // position = [x+w/2,y+h/2,log2(w),log2(h)], ws=weights-thr
+    // perform meanshift on positions with weights ws (variable bandwidth kernel)
+
+    CV_Assert(radii.size() == 4);
+
+    // bbs at the threshold have zero weight, so they are discarded along w/ those below it:
+    std::vector<Detection> bbsIn;
+    std::copy_if(bbsAll.begin(), bbsAll.end(), std::back_inserter(bbsIn), [&](const Detection& bb) {
+        return bb.score > thr;
+    });
+
+    const int n = int(bbsIn.size());
+    if (n <= 1)
+    {
+        return bbsIn;
+    }
+
+    // Neighbors beyond kSupport kernel radii in x or y (weight < exp(-kSupport^2)) are ignored:
+    const double kSupport = 3.0, kStopThr = 1e-2;
+    const int kMaxIterations = 100;
+
+    std::vector<cv::Vec4d> ps(n), hInv(n);
+    std::vector<double> ws(n);
+    std::vector<BoxGrid::Box> supports(n);
     for (int i = 0; i < n; i++)
     {
-        if (greedy && !coords[i].kp)
+        const cv::Rect& roi = bbsIn[i].roi;
+        CV_Assert(roi.width > 0 && roi.height > 0);
+
+        const double w = roi.width, h = roi.height;
+        ps[i] = cv::Vec4d(roi.x + w / 2.0, roi.y + h / 2.0, std::log2(w), std::log2(h));
+        hInv[i] = cv::Vec4d(1.0 / (w * radii[0]), 1.0 / (h * radii[1]), 1.0 / radii[2], 1.0 / radii[3]);
+        ws[i] = bbsIn[i].score - thr;
+
+        const double sx = kSupport * w * radii[0], sy = kSupport * h * radii[1];
+        supports[i] = { ps[i][0] - sx, ps[i][1] - sy, ps[i][0] + sx, ps[i][1] + sy };
+    }
+    BoxGrid grid(supports);
+
+    // Returns the kernel density at p, and the kernel weighted mean of the positions:
+    auto kernel = [&](const cv::Vec4d& p, cv::Vec4d& mean) {
+        double density = 0.0;
+        mean = cv::Vec4d::all(0.0);
+        grid.query({ p[0], p[1], p[0], p[1] }, [&](int j) {
+            const cv::Vec4d d = (ps[j] - p).mul(hInv[j]);
+            const double wj = ws[j] * std::exp(-d.dot(d));
+            mean += ps[j] * wj;
+            density += wj;
+        });
+        if (density > 0.0)
         {
-            continue;
+            mean *= (1.0 / density);
         }
+        return density;
+    };
 
-        for (int j = i + 1; j < n; j++)
+    // find modes starting from each elt, then merge nodes that are same
+    std::vector<cv::Vec4d> modes(n);
+    std::vector<double> density(n, 0.0);
+    for (int i = 0; i < n; i++)
+    {
+        cv::Vec4d p = ps[i], p1;
+        for (int iter = 0; iter < kMaxIterations; iter++)
         {
-            if (coords[j].kp == 0)
+            density[i] = kernel(p, p1);
+            if (density[i] <= 0.0)
             {
-                continue;
+                break;
             }
 
-            int iw = std::min(coords[i].xe, coords[j].xe) - std::max(coords[i].xs, coords[j].xs);
-            if (iw <= 0)
+            const double diff = cv::norm(p1 - p, cv::NORM_L1) / 4.0;
+            p = p1;
+            if (diff < kStopThr)
             {
-                continue;
+                break;
             }
+        }
+        modes[i] = p;
+    }
+
+    // Merge modes (in order of decreasing density) within one kernel radius of a stronger mode:
+    std::vector<cv::Vec4d> modeHInv(n);
+    std::vector<BoxGrid::Box> modeSupports(n);
+    for (int i = 0; i < n; i++)
+    {
+        const double w = std::exp2(modes[i][2]) * radii[0], h = std::exp2(modes[i][3]) * radii[1];
+        modeHInv[i] = cv::Vec4d(1.0 / w, 1.0 / h, 1.0 / radii[2], 1.0 / radii[3]);
+        modeSupports[i] = { modes[i][0] - w, modes[i][1] - h, modes[i][0] + w, modes[i][1] + h };
+    }
+    BoxGrid modeGrid(modeSupports);
+
+    auto ord = drishti::core::ordered(density, [](double a, double b) { return a > b; });
+
+    std::vector<int> accepted(n, 0);
+    std::vector<Detection> bbs;
+    for (auto i : ord)
+    {
+        if (density[i] <= 0.0)
+        {
+            break; // modes w/o support are discarded
+        }
+
+        bool merged = false;
+        modeGrid.query({ modes[i][0], modes[i][1], modes[i][0], modes[i][1] }, [&](int j) {
+            const cv::Vec4d d = (modes[i] - modes[j]).mul(modeHInv[j]);
+            merged |= (accepted[j] && (d.dot(d) < 1.0));
+        });
+
+        if (!merged)
+        {
+            // convert back to bbs format (sorted by weight)
+            accepted[i] = 1;
+            const double w = std::exp2(modes[i][2]), h = std::exp2(modes[i][3]);
+            const cv::Rect roi(cvRound(modes[i][0] - w / 2.0), cvRound(modes[i][1] - h / 2.0), cvRound(w), cvRound(h));
+            bbs.emplace_back(roi, density[i] + thr);
+        }
+    }
+
+    return bbs;
+}
+
+static std::vector<Detection> nmsCover(const std::vector<Detection>& bbsIn, double overlap, double ovrDnm)
+{
+    // construct neighbor lists: N(i) = { j : overlap(bb_i, bb_j) > overlap } (including i)
+    const int n = int(bbsIn.size());
+    const auto coords = getRois(bbsIn);
+    const auto boxes = getBoxes(coords);
+    BoxGrid grid(boxes);
 
-            int ih = std::min(coords[i].ye, coords[j].ye) - std::max(coords[i].ys, coords[j].ys);
-            if (ih <= 0)
+    std::vector<std::vector<int>> neighbors(n);
+    for (int i = 0; i < n; i++)
+    {
+        neighbors[i].push_back(i);
+        grid.query(boxes[i], [&](int j) {
+            if ((j != i) && isOverlapping(coords[i], coords[j], overlap, ovrDnm))
             {
-                continue;
+                neighbors[i].push_back(j);
             }
+        });
+        std::sort(neighbors[i].begin(), neighbors[i].end());
+    }
 
-            double o = (iw * ih), u = (ovrDnm) ? (coords[i].as + coords[j].as - o) : std::min(coords[i].as, coords[j].as);
-            o /= u;
+    // Set cover weights must be non-negative (shift negative detection scores):
+    double lowest = 0.0;
+    for (const auto& bb : bbsIn)
+    {
+        lowest = std::min(lowest, bb.score);
+    }
 
-            if (o > overlap)
+    std::vector<int> covered(n, 0);
+    auto gain = [&](int i, int& count) {
+        double sum = 0.0;
+        count = 0;
+        for (auto j : neighbors[i])
+        {
+            if (!covered[j])
             {
-                coords[j].kp = 0;
+                sum += (bbsIn[j].score - lowest);
+                count++;
+            }
+        }
+        return sum;
+    };
 
-                //std::cout << j << " " << o << std::endl;
+    // perform set cover operation (greedily choose next best), w/ lazy gain updates since the
+    // gain of a bb can only decrease as its neighbors are covered:
+    std::priority_queue<std::pair<double, int>> queue;
+    for (int i = 0; i < n; i++)
+    {
+        int count = 0;
+        queue.emplace(gain(i, count), i);
+    }
+
+    std::vector<Detection> bbs;
+    while (!queue.empty())
+    {
+        const auto top = queue.top();
+        queue.pop();
+
+        int count = 0;
+        const double value = gain(top.second, count);
+        if (count == 0)
+        {
+            continue;
+        }
+        if (value < top.first)
+        {
+            queue.emplace(value, top.second);
+            continue;
+        }
+
+        // The score of each bb is set to the sum of the scores of the bbs it covers:
+        Detection bb = bbsIn[top.second];
+        bb.score = 0.0;
+        for (auto j : neighbors[top.second])
+        {
+            if (!covered[j])
+            {
+                covered[j] = 1;
+                bb.score += bbsIn[j].score;
             }
         }
+        bbs.push_back(bb);
     }
 
-    // Delete the boxes with kp[i] < 0
-    auto pkp = coords.begin();
-    auto pbb = bbs.begin();
-    while (pkp != coords.end())
+    std::stable_sort(bbs.begin(), bbs.end(), [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+
+    return bbs;
+}
+
+// Note: This is very close to the opencv rectangle grouping code (need to compare the two)
+static std::vector<Detection> nmsMax(const std::vector<Detection>& bbsIn, double overlap, bool greedy, double ovrDnm)
+{
+    // for each i suppress all j st j>i and area-overlap>overlap:
+
+    // i.e., ord = sort(bbsIn(:,5), 'descend');  bbs=bbsIn(ord,:)
+    auto ord = drishti::core::ordered(bbsIn, [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+    std::vector<Detector::Detection> bbs(bbsIn.size());
+    for (std::size_t i = 0; i < bbs.size(); i++)
     {
-        pbb = (pkp++)->kp ? (pbb + 1) : bbs.erase(pbb);
+        bbs[i] = bbsIn[ord[i]];
+    }
+
+    size_t n = bbs.size();
+    auto coords = getRois(bbs);
+
+    // Only the bbs intersecting bbs[i] can be suppressed by it, so the candidate j are drawn from
+    // a uniform grid instead of the O(n^2) loop over all j>i (the result is identical):
+    const auto boxes = getBoxes(coords);
+    BoxGrid grid(boxes);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (greedy && !coords[i].kp)
+        {
+            continue;
+        }
+
+        grid.query(boxes[i], [&](int j) {
+            if ((j > i) && coords[j].kp && isOverlapping(coords[i], coords[j], overlap, ovrDnm))
+            {
+                coords[j].kp = 0;
+            }
+        });
+    }
+
+    // Delete the boxes with kp[i] == 0
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (coords[i].kp)
+        {
+            bbs[kept++] = bbs[i];
+        }
     }
+    bbs.resize(kept);
 
     return bbs;
 }
 
 static void nms1(const std::vector<Detection>& bbsIn, std::vector<Detection>& bbs, const Detector::Options::Nms& pNms, double ovrDnm)
 {
-    // TODO: The original code splits large vectors in two, runs nms on each half, then runs nms again on result
-    // We don't bother with that here:
+    // The original code splits large vectors in two (maxn), which isn't needed w/ the bucketed neighbors:
 
     switch (string_hash::hash((*pNms.type)))
     {
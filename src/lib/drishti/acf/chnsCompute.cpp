@@ -223,7 +223,11 @@ int Detector::chnsCompute(const MatP& IIn, const Options::Pyramid::Chns& pChnsIn
 
         if (I.channels())
         {
-            convTri(I, I, p.smooth, 1);
+            // Smooth into a new buffer: the input may be shared by the caller (e.g., other
+            // pyramid scales), and convTri() can't operate in place.
+            MatP J;
+            convTri(I, J, p.smooth, 1);
+            I = J;
 
             if (pLogger)
             {
@@ -0,0 +1,188 @@
+/*! -*-c++-*-
+  @file   chnsComputeFixed.cpp
+  @brief  Fixed point computation of Aggregated Channel Features for a single image.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  The channels match chnsCompute() w/ the default channel types, but each
+  stage is computed in Q14 uint16_t planes w/ the integer toolbox kernels
+  (see toolbox/fixed.hpp), and the output is uint8_t scaled by 255, which is
+  the input format of the Classifier::thrsU8 trees.  This is 4x less channel
+  memory (and bandwidth) than the float pyramid, so more pyramid levels fit in
+  cache for detection.
+
+*/
+
+#include "drishti/acf/ACF.h"
+#include "drishti/acf/toolbox/fixed.hpp"
+
+#include <sstream>
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+// Copy planes into contiguous storage (if needed), as the toolbox kernels use MatP::ptr():
+static MatP pack(const MatP& I)
+{
+    const cv::Mat& base = I.base();
+    if (I.empty() || (!base.empty() && base.isContinuous() && (base.data == I[0].data) && (base.rows == I.rows() * I.channels())))
+    {
+        return I;
+    }
+
+    MatP J(I.size(), I.depth(), I.channels());
+    for (int i = 0; i < I.channels(); i++)
+    {
+        I[i].copyTo(J[i]);
+    }
+    return J;
+}
+
+// Q14 uint16_t -> uint8_t at the output resolution (see addChn() in chnsCompute.cpp)
+static void addChnFixed(Detector::Channels& chns, const MatP& data, const std::string& name, const std::string& padWith, int h, int w)
+{
+    MatP chn(cv::Size(w, h), CV_8U, data.channels());
+    if (!data.empty())
+    {
+        fixed::resample(data.ptr<uint16_t>(), chn.ptr<uint8_t>(), data.cols(), w, data.rows(), h, data.channels(), 255.0 / fixed::kOne);
+    }
+
+    chns.nTypes++;
+    chns.data.push_back(chn);
+
+    Detector::Channels::Info info;
+    info.name = name;
+    info.nChns = data.channels();
+    info.padWith = padWith;
+    chns.info.emplace_back(info);
+}
+
+int Detector::rgbConvertFixed(const MatP& IIn, MatP& J, const std::string& cs, bool isLuv)
+{
+    CV_Assert((cs == "luv") || (cs == "orig"));
+    if (IIn.empty() || (IIn.depth() == CV_16U))
+    {
+        J = IIn; // already Q14 in the target color space
+        return 0;
+    }
+
+    CV_Assert(IIn.depth() == CV_8U);
+    const MatP I = pack(IIn);
+    const int n = I.size().area();
+
+    MatP K(I.size(), CV_16U, I.channels());
+    if ((cs == "luv") && !isLuv)
+    {
+        CV_Assert(I.channels() == 3);
+        fixed::rgb2luv(I[0].ptr<uint8_t>(), I[1].ptr<uint8_t>(), I[2].ptr<uint8_t>(), K.ptr<uint16_t>(), n);
+    }
+    else
+    {
+        for (int i = 0; i < I.channels(); i++)
+        {
+            fixed::normalize(I[i].ptr<uint8_t>(), K[i].ptr<uint16_t>(), n);
+        }
+    }
+    J = K;
+    return 0;
+}
+
+int Detector::chnsComputeFixed(const MatP& IIn, const Options::Pyramid::Chns& pChnsIn, Detector::Channels& chns, MatLoggerType pLogger)
+{
+    Options::Pyramid::Chns pChns = pChnsIn;
+    if (!pChnsIn.complete.has || (pChnsIn.complete.get() != 1))
+    {
+        Channels dfs; // default parameters only
+        chnsCompute({}, pChnsIn, dfs);
+        pChns = dfs.pChns;
+    }
+
+    const auto& pColor = pChns.pColor.get();
+    const auto& pGradMag = pChns.pGradMag.get();
+    const auto& pGradHist = pChns.pGradHist.get();
+    CV_Assert(IIn.channels() <= 3); // precomputed M and O channels are float (see chnsCompute())
+    CV_Assert(!pGradHist.enabled.get() || ((pGradHist.softBin.get() % 2 == 0) && !pGradHist.useHog.get()));
+
+    // Crop I so divisible by shrink and get target dimensions:
+    const int shrink = pChns.shrink.get();
+    int h = IIn.rows(), w = IIn.cols();
+    MatP I = IIn;
+    if ((h % shrink) || (w % shrink))
+    {
+        h -= h % shrink;
+        w -= w % shrink;
+        I = IIn(cv::Range(0, h), cv::Range(0, w));
+    }
+    I = pack(I);
+
+    h = h / shrink;
+    w = w / shrink;
+
+    if (I.channels())
+    {
+        // Compute color channels, smoothed into a new buffer since the input may be shared:
+        MatP J, K;
+        rgbConvertFixed(I, J, pColor.colorSpace.get());
+        convTri(J, K, pColor.smooth.get(), 1);
+        I = K;
+
+        if (pLogger)
+        {
+            for (int i = 0; i < I.channels(); i++)
+            {
+                std::stringstream ss;
+                ss << "LUV"[i % 3] << ":" << I[i].cols << "x" << I[i].rows;
+                pLogger(I[i], ss.str());
+            }
+        }
+    }
+    if (pColor.enabled.get())
+    {
+        addChnFixed(chns, I, "color channels", "replicate", h, w);
+    }
+
+    // Compute gradient magnitude channel:
+    const bool full = pGradMag.full.has && pGradMag.full.get();
+    cv::Mat M, O;
+    if (I.channels() && (pGradMag.enabled.get() || pGradHist.enabled.get()))
+    {
+        M.create(I.size(), CV_16U);
+        O.create(I.size(), CV_16U);
+        fixed::gradMag(I[pGradMag.colorChn.get()].ptr<uint16_t>(), M.ptr<uint16_t>(), O.ptr<uint16_t>(), I.cols(), I.rows(), full);
+        if (pGradMag.normRad.get() != 0)
+        {
+            MatP S;
+            convTri(MatP(M), S, pGradMag.normRad.get(), 1);
+            fixed::gradMagNorm(M.ptr<uint16_t>(), S.ptr<uint16_t>(), int(M.total()), float(pGradMag.normConst.get()));
+        }
+
+        if (pLogger)
+        {
+            pLogger(M, "Mnorm:" + std::to_string(M.cols) + "x" + std::to_string(M.rows));
+            pLogger(O, "O:" + std::to_string(O.cols) + "x" + std::to_string(O.rows));
+        }
+    }
+    if (pGradMag.enabled.get())
+    {
+        addChnFixed(chns, M.empty() ? MatP() : MatP(M), "gradient magnitude", {}, h, w);
+    }
+
+    // Compute gradient histogram channels:
+    if (pGradHist.enabled.get())
+    {
+        const int binSize = pGradHist.binSize.has ? pGradHist.binSize.get() : shrink;
+        const int nOrients = pGradHist.nOrients.get();
+        MatP H;
+        if (!M.empty())
+        {
+            H.create({ M.cols / binSize, M.rows / binSize }, CV_16U, nOrients);
+            fixed::gradHist(M.ptr<uint16_t>(), O.ptr<uint16_t>(), H.ptr<uint16_t>(), M.cols, M.rows, binSize, nOrients, pGradHist.softBin.get());
+        }
+        addChnFixed(chns, H, "gradient histogram", {}, h, w);
+    }
+    chns.pChns = pChns;
+
+    return 0;
+}
+
+DRISHTI_ACF_NAMESPACE_END
@@ -129,6 +129,8 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include <algorithm>
+
 DRISHTI_ACF_NAMESPACE_BEGIN
 
 template <typename T>
@@ -137,7 +139,17 @@ cv::Size round(const cv::Size_<T>& size)
     return cv::Size_<T>(core::round(size.width), core::round(size.height));
 }
 
-int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid& pyramid, bool isInit, MatLoggerType pLogger)
+// Return true if any plane of A references the storage of B:
+static bool isShared(const MatP& A, const MatP& B)
+{
+    const uint8_t* begin = B.ptr();
+    const uint8_t* end = begin + (B.base().total() * B.base().elemSize());
+    return (begin != nullptr) && std::any_of(A.begin(), A.end(), [&](const cv::Mat& plane) {
+        return (plane.data >= begin) && (plane.data < end);
+    });
+}
+
+int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid& pyramid, bool isInit, MatLoggerType pLogger, PyramidWorkspace* workspace)
 {
     // % get default parameters pPyramid
     //if(nargin==2), p=varargin{1}; else p=[]; end
@@ -226,7 +238,11 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
         }
     }
 
-    if (pI.channels())
+    if (pI.channels() && m_doFixedPoint)
+    {
+        rgbConvertFixed(pI, I, cs, m_isLuv);
+    }
+    else if (pI.channels())
     {
         rgbConvert(pI, I, cs, true, m_isLuv);
     }
@@ -236,40 +252,76 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
     auto& scales = pyramid.scales;
     auto& scaleshw = pyramid.scaleshw;
 
-    // Get scales at which to compute features and list of real/approx scales:
-    getScales(nPerOct, nOctUp, minDs, shrink, sz, scales, scaleshw);
-
-    int nScales = static_cast<int>(scales.size());
-    std::vector<int> isR, isA, isN(nScales, 0), *isRA[2] = { &isR, &isA };
-    for (int i = 0; i < nScales; i++)
+    // Scale geometry and resampled images are always cached, but the output planes are only
+    // allocated from the arena when the caller provides a workspace (see PyramidWorkspace):
+    PyramidWorkspace& ws = workspace ? *workspace : *getWorkspace();
+    if (workspace)
     {
-        isRA[(i % (nApprox + 1)) > 0]->push_back(i + 1);
+        ws.reset();
     }
 
-    std::vector<int> isH((isR.size() + 1), 0);
-    isH.back() = nScales;
-    for (int i = 0; i < std::max(int(isR.size()) - 1, 0); i++)
+    // Get scales at which to compute features and list of real/approx scales:
+    auto& geometry = ws.geometry;
+    if (!geometry.matches(sz, nPerOct, nOctUp, nApprox, minDs, shrink))
     {
-        isH[i + 1] = (isR[i] + isR[i + 1]) / 2;
-    }
+        geometry = {};
+        getScales(nPerOct, nOctUp, minDs, shrink, sz, geometry.scales, geometry.scaleshw);
 
-    for (int i = 0; i < isR.size(); i++)
-    {
-        for (int j = isH[i]; j < isH[i + 1]; j++)
+        int nScales = static_cast<int>(geometry.scales.size());
+        std::vector<int> &isR = geometry.isR, &isA = geometry.isA, &isN = geometry.isN, *isRA[2] = { &isR, &isA };
+        isN.assign(nScales, 0);
+        for (int i = 0; i < nScales; i++)
+        {
+            isRA[(i % (nApprox + 1)) > 0]->push_back(i + 1);
+        }
+
+        std::vector<int> isH((isR.size() + 1), 0);
+        isH.back() = nScales;
+        for (int i = 0; i < std::max(int(isR.size()) - 1, 0); i++)
+        {
+            isH[i + 1] = (isR[i] + isR[i + 1]) / 2;
+        }
+
+        for (int i = 0; i < isR.size(); i++)
         {
-            isN[j] = isR[i];
+            for (int j = isH[i]; j < isH[i + 1]; j++)
+            {
+                isN[j] = isR[i];
+            }
         }
+
+        geometry.size = sz;
+        geometry.nPerOct = nPerOct;
+        geometry.nOctUp = nOctUp;
+        geometry.nApprox = nApprox;
+        geometry.minDs = minDs;
+        geometry.shrink = shrink;
     }
 
+    scales = geometry.scales;
+    scaleshw = geometry.scaleshw;
+
+    const int nScales = static_cast<int>(scales.size());
+    const auto& isR = geometry.isR;
+    const auto& isA = geometry.isA;
+    const auto& isN = geometry.isN;
+
     // Compute image pyramid [real scales]
-    int nTypes = 0;
-    auto& data = pyramid.data;
-    for (const auto& i : isR)
+    //
+    // The resampled images are computed first, since each octave is resampled from the
+    // previous one.  These are stored in per scale buffers that are reused across frames.
+    const int nReal = static_cast<int>(isR.size());
+    auto& scaleBuffers = ws.scaleBuffers;
+    scaleBuffers.resize(nReal);
+
+    std::vector<MatP> I1s(nReal);
+    for (int k = 0; k < nReal; k++)
     {
+        const int i = isR[k];
         double s = scales[i - 1];
         cv::Size sz1 = round((cv::Size2d(sz) * s) / double(shrink)) * shrink;
 
-        MatP I1;
+        MatP& I1 = I1s[k];
         if (sz == sz1)
         {
             I1 = I;
@@ -277,7 +329,8 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
         else
         {
             // TODO: use imResampleMex to resave remap coefficients
-            imResample(I, I1, sz1, 1.0);
+            imResample(I, scaleBuffers[k], sz1, 1.0);
+            I1 = scaleBuffers[k];
         }
 
         if ((s == 0.5) && ((nApprox > 0) || (nPerOct == 1)))
@@ -290,9 +343,35 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
             I1.push_back(MO[0]);
             I1.push_back(MO[1]);
         }
+    }
 
-        Detector::Channels chns;
-        chnsCompute(I1, pChns, chns, false, pLogger);
+    // The channels at each real scale are independent (the logger is called serially):
+    std::vector<Detector::Channels> chnsR(nReal);
+    core::ParallelHomogeneousLambda harnessR = [&](int k) {
+        if (m_doFixedPoint)
+        {
+            chnsComputeFixed(I1s[k], pChns, chnsR[k], pLogger);
+        }
+        else
+        {
+            chnsCompute(I1s[k], pChns, chnsR[k], false, pLogger);
+        }
+    };
+    if (pLogger)
+    {
+        harnessR({ 0, nReal });
+    }
+    else
+    {
+        cv::parallel_for_({ 0, nReal }, harnessR);
+    }
+
+    int nTypes = 0;
+    auto& data = pyramid.data;
+    for (int k = 0; k < nReal; k++)
+    {
+        const int i = isR[k];
+        const auto& chns = chnsR[k];
         info = chns.info;
         if (i == isR.front()) // on first iteration allocate data
         {
@@ -304,6 +383,16 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
             }
         }
         std::copy(chns.data.begin(), chns.data.end(), data[i - 1].begin());
+
+        // Channels can reference the input (e.g., no smoothing), so don't reuse the buffer:
+        for (const auto& chn : chns.data)
+        {
+            if (isShared(chn, scaleBuffers[k]))
+            {
+                scaleBuffers[k] = MatP();
+                break;
+            }
+        }
     }
 
     // If lambdas not specified compute image specific lambdas:
@@ -340,6 +429,20 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
         }
     }
 
+    // Approximated scales are resampled into the arena (imResample() reuses the storage):
+    if (workspace && nTypes)
+    {
+        for (const auto& i : isA)
+        {
+            const auto& chns = data[isN[i - 1] - 1];
+            cv::Size sz1 = round(cv::Size2d(sz) * scales[i - 1] / double(shrink));
+            for (int j = 0; j < nTypes; j++)
+            {
+                data[i - 1][j] = ws.allocate(sz1, chns[j].depth(), chns[j].channels());
+            }
+        }
+    }
+
     core::ParallelHomogeneousLambda harness = [&](int j) {
         const int i = isA[j];
 
@@ -368,7 +471,17 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
                 int y = pad.height / shrink;
                 int x = pad.width / shrink;
                 // TODO: check if rows need to be contiguous
-                copyMakeBorder(data[i][j], data[i][j], y, y, x, x, cv::BORDER_REFLECT);
+                if (workspace)
+                {
+                    const auto& src = data[i][j];
+                    MatP dst = ws.allocate(src.size() + cv::Size(x * 2, y * 2), src.depth(), src.channels());
+                    copyMakeBorder(src, dst, y, y, x, x, cv::BORDER_REFLECT);
+                    data[i][j] = dst;
+                }
+                else
+                {
+                    copyMakeBorder(data[i][j], data[i][j], y, y, x, x, cv::BORDER_REFLECT);
+                }
             }
         }
     }
@@ -380,7 +493,29 @@ int Detector::chnsPyramid(const MatP& Iin, const Options::Pyramid* pIn, Pyramid&
         for (int i = 0; i < nScales; i++)
         {
             data[i].resize(1);
-            fuseChannels(data0[i].begin(), data0[i].end(), data[i][0]);
+            if (workspace)
+            {
+                // Copy the planes into contiguous arena storage (as in fuseChannels()):
+                int nChns = 0;
+                for (const auto& chns : data0[i])
+                {
+                    nChns += chns.channels();
+                }
+
+                MatP& dst = data[i][0];
+                dst = ws.allocate(data0[i][0].size(), data0[i][0].depth(), nChns);
+                for (int j = 0, k = 0; j < nTypes; j++)
+                {
+                    for (const auto& plane : data0[i][j])
+                    {
+                        plane.copyTo(dst[k++]);
+                    }
+                }
+            }
+            else
+            {
+                fuseChannels(data0[i].begin(), data0[i].end(), data[i][0]);
+            }
         }
     }
 
@@ -110,6 +110,7 @@
 
 #include "drishti/acf/drishti_acf.h"
 #include "drishti/acf/ACF.h"
+#include "drishti/acf/toolbox/fixed.hpp"
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
@@ -209,6 +210,22 @@ int Detector::convTri(const MatP& I, MatP& J, double r, int s)
         return 0;
     }
 
+    if (I.depth() == CV_8U || I.depth() == CV_16U)
+    {
+        // Channels of the fixed point pipeline (see toolbox/fixed.hpp), column major as above:
+        CV_Assert(s == 1);
+        J.create(I.size(), I.depth(), I.channels());
+        if (I.depth() == CV_8U)
+        {
+            fixed::convTri(I.ptr<uint8_t>(), J.ptr<uint8_t>(), I.cols(), I.rows(), I.channels(), float(r));
+        }
+        else
+        {
+            fixed::convTri(I.ptr<uint16_t>(), J.ptr<uint16_t>(), I.cols(), I.rows(), I.channels(), float(r));
+        }
+        return 0;
+    }
+
     int m = std::min(I.rows(), I.cols()), nomex = ((m < 4) || (2 * r + 1) >= m);
     if (nomex == 0)
     {
@@ -81,10 +81,11 @@
 
 #include "drishti/acf/ACF.h"
 #include "drishti/acf/drishti_acf.h"
+#include "drishti/core/Parallel.h"
 #include <opencv2/highgui/highgui.hpp>
 
 void gradQuantize(float* O, float* M, int* O0, int* O1, float* M0, float* M1, int nb, int n, float norm, int nOrients, bool full, bool interpolate);
-void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full);
+void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full, int x0, int x1);
 
 void gradHist(const cv::Mat& M, const cv::Mat& O, MatP& H, int bin, int nOrients, int softBin, bool full)
 {
@@ -98,7 +99,21 @@ void gradHist(const cv::Mat& M, const cv::Mat& O, MatP& H, int bin, int nOrients
     int h = M.rows;
     std::swap(w, h);
 
-    gradHist(m, o, H.ptr<float>(), h, w, bin, nOrients, softBin, full);
+    // Without spatial interpolation each histogram column is independent, so large images are
+    // split into row bands of whole bins (nested in the parallel pyramid scales):
+    const int wb = w / bin, bands = (softBin % 2 == 0) ? std::min(cv::getNumThreads(), w / 64) : 1;
+    if (bands > 1)
+    {
+        float* hp = H.ptr<float>();
+        drishti::core::ParallelLambdaRange harness = [&](const cv::Range& r) {
+            gradHist(m, o, hp, h, w, bin, nOrients, softBin, full, r.start * bin, r.end * bin);
+        };
+        cv::parallel_for_({ 0, wb }, harness, bands);
+    }
+    else
+    {
+        gradHist(m, o, H.ptr<float>(), h, w, bin, nOrients, softBin, full, 0, w);
+    }
 }
 
 DRISHTI_ACF_NAMESPACE_BEGIN
@@ -74,11 +74,12 @@
 //gradientMex('gradientMagNorm',M,S,normConst); % operates on M
 
 #include "drishti/acf/ACF.h"
+#include "drishti/core/Parallel.h"
 #include <opencv2/highgui/highgui.hpp>
 
 void grad1(float* I, float* Gx, float* Gy, int h, int w, int x);
 void grad2(float* I, float* Gx, float* Gy, int h, int w, int d);
-void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full);
+void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full, int x0, int x1);
 void gradMagNorm(float* M, float* S, int h, int w, float norm);
 
 void gradMag(const cv::Mat& I, cv::Mat& M, cv::Mat& O, int d, bool full)
@@ -88,7 +89,21 @@ void gradMag(const cv::Mat& I, cv::Mat& M, cv::Mat& O, int d, bool full)
     float* i = const_cast<float*>(I.ptr<float>());
     float* m = M.ptr<float>();
     float* o = O.ptr<float>();
-    gradMag(i, m, o, M.cols, M.rows, M.channels(), full);
+
+    // Storage is column major, so each row of M is a column in the toolbox code.  Large images
+    // are split into row bands (nested in the parallel pyramid scales):
+    const int w = M.rows, bands = std::min(cv::getNumThreads(), w / 64);
+    if (bands > 1)
+    {
+        drishti::core::ParallelLambdaRange harness = [&](const cv::Range& r) {
+            gradMag(i, m, o, M.cols, w, M.channels(), full, r.start, r.end);
+        };
+        cv::parallel_for_({ 0, w }, harness, bands);
+    }
+    else
+    {
+        gradMag(i, m, o, M.cols, w, M.channels(), full, 0, w);
+    }
 }
 
 void gradMagNorm(cv::Mat& M, const cv::Mat& S, float norm) // operates on M
@@ -16,9 +16,11 @@ sugar_files(DRISHTI_ACF_SRCS
   ACFIO.cpp # optional
   ACFIOArchiveCereal.cpp
   MatP.cpp
+  PyramidWorkspace.cpp
   acfModify.cpp
   bbNms.cpp
   chnsCompute.cpp
+  chnsComputeFixed.cpp
   chnsPyramid.cpp
   convTri.cpp
   gradientHist.cpp
@@ -28,11 +30,16 @@ sugar_files(DRISHTI_ACF_SRCS
   ### Toolbox sources ###
   #######################  
   toolbox/acfDetect1.cpp
+  toolbox/acfDetectAVX2.cpp
   toolbox/convConst.cpp
+  toolbox/fixed.cpp
   toolbox/gradientMex.cpp
   toolbox/imPadMex.cpp
   toolbox/imResampleMex.cpp
   toolbox/rgbConvertMex.cpp
+  toolbox/simd.cpp
+  toolbox/simdAVX2.cpp
+  toolbox/simdAVX512.cpp
   toolbox/wrappers.cpp
   )
 
@@ -43,10 +50,14 @@ sugar_files(DRISHTI_ACF_HDRS_PUBLIC
   ACFIOArchive.h
   ACFObject.h
   MatP.h
+  PyramidWorkspace.h
   drishti_acf.h
   #######################
   ### Toolbox headers ###
   #######################  
+  toolbox/fixed.hpp
+  toolbox/simd.hpp
+  toolbox/simdKernels.hpp
   toolbox/sse.hpp
   toolbox/wrappers.hpp
   )
@@ -70,4 +81,5 @@ endif()
 
 sugar_files(DRISHTI_ACF_UT
   ut/test-drishti-acf.cpp
+  ut/test-nms-reference.h
   )
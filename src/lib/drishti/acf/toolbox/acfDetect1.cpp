@@ -6,12 +6,13 @@
 *******************************************************************************/
 
 #include "drishti/acf/ACF.h"
+#include "drishti/acf/toolbox/simd.hpp"
 #include "drishti/core/Parallel.h"
 #include <opencv2/highgui/highgui.hpp>
 #include <vector>
 #include <cmath>
-#include <thread>
-#include <mutex>
+#include <algorithm>
+#include <numeric>
 
 using namespace std;
 
@@ -40,18 +41,14 @@ public:
     {
         hits.emplace_back(p, value);
     }
-    std::vector<std::pair<cv::Point, float>> hits;
-};
 
-class DetectionSinkLock : public DetectionSink
-{
-public:
-    virtual void add(const cv::Point& p, float value)
+    // Optional cascade statistics (enabled when rejected is non empty):
+    void reject(int stage)
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        DetectionSink::add(p, value);
+        rejected[stage]++;
     }
-    std::mutex mutex;
+    std::vector<std::pair<cv::Point, float>> hits;
+    std::vector<std::uint64_t> rejected;
 };
 
 class DetectionParams : public cv::ParallelLoopBody
@@ -64,20 +61,49 @@ public:
     int shrink;
     int rowStride;
     std::vector<uint32_t> cids;
-    const uint32* fids;
-    const float* hs = nullptr;
-    const float* thrs = nullptr;
+    const Detector::Classifier::Node* nodes = nullptr;
     int nTrees;
-    int nTreeNodes;
+    int nTreeNodes; // padded tree stride in nodes
     float cascThr;
+    std::vector<float> cascThrs; // per tree rejection thresholds
     const uint32_t* child = nullptr;
+    simd::WindowLanes lanes = nullptr; // evaluate simd::kWindowLanes windows at once (float only)
 
     MatP I;
     cv::Mat canvas;
 
+    // Set the final threshold and the early rejection threshold for each tree.  In a soft cascade
+    // the rejection trace replaces cascThr for early rejection, but not for the final decision.
+    void setCascadeThresholds(float thr, const std::vector<float>& trace = {})
+    {
+        cascThr = thr;
+        cascThrs.assign(nTrees, thr);
+        if (trace.size() == static_cast<std::size_t>(nTrees))
+        {
+            cascThrs = trace;
+        }
+    }
+
     virtual float evaluate(uint32_t row, uint32_t col) const = 0;
+
+    // Compute the partial sums after each tree w/ no early rejection:
+    virtual void trace(uint32_t row, uint32_t col, std::vector<float>& partials) const = 0;
+
+    // Scan all windows in columns [range.start, range.end) and add hits to sink:
+    virtual void scan(const cv::Range& range, DetectionSink* sink) const = 0;
 };
 
+// Window lanes are only available for float channels (see simd::getWindowLanes()):
+static void evaluateWindowLanes(simd::WindowLanes lanes, const simd::Cascade& cascade, const float* chns, const int* offsets, float* h, int* stages)
+{
+    lanes(cascade, chns, offsets, h, stages);
+}
+
+static void evaluateWindowLanes(simd::WindowLanes lanes, const simd::Cascade& cascade, const uint8_t* chns, const int* offsets, float* h, int* stages)
+{
+    CV_Assert(false);
+}
+
 template <class T, int kDepth>
 class ParallelDetectionBody : public DetectionParams
 {
@@ -89,22 +115,68 @@ public:
     }
 
     virtual void operator()(const cv::Range& range) const
+    {
+        scan(range, sink);
+    }
+
+    virtual void scan(const cv::Range& range, DetectionSink* output) const
     {
 #if DEBUG_SCANNING
         cv::imshow("I", I.base());
 #endif
-        for (int c = 0; c < size1.width; c += step1.x)
+        const bool doStats = !output->rejected.empty();
+
+        // Align the first column with the step grid so tiled scans match the full scan:
+        const int start = ((range.start + step1.x - 1) / step1.x) * step1.x;
+        const int end = std::min(range.end, size1.width);
+        const int nLanes = simd::kWindowLanes;
+        const simd::Cascade cascade = { nodes, cids.data(), nTrees, nTreeNodes, cascThr, cascThrs.data() };
+        for (int c = start; c < end; c += step1.x)
         {
-            for (int r = 0; r < size1.height; r += step1.y)
+            int r = 0;
+            if (lanes)
+            {
+                // Score runs of adjacent windows in a column together:
+                int offsets[simd::kWindowLanes];
+                int stages[simd::kWindowLanes];
+                float h[simd::kWindowLanes];
+                for (; (r + (nLanes - 1) * step1.y) < size1.height; r += nLanes * step1.y)
+                {
+                    for (int j = 0; j < nLanes; j++)
+                    {
+                        offsets[j] = ((r + j * step1.y) * stride / shrink) + (c * stride / shrink) * rowStride;
+                    }
+
+                    evaluateWindowLanes(lanes, cascade, chns, offsets, h, stages);
+
+                    for (int j = 0; j < nLanes; j++)
+                    {
+                        if (h[j] > cascThr)
+                        {
+                            output->add({ c, r + j * step1.y }, h[j]);
+                        }
+                        else if (doStats)
+                        {
+                            output->reject(stages[j]);
+                        }
+                    }
+                }
+            }
+
+            for (; r < size1.height; r += step1.y)
             {
-                int offset = (r * stride / shrink) + (c * stride / shrink) * rowStride;
-                float h = evaluate(chns, offset);
+                int offset = (r * stride / shrink) + (c * stride / shrink) * rowStride, stage = 0;
+                float h = evaluate(chns, offset, stage);
 #if DEBUG_SCANNING
                 drawScan(r, c, offset);
 #endif
                 if (h > cascThr)
                 {
-                    sink->add({ c, r }, h);
+                    output->add({ c, r }, h);
+                }
+                else if (doStats)
+                {
+                    output->reject(stage);
                 }
             }
         }
@@ -123,20 +195,38 @@ public:
 
     void getChild(const T* chns1, uint32 offset, uint32& k0, uint32& k) const
     {
-        int index = cids[fids[k]];
-        float ftr = chns1[index];
-        k = (ftr < thrs[k]) ? 1 : 2;
+        const auto& node = nodes[k];
+        float ftr = chns1[cids[node.fid]];
+        k = (ftr < node.value) ? 1 : 2;
         k0 = k += k0 * 2;
         k += offset;
     }
 
     float evaluate(uint32_t row, uint32_t col) const
     {
-        int offset = (row * stride / shrink) + (col * stride / shrink) * rowStride;
-        return evaluate(chns, offset);
+        int offset = (row * stride / shrink) + (col * stride / shrink) * rowStride, stage = 0;
+        return evaluate(chns, offset, stage);
     }
 
-    float evaluate(const T* chns1, uint32_t index) const
+    void trace(uint32_t row, uint32_t col, std::vector<float>& partials) const
+    {
+        int index = (row * stride / shrink) + (col * stride / shrink) * rowStride;
+        partials.resize(nTrees);
+
+        float h = 0.f;
+        for (int t = 0; t < nTrees; t++)
+        {
+            uint32 offset = t * nTreeNodes, k = offset, k0 = 0;
+            for (int i = 0; i < kDepth; i++)
+            {
+                getChild(chns + index, offset, k0, k);
+            }
+            partials[t] = (h += nodes[k].value);
+        }
+    }
+
+    // Return the score and the last tree evaluated (i.e., the rejection stage):
+    float evaluate(const T* chns1, uint32_t index, int& stage) const
     {
         float h = 0.f;
         for (int t = 0; t < nTrees; t++)
@@ -146,12 +236,14 @@ public:
             {
                 getChild(chns1 + index, offset, k0, k);
             }
-            h += hs[k];
-            if (h <= cascThr)
+            h += nodes[k].value;
+            if (h <= cascThrs[t])
             {
-                break;
+                stage = t;
+                return std::min(h, cascThr); // rejected windows can't exceed the final threshold
             }
         }
+        stage = nTrees - 1;
         return h;
     }
 
@@ -174,14 +266,112 @@ const cv::Mat& Detector::Classifier::getScaledThresholds(int type) const
     return thrs; // unused: for static analyzer
 }
 
-static std::shared_ptr<DetectionParams> allocDetector(const MatP& I, DetectionSink* sink)
+static Detector::Classifier::Nodes packNodes(const cv::Mat& fids, const cv::Mat& thrs, const cv::Mat& hs, int treeDepth)
+{
+    using Node = Detector::Classifier::Node;
+
+    // Trees are stored in rows (see transpose at load time), pad each one to a multiple of 64 bytes:
+    const int nTrees = fids.rows;
+    const int nTreeNodes = fids.cols;
+    const int nodesPerLine = 64 / sizeof(Node);
+    const int stride = ((nTreeNodes + nodesPerLine - 1) / nodesPerLine) * nodesPerLine;
+
+    const int bytes = nTrees * stride * sizeof(Node);
+    cv::Mat buffer(1, bytes + 64, CV_8UC1, cv::Scalar::all(0));
+    const int offset = static_cast<int>(cv::alignPtr(buffer.ptr(), 64) - buffer.ptr());
+
+    Detector::Classifier::Nodes packed;
+    packed.data = buffer.colRange(offset, offset + bytes);
+    packed.nTreeNodes = stride;
+
+    // In a complete binary tree the first (2^depth - 1) nodes are splits and the rest are leaves:
+    const int nSplits = (1 << treeDepth) - 1;
+
+    Node* nodes = reinterpret_cast<Node*>(packed.data.ptr());
+    for (int t = 0; t < nTrees; t++)
+    {
+        const uint32_t* fid = fids.ptr<uint32_t>(t);
+        const float* thr = thrs.ptr<float>(t);
+        const float* h = hs.ptr<float>(t);
+        for (int k = 0; k < nTreeNodes; k++)
+        {
+            Node& node = nodes[t * stride + k];
+            node.fid = (k < nSplits) ? fid[k] : 0;
+            node.value = (k < nSplits) ? thr[k] : h[k];
+        }
+    }
+    return packed;
+}
+
+void Detector::Classifier::pack()
+{
+    if (fids.empty() || (treeDepth < 1))
+    {
+        nodes = {};
+        nodesU8 = {};
+        return;
+    }
+
+    CV_Assert(fids.size() == thrs.size() && fids.size() == hs.size());
+    CV_Assert(thrs.type() == CV_32FC1 && hs.type() == CV_32FC1);
+
+    nodes = packNodes(fids, thrs, hs, treeDepth);
+    if (!thrsU8.empty())
+    {
+        nodesU8 = packNodes(fids, thrsU8, hs, treeDepth);
+    }
+}
+
+auto Detector::Classifier::getPackedNodes(int type) const -> const Nodes&
+{
+    switch (type)
+    {
+        case CV_32FC1:
+            return nodes;
+        case CV_8UC1:
+            return nodesU8;
+        default:
+            assert(false);
+    }
+    return nodes; // unused: for static analyzer
+}
+
+// Trees are complete binary trees, so the depth is a compile time constant for the traversal:
+template <typename T>
+static std::shared_ptr<DetectionParams> allocDetector(const T* chns, int treeDepth, DetectionSink* sink)
+{
+    switch (treeDepth)
+    {
+        case 1:
+            return std::make_shared<ParallelDetectionBody<T, 1>>(chns, sink);
+        case 2:
+            return std::make_shared<ParallelDetectionBody<T, 2>>(chns, sink);
+        case 3:
+            return std::make_shared<ParallelDetectionBody<T, 3>>(chns, sink);
+        case 4:
+            return std::make_shared<ParallelDetectionBody<T, 4>>(chns, sink);
+        case 5:
+            return std::make_shared<ParallelDetectionBody<T, 5>>(chns, sink);
+        case 6:
+            return std::make_shared<ParallelDetectionBody<T, 6>>(chns, sink);
+        case 7:
+            return std::make_shared<ParallelDetectionBody<T, 7>>(chns, sink);
+        case 8:
+            return std::make_shared<ParallelDetectionBody<T, 8>>(chns, sink);
+        default:
+            CV_Assert(treeDepth >= 1 && treeDepth <= 8); // varying leaf depth (treeDepth == 0) is not supported
+    }
+    return nullptr; // unused: for static analyzer
+}
+
+static std::shared_ptr<DetectionParams> allocDetector(const MatP& I, int treeDepth, DetectionSink* sink)
 {
     switch (I.depth())
     {
         case CV_8UC1:
-            return std::make_shared<ParallelDetectionBody<uint8_t, 2>>(I[0].ptr<uint8_t>(), sink);
+            return allocDetector(I[0].ptr<uint8_t>(), treeDepth, sink);
         case CV_32FC1:
-            return std::make_shared<ParallelDetectionBody<float, 2>>(I[0].ptr<float>(), sink);
+            return allocDetector(I[0].ptr<float>(), treeDepth, sink);
         default:
             assert(false);
     }
@@ -222,13 +412,10 @@ auto Detector::createDetector(const MatP& I, const RectVec& rois, int shrink, cv
     // Extract relevant fields from trees
     // Note: Need tranpose for column-major storage
     auto& trees = clf;
-    int nTreeNodes = trees.fids.rows; // TODO: check?
-    int nTrees = trees.fids.cols;
-    std::swap(nTrees, nTreeNodes);
-    assert(trees.treeDepth == 2); // TODO: switch
-    cv::Mat thresholds = trees.getScaledThresholds(I.depth());
+    const auto& nodes = trees.getPackedNodes(I.depth());
+    CV_Assert(nodes.ptr() != nullptr);
 
-    std::shared_ptr<DetectionParams> detector = allocDetector(I, sink);
+    std::shared_ptr<DetectionParams> detector = allocDetector(I, trees.treeDepth, sink);
 
     // Scanning parameters
     detector->winSize = { modelWd, modelHt };
@@ -240,12 +427,11 @@ auto Detector::createDetector(const MatP& I, const RectVec& rois, int shrink, cv
     detector->cids = cids;
 
     // Tree parameters:
-    detector->thrs = thresholds.ptr<float>();
-    detector->fids = trees.fids.ptr<uint32_t>();
-    detector->nTrees = nTrees;
-    detector->nTreeNodes = nTreeNodes;
-    detector->hs = trees.hs.ptr<float>();
+    detector->nodes = nodes.ptr();
+    detector->nTrees = trees.fids.rows;
+    detector->nTreeNodes = nodes.nTreeNodes;
     detector->child = trees.child.ptr<uint32_t>();
+    detector->lanes = (I.depth() == CV_32F) ? simd::getWindowLanes(trees.treeDepth) : nullptr;
     detector->I = I;
 
     return detector;
@@ -254,29 +440,198 @@ auto Detector::createDetector(const MatP& I, const RectVec& rois, int shrink, cv
 // Changelog:
 //
 // 3/21/2015: Rework arithmetic for row-major storage order
+// 10/18/2026: Scan column tiles in parallel w/ per tile sinks (concatenated in serial scan order)
+// 10/18/2026: Schedule tiles from all pyramid levels in a single parallel pass
+// 10/18/2026: Soft cascade rejection trace w/ optional per tree rejection counts
+// 10/18/2026: Scan the levels of a batch of pyramids in a single parallel pass
+// 10/18/2026: Runtime dispatch of the AVX2 window lanes (see acfDetectAVX2.cpp)
+
+// A column range of a single pyramid level with its own sink (no locking required):
+struct ScanJob
+{
+    ScanJob(const DetectionParams* detector, int level, const cv::Range& range)
+        : detector(detector)
+        , level(level)
+        , range(range)
+    {
+    }
 
-void Detector::acfDetect1(const MatP& I, const RectVec& rois, int shrink, cv::Size modelDsPad, int stride, double cascThr, std::vector<Detection>& objects)
+    const DetectionParams* detector = nullptr;
+    int level = 0;
+    cv::Range range;
+    DetectionSink sink;
+};
+
+// Split the level into column tiles containing roughly `work` windows each:
+static void addScanJobs(const DetectionParams* detector, int level, int work, std::vector<ScanJob>& jobs)
 {
-    DetectionSink detections;
-    auto detector = createDetector(I, rois, shrink, modelDsPad, stride, &detections);
-    detector->cascThr = cascThr;
-    (*detector)({ 0, detector->size1.width });
+    const int width1 = detector->size1.width;
+    const int height1 = detector->size1.height;
+    if ((width1 <= 0) || (height1 <= 0))
+    {
+        return;
+    }
 
-    for (const auto& hit : detections.hits)
+    const int cols = std::max(work / height1, 1);
+    for (int c = 0; c < width1; c += cols)
     {
-        cv::Rect roi({ hit.first.x * stride, hit.first.y * stride }, detector->winSize);
+        jobs.emplace_back(detector, level, cv::Range(c, std::min(c + cols, width1)));
+    }
+}
+
+static void scanJobs(std::vector<ScanJob>& jobs)
+{
+    core::ParallelHomogeneousLambda harness = [&](int i) {
+        jobs[i].detector->scan(jobs[i].range, &jobs[i].sink);
+    };
+    cv::parallel_for_({ 0, int(jobs.size()) }, harness);
+}
+
+// Use a few tiles per thread for load balancing (early rejection rates vary across the image):
+static int getTileWork(int windows)
+{
+    return std::max(windows / (cv::getNumThreads() * 4), 1);
+}
+
+static int getWindowCount(const DetectionParams& detector)
+{
+    return std::max(detector.size1.width, 0) * std::max(detector.size1.height, 0);
+}
+
+static void initStats(std::vector<ScanJob>& jobs, int nTrees)
+{
+    for (auto& job : jobs)
+    {
+        job.sink.rejected.assign(nTrees, 0);
+    }
+}
+
+static void appendStats(const ScanJob& job, Detector::CascadeStats& stats)
+{
+    stats.rejected.resize(job.sink.rejected.size(), 0);
+    for (std::size_t i = 0; i < job.sink.rejected.size(); i++)
+    {
+        stats.rejected[i] += job.sink.rejected[i];
+    }
+    stats.accepted += job.sink.hits.size();
+}
+
+std::uint64_t Detector::CascadeStats::windows() const
+{
+    return std::accumulate(rejected.begin(), rejected.end(), accepted);
+}
+
+void Detector::setCascadeThresholds(DetectionParams& detector, double cascThr) const
+{
+    detector.setCascadeThresholds(float(cascThr), m_doSoftCascade ? clf.rejection : std::vector<float>());
+}
+
+static void appendHits(const ScanJob& job, int stride, Detector::DetectionVec& objects)
+{
+    for (const auto& hit : job.sink.hits)
+    {
+        cv::Rect roi({ hit.first.x * stride, hit.first.y * stride }, job.detector->winSize);
 #if GPU_ACF_TRANSPOSE
         std::swap(roi.x, roi.y);
         std::swap(roi.width, roi.height);
 #endif
-        objects.push_back(Detection(roi, hit.second));
+        objects.push_back(Detector::Detection(roi, hit.second));
+    }
+}
+
+void Detector::acfDetect1(const MatP& I, const RectVec& rois, int shrink, cv::Size modelDsPad, int stride, double cascThr, std::vector<Detection>& objects)
+{
+    auto detector = createDetector(I, rois, shrink, modelDsPad, stride, nullptr);
+    setCascadeThresholds(*detector, cascThr);
+
+    std::vector<ScanJob> jobs;
+    addScanJobs(detector.get(), 0, getTileWork(getWindowCount(*detector)), jobs);
+    if (m_doCascadeStats)
+    {
+        initStats(jobs, detector->nTrees);
+    }
+    scanJobs(jobs);
+
+    for (const auto& job : jobs)
+    {
+        appendHits(job, stride, objects);
+        if (m_doCascadeStats)
+        {
+            appendStats(job, m_cascadeStats);
+        }
     }
 }
 
-float Detector::evaluate(const MatP& I, int shrink, cv::Size modelDsPad, int stride) const
+void Detector::acfDetect(const Pyramid& P, int shrink, cv::Size modelDsPad, int stride, double cascThr, std::vector<DetectionVec>& objects)
+{
+    std::vector<std::vector<DetectionVec>> batch;
+    acfDetect({ &P }, shrink, modelDsPad, stride, cascThr, batch);
+    objects = std::move(batch[0]);
+}
+
+void Detector::acfDetect(const std::vector<const Pyramid*>& pyramids, int shrink, cv::Size modelDsPad, int stride, double cascThr, std::vector<std::vector<DetectionVec>>& objects)
+{
+    // Levels are numbered consecutively across all pyramids (see ScanJob::level):
+    int windows = 0;
+    std::vector<DetectionParamPtr> detectors;
+    for (const auto* P : pyramids)
+    {
+        for (int i = 0; i < P->nScales; i++)
+        {
+            // ROI fields indicates row major storage, else column major:
+            const RectVec& rois = (P->rois.size() > i) ? P->rois[i] : RectVec();
+            detectors.push_back(createDetector(P->data[i][0], rois, shrink, modelDsPad, stride, nullptr));
+            setCascadeThresholds(*detectors.back(), cascThr);
+            windows += getWindowCount(*detectors.back());
+        }
+    }
+
+    // Tiles are sized by window count, so large levels are split and small levels are scanned whole:
+    const int work = getTileWork(windows);
+
+    std::vector<ScanJob> jobs;
+    for (int i = 0; i < int(detectors.size()); i++)
+    {
+        addScanJobs(detectors[i].get(), i, work, jobs);
+    }
+    if (m_doCascadeStats)
+    {
+        initStats(jobs, clf.fids.rows);
+    }
+    scanJobs(jobs);
+
+    // Jobs are ordered by level and column, so the per level output matches acfDetect1():
+    std::vector<DetectionVec*> levels;
+    objects.clear();
+    objects.resize(pyramids.size());
+    for (std::size_t k = 0; k < pyramids.size(); k++)
+    {
+        objects[k].resize(pyramids[k]->nScales);
+        for (auto& level : objects[k])
+        {
+            levels.push_back(&level);
+        }
+    }
+    for (const auto& job : jobs)
+    {
+        appendHits(job, stride, *levels[job.level]);
+        if (m_doCascadeStats)
+        {
+            appendStats(job, m_cascadeStats);
+        }
+    }
+}
+
+float Detector::evaluate(const MatP& I, int shrink, cv::Size modelDsPad, int stride, std::vector<float>* trace) const
 {
     auto detector = createDetector(I, {}, shrink, modelDsPad, stride, nullptr);
-    detector->cascThr = 0.f;
+    if (trace)
+    {
+        detector->trace(0, 0, *trace);
+        return trace->empty() ? 0.f : trace->back();
+    }
+
+    setCascadeThresholds(*detector, 0.0);
     return detector->evaluate(0, 0);
 }
 
@@ -0,0 +1,102 @@
+/*! -*-c++-*-
+  @file   acfDetectAVX2.cpp
+  @brief  AVX2 window lane evaluation of the ACF soft cascade (see simd.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  This file is compiled w/ AVX2 enabled on x86 and is only called after a runtime
+  check (see simdAVX2.cpp).
+
+*/
+
+#include "drishti/acf/toolbox/simd.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace simd
+{
+
+#if defined(__AVX2__)
+namespace
+{
+
+// Each lane follows its own path through the tree, so node indices, feature ids, channel values,
+// thresholds and leaf values are all gathered per lane.  Lanes are retired from the sum once they
+// fall below the cascade threshold, and the cascade exits when all lanes have been rejected.
+// The per lane accumulation order is the same as the scalar path, so the scores are identical.
+template <int kDepth>
+void evaluateWindowLanes(const Cascade& cascade, const float* chns, const int* offsets, float* h, int* stages)
+{
+    // Node fields are gathered w/ an 8 byte scale (sizeof(Node)) from the fid and value members:
+    const int* fids = reinterpret_cast<const int*>(cascade.nodes);
+    const float* values = reinterpret_cast<const float*>(cascade.nodes) + 1;
+    const int* cids = reinterpret_cast<const int*>(cascade.cids);
+    const __m256 cascThr = _mm256_set1_ps(cascade.cascThr);
+    const __m256i base = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets));
+    const __m256i two = _mm256_set1_epi32(2);
+
+    __m256 hs = _mm256_setzero_ps();
+    __m256 active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256i stage = _mm256_setzero_si256();
+    for (int t = 0; t < cascade.nTrees; t++)
+    {
+        stage = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(stage), _mm256_castsi256_ps(_mm256_set1_epi32(t)), active));
+        const __m256i offset = _mm256_set1_epi32(t * cascade.nTreeNodes);
+        __m256i k0 = _mm256_setzero_si256();
+        for (int i = 0; i < kDepth; i++)
+        {
+            const __m256i k = _mm256_add_epi32(k0, offset);
+            const __m256i cid = _mm256_i32gather_epi32(cids, _mm256_i32gather_epi32(fids, k, 8), 4);
+            const __m256 ftr = _mm256_i32gather_ps(chns, _mm256_add_epi32(base, cid), 4);
+            const __m256 thr = _mm256_i32gather_ps(values, k, 8);
+
+            // k0 = (k0 * 2) + ((ftr < thr) ? 1 : 2), where the comparison mask is -1 for true:
+            const __m256i lt = _mm256_castps_si256(_mm256_cmp_ps(ftr, thr, _CMP_LT_OQ));
+            k0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(k0, 1), two), lt);
+        }
+
+        const __m256 leaf = _mm256_i32gather_ps(values, _mm256_add_epi32(k0, offset), 8);
+        hs = _mm256_blendv_ps(hs, _mm256_add_ps(hs, leaf), active);
+        active = _mm256_and_ps(active, _mm256_cmp_ps(hs, _mm256_set1_ps(cascade.cascThrs[t]), _CMP_GT_OQ));
+        if (!_mm256_movemask_ps(active))
+        {
+            break;
+        }
+    }
+
+    // Rejected lanes can't exceed the final threshold:
+    hs = _mm256_blendv_ps(_mm256_min_ps(hs, cascThr), hs, active);
+    _mm256_storeu_ps(h, hs);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(stages), stage);
+}
+
+} // namespace
+#endif
+
+WindowLanes getWindowLanesAVX2(int depth)
+{
+#if defined(__AVX2__)
+    static const WindowLanes lanes[] = {
+        evaluateWindowLanes<1>,
+        evaluateWindowLanes<2>,
+        evaluateWindowLanes<3>,
+        evaluateWindowLanes<4>,
+        evaluateWindowLanes<5>,
+        evaluateWindowLanes<6>,
+        evaluateWindowLanes<7>,
+        evaluateWindowLanes<8>
+    };
+    return ((depth >= 1) && (depth <= 8)) ? lanes[depth - 1] : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace simd
+
+DRISHTI_ACF_NAMESPACE_END
@@ -7,9 +7,12 @@
 #include "wrappers.hpp"
 #include <string.h>
 #include "sse.hpp"
+#include "simd.hpp"
 
 #include <opencv2/core/core.hpp>
 
+namespace simd = drishti::acf::simd;
+
 // convolve one column of I by a 2rx1 ones filter
 void convBoxY(float* I, float* O, int h, int r, int s)
 {
@@ -82,9 +85,10 @@ void convBoxY(float* I, float* O, int h, int r, int s)
     }
 }
 
-// convolve I by a 2r+1 x 2r+1 ones filter (uses SSE)
+// convolve I by a 2r+1 x 2r+1 ones filter (uses SSE, AVX2 or AVX-512 for the x pass)
 void convBox(float* I, float* O, int h, int w, int d, int r, int s)
 {
+    const simd::Kernels& K = simd::kernels();
     float nrm = 1.0f / ((2 * r + 1) * (2 * r + 1));
     int i, j, k = (s - 1) / 2, h0, h1, w0;
     if (h % 4 == 0)
@@ -148,14 +152,7 @@ void convBox(float* I, float* O, int h, int w, int d, int r, int s)
             {
                 Ir = I + (2 * w - r - i - 1) * h;
             }
-            for (j = 0; j < h0; j += 4)
-            {
-                DEC(T[j], MUL(nrm, SUB(LDu(Il[j]), LDu(Ir[j]))));
-            }
-            for (j = h0; j < h; j++)
-            {
-                T[j] -= nrm * (Il[j] - Ir[j]);
-            }
+            K.boxX(Il, Ir, nrm, T, h);
             k++;
             if (k == s)
             {
@@ -344,9 +341,10 @@ void convTriY(float* I, float* O, int h, int r, int s)
     }
 }
 
-// convolve I by a 2rx1 triangle filter (uses SSE)
+// convolve I by a 2rx1 triangle filter (uses SSE, AVX2 or AVX-512 for the x pass)
 void convTri(float* I, float* O, int h, int w, int d, int r, int s)
 {
+    const simd::Kernels& K = simd::kernels();
     r++;
     float nrm = 1.0f / (r * r * r * r);
     int i, j, k = (s - 1) / 2, h0, h1, w0;
@@ -420,15 +418,7 @@ void convTri(float* I, float* O, int h, int w, int d, int r, int s)
             {
                 Ir = I + (2 * w - r - i) * h;
             }
-            for (j = 0; j < h0; j += 4)
-            {
-                INC(T[j], ADD(LDu(Il[j]), LDu(Ir[j]), MUL(-2, LDu(Im[j]))));
-                INC(U[j], MUL(nrm, LD(T[j])));
-            }
-            for (j = h0; j < h; j++)
-            {
-                U[j] += nrm * (T[j] += Il[j] + Ir[j] - 2 * Im[j]);
-            }
+            K.triX(Il, Im, Ir, nrm, T, U, h);
             k++;
             if (k == s)
             {
@@ -491,11 +481,12 @@ void convTri1Y(float* I, float* O, int h, float p, int s)
 #undef C4
 }
 
-// convolve I by a [1 p 1] filter (uses SSE)
+// convolve I by a [1 p 1] filter (uses SSE, AVX2 or AVX-512 for the x pass)
 void convTri1(float* I, float* O, int h, int w, int d, float p, int s)
 {
+    const simd::Kernels& K = simd::kernels();
     const float nrm = 1.0f / ((p + 2) * (p + 2));
-    int i, j, h0 = h - (h % 4);
+    int i;
     float *Il, *Im, *Ir, *T = (float*)alMalloc(h * sizeof(float), 16);
     for (int d0 = 0; d0 < d; d0++)
     {
@@ -510,14 +501,7 @@ void convTri1(float* I, float* O, int h, int w, int d, float p, int s)
             {
                 Ir += h;
             }
-            for (j = 0; j < h0; j += 4)
-            {
-                STR(T[j], MUL(nrm, ADD(ADD(LDu(Il[j]), MUL(p, LDu(Im[j]))), LDu(Ir[j]))));
-            }
-            for (j = h0; j < h; j++)
-            {
-                T[j] = nrm * (Il[j] + p * Im[j] + Ir[j]);
-            }
+            K.tri1X(Il, Im, Ir, p, nrm, T, h);
             convTri1Y(T, O, h, p, s);
             O += h / s;
         }
@@ -0,0 +1,611 @@
+/*! -*-c++-*-
+  @file   fixed.cpp
+  @brief  Fixed point ACF toolbox kernels (see fixed.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  The inner loops are plain loops over the contiguous dimension, which
+  compilers vectorize at the native width (w/ -fno-math-errno for sqrt, see
+  drishti/CMakeLists.txt).
+
+*/
+
+#include "drishti/acf/toolbox/fixed.hpp"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace fixed
+{
+
+namespace
+{
+
+const int kCoefShift = 14; // resampling weights
+
+// Exact rounded division by a constant, (x + d/2) / d for x + d/2 < 2^31 (Granlund & Montgomery):
+struct Divide
+{
+    explicit Divide(uint32_t d)
+        : half(d / 2)
+    {
+        int l = 0;
+        while ((uint64_t(1) << l) < d)
+        {
+            l++;
+        }
+        shift = 31 + l;
+        mult = ((uint64_t(1) << shift) + d - 1) / d;
+    }
+
+    uint32_t operator()(uint32_t x) const
+    {
+        return uint32_t((uint64_t(x + half) * mult) >> shift);
+    }
+
+    uint32_t half;
+    uint64_t mult;
+    int shift;
+};
+
+template <typename T>
+inline T saturate(uint64_t x)
+{
+    return T(std::min<uint64_t>(x, std::numeric_limits<T>::max()));
+}
+
+// Symmetric padding (see imPad()): -1 -> 0, n -> n - 1
+inline int reflect(int i, int n)
+{
+    while (i < 0 || i >= n)
+    {
+        i = (i < 0) ? (-i - 1) : (2 * n - i - 1);
+    }
+    return i;
+}
+
+// Constants for rgb2luv() (see rgb2luv_setup())
+struct LuvTables
+{
+    static const LuvTables& get()
+    {
+        static const LuvTables tables;
+        return tables;
+    }
+
+    static const int kXyzShift = 20;
+
+    int32_t mr[3], mg[3], mb[3]; // uint8_t RGB -> XYZ in Q20
+    uint16_t lTable[1025];       // y -> l in kOne units (same resolution as the float table)
+
+private:
+    LuvTables()
+    {
+        const double m[3][3] = {
+            { 0.430574, 0.341550, 0.178325 },
+            { 0.222015, 0.706655, 0.071330 },
+            { 0.020183, 0.129553, 0.939180 }
+        };
+        const double z = double(1 << kXyzShift) / 255.0;
+        for (int j = 0; j < 3; j++)
+        {
+            mr[j] = int32_t(std::lround(m[j][0] * z));
+            mg[j] = int32_t(std::lround(m[j][1] * z));
+            mb[j] = int32_t(std::lround(m[j][2] * z));
+        }
+
+        const double y0 = (6.0 / 29) * (6.0 / 29) * (6.0 / 29), a = (29.0 / 3) * (29.0 / 3) * (29.0 / 3);
+        for (int i = 0; i < 1025; i++)
+        {
+            const double y = i / 1024.0, l = (y > y0) ? (116 * std::pow(y, 1.0 / 3.0) - 16) : (y * a);
+            lTable[i] = uint16_t(std::lround(l / 270.0 * kOne));
+        }
+    }
+};
+
+// atan(t) / pi for t in [0, 1], |error| < 1e-5 rad (Abramowitz & Stegun 4.4.49)
+inline float atanPi(float t)
+{
+    const float t2 = t * t;
+    const float p = 0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f)));
+    return t * p * float(1.0 / CV_PI);
+}
+
+// Integer taps of the 1D filter applied by convTri(I, r)
+std::vector<uint32_t> getTriangleTaps(float r)
+{
+    if (r <= 1.f)
+    {
+        const float p = 12.f / r / (r + 2.f) - 2.f;
+        if (p == std::round(p))
+        {
+            return { 1, uint32_t(p), 1 };
+        }
+        const uint32_t q = 16;
+        return { q, uint32_t(std::lround(p * q)), q };
+    }
+
+    const int k = int(std::round(r));
+    std::vector<uint32_t> taps(2 * k + 1);
+    for (int i = -k; i <= k; i++)
+    {
+        taps[i + k] = uint32_t(k + 1 - std::abs(i));
+    }
+    return taps;
+}
+
+// Filter one column along y w/ symmetric padding, P is scratch space for h + n + 1 values
+template <typename T>
+void convY(const T* I, uint32_t* O, int h, const std::vector<uint32_t>& k, uint32_t* P)
+{
+    const int n = int(k.size()), r0 = n / 2;
+    if (n == 3)
+    {
+        // [k0 k1 k2] (see convTri1())
+        const uint32_t k0 = k[0], k1 = k[1], k2 = k[2];
+        for (int y = 1; y < h - 1; y++)
+        {
+            O[y] = k0 * I[y - 1] + k1 * I[y] + k2 * I[y + 1];
+        }
+        for (int y : { 0, h - 1 })
+        {
+            O[y] = k0 * I[reflect(y - 1, h)] + k1 * I[y] + k2 * I[reflect(y + 1, h)];
+        }
+        return;
+    }
+
+    // Triangle as two box filters of width r0 + 1, w/ differences of prefix sums (see convTri()),
+    // where the uint32_t wrap around cancels in each difference:
+    P[0] = 0;
+    for (int j = 0; j < h + 2 * r0; j++)
+    {
+        P[j + 1] = P[j] + I[reflect(j - r0, h)];
+    }
+    for (int j = 0; j < h + r0; j++)
+    {
+        P[j] = P[j + r0 + 1] - P[j];
+    }
+    uint32_t q = 0;
+    for (int j = 0; j < h + r0; j++)
+    {
+        const uint32_t b = P[j];
+        P[j] = q;
+        q += b;
+    }
+    P[h + r0] = q;
+    for (int y = 0; y < h; y++)
+    {
+        O[y] = P[y + r0 + 1] - P[y];
+    }
+}
+
+template <typename T>
+void convTriT(const T* I, T* O, int h, int w, int d, float r)
+{
+    const std::vector<uint32_t> k = getTriangleTaps(r);
+    const int n = int(k.size()), r0 = n / 2, m = n + 2;
+    const uint32_t sum = std::accumulate(k.begin(), k.end(), 0u), norm = sum * sum;
+    CV_Assert(uint64_t(std::numeric_limits<T>::max()) * norm < (uint64_t(1) << 31));
+
+    const Divide divide(norm);
+    const bool isPow2 = !(norm & (norm - 1));
+    int shift = 0;
+    while ((1u << shift) < norm)
+    {
+        shift++;
+    }
+
+    // Columns filtered along y are computed once, in a ring of the m most recent columns, so
+    // in place filtering only overwrites columns that are no longer needed:
+    std::vector<uint32_t> ring(std::size_t(m) * h), acc(h), U(h), P(h + n + 1);
+    std::vector<int> tags(m);
+    for (int c = 0; c < d; c++)
+    {
+        const T* Ic = I + std::size_t(c) * h * w;
+        T* Oc = O + std::size_t(c) * h * w;
+        std::fill(tags.begin(), tags.end(), -1);
+        auto column = [&](int x) -> const uint32_t* {
+            x = reflect(x, w);
+            uint32_t* C = ring.data() + std::size_t(x % m) * h;
+            if (tags[x % m] != x)
+            {
+                tags[x % m] = x;
+                convY(Ic + std::size_t(x) * h, C, h, k, P.data());
+            }
+            return C;
+        };
+
+        if (n > 3)
+        {
+            // acc(x) for x == 0 and the running difference U(x) = acc(x + 1) - acc(x)
+            std::fill(acc.begin(), acc.end(), 0u);
+            std::fill(U.begin(), U.end(), 0u);
+            for (int i = -r0; i <= r0 + 1; i++)
+            {
+                const uint32_t *C = column(i), ki = (i <= r0) ? k[i + r0] : 0u;
+                for (int y = 0; y < h; y++)
+                {
+                    acc[y] += ki * C[y];
+                    U[y] += (i > 0) ? C[y] : (0u - C[y]);
+                }
+            }
+        }
+
+        for (int x = 0; x < w; x++)
+        {
+            // filter along x
+            if (n == 3)
+            {
+                const uint32_t *C0 = column(x - 1), *C1 = column(x), *C2 = column(x + 1);
+                const uint32_t k0 = k[0], k1 = k[1], k2 = k[2];
+                for (int y = 0; y < h; y++)
+                {
+                    acc[y] = k0 * C0[y] + k1 * C1[y] + k2 * C2[y];
+                }
+            }
+
+            T* Ox = Oc + std::size_t(x) * h;
+            if (isPow2)
+            {
+                for (int y = 0; y < h; y++)
+                {
+                    Ox[y] = T((acc[y] + (norm >> 1)) >> shift);
+                }
+            }
+            else
+            {
+                for (int y = 0; y < h; y++)
+                {
+                    Ox[y] = T(divide(acc[y]));
+                }
+            }
+
+            if (n > 3 && x + 1 < w)
+            {
+                // acc(x + 1) = acc(x) + U(x), U(x + 1) = U(x) + C(x + r0 + 2) - 2 * C(x + 1) + C(x - r0)
+                const uint32_t *Cn = column(x + r0 + 2), *Cc = column(x + 1), *Cp = column(x - r0);
+                for (int y = 0; y < h; y++)
+                {
+                    acc[y] += U[y];
+                    U[y] += Cn[y] - 2 * Cc[y] + Cp[y];
+                }
+            }
+        }
+    }
+}
+
+// Q14 interpolation weights for each output index (see resampleCoef())
+struct Coef
+{
+    Coef(int na, int nb);
+
+    std::vector<int> offset; // [nb + 1] ranges into index and weight
+    std::vector<int> index;
+    std::vector<int64_t> weight;
+};
+
+Coef::Coef(int na, int nb)
+{
+    const double s = double(nb) / double(na), sInv = 1.0 / s;
+    std::vector<double> wts;
+    offset.push_back(0);
+    for (int b = 0; b < nb; b++)
+    {
+        const std::size_t begin = index.size();
+        wts.clear();
+        if (na > nb)
+        {
+            // area weights for downsampling
+            const double a0f = b * sInv, a1f = a0f + sInv;
+            const int a0 = int(std::ceil(a0f)), a1 = int(a1f);
+            double W = 0.0;
+            for (int a = a0 - 1; a < a1 + 1; a++)
+            {
+                double wt = s;
+                if (a == a0 - 1)
+                {
+                    wt = (a0 - a0f) * s;
+                }
+                else if (a == a1)
+                {
+                    wt = (a1f - a1) * s;
+                }
+                if (wt > 1e-3 * s && a >= 0 && a < na)
+                {
+                    index.push_back(a);
+                    wts.push_back(wt);
+                    W += wt;
+                }
+            }
+            if (W > 1.0)
+            {
+                for (auto& wt : wts)
+                {
+                    wt /= W;
+                }
+            }
+        }
+        else
+        {
+            // bilinear weights for upsampling
+            const double af = (0.5 + b) * sInv - 0.5;
+            const int a = int(std::floor(af));
+            if (a < 0 || a >= na - 1)
+            {
+                index.push_back(std::min(std::max(a, 0), na - 1));
+                wts.push_back(1.0);
+            }
+            else
+            {
+                index.push_back(a);
+                index.push_back(a + 1);
+                wts.push_back(1.0 - (af - a));
+                wts.push_back(af - a);
+            }
+        }
+
+        // quantize, w/ the rounding error assigned to the largest weight
+        const double total = std::accumulate(wts.begin(), wts.end(), 0.0);
+        int64_t remainder = std::llround(total * (1 << kCoefShift));
+        std::size_t big = 0;
+        for (std::size_t i = 0; i < wts.size(); i++)
+        {
+            weight.push_back(std::llround(wts[i] * (1 << kCoefShift)));
+            remainder -= weight.back();
+            big = (wts[i] > wts[big]) ? i : big;
+        }
+        if (!wts.empty())
+        {
+            weight[begin + big] += remainder;
+        }
+        offset.push_back(int(index.size()));
+    }
+}
+
+template <typename S, typename D>
+void resampleT(const S* A, D* B, int ha, int hb, int wa, int wb, int d, double nrm)
+{
+    CV_Assert(nrm >= 0.0 && nrm < 8.0);
+
+    const Coef xc(wa, wb), yc(ha, hb);
+    const uint64_t r = uint64_t(std::llround(nrm * 65536.0));
+    const int shift = 2 * kCoefShift + 16;
+    const uint64_t half = uint64_t(1) << (shift - 1);
+
+    std::vector<uint32_t> C(ha);
+    for (int z = 0; z < d; z++)
+    {
+        const S* Az = A + std::size_t(z) * ha * wa;
+        D* Bz = B + std::size_t(z) * hb * wb;
+        for (int xb = 0; xb < wb; xb++)
+        {
+            // resample along x direction (A -> C)
+            std::fill(C.begin(), C.end(), 0u);
+            for (int i = xc.offset[xb]; i < xc.offset[xb + 1]; i++)
+            {
+                const uint32_t wt = uint32_t(xc.weight[i]);
+                const S* Ax = Az + std::size_t(xc.index[i]) * ha;
+                for (int y = 0; y < ha; y++)
+                {
+                    C[y] += wt * Ax[y];
+                }
+            }
+
+            // resample along y direction (C -> B)
+            D* Bx = Bz + std::size_t(xb) * hb;
+            for (int yb = 0; yb < hb; yb++)
+            {
+                uint64_t acc = 0;
+                for (int i = yc.offset[yb]; i < yc.offset[yb + 1]; i++)
+                {
+                    acc += uint64_t(yc.weight[i]) * C[yc.index[i]];
+                }
+                Bx[yb] = saturate<D>((acc * r + half) >> shift);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void rgb2luv(const uint8_t* R, const uint8_t* G, const uint8_t* B, uint16_t* J, int n)
+{
+    const LuvTables& t = LuvTables::get();
+    const float un = 13 * 0.197833f, vn = 13 * 0.468331f, minu = -88.f / 270 * kOne, minv = -134.f / 270 * kOne;
+    uint16_t *L = J, *U = L + n, *V = U + n;
+
+    // Blocks of pixels w/ the table lookup split from the arithmetic, so the latter vectorizes:
+    const int kBlock = 256;
+    int32_t Y[kBlock];
+    float Fu[kBlock], Fv[kBlock];
+    for (int i0 = 0; i0 < n; i0 += kBlock)
+    {
+        const int m = std::min(kBlock, n - i0);
+        const uint8_t *Ri = R + i0, *Gi = G + i0, *Bi = B + i0;
+        for (int i = 0; i < m; i++)
+        {
+            const int32_t r = Ri[i], g = Gi[i], b = Bi[i];
+            const int32_t x = t.mr[0] * r + t.mg[0] * g + t.mb[0] * b;
+            const int32_t y = t.mr[1] * r + t.mg[1] * g + t.mb[1] * b;
+            const int32_t z = t.mr[2] * r + t.mg[2] * g + t.mb[2] * b;
+            const float q = 1.f / float(std::max(x + 15 * y + 3 * z, 1));
+            Y[i] = std::min(y >> (LuvTables::kXyzShift - 10), 1024);
+            Fu[i] = 52.f * float(x) * q - un;
+            Fv[i] = 117.f * float(y) * q - vn;
+        }
+
+        uint16_t *Li = L + i0, *Ui = U + i0, *Vi = V + i0;
+        for (int i = 0; i < m; i++)
+        {
+            Li[i] = t.lTable[Y[i]];
+        }
+        for (int i = 0; i < m; i++)
+        {
+            const float l = float(Li[i]), u = l * Fu[i] - minu, v = l * Fv[i] - minv;
+            Ui[i] = uint16_t(std::min(std::max(u + 0.5f, 0.f), 65535.f));
+            Vi[i] = uint16_t(std::min(std::max(v + 0.5f, 0.f), 65535.f));
+        }
+    }
+}
+
+void normalize(const uint8_t* I, uint16_t* J, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        J[i] = uint16_t((uint32_t(I[i]) * kOne + 127) / 255);
+    }
+}
+
+void convTri(const uint16_t* I, uint16_t* O, int h, int w, int d, float r)
+{
+    convTriT(I, O, h, w, d, r);
+}
+
+void convTri(const uint8_t* I, uint8_t* O, int h, int w, int d, float r)
+{
+    convTriT(I, O, h, w, d, r);
+}
+
+void gradMag(const uint16_t* I, uint16_t* M, uint16_t* O, int h, int w, bool full)
+{
+    std::vector<int32_t> Gx(h), Gy(h);
+    for (int x = 0; x < w; x++)
+    {
+        // 2x gradient w/ one sided differences at the border (see grad1())
+        const uint16_t* Ix = I + std::size_t(x) * h;
+        const uint16_t* Ip = (x > 0) ? (Ix - h) : Ix;
+        const uint16_t* In = (x < w - 1) ? (Ix + h) : Ix;
+        const int sx = (x > 0 && x < w - 1) ? 1 : 2;
+        for (int y = 0; y < h; y++)
+        {
+            Gx[y] = sx * (int32_t(In[y]) - int32_t(Ip[y]));
+        }
+        Gy[0] = Gy[h - 1] = 0;
+        if (h > 1)
+        {
+            for (int y = 1; y < h - 1; y++)
+            {
+                Gy[y] = int32_t(Ix[y + 1]) - int32_t(Ix[y - 1]);
+            }
+            Gy[0] = 2 * (int32_t(Ix[1]) - int32_t(Ix[0]));
+            Gy[h - 1] = 2 * (int32_t(Ix[h - 1]) - int32_t(Ix[h - 2]));
+        }
+
+        uint16_t* Mx = M + std::size_t(x) * h;
+        for (int y = 0; y < h; y++)
+        {
+            const float gx = float(Gx[y]), gy = float(Gy[y]);
+            Mx[y] = uint16_t(std::min(std::sqrt(gx * gx + gy * gy) * 0.5f + 0.5f, 65535.f));
+        }
+
+        if (O)
+        {
+            // acos(gx / |g|) in [0, pi] (as in gradMag()) from the first octant, pi/2 if |g| == 0
+            uint16_t* Ox = O + std::size_t(x) * h;
+            const int32_t fullShift = full ? 1 : 0, fullOffset = full ? 32768 : 0;
+            for (int y = 0; y < h; y++)
+            {
+                const int32_t ax = std::abs(Gx[y]), ay = std::abs(Gy[y]);
+                const int32_t lo = std::min(ax, ay), hi = std::max(ax, ay);
+                int32_t a = int32_t(atanPi(float(lo) / float(hi + int32_t(hi == 0))) * 65536.f + 0.5f);
+                a = (ay > ax) ? (32768 - a) : a;
+                a = (Gx[y] < 0) ? (65536 - a) : a;
+                a = hi ? a : 32768;
+                a = (a >> fullShift) + ((Gy[y] < 0) ? fullOffset : 0);
+                Ox[y] = uint16_t(a); // pi (or 2*pi) wraps to 0
+            }
+        }
+    }
+}
+
+void gradMagNorm(uint16_t* M, const uint16_t* S, int n, float norm)
+{
+    const float one = float(kOne), c = norm * one;
+    for (int i = 0; i < n; i++)
+    {
+        M[i] = uint16_t(std::min(float(M[i]) * one / (float(S[i]) + c) + 0.5f, 65535.f));
+    }
+}
+
+void gradHist(const uint16_t* M, const uint16_t* O, uint16_t* H, int h, int w, int bin, int nOrients, int softBin)
+{
+    CV_Assert((softBin % 2 == 0) && (bin <= 8));
+
+    const int hb = h / bin, wb = w / bin, h0 = hb * bin, w0 = wb * bin, nb = wb * hb;
+    const bool interpolate = (softBin >= 0);
+
+    // Sums of M * weight (Q8) for each bin, w/ each column quantized in turn (see gradQuantize())
+    std::vector<uint32_t> acc(std::size_t(nb) * nOrients, 0), O0(h0), O1(h0), M0(h0), M1(h0);
+    for (int x = 0; x < w0; x++)
+    {
+        const uint16_t* Mx = M + std::size_t(x) * h;
+        const uint16_t* Ox = O + std::size_t(x) * h;
+        if (interpolate)
+        {
+            for (int y = 0; y < h0; y++)
+            {
+                const uint32_t o = uint32_t(Ox[y]) * nOrients, o0 = o >> 16, od = (o >> 8) & 255;
+                O0[y] = o0 * nb;
+                O1[y] = (o0 + 1 < uint32_t(nOrients)) ? (o0 + 1) * nb : 0;
+                M0[y] = Mx[y] * (256 - od);
+                M1[y] = Mx[y] * od;
+            }
+        }
+        else
+        {
+            for (int y = 0; y < h0; y++)
+            {
+                const uint32_t o0 = (uint32_t(Ox[y]) * nOrients + 32768) >> 16;
+                O0[y] = (o0 < uint32_t(nOrients)) ? o0 * nb : 0;
+                M0[y] = uint32_t(Mx[y]) << 8;
+            }
+        }
+
+        uint32_t* A = acc.data() + (x / bin) * hb;
+        for (int y = 0; y < h0; A++)
+        {
+            for (int j = 0; j < bin; j++, y++)
+            {
+                A[O0[y]] += M0[y];
+                if (interpolate)
+                {
+                    A[O1[y]] += M1[y];
+                }
+            }
+        }
+    }
+
+    const Divide divide(256 * bin * bin);
+    for (std::size_t i = 0; i < acc.size(); i++)
+    {
+        H[i] = saturate<uint16_t>(divide(acc[i]));
+    }
+}
+
+void resample(const uint16_t* A, uint16_t* B, int ha, int hb, int wa, int wb, int d, double nrm)
+{
+    resampleT(A, B, ha, hb, wa, wb, d, nrm);
+}
+
+void resample(const uint16_t* A, uint8_t* B, int ha, int hb, int wa, int wb, int d, double nrm)
+{
+    resampleT(A, B, ha, hb, wa, wb, d, nrm);
+}
+
+void resample(const uint8_t* A, uint8_t* B, int ha, int hb, int wa, int wb, int d, double nrm)
+{
+    resampleT(A, B, ha, hb, wa, wb, d, nrm);
+}
+
+} // namespace fixed
+
+DRISHTI_ACF_NAMESPACE_END
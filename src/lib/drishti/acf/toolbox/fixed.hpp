@@ -0,0 +1,64 @@
+/*! -*-c++-*-
+  @file   fixed.hpp
+  @brief  Fixed point ACF toolbox kernels for the uint8_t channel pipeline.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Integer versions of the toolbox functions used by chnsCompute() and
+  chnsPyramid() (rgbConvertMex.cpp, convConst.cpp, gradientMex.cpp and
+  imResampleMex.cpp) w/ the same column major layout, where h is the
+  contiguous dimension.  Intermediate planes are uint16_t in Q14 (kOne == 1.0)
+  and the final channels are uint8_t, scaled by 255 (and saturated) to match
+  Classifier::thrsU8.  Orientation is stored as a uint16_t fraction of pi (or
+  2*pi if full).  Filters and resampling are exact integer arithmetic, while
+  the square root, atan and the divisions in rgb2luv() and gradMagNorm() are
+  single precision float on integer operands, rounded to the nearest integer.
+
+*/
+
+#ifndef __drishti_acf_toolbox_fixed_hpp__
+#define __drishti_acf_toolbox_fixed_hpp__
+
+#include "drishti/acf/drishti_acf.h"
+
+#include <cstdint>
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace fixed
+{
+
+const int kShift = 14;
+const int kOne = 1 << kShift;
+
+// J = luv(R, G, B) in Q14 w/ n pixels per plane, J is planar (see rgb2luv())
+void rgb2luv(const uint8_t* R, const uint8_t* G, const uint8_t* B, uint16_t* J, int n);
+
+// J = I * kOne / 255, i.e., for input that is already in the target color space
+void normalize(const uint8_t* I, uint16_t* J, int n);
+
+// Triangle filter w/ symmetric padding (see convTri.m): [1 p 1] for r <= 1 (as in convTri1()),
+// otherwise [1 ... r+1 ... 1] for round(r).  In place filtering (I == O) is supported.
+void convTri(const uint16_t* I, uint16_t* O, int h, int w, int d, float r);
+void convTri(const uint8_t* I, uint8_t* O, int h, int w, int d, float r);
+
+// Gradient magnitude (Q14) and orientation of a single channel (see gradMag())
+void gradMag(const uint16_t* I, uint16_t* M, uint16_t* O, int h, int w, bool full);
+
+// M = M / (S + norm) (see gradMagNorm())
+void gradMagNorm(uint16_t* M, const uint16_t* S, int n, float norm);
+
+// [hb x wb x nOrients] Q14 histograms (see gradHist()), softBin must be even (no spatial interpolation)
+void gradHist(const uint16_t* M, const uint16_t* O, uint16_t* H, int h, int w, int bin, int nOrients, int softBin);
+
+// B = nrm * resample(A) w/ saturation (see resample())
+void resample(const uint16_t* A, uint16_t* B, int ha, int hb, int wa, int wb, int d, double nrm);
+void resample(const uint16_t* A, uint8_t* B, int ha, int hb, int wa, int wb, int d, double nrm);
+void resample(const uint8_t* A, uint8_t* B, int ha, int hb, int wa, int wb, int d, double nrm);
+
+} // namespace fixed
+
+DRISHTI_ACF_NAMESPACE_END
+
+#endif // __drishti_acf_toolbox_fixed_hpp__
@@ -5,25 +5,28 @@
 * Licensed under the Simplified BSD License [see external/bsd.txt]
 *******************************************************************************/
 #include "wrappers.hpp"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include "string.h"
 #include "sse.hpp"
+#include "simd.hpp"
 
 #include <assert.h>
 
+namespace simd = drishti::acf::simd;
+
 #define PI 3.14159265f
 
 #define DRISHTI_DEBUG_ACOS_TABLE 0
 
-// compute x and y gradients for just one column (uses sse)
+// compute x and y gradients for just one column (uses sse, avx2 or avx512)
 void grad1(float* I, float* Gx, float* Gy, int h, int w, int x)
 {
-    int y, y1;
+    const simd::Kernels& K = simd::kernels();
     float *Ip, *In, r;
-    __m128 *_Ip, *_In, *_G, _r;
     // compute column of Gx
     Ip = I - h;
     In = I + h;
@@ -38,53 +41,20 @@ void grad1(float* I, float* Gx, float* Gy, int h, int w, int x)
         r = 1;
         In -= h;
     }
-    if (h < 4 || h % 4 > 0 || (size_t(I) & 15) || (size_t(Gx) & 15))
-    {
-        for (y = 0; y < h; y++)
-        {
-            *Gx++ = (*In++ - *Ip++) * r;
-        }
-    }
-    else
-    {
-        _G = (__m128*)Gx;
-        _Ip = (__m128*)Ip;
-        _In = (__m128*)In;
-        _r = SET(r);
-        for (y = 0; y < h; y += 4)
-        {
-            *_G++ = MUL(SUB(*_In++, *_Ip++), _r);
-        }
-    }
+    K.diffScale(In, Ip, r, Gx, h);
 // compute column of Gy
 #define GRADY(r) *Gy++ = (*In++ - *Ip++) * r;
     Ip = I;
     In = Ip + 1;
     // GRADY(1); Ip--; for(y=1; y<h-1; y++) GRADY(.5f); In--; GRADY(1);
-    y1 = ((~((size_t)Gy) + 1) & 15) / 4;
-    if (y1 == 0)
-    {
-        y1 = 4;
-    }
-    if (y1 > h - 1)
-    {
-        y1 = h - 1;
-    }
     GRADY(1);
     Ip--;
-    for (y = 1; y < y1; y++)
-    {
-        GRADY(.5f);
-    }
-    _r = SET(.5f);
-    _G = (__m128*)Gy;
-    for (; y + 4 < h - 1; y += 4, Ip += 4, In += 4, Gy += 4)
-    {
-        *_G++ = MUL(SUB(LDu(*In), LDu(*Ip)), _r);
-    }
-    for (; y < h - 1; y++)
+    if (h > 2)
     {
-        GRADY(.5f);
+        K.diffScale(In, Ip, .5f, Gy, h - 2);
+        In += h - 2;
+        Ip += h - 2;
+        Gy += h - 2;
     }
     In--;
     GRADY(1);
@@ -174,10 +144,13 @@ private:
     void operator=(ACosTable const&) = delete;
 };
 
-// compute gradient magnitude and orientation at each location (uses sse)
-void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
+// compute gradient magnitude and orientation for columns [x0,x1) (uses sse, avx2 or avx512)
+// each column is independent, so disjoint column ranges can run concurrently
+// (the approximate rcp and rsqrt steps are always sse for consistent output)
+void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full, int x0, int x1)
 {
-    int x, y, y1, c, h4, s;
+    const simd::Kernels& K = simd::kernels();
+    int x, y, c, h4, s;
     float *Gx, *Gy, *M2;
     __m128 *_Gx, *_Gy, *_M2, _m;
     float acMult = float(ACosTable::n);
@@ -191,24 +164,19 @@ void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
     Gy = (float*)alMalloc(s, 16);
     _Gy = (__m128*)Gy;
     // compute gradient magnitude and orientation for each column
-    for (x = 0; x < w; x++)
+    for (x = x0; x < x1; x++)
     {
         // compute gradients (Gx, Gy) with maximum squared magnitude (M2)
         for (c = 0; c < d; c++)
         {
             grad1(I + x * h + c * w * h, Gx + c * h4, Gy + c * h4, h, w, x);
-            for (y = 0; y < h4 / 4; y++)
+            if (c == 0)
             {
-                y1 = h4 / 4 * c + y;
-                _M2[y1] = ADD(MUL(_Gx[y1], _Gx[y1]), MUL(_Gy[y1], _Gy[y1]));
-                if (c == 0)
-                {
-                    continue;
-                }
-                _m = CMPGT(_M2[y1], _M2[y]);
-                _M2[y] = OR(AND(_m, _M2[y1]), ANDNOT(_m, _M2[y]));
-                _Gx[y] = OR(AND(_m, _Gx[y1]), ANDNOT(_m, _Gx[y]));
-                _Gy[y] = OR(AND(_m, _Gy[y1]), ANDNOT(_m, _Gy[y]));
+                K.magSq(Gx, Gy, M2, h4);
+            }
+            else
+            {
+                K.magSqMax(Gx + c * h4, Gy + c * h4, Gx, Gy, M2, h4);
             }
         }
         // compute gradient mangitude (M) and normalize Gx
@@ -234,20 +202,7 @@ void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
 
             if (full)
             {
-                y1 = ((~size_t(O + x * h) + 1) & 15) / 4;
-                y = 0;
-                for (; y < y1; y++)
-                {
-                    O[y + x * h] += (Gy[y] < 0) * PI;
-                }
-                for (; y < h - 4; y += 4)
-                {
-                    STRu(O[y + x * h], ADD(LDu(O[y + x * h]), AND(CMPLT(LDu(Gy[y]), SET(0.f)), SET(PI))));
-                }
-                for (; y < h; y++)
-                {
-                    O[y + x * h] += (Gy[y] < 0) * PI;
-                }
+                K.addIfNegative(Gy, PI, O + x * h, h);
             }
         }
     }
@@ -256,6 +211,12 @@ void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
     alFree(M2);
 }
 
+// compute gradient magnitude and orientation at each location (uses sse)
+void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
+{
+    gradMag(I, M, O, h, w, d, full, 0, w);
+}
+
 // normalize gradient magnitude at each location (uses sse)
 void gradMagNorm(float* M, float* S, int h, int w, float norm)
 {
@@ -280,105 +241,19 @@ void gradMagNorm(float* M, float* S, int h, int w, float norm)
     }
 }
 
-// helper for gradHist, quantize O and M into O0, O1 and M0, M1 (uses sse)
+// helper for gradHist, quantize O and M into O0, O1 and M0, M1 (uses sse, avx2 or avx512)
 void gradQuantize(float* O, float* M, int* O0, int* O1, float* M0, float* M1, int nb, int n, float norm, int nOrients, bool full, bool interpolate)
 {
-    // assumes all *OUTPUT* matrices are 4-byte aligned
-    int i = 0, o0, o1;
-    float o, od, m;
-    __m128i _o0, _o1, *_O0, *_O1;
-    __m128 _o, _od, _m, *_M0, *_M1;
-    // define useful constants
+    // define useful constants (see simd::Kernels::quantize for the sse, avx2 or avx512 loops)
     const float oMult = (float)nOrients / (full ? 2 * PI : PI);
     const int oMax = nOrients * nb;
-    const __m128 _norm = SET(norm), _oMult = SET(oMult), _nbf = SET((float)nb);
-    const __m128i _oMax = SET(oMax), _nb = SET(nb);
-    // perform the majority of the work with sse
-    _O0 = (__m128i*)O0;
-    _O1 = (__m128i*)O1;
-    _M0 = (__m128*)M0;
-    _M1 = (__m128*)M1;
-
-    if (interpolate)
-    {
-        for (i = 0; i <= n - 4; i += 4)
-        {
-            _o = MUL(LDu(O[i]), _oMult);
-            _o0 = CVT(_o);
-            _od = SUB(_o, CVT(_o0));
-            _o0 = CVT(MUL(CVT(_o0), _nbf));
-            _o0 = AND(CMPGT(_oMax, _o0), _o0);
-            *_O0++ = _o0;
-            _o1 = ADD(_o0, _nb);
-            _o1 = AND(CMPGT(_oMax, _o1), _o1);
-            *_O1++ = _o1;
-            _m = MUL(LDu(M[i]), _norm);
-            *_M1 = MUL(_od, _m);
-            *_M0++ = SUB(_m, *_M1);
-            _M1++;
-        }
-    }
-    else
-    {
-        for (i = 0; i <= n - 4; i += 4)
-        {
-            _o = MUL(LDu(O[i]), _oMult);
-            _o0 = CVT(ADD(_o, SET(.5f)));
-            _o0 = CVT(MUL(CVT(_o0), _nbf));
-            _o0 = AND(CMPGT(_oMax, _o0), _o0);
-            *_O0++ = _o0;
-            *_M0++ = MUL(LDu(M[i]), _norm);
-            *_M1++ = SET(0.f);
-            *_O1++ = SET(0);
-        }
-    }
-
-    // compute trailing locations without sse
-    if (interpolate)
-    {
-        for (; i < n; i++)
-        {
-            o = O[i] * oMult;
-            o0 = (int)o;
-            od = o - o0;
-            o0 *= nb;
-            if (o0 >= oMax)
-            {
-                o0 = 0;
-            }
-            O0[i] = o0;
-            o1 = o0 + nb;
-            if (o1 == oMax)
-            {
-                o1 = 0;
-            }
-            O1[i] = o1;
-            m = M[i] * norm;
-            M1[i] = od * m;
-            M0[i] = m - M1[i];
-        }
-    }
-    else
-    {
-        for (; i < n; i++)
-        {
-            o = O[i] * oMult;
-            o0 = (int)(o + .5f);
-            o0 *= nb;
-            if (o0 >= oMax)
-            {
-                o0 = 0;
-            }
-            O0[i] = o0;
-            M0[i] = M[i] * norm;
-            M1[i] = 0;
-            O1[i] = 0;
-        }
-    }
+    simd::kernels().quantize(O, M, O0, O1, M0, M1, n, oMult, norm, nb, oMax, interpolate);
 }
 
-// compute nOrients gradient histograms per bin x bin block of pixels
-void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full)
+// compute nOrients gradient histograms per bin x bin block of pixels for columns [x0,x1)
+// without spatial interpolation (softBin even) each column only updates the bins of column
+// x/bin, so column ranges aligned to bin can run concurrently; otherwise use the full range
+void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full, int x0, int x1)
 {
     const int hb = h / bin, wb = w / bin, h0 = hb * bin, w0 = wb * bin, nb = wb * hb;
     const float s = (float)bin, sInv = 1 / s, sInv2 = 1 / s / s;
@@ -386,12 +261,13 @@ void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients,
     int x, y;
     int *O0, *O1;
     float xb, init;
+    assert((softBin % 2 == 0) ? (x0 % bin == 0) : (x0 == 0 && x1 >= w0));
     O0 = (int*)alMalloc(h * sizeof(int), 16);
     M0 = (float*)alMalloc(h * sizeof(float), 16);
     O1 = (int*)alMalloc(h * sizeof(int), 16);
     M1 = (float*)alMalloc(h * sizeof(float), 16);
     // main loop
-    for (x = 0; x < w0; x++)
+    for (x = x0; x < std::min(x1, w0); x++)
     {
         // compute target orientation bins for entire column - very fast
         gradQuantize(O + x * h, M + x * h, O0, O1, M0, M1, nb, h0, sInv2, nOrients, full, softBin >= 0);
@@ -664,6 +540,12 @@ void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients,
     }
 }
 
+// compute nOrients gradient histograms per bin x bin block of pixels
+void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full)
+{
+    gradHist(M, O, H, h, w, bin, nOrients, softBin, full, 0, w);
+}
+
 /******************************************************************************/
 
 // HOG helper: compute 2x2 block normalization values (padded by 1 pixel)
@@ -9,6 +9,8 @@
 #include <math.h>
 #include <typeinfo>
 #include "sse.hpp"
+#include "simd.hpp"
+#include "fixed.hpp"
 typedef unsigned char uchar;
 
 #include <opencv2/imgproc/imgproc.hpp>
@@ -18,6 +20,8 @@ typedef unsigned char uchar;
 #include <functional>
 #include <iostream>
 
+namespace simd = drishti::acf::simd;
+
 // compute interpolation values for single column for resapling
 template <class T>
 void resampleCoef(int ha, int hb, int& n, int*& yas, int*& ybs, T*& wts, int bd[2], int pad = 0)
@@ -132,6 +136,8 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
         C[y] = 0;
     }
     bool sse = (typeid(T) == typeid(float)) && !(size_t(A) & 15) && !(size_t(B) & 15);
+    bool vec = (typeid(T) == typeid(float)); // x pass uses sse, avx2 or avx512 kernels
+    const simd::Kernels& K = simd::kernels();
     // get coefficients for resampling along w and h
     int *xas, *xbs, *yas, *ybs;
     T *xwts, *ywts;
@@ -183,29 +189,32 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
             ywtsf = (float*)ywts;
             wtf = (float)wt;
             wt1f = (float)wt1;
+            const float* Af[4] = { Af0, Af1, Af2, Af3 };
 // resample along x direction (A -> C)
-#define FORs(X)                    \
-    if (sse)                       \
-        for (; y < ha - 4; y += 4) \
-            STR(Cf[y], X);
+#define FORs(X) \
+    if (vec)    \
+    {           \
+        X;      \
+        y = ha; \
+    }
 #define FORr(X)         \
     for (; y < ha; y++) \
         C[y] = X;
             if (wa == 2 * wb)
             {
-                FORs(ADD(LDu(Af0[y]), LDu(Af1[y])));
+                FORs(K.columnSum(Af, 2, Cf, ha));
                 FORr(A0[y] + A1[y]);
                 x1 += 2;
             }
             else if (wa == 3 * wb)
             {
-                FORs(ADD(LDu(Af0[y]), LDu(Af1[y]), LDu(Af2[y])));
+                FORs(K.columnSum(Af, 3, Cf, ha));
                 FORr(A0[y] + A1[y] + A2[y]);
                 x1 += 3;
             }
             else if (wa == 4 * wb)
             {
-                FORs(ADD(LDu(Af0[y]), LDu(Af1[y]), LDu(Af2[y]), LDu(Af3[y])));
+                FORs(K.columnSum(Af, 4, Cf, ha));
                 FORr(A0[y] + A1[y] + A2[y] + A3[y]);
                 x1 += 4;
             }
@@ -221,29 +230,27 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
                 {
                     wtsf[x0] = float(xwts[x1 + x0]);
                 }
-#define U(x) MUL(LDu(*(Af##x + y)), SET(wtsf[x]))
 #define V(x) *(A##x + y) * xwts[x1 + x]
                 if (m == 1)
                 {
-                    FORs(U(0));
+                    FORs(K.columnDot(Af, wtsf, 1, Cf, ha));
                     FORr(V(0));
                 }
                 if (m == 2)
                 {
-                    FORs(ADD(U(0), U(1)));
+                    FORs(K.columnDot(Af, wtsf, 2, Cf, ha));
                     FORr(V(0) + V(1));
                 }
                 if (m == 3)
                 {
-                    FORs(ADD(U(0), U(1), U(2)));
+                    FORs(K.columnDot(Af, wtsf, 3, Cf, ha));
                     FORr(V(0) + V(1) + V(2));
                 }
                 if (m >= 4)
                 {
-                    FORs(ADD(U(0), U(1), U(2), U(3)));
+                    FORs(K.columnDot(Af, wtsf, 4, Cf, ha));
                     FORr(V(0) + V(1) + V(2) + V(3));
                 }
-#undef U
 #undef V
                 for (int x0 = 4; x0 < m; x0++)
                 {
@@ -252,7 +259,7 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
                     Af1 = (float*)A1;
                     wt1f = float(wt1);
                     y = 0;
-                    FORs(ADD(LD(Cf[y]), MUL(LDu(Af1[y]), SET(wt1f))));
+                    FORs(K.columnAxpy(Af1, wt1f, Cf, ha));
                     FORr(C[y] + A1[y] * wt1);
                 }
                 x1 += m;
@@ -267,7 +274,8 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
                 }
                 if (!xBd)
                 {
-                    FORs(ADD(MUL(LDu(Af0[y]), SET(wtf)), MUL(LDu(Af1[y]), SET(wt1f))));
+                    const float wts2f[2] = { wtf, wt1f };
+                    FORs(K.columnDot(Af, wts2f, 2, Cf, ha));
                 }
                 if (!xBd)
                 {
@@ -395,21 +403,11 @@ void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm)
             resample((double*)A.ptr(), (double*)B.ptr(), ha, hb, wa, wb, d, double(nrm));
             break;
         case CV_8U:
-        {
-            MatP A1(A.size(), CV_32F, A.channels()), B1(size, CV_32F, A.channels());
-            for (int i = 0; i < A.channels(); i++)
-            {
-                A[i].convertTo(A1[i], A1[i].type());
-            }
-
-            resample((float*)A1.ptr(), (float*)B1.ptr(), ha, hb, wa, wb, A.channels(), float(nrm));
-
-            for (int i = 0; i < B.channels(); i++)
-            {
-                B1[i].convertTo(B[i], B[i].type());
-            }
+            drishti::acf::fixed::resample(A.ptr<uint8_t>(), B.ptr<uint8_t>(), ha, hb, wa, wb, d, nrm);
+            break;
+        case CV_16U:
+            drishti::acf::fixed::resample(A.ptr<uint16_t>(), B.ptr<uint16_t>(), ha, hb, wa, wb, d, nrm);
             break;
-        }
         default:
             CV_Error(-1, "Unsupported types");
     }
@@ -6,6 +6,7 @@
 *******************************************************************************/
 #include "drishti/acf/toolbox/wrappers.hpp"
 #include "drishti/acf/toolbox/sse.hpp"
+#include "drishti/acf/toolbox/simd.hpp"
 #include "drishti/acf/MatP.h"
 
 #include <cmath>
@@ -79,7 +80,7 @@ void rgb2luv(iT* I, oT* J, int n, oT nrm)
     }
 }
 
-// Convert from rgb to luv using sse
+// Convert from rgb to luv using sse (w/ avx2 or avx512 for the linear steps)
 template <class iT>
 void rgb2luv_sse(iT* I, float* J, int n, float nrm)
 {
@@ -93,6 +94,7 @@ void rgb2luv_sse(iT* I, float* J, int n, float nrm)
     int i = 0, i1, n1;
     float minu, minv, un, vn, mr[3], mg[3], mb[3];
     float* lTable = rgb2luv_setup(nrm, mr, mg, mb, minu, minv, un, vn);
+    const drishti::acf::simd::Kernels& K = drishti::acf::simd::kernels();
     while (i < n)
     {
         n1 = i + k;
@@ -125,15 +127,7 @@ void rgb2luv_sse(iT* I, float* J, int n, float nrm)
         // compute RGB -> XYZ
         for (int j = 0; j < 3; j++)
         {
-            __m128 _mr, _mg, _mb, *_J = (__m128*)(J1 + j * n);
-            __m128 *_pR = (__m128*)R1, *_pG = (__m128*)G1, *_pB = (__m128*)B1;
-            _mr = SET(mr[j]);
-            _mg = SET(mg[j]);
-            _mb = SET(mb[j]);
-            for (i1 = i; i1 < n1; i1 += 4)
-            {
-                *(_J++) = ADD(ADD(MUL(*(_pR++), _mr), MUL(*(_pG++), _mg)), MUL(*(_pB++), _mb));
-            }
+            K.linear3(R1, G1, B1, mr[j], mg[j], mb[j], J1 + j * n, n1 - i);
         }
         {
             // compute XZY -> LUV (without doing L lookup/normalization)
@@ -166,20 +160,8 @@ void rgb2luv_sse(iT* I, float* J, int n, float nrm)
             {
                 J[i1] = lTable[(int)J[i1]];
             }
-            __m128 *_pL, *_pU, *_pV, _l, _cminu, _cminv;
-            _pL = (__m128*)J1;
-            _pU = (__m128*)(J1 + n);
-            _pV = (__m128*)(J1 + 2 * n);
-            _cminu = SET(minu);
-            _cminv = SET(minv);
-            for (i1 = i; i1 < n1; i1 += 4)
-            {
-                _l = *(_pL++);
-                *_pU = SUB(MUL(_l, *_pU), _cminu);
-                _pU++;
-                *_pV = SUB(MUL(_l, *_pV), _cminv);
-                _pV++;
-            }
+            K.mulSub(J1, minu, J1 + n, n1 - i);
+            K.mulSub(J1, minv, J1 + 2 * n, n1 - i);
         }
         i = n1;
     }
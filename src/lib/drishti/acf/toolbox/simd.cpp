@@ -0,0 +1,149 @@
+/*! -*-c++-*-
+  @file   simd.cpp
+  @brief  Scalar and 128 bit ACF toolbox kernels and runtime CPU dispatch (see simd.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/acf/toolbox/simd.hpp"
+#include "drishti/acf/toolbox/simdKernels.hpp"
+#include "drishti/acf/toolbox/sse.hpp" // SSE2 or NEON (via SSE2NEON)
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace simd
+{
+
+// Wider x86 backends are compiled in separate translation units w/ their own target flags:
+const Kernels* getKernelsAVX2();           // simdAVX2.cpp
+const Kernels* getKernelsAVX512();         // simdAVX512.cpp
+WindowLanes getWindowLanesAVX2(int depth); // acfDetectAVX2.cpp
+
+namespace
+{
+
+struct SSE
+{
+    typedef __m128 f32;
+    typedef __m128i i32;
+    static const int width = 4;
+
+    static f32 load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, f32 x) { _mm_storeu_ps(p, x); }
+    static f32 set(float x) { return _mm_set1_ps(x); }
+    static f32 add(f32 a, f32 b) { return _mm_add_ps(a, b); }
+    static f32 sub(f32 a, f32 b) { return _mm_sub_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm_mul_ps(a, b); }
+    static f32 selectGT(f32 a, f32 b, f32 x, f32 y)
+    {
+        const f32 m = _mm_cmpgt_ps(a, b);
+        return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y));
+    }
+
+    static i32 seti(int x) { return _mm_set1_epi32(x); }
+    static i32 addi(i32 a, i32 b) { return _mm_add_epi32(a, b); }
+    static void storei(int* p, i32 x) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x); }
+    static f32 cvt(i32 x) { return _mm_cvtepi32_ps(x); }
+    static i32 cvtt(f32 x) { return _mm_cvttps_epi32(x); }
+    static i32 keepBelow(i32 x, i32 limit) { return _mm_and_si128(_mm_cmpgt_epi32(limit, x), x); }
+};
+
+std::atomic<const Kernels*>& active()
+{
+    static std::atomic<const Kernels*> kernels(getKernels(getBestIsa()));
+    return kernels;
+}
+
+} // namespace
+
+const Kernels* getKernels(Isa isa)
+{
+    switch (isa)
+    {
+        case kScalar:
+        {
+            static const Kernels kernels = makeKernels<Scalar>(kScalar);
+            return &kernels;
+        }
+        case kSSE:
+        {
+            static const Kernels kernels = makeKernels<SSE>(kSSE);
+            return &kernels;
+        }
+        case kAVX2:
+            return cv::checkHardwareSupport(CV_CPU_AVX2) ? getKernelsAVX2() : nullptr;
+        case kAVX512:
+            return cv::checkHardwareSupport(CV_CPU_AVX_512F) ? getKernelsAVX512() : nullptr;
+    }
+    return nullptr;
+}
+
+const Kernels& kernels()
+{
+    return *active().load(std::memory_order_acquire);
+}
+
+bool setIsa(Isa isa)
+{
+    const Kernels* kernels = getKernels(isa);
+    if (kernels)
+    {
+        active().store(kernels, std::memory_order_release);
+    }
+    return (kernels != nullptr);
+}
+
+Isa getIsa()
+{
+    return kernels().isa;
+}
+
+Isa getBestIsa()
+{
+    for (auto isa : { kAVX512, kAVX2, kSSE })
+    {
+        if (getKernels(isa))
+        {
+            return isa;
+        }
+    }
+    return kScalar;
+}
+
+WindowLanes getWindowLanes(int depth)
+{
+    switch (getIsa())
+    {
+        case kAVX2:
+        case kAVX512:
+            return getKernels(kAVX2) ? getWindowLanesAVX2(depth) : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+const char* getIsaName(Isa isa)
+{
+    switch (isa)
+    {
+        case kScalar:
+            return "scalar";
+        case kSSE:
+            return "sse";
+        case kAVX2:
+            return "avx2";
+        case kAVX512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+} // namespace simd
+
+DRISHTI_ACF_NAMESPACE_END
@@ -0,0 +1,130 @@
+/*! -*-c++-*-
+  @file   simd.hpp
+  @brief  Width agnostic SIMD kernels for the ACF toolbox w/ runtime CPU dispatch.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  The elementwise inner loops of the toolbox (gradients, orientation quantization,
+  separable convolution passes, resampling and color conversion) are written once
+  against a small vector ops interface (see simdKernels.hpp) and instantiated for
+  each instruction set:
+
+    kScalar : plain C++ reference
+    kSSE    : 128 bit SSE2 (NEON on ARM via SSE2NEON)
+    kAVX2   : 256 bit AVX2 (x86, selected at runtime)
+    kAVX512 : 512 bit AVX-512F (x86, selected at runtime)
+
+  Each kernel performs the same sequence of IEEE single precision operations at
+  every width (no FMA contraction, no reciprocal approximations), so all backends
+  produce output identical to the scalar reference.  The approximate RCP/RCPSQRT
+  steps in gradMag(), gradMagNorm() and rgb2luv_sse() remain 128 bit SSE.
+
+*/
+
+#ifndef __drishti_acf_toolbox_simd_hpp__
+#define __drishti_acf_toolbox_simd_hpp__
+
+#include "drishti/acf/drishti_acf.h"
+
+#include <cstdint>
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace simd
+{
+
+enum Isa
+{
+    kScalar,
+    kSSE,
+    kAVX2,
+    kAVX512
+};
+
+struct Kernels
+{
+    Isa isa;
+    int width; // floats per vector
+
+    // out = (a - b) * r
+    void (*diffScale)(const float* a, const float* b, float r, float* out, int n);
+
+    // m2 = gx * gx + gy * gy
+    void (*magSq)(const float* gx, const float* gy, float* m2, int n);
+
+    // keep the channel (gxc, gyc) where its squared magnitude exceeds m2
+    void (*magSqMax)(const float* gxc, const float* gyc, float* gx, float* gy, float* m2, int n);
+
+    // o += (g < 0) * v
+    void (*addIfNegative)(const float* g, float v, float* o, int n);
+
+    // orientation binning for gradHist() (see gradQuantize())
+    void (*quantize)(const float* O, const float* M, int* O0, int* O1, float* M0, float* M1, int n, float oMult, float norm, int nb, int oMax, bool interpolate);
+
+    // t = nrm * (l + p * m + r)
+    void (*tri1X)(const float* l, const float* m, const float* r, float p, float nrm, float* t, int n);
+
+    // t += l + r - 2 * m, u += nrm * t
+    void (*triX)(const float* l, const float* m, const float* r, float nrm, float* t, float* u, int n);
+
+    // t -= nrm * (l - r)
+    void (*boxX)(const float* l, const float* r, float nrm, float* t, int n);
+
+    // c = a[0] + ... + a[m-1], m in [2,4]
+    void (*columnSum)(const float* const* a, int m, float* c, int n);
+
+    // c = a[0] * w[0] + ... + a[m-1] * w[m-1], m in [1,4]
+    void (*columnDot)(const float* const* a, const float* w, int m, float* c, int n);
+
+    // c += a * w
+    void (*columnAxpy)(const float* a, float w, float* c, int n);
+
+    // out = r * mr + g * mg + b * mb
+    void (*linear3)(const float* r, const float* g, const float* b, float mr, float mg, float mb, float* out, int n);
+
+    // u = l * u - c
+    void (*mulSub)(const float* l, float c, float* u, int n);
+};
+
+// Kernels for the requested instruction set, or nullptr if it is not compiled in or not
+// supported by the CPU:
+const Kernels* getKernels(Isa isa);
+
+// Active kernels (the widest supported instruction set by default):
+const Kernels& kernels();
+
+// Select the active kernels (i.e., kScalar for reference output), returns false if unavailable:
+bool setIsa(Isa isa);
+Isa getIsa();
+Isa getBestIsa();
+
+const char* getIsaName(Isa isa);
+
+// ACF soft cascade of complete binary trees in the interleaved node layout used for
+// detection (see Detector::Classifier::Node and acfDetect1.cpp):
+struct Cascade
+{
+    const void* nodes;     // { uint32_t fid; float value; } nodes, nTreeNodes per tree
+    const uint32_t* cids;  // channel offset for each feature id
+    int nTrees;
+    int nTreeNodes;        // padded tree stride in nodes
+    float cascThr;         // final threshold
+    const float* cascThrs; // per tree rejection thresholds
+};
+
+// Score kWindowLanes windows (chns + offsets[i]) w/ one lane per window, returning the score
+// in h[i] (clamped to cascThr if rejected) and the last tree evaluated in stages[i], identical
+// to the scalar evaluation.
+static const int kWindowLanes = 8;
+typedef void (*WindowLanes)(const Cascade& cascade, const float* chns, const int* offsets, float* h, int* stages);
+
+// Window lane evaluation for trees of the given depth [1,8] w/ the active instruction set, or
+// nullptr if it has no gather (i.e., use the scalar evaluation):
+WindowLanes getWindowLanes(int depth);
+
+} // namespace simd
+
+DRISHTI_ACF_NAMESPACE_END
+
+#endif // __drishti_acf_toolbox_simd_hpp__
@@ -0,0 +1,67 @@
+/*! -*-c++-*-
+  @file   simdAVX2.cpp
+  @brief  256 bit AVX2 ACF toolbox kernels (see simd.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  This file is compiled w/ AVX2 enabled on x86 and is only called after a runtime
+  check, so it must not instantiate (or include) anything w/ external linkage
+  that the baseline code could share.
+
+*/
+
+#include "drishti/acf/toolbox/simd.hpp"
+
+#if defined(__AVX2__)
+#include "drishti/acf/toolbox/simdKernels.hpp"
+#include <immintrin.h>
+#endif
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace simd
+{
+
+#if defined(__AVX2__)
+namespace
+{
+
+struct AVX2
+{
+    typedef __m256 f32;
+    typedef __m256i i32;
+    static const int width = 8;
+
+    static f32 load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, f32 x) { _mm256_storeu_ps(p, x); }
+    static f32 set(float x) { return _mm256_set1_ps(x); }
+    static f32 add(f32 a, f32 b) { return _mm256_add_ps(a, b); }
+    static f32 sub(f32 a, f32 b) { return _mm256_sub_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm256_mul_ps(a, b); }
+    static f32 selectGT(f32 a, f32 b, f32 x, f32 y) { return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+
+    static i32 seti(int x) { return _mm256_set1_epi32(x); }
+    static i32 addi(i32 a, i32 b) { return _mm256_add_epi32(a, b); }
+    static void storei(int* p, i32 x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+    static f32 cvt(i32 x) { return _mm256_cvtepi32_ps(x); }
+    static i32 cvtt(f32 x) { return _mm256_cvttps_epi32(x); }
+    static i32 keepBelow(i32 x, i32 limit) { return _mm256_and_si256(_mm256_cmpgt_epi32(limit, x), x); }
+};
+
+} // namespace
+#endif
+
+const Kernels* getKernelsAVX2()
+{
+#if defined(__AVX2__)
+    static const Kernels kernels = makeKernels<AVX2>(kAVX2);
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace simd
+
+DRISHTI_ACF_NAMESPACE_END
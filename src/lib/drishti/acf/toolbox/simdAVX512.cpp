@@ -0,0 +1,66 @@
+/*! -*-c++-*-
+  @file   simdAVX512.cpp
+  @brief  512 bit AVX-512F ACF toolbox kernels (see simd.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  This file is compiled w/ AVX-512F enabled on x86 and is only called after a
+  runtime check (see simdAVX2.cpp).
+
+*/
+
+#include "drishti/acf/toolbox/simd.hpp"
+
+#if defined(__AVX512F__)
+#include "drishti/acf/toolbox/simdKernels.hpp"
+#include <immintrin.h>
+#endif
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace simd
+{
+
+#if defined(__AVX512F__)
+namespace
+{
+
+struct AVX512
+{
+    typedef __m512 f32;
+    typedef __m512i i32;
+    static const int width = 16;
+
+    static f32 load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, f32 x) { _mm512_storeu_ps(p, x); }
+    static f32 set(float x) { return _mm512_set1_ps(x); }
+    static f32 add(f32 a, f32 b) { return _mm512_add_ps(a, b); }
+    static f32 sub(f32 a, f32 b) { return _mm512_sub_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm512_mul_ps(a, b); }
+    static f32 selectGT(f32 a, f32 b, f32 x, f32 y) { return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ), y, x); }
+
+    static i32 seti(int x) { return _mm512_set1_epi32(x); }
+    static i32 addi(i32 a, i32 b) { return _mm512_add_epi32(a, b); }
+    static void storei(int* p, i32 x) { _mm512_storeu_si512(p, x); }
+    static f32 cvt(i32 x) { return _mm512_cvtepi32_ps(x); }
+    static i32 cvtt(f32 x) { return _mm512_cvttps_epi32(x); }
+    static i32 keepBelow(i32 x, i32 limit) { return _mm512_maskz_mov_epi32(_mm512_cmplt_epi32_mask(x, limit), x); }
+};
+
+} // namespace
+#endif
+
+const Kernels* getKernelsAVX512()
+{
+#if defined(__AVX512F__)
+    static const Kernels kernels = makeKernels<AVX512>(kAVX512);
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace simd
+
+DRISHTI_ACF_NAMESPACE_END
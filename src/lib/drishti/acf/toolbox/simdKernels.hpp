@@ -0,0 +1,414 @@
+/*! -*-c++-*-
+  @file   simdKernels.hpp
+  @brief  Width agnostic ACF toolbox kernels (internal, see simd.hpp).
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Kernels are templates on a vector ops type V providing:
+
+    f32, i32, width
+    load(p), store(p, x), set(x), add(a, b), sub(a, b), mul(a, b)
+    selectGT(a, b, x, y) : (a > b) ? x : y
+    seti(x), addi(a, b), storei(p, x), cvt(i32), cvtt(f32) (truncation)
+    keepBelow(x, limit)  : (x < limit) ? x : 0
+
+  The remainder of each row is processed with scalar code that performs the same
+  operations as the vector loop.
+
+  This header is included by one translation unit per instruction set, each of
+  which is compiled with its own target flags, so everything here has internal
+  linkage: an AVX2 instantiation must never be selected by the linker in place
+  of the baseline code.
+
+*/
+
+#ifndef __drishti_acf_toolbox_simdKernels_hpp__
+#define __drishti_acf_toolbox_simdKernels_hpp__
+
+#include "drishti/acf/toolbox/simd.hpp"
+
+DRISHTI_ACF_NAMESPACE_BEGIN
+
+namespace simd
+{
+namespace
+{
+
+struct Scalar
+{
+    typedef float f32;
+    typedef int i32;
+    static const int width = 1;
+
+    static f32 load(const float* p) { return *p; }
+    static void store(float* p, f32 x) { *p = x; }
+    static f32 set(float x) { return x; }
+    static f32 add(f32 a, f32 b) { return a + b; }
+    static f32 sub(f32 a, f32 b) { return a - b; }
+    static f32 mul(f32 a, f32 b) { return a * b; }
+    static f32 selectGT(f32 a, f32 b, f32 x, f32 y) { return (a > b) ? x : y; }
+
+    static i32 seti(int x) { return x; }
+    static i32 addi(i32 a, i32 b) { return a + b; }
+    static void storei(int* p, i32 x) { *p = x; }
+    static f32 cvt(i32 x) { return static_cast<float>(x); }
+    static i32 cvtt(f32 x) { return static_cast<int>(x); }
+    static i32 keepBelow(i32 x, i32 limit) { return (x < limit) ? x : 0; }
+};
+
+template <typename V>
+void diffScale(const float* a, const float* b, float r, float* out, int n)
+{
+    const typename V::f32 _r = V::set(r);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(out + i, V::mul(V::sub(V::load(a + i), V::load(b + i)), _r));
+    }
+    for (; i < n; i++)
+    {
+        out[i] = (a[i] - b[i]) * r;
+    }
+}
+
+template <typename V>
+void magSq(const float* gx, const float* gy, float* m2, int n)
+{
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        const typename V::f32 x = V::load(gx + i), y = V::load(gy + i);
+        V::store(m2 + i, V::add(V::mul(x, x), V::mul(y, y)));
+    }
+    for (; i < n; i++)
+    {
+        m2[i] = gx[i] * gx[i] + gy[i] * gy[i];
+    }
+}
+
+template <typename V>
+void magSqMax(const float* gxc, const float* gyc, float* gx, float* gy, float* m2, int n)
+{
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        const typename V::f32 x = V::load(gxc + i), y = V::load(gyc + i);
+        const typename V::f32 m2c = V::add(V::mul(x, x), V::mul(y, y)), m2i = V::load(m2 + i);
+        V::store(gx + i, V::selectGT(m2c, m2i, x, V::load(gx + i)));
+        V::store(gy + i, V::selectGT(m2c, m2i, y, V::load(gy + i)));
+        V::store(m2 + i, V::selectGT(m2c, m2i, m2c, m2i));
+    }
+    for (; i < n; i++)
+    {
+        const float m2c = gxc[i] * gxc[i] + gyc[i] * gyc[i];
+        if (m2c > m2[i])
+        {
+            m2[i] = m2c;
+            gx[i] = gxc[i];
+            gy[i] = gyc[i];
+        }
+    }
+}
+
+template <typename V>
+void addIfNegative(const float* g, float v, float* o, int n)
+{
+    const typename V::f32 _v = V::set(v), _0 = V::set(0.f);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(o + i, V::add(V::load(o + i), V::selectGT(_0, V::load(g + i), _v, _0)));
+    }
+    for (; i < n; i++)
+    {
+        o[i] += (g[i] < 0) * v;
+    }
+}
+
+template <typename V>
+void quantize(const float* O, const float* M, int* O0, int* O1, float* M0, float* M1, int n, float oMult, float norm, int nb, int oMax, bool interpolate)
+{
+    const typename V::f32 _oMult = V::set(oMult), _norm = V::set(norm), _nbf = V::set(static_cast<float>(nb));
+    const typename V::i32 _oMax = V::seti(oMax), _nb = V::seti(nb);
+    int i = 0;
+    if (interpolate)
+    {
+        for (; i <= n - V::width; i += V::width)
+        {
+            const typename V::f32 o = V::mul(V::load(O + i), _oMult);
+            typename V::i32 o0 = V::cvtt(o);
+            const typename V::f32 od = V::sub(o, V::cvt(o0));
+            o0 = V::keepBelow(V::cvtt(V::mul(V::cvt(o0), _nbf)), _oMax);
+            V::storei(O0 + i, o0);
+            V::storei(O1 + i, V::keepBelow(V::addi(o0, _nb), _oMax));
+            const typename V::f32 m = V::mul(V::load(M + i), _norm), m1 = V::mul(od, m);
+            V::store(M1 + i, m1);
+            V::store(M0 + i, V::sub(m, m1));
+        }
+        for (; i < n; i++)
+        {
+            const float o = O[i] * oMult;
+            int o0 = static_cast<int>(o);
+            const float od = o - o0;
+            o0 *= nb;
+            if (o0 >= oMax)
+            {
+                o0 = 0;
+            }
+            O0[i] = o0;
+            int o1 = o0 + nb;
+            if (o1 == oMax)
+            {
+                o1 = 0;
+            }
+            O1[i] = o1;
+            const float m = M[i] * norm;
+            M1[i] = od * m;
+            M0[i] = m - M1[i];
+        }
+    }
+    else
+    {
+        const typename V::f32 _half = V::set(.5f), _0 = V::set(0.f);
+        const typename V::i32 _0i = V::seti(0);
+        for (; i <= n - V::width; i += V::width)
+        {
+            const typename V::f32 o = V::mul(V::load(O + i), _oMult);
+            const typename V::i32 o0 = V::cvtt(V::mul(V::cvt(V::cvtt(V::add(o, _half))), _nbf));
+            V::storei(O0 + i, V::keepBelow(o0, _oMax));
+            V::store(M0 + i, V::mul(V::load(M + i), _norm));
+            V::store(M1 + i, _0);
+            V::storei(O1 + i, _0i);
+        }
+        for (; i < n; i++)
+        {
+            const float o = O[i] * oMult;
+            int o0 = static_cast<int>(o + .5f);
+            o0 *= nb;
+            if (o0 >= oMax)
+            {
+                o0 = 0;
+            }
+            O0[i] = o0;
+            M0[i] = M[i] * norm;
+            M1[i] = 0;
+            O1[i] = 0;
+        }
+    }
+}
+
+template <typename V>
+void tri1X(const float* l, const float* m, const float* r, float p, float nrm, float* t, int n)
+{
+    const typename V::f32 _p = V::set(p), _nrm = V::set(nrm);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(t + i, V::mul(_nrm, V::add(V::add(V::load(l + i), V::mul(_p, V::load(m + i))), V::load(r + i))));
+    }
+    for (; i < n; i++)
+    {
+        t[i] = nrm * (l[i] + p * m[i] + r[i]);
+    }
+}
+
+template <typename V>
+void triX(const float* l, const float* m, const float* r, float nrm, float* t, float* u, int n)
+{
+    const typename V::f32 _nrm = V::set(nrm), _m2 = V::set(-2.f);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        const typename V::f32 ti = V::add(V::load(t + i), V::add(V::add(V::load(l + i), V::load(r + i)), V::mul(_m2, V::load(m + i))));
+        V::store(t + i, ti);
+        V::store(u + i, V::add(V::load(u + i), V::mul(_nrm, ti)));
+    }
+    for (; i < n; i++)
+    {
+        u[i] += nrm * (t[i] += l[i] + r[i] - 2 * m[i]);
+    }
+}
+
+template <typename V>
+void boxX(const float* l, const float* r, float nrm, float* t, int n)
+{
+    const typename V::f32 _nrm = V::set(nrm);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(t + i, V::sub(V::load(t + i), V::mul(_nrm, V::sub(V::load(l + i), V::load(r + i)))));
+    }
+    for (; i < n; i++)
+    {
+        t[i] -= nrm * (l[i] - r[i]);
+    }
+}
+
+template <typename V>
+void columnSum(const float* const* a, int m, float* c, int n)
+{
+    const float *a0 = a[0], *a1 = a[1], *a2 = a[m > 2 ? 2 : 0], *a3 = a[m > 3 ? 3 : 0];
+    int i = 0;
+    switch (m)
+    {
+        case 2:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, V::add(V::load(a0 + i), V::load(a1 + i)));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] + a1[i];
+            }
+            break;
+        case 3:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, V::add(V::add(V::load(a0 + i), V::load(a1 + i)), V::load(a2 + i)));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] + a1[i] + a2[i];
+            }
+            break;
+        case 4:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, V::add(V::add(V::add(V::load(a0 + i), V::load(a1 + i)), V::load(a2 + i)), V::load(a3 + i)));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] + a1[i] + a2[i] + a3[i];
+            }
+            break;
+    }
+}
+
+template <typename V>
+void columnDot(const float* const* a, const float* w, int m, float* c, int n)
+{
+    const float *a0 = a[0], *a1 = a[m > 1 ? 1 : 0], *a2 = a[m > 2 ? 2 : 0], *a3 = a[m > 3 ? 3 : 0];
+    const float w0 = w[0], w1 = w[m > 1 ? 1 : 0], w2 = w[m > 2 ? 2 : 0], w3 = w[m > 3 ? 3 : 0];
+    const typename V::f32 _w0 = V::set(w0), _w1 = V::set(w1), _w2 = V::set(w2), _w3 = V::set(w3);
+#define U(k) V::mul(V::load(a##k + i), _w##k)
+    int i = 0;
+    switch (m)
+    {
+        case 1:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, U(0));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] * w0;
+            }
+            break;
+        case 2:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, V::add(U(0), U(1)));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] * w0 + a1[i] * w1;
+            }
+            break;
+        case 3:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, V::add(V::add(U(0), U(1)), U(2)));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] * w0 + a1[i] * w1 + a2[i] * w2;
+            }
+            break;
+        case 4:
+            for (; i <= n - V::width; i += V::width)
+            {
+                V::store(c + i, V::add(V::add(V::add(U(0), U(1)), U(2)), U(3)));
+            }
+            for (; i < n; i++)
+            {
+                c[i] = a0[i] * w0 + a1[i] * w1 + a2[i] * w2 + a3[i] * w3;
+            }
+            break;
+    }
+#undef U
+}
+
+template <typename V>
+void columnAxpy(const float* a, float w, float* c, int n)
+{
+    const typename V::f32 _w = V::set(w);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(c + i, V::add(V::load(c + i), V::mul(V::load(a + i), _w)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] += a[i] * w;
+    }
+}
+
+template <typename V>
+void linear3(const float* r, const float* g, const float* b, float mr, float mg, float mb, float* out, int n)
+{
+    const typename V::f32 _mr = V::set(mr), _mg = V::set(mg), _mb = V::set(mb);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(out + i, V::add(V::add(V::mul(V::load(r + i), _mr), V::mul(V::load(g + i), _mg)), V::mul(V::load(b + i), _mb)));
+    }
+    for (; i < n; i++)
+    {
+        out[i] = r[i] * mr + g[i] * mg + b[i] * mb;
+    }
+}
+
+template <typename V>
+void mulSub(const float* l, float c, float* u, int n)
+{
+    const typename V::f32 _c = V::set(c);
+    int i = 0;
+    for (; i <= n - V::width; i += V::width)
+    {
+        V::store(u + i, V::sub(V::mul(V::load(l + i), V::load(u + i)), _c));
+    }
+    for (; i < n; i++)
+    {
+        u[i] = l[i] * u[i] - c;
+    }
+}
+
+template <typename V>
+Kernels makeKernels(Isa isa)
+{
+    Kernels k;
+    k.isa = isa;
+    k.width = V::width;
+    k.diffScale = &diffScale<V>;
+    k.magSq = &magSq<V>;
+    k.magSqMax = &magSqMax<V>;
+    k.addIfNegative = &addIfNegative<V>;
+    k.quantize = &quantize<V>;
+    k.tri1X = &tri1X<V>;
+    k.triX = &triX<V>;
+    k.boxX = &boxX<V>;
+    k.columnSum = &columnSum<V>;
+    k.columnDot = &columnDot<V>;
+    k.columnAxpy = &columnAxpy<V>;
+    k.linear3 = &linear3<V>;
+    k.mulSub = &mulSub<V>;
+    return k;
+}
+
+} // namespace
+} // namespace simd
+
+DRISHTI_ACF_NAMESPACE_END
+
+#endif // __drishti_acf_toolbox_simdKernels_hpp__
@@ -42,14 +42,20 @@
 #include <gtest/gtest.h>
 
 #include "drishti/core/drawing.h"
+#include "drishti/core/drishti_algorithm.h"
 #include "drishti/acf/ACF.h"
 #include "drishti/acf/MatP.h"
+#include "drishti/acf/toolbox/simd.hpp"
 #include "drishti/core/Logger.h"
 #include "drishti/geometry/Primitives.h"
 
+#include "test-nms-reference.h"
+
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <memory>
 
@@ -95,6 +101,7 @@ struct WaitKey
 static bool isEqual(const cv::Mat& a, const cv::Mat& b);
 static bool isEqual(const drishti::acf::Detector& a, const drishti::acf::Detector& b);
 static cv::Mat draw(drishti::acf::Detector::Pyramid& pyramid);
+static drishti::acf::Detector::DetectionVec detectReference(const drishti::acf::Detector::Classifier& clf, const drishti::acf::MatP& chns, int shrink, const cv::Size& modelDsPad, int stride, float cascThr);
 
 class ACFTest : public ::testing::Test
 {
@@ -328,6 +335,118 @@ TEST_F(ACFTest, ACFDetectionCPUMatP)
     ASSERT_GT(objects.size(), 0); // Very weak test!!!
 }
 
+// The tiled scan must produce the same detections, in the same order, for any thread count:
+TEST_F(ACFTest, ACFDetectionCPUThreadInvariance)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    detector->setIsTranspose(true);
+    detector->setDoNonMaximaSuppression(false);
+
+    const int nThreads = cv::getNumThreads();
+
+    std::vector<double> scores1, scoresN;
+    std::vector<cv::Rect> objects1, objectsN;
+
+    cv::setNumThreads(1);
+    (*detector)(m_IpT, objects1, &scores1);
+
+    cv::setNumThreads(nThreads);
+    (*detector)(m_IpT, objectsN, &scoresN);
+
+    ASSERT_EQ(objects1, objectsN);
+    ASSERT_EQ(scores1, scoresN);
+}
+
+// Scanning all levels in one pass must match the level by level search:
+TEST_F(ACFTest, ACFDetectionCPUParallelScales)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    detector->setIsTranspose(true);
+    detector->setDoNonMaximaSuppression(false);
+
+    std::vector<double> scoresS, scoresP;
+    std::vector<cv::Rect> objectsS, objectsP;
+
+    detector->setDoParallelScales(false);
+    (*detector)(m_IpT, objectsS, &scoresS);
+
+    detector->setDoParallelScales(true);
+    (*detector)(m_IpT, objectsP, &scoresP);
+
+    ASSERT_EQ(objectsS, objectsP);
+    ASSERT_EQ(scoresS, scoresP);
+}
+
+// Batched detection w/ mixed image sizes must match the per image search:
+TEST_F(ACFTest, ACFDetectionCPUBatch)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    detector->setIsTranspose(false);
+    detector->setDoNonMaximaSuppression(true);
+
+    cv::Mat I2, I3;
+    cv::resize(m_I, I2, {}, 0.75, 0.75, cv::INTER_AREA);
+    cv::flip(m_I, I3, 1);
+    const std::vector<cv::Mat> images = { m_I, I2, cv::Mat(), I3 };
+
+    std::vector<std::vector<double>> scoresB;
+    std::vector<std::vector<cv::Rect>> objectsB;
+    (*detector)(images, objectsB, &scoresB);
+    ASSERT_EQ(objectsB.size(), images.size());
+    ASSERT_EQ(scoresB.size(), images.size());
+
+    for (int i = 0; i < images.size(); i++)
+    {
+        std::vector<double> scores;
+        std::vector<cv::Rect> objects;
+        if (!images[i].empty())
+        {
+            (*detector)(images[i], objects, &scores);
+        }
+        ASSERT_EQ(objects, objectsB[i]);
+        ASSERT_EQ(scores, scoresB[i]);
+    }
+
+    ASSERT_GT(objectsB[0].size(), 0);
+}
+
+TEST_F(ACFTest, ACFDetectionCPUSoftCascade)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    detector->setIsTranspose(true);
+    detector->setDoNonMaximaSuppression(false);
+
+    std::vector<double> scores0, scores1;
+    std::vector<cv::Rect> objects0, objects1;
+
+    detector->resetCascadeStats();
+    detector->setDoCascadeStats(true);
+    (*detector)(m_IpT, objects0, &scores0);
+    detector->setDoCascadeStats(false);
+
+    // Every window is either accepted or rejected at exactly one stage:
+    const auto stats = detector->getCascadeStats();
+    ASSERT_EQ(stats.rejected.size(), static_cast<std::size_t>(detector->clf.fids.rows));
+    ASSERT_EQ(stats.accepted, objects0.size());
+    ASSERT_GT(stats.windows(), stats.accepted);
+
+    // A constant rejection trace is equivalent to the cascade threshold:
+    detector->clf.rejection.assign(detector->clf.fids.rows, float(*detector->opts.cascThr));
+    (*detector)(m_IpT, objects1, &scores1);
+    detector->clf.rejection.clear();
+
+    ASSERT_EQ(objects0, objects1);
+    ASSERT_EQ(scores0, scores1);
+}
+
 // Pull out the ACF intermediate results from the logger:
 //
 //using ChannelLogger = int(const cv::Mat &, const std::string &);
@@ -386,6 +505,418 @@ TEST_F(ACFTest, ACFPyramidCPU)
     ASSERT_GT(pyramid->data.max_size(), 0);
 }
 
+// The real scales are computed in parallel (w/ reused buffers), so repeated and single threaded
+// pyramids must be identical:
+TEST_F(ACFTest, ACFPyramidCPUThreadInvariance)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+    detector->setIsTranspose(true);
+
+    const int nThreads = cv::getNumThreads();
+
+    drishti::acf::Detector::Pyramid P1, PN, PN2;
+    cv::setNumThreads(1);
+    detector->computePyramid(m_IpT, P1);
+
+    cv::setNumThreads(nThreads);
+    detector->computePyramid(m_IpT, PN);
+    detector->computePyramid(m_IpT, PN2);
+
+    ASSERT_EQ(P1.nScales, PN.nScales);
+    for (int i = 0; i < P1.nScales; i++)
+    {
+        for (int j = 0; j < P1.data[i].size(); j++)
+        {
+            for (int k = 0; k < P1.data[i][j].channels(); k++)
+            {
+                ASSERT_EQ(cv::norm(P1.data[i][j][k], PN.data[i][j][k], cv::NORM_INF), 0.0);
+                ASSERT_EQ(cv::norm(PN.data[i][j][k], PN2.data[i][j][k], cv::NORM_INF), 0.0);
+            }
+        }
+    }
+}
+
+// After the first frame the workspace slab is sized, and the pyramid planes must come from the
+// slab with identical content:
+TEST_F(ACFTest, ACFPyramidCPUWorkspace)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+    detector->setIsTranspose(true);
+
+    drishti::acf::Detector::Pyramid P, P1, P2;
+    detector->computePyramid(m_IpT, P);
+
+    drishti::acf::PyramidWorkspace workspace;
+    detector->computePyramid(m_IpT, P1, &workspace);
+    ASSERT_GT(workspace.getOverflowCount(), 0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        detector->computePyramid(m_IpT, P2, &workspace);
+        ASSERT_EQ(workspace.getOverflowCount(), 0);
+    }
+
+    ASSERT_EQ(P.nScales, P2.nScales);
+    for (int i = 0; i < P.nScales; i++)
+    {
+        for (int j = 0; j < P.data[i].size(); j++)
+        {
+            for (int k = 0; k < P.data[i][j].channels(); k++)
+            {
+                ASSERT_EQ(cv::norm(P.data[i][j][k], P2.data[i][j][k], cv::NORM_INF), 0.0);
+            }
+        }
+    }
+}
+
+// Each SIMD backend must reproduce the scalar toolbox kernels bit for bit (odd lengths exercise
+// the scalar remainder of each row):
+TEST_F(ACFTest, ACFToolboxSimdKernels)
+{
+    namespace simd = drishti::acf::simd;
+
+    const int n = 1031;
+    cv::RNG rng(1);
+    cv::Mat1f a(1, n), b(1, n), c(1, n), d(1, n);
+    rng.fill(a, cv::RNG::UNIFORM, -1.f, 1.f);
+    rng.fill(b, cv::RNG::UNIFORM, -1.f, 1.f);
+    rng.fill(c, cv::RNG::UNIFORM, -1.f, 1.f);
+    rng.fill(d, cv::RNG::UNIFORM, -1.f, 1.f);
+    cv::Mat1f angle(1, n);
+    rng.fill(angle, cv::RNG::UNIFORM, 0.f, float(2.0 * CV_PI));
+
+    const float* columns[4] = { a[0], b[0], c[0], d[0] };
+    const float weights[4] = { 0.125f, 0.3f, 0.7f, 1.1f };
+
+    // Run all kernels w/ the given backend, returning the concatenated output:
+    auto run = [&](const simd::Kernels& K) {
+        std::vector<cv::Mat> outputs;
+        auto output = [&](const cv::Mat& init) {
+            outputs.push_back(init.clone());
+            return outputs.back().ptr<float>();
+        };
+
+        K.diffScale(a[0], b[0], 0.5f, output(c), n);
+        K.magSq(a[0], b[0], output(c), n);
+        float *gx = output(a), *gy = output(b), *m2 = output(d.mul(d));
+        K.magSqMax(c[0], d[0], gx, gy, m2, n);
+        K.addIfNegative(b[0], float(CV_PI), output(a), n);
+        for (int interpolate = 0; interpolate < 2; interpolate++)
+        {
+            cv::Mat1i O0(1, n), O1(1, n);
+            K.quantize(angle[0], a[0], O0[0], O1[0], output(c), output(d), n, float(6.0 / (2.0 * CV_PI)), 0.25f, 3, 18, interpolate);
+            outputs.push_back(O0.clone());
+            outputs.push_back(O1.clone());
+        }
+        K.tri1X(a[0], b[0], c[0], 1.3f, 0.1f, output(d), n);
+        float *t = output(a), *u = output(b);
+        K.triX(b[0], c[0], d[0], 0.04f, t, u, n);
+        K.boxX(c[0], d[0], 0.04f, output(a), n);
+        for (int m = 2; m <= 4; m++)
+        {
+            K.columnSum(columns, m, output(a), n);
+        }
+        for (int m = 1; m <= 4; m++)
+        {
+            K.columnDot(columns, weights, m, output(a), n);
+        }
+        K.columnAxpy(a[0], 0.3f, output(b), n);
+        K.linear3(a[0], b[0], c[0], 0.4f, 0.35f, 0.18f, output(d), n);
+        K.mulSub(a[0], 0.3f, output(b), n);
+        return outputs;
+    };
+
+    const auto* scalar = simd::getKernels(simd::kScalar);
+    ASSERT_NE(scalar, nullptr);
+    const auto golden = run(*scalar);
+
+    for (auto isa : { simd::kSSE, simd::kAVX2, simd::kAVX512 })
+    {
+        if (const auto* kernels = simd::getKernels(isa))
+        {
+            const auto outputs = run(*kernels);
+            ASSERT_EQ(outputs.size(), golden.size());
+            for (std::size_t i = 0; i < golden.size(); i++)
+            {
+                ASSERT_TRUE(isEqual(outputs[i], golden[i])) << simd::getIsaName(isa) << " output " << i;
+            }
+        }
+    }
+}
+
+// Pyramids (color conversion, resampling, gradients, histograms and smoothing) computed with each
+// SIMD backend must be identical to the scalar pyramid:
+TEST_F(ACFTest, ACFPyramidCPUSimd)
+{
+    namespace simd = drishti::acf::simd;
+
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+    detector->setIsTranspose(true);
+
+    const auto best = simd::getIsa();
+
+    drishti::acf::Detector::Pyramid Pscalar;
+    ASSERT_TRUE(simd::setIsa(simd::kScalar));
+    detector->computePyramid(m_IpT, Pscalar);
+
+    for (auto isa : { simd::kSSE, simd::kAVX2, simd::kAVX512 })
+    {
+        if (!simd::setIsa(isa))
+        {
+            continue;
+        }
+
+        drishti::acf::Detector::Pyramid P;
+        detector->computePyramid(m_IpT, P);
+
+        ASSERT_EQ(Pscalar.nScales, P.nScales);
+        for (int i = 0; i < P.nScales; i++)
+        {
+            for (int j = 0; j < P.data[i].size(); j++)
+            {
+                for (int k = 0; k < P.data[i][j].channels(); k++)
+                {
+                    ASSERT_EQ(cv::norm(Pscalar.data[i][j][k], P.data[i][j][k], cv::NORM_INF), 0.0) << simd::getIsaName(isa);
+                }
+            }
+        }
+    }
+
+    simd::setIsa(best);
+}
+
+// The fixed point pyramid (uint8_t input and channels) must be close to the float pyramid scaled
+// to the uint8_t range (i.e., the Classifier::thrsU8 input), and detect the same objects:
+TEST_F(ACFTest, ACFPyramidCPUFixedPoint)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+    detector->setIsTranspose(true);
+
+    cv::Mat I8;
+    m_I.convertTo(I8, CV_8UC3, 255.0);
+    MatP IpT8(I8.t());
+
+    drishti::acf::Detector::Pyramid P, Pfixed;
+    detector->computePyramid(m_IpT, P);
+    detector->setDoFixedPoint(true);
+    detector->computePyramid(IpT8, Pfixed);
+
+    ASSERT_EQ(P.nScales, Pfixed.nScales);
+    for (int i = 0; i < P.nScales; i++)
+    {
+        for (int j = 0; j < P.data[i].size(); j++)
+        {
+            ASSERT_EQ(P.data[i][j].channels(), Pfixed.data[i][j].channels());
+            for (int k = 0; k < P.data[i][j].channels(); k++)
+            {
+                cv::Mat expected;
+                P.data[i][j][k].convertTo(expected, CV_8U, 255.0);
+                ASSERT_EQ(Pfixed.data[i][j][k].type(), CV_8UC1);
+                ASSERT_LT(cv::norm(expected, Pfixed.data[i][j][k], cv::NORM_L1) / expected.total(), 1.0) << i << " " << k;
+            }
+        }
+    }
+
+    std::vector<double> scores, scoresFixed;
+    std::vector<cv::Rect> objects, objectsFixed;
+    detector->setDoFixedPoint(false);
+    (*detector)(m_IpT, objects, &scores);
+    detector->setDoFixedPoint(true);
+    (*detector)(IpT8, objectsFixed, &scoresFixed);
+    detector->setDoFixedPoint(false);
+
+    ASSERT_GT(objects.size(), 0);
+    ASSERT_GT(objectsFixed.size(), 0);
+
+    // Best detections must overlap:
+    const auto& a = objects[std::max_element(scores.begin(), scores.end()) - scores.begin()];
+    const auto& b = objectsFixed[std::max_element(scoresFixed.begin(), scoresFixed.end()) - scoresFixed.begin()];
+    ASSERT_GT(double((a & b).area()) / double((a | b).area()), 0.5);
+}
+
+// Detection w/ the packed (interleaved) node tables must match a direct evaluation of the
+// original fids/thrs/hs tables of the model, detection for detection:
+TEST_F(ACFTest, ACFPackedNodesMatchTables)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+    detector->setIsTranspose(true);
+    ASSERT_NE(detector->clf.getPackedNodes(CV_32FC1).ptr(), nullptr);
+
+    drishti::acf::Detector::Pyramid P;
+    detector->computePyramid(m_IpT, P);
+
+    const int shrink = *(detector->opts.pPyramid->pChns->shrink);
+    const cv::Size modelDsPad = *(detector->opts.modelDsPad);
+    const int stride = *(detector->opts.stride);
+    const double cascThr = *(detector->opts.cascThr);
+
+    std::size_t total = 0;
+    for (int i = 0; i < P.nScales; i++)
+    {
+        drishti::acf::Detector::DetectionVec objects;
+        detector->acfDetect1(P.data[i][0], {}, shrink, modelDsPad, stride, cascThr, objects);
+
+        const auto expected = detectReference(detector->clf, P.data[i][0], shrink, modelDsPad, stride, float(cascThr));
+        ASSERT_EQ(objects.size(), expected.size()) << "level " << i;
+        for (std::size_t j = 0; j < expected.size(); j++)
+        {
+            ASSERT_EQ(objects[j].roi, expected[j].roi) << "level " << i;
+            ASSERT_EQ(objects[j].score, expected[j].score) << "level " << i;
+        }
+        total += objects.size();
+    }
+    ASSERT_GT(total, 0);
+}
+
+// Synthetic cascades of depth 1, 3 and 4 must produce the same detections and scores w/ the
+// scalar and the AVX2 window lane evaluation as a direct evaluation of the fids/thrs/hs tables:
+TEST(ACFCascade, WindowLanesMatchReference)
+{
+    namespace simd = drishti::acf::simd;
+
+    const int shrink = 4, stride = 4, nChns = 3, cells = 4;
+    const cv::Size modelDsPad(cells * shrink, cells * shrink);
+    const float cascThr = -1.f;
+
+    cv::RNG rng(1);
+    drishti::acf::MatP chns(cv::Size(24, 24), CV_32F, nChns);
+    for (int z = 0; z < nChns; z++)
+    {
+        rng.fill(chns[z], cv::RNG::UNIFORM, 0.f, 1.f);
+    }
+
+    const auto best = simd::getIsa();
+    for (int depth : { 1, 3, 4 })
+    {
+        const int nTrees = 32, nTreeNodes = (1 << (depth + 1)) - 1, nSplits = (1 << depth) - 1;
+
+        drishti::acf::Detector detector;
+        auto& clf = detector.clf;
+        clf.treeDepth = depth;
+        clf.fids = cv::Mat1i(nTrees, nTreeNodes, 0);
+        clf.thrs = cv::Mat1f(nTrees, nTreeNodes, 0.f);
+        clf.hs = cv::Mat1f(nTrees, nTreeNodes, 0.f);
+        cv::Mat fids = clf.fids.colRange(0, nSplits);
+        rng.fill(fids, cv::RNG::UNIFORM, 0, nChns * cells * cells);
+        rng.fill(clf.thrs, cv::RNG::UNIFORM, 0.25f, 0.75f);
+        rng.fill(clf.hs, cv::RNG::UNIFORM, -0.5f, 0.5f);
+        clf.pack();
+
+        const auto expected = detectReference(clf, chns, shrink, modelDsPad, stride, cascThr);
+        ASSERT_GT(expected.size(), 0) << depth;
+
+        for (auto isa : { simd::kScalar, simd::kAVX2 })
+        {
+            if (!simd::setIsa(isa))
+            {
+                continue;
+            }
+            ASSERT_EQ(simd::getWindowLanes(depth) != nullptr, isa == simd::kAVX2);
+
+            drishti::acf::Detector::DetectionVec objects;
+            detector.acfDetect1(chns, {}, shrink, modelDsPad, stride, cascThr, objects);
+            ASSERT_EQ(objects.size(), expected.size()) << simd::getIsaName(isa) << " depth " << depth;
+            for (std::size_t i = 0; i < expected.size(); i++)
+            {
+                ASSERT_EQ(objects[i].roi, expected[i].roi) << simd::getIsaName(isa) << " depth " << depth;
+                ASSERT_EQ(objects[i].score, expected[i].score) << simd::getIsaName(isa) << " depth " << depth;
+            }
+        }
+    }
+    simd::setIsa(best);
+}
+
+// The bucketed 'max' and 'maxg' nms must be identical to the pairwise greedy loop:
+TEST(ACFNms, MaxMatchesPairwise)
+{
+    cv::RNG rng(1);
+    const auto bbs = randomDetections(2000, rng);
+
+    for (auto greedy : { false, true })
+    {
+        drishti::acf::Detector::Options::Nms pNms;
+        pNms.type = { "type", std::string(greedy ? "maxg" : "max") };
+        pNms.overlap = { "overlap", 0.5 };
+
+        drishti::acf::Detector::DetectionVec suppressed;
+        drishti::acf::Detector().bbNms(bbs, pNms, suppressed);
+
+        const auto expected = nmsPairwise(bbs, 0.5, greedy);
+        ASSERT_EQ(suppressed.size(), expected.size()) << *pNms.type;
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(suppressed[i].roi, expected[i].roi) << *pNms.type << " " << i;
+            ASSERT_EQ(suppressed[i].score, expected[i].score) << *pNms.type << " " << i;
+        }
+    }
+}
+
+// Three clusters of jittered detections must reduce to one bb per cluster w/ 'ms' and 'cover':
+TEST(ACFNms, MeanShiftAndCover)
+{
+    cv::RNG rng(1);
+    const cv::Point centers[3] = { { 100, 200 }, { 300, 200 }, { 600, 220 } };
+    const int sizes[3] = { 40, 60, 80 };
+
+    double total = 0.0;
+    drishti::acf::Detector::DetectionVec bbs;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 30; j++)
+        {
+            const int size = sizes[i] + cvRound(rng.gaussian(2.0));
+            const cv::Point tl(centers[i].x + cvRound(rng.gaussian(2.0)) - size / 2, centers[i].y + cvRound(rng.gaussian(2.0)) - size / 2);
+            bbs.emplace_back(cv::Rect(tl, cv::Size(size, size)), rng.uniform(1.0, 2.0));
+            total += bbs.back().score;
+        }
+    }
+
+    auto isClusterCenter = [&](const cv::Rect& roi) {
+        const cv::Point center = (roi.tl() + roi.br()) * 0.5;
+        for (int i = 0; i < 3; i++)
+        {
+            if ((cv::norm(center - centers[i]) < 5.0) && (std::abs(roi.width - sizes[i]) < 5))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    drishti::acf::Detector::Options::Nms pNms;
+    pNms.type = { "type", std::string("ms") };
+    drishti::acf::Detector::DetectionVec modes;
+    drishti::acf::Detector().bbNms(bbs, pNms, modes);
+    ASSERT_EQ(modes.size(), 3);
+    for (const auto& bb : modes)
+    {
+        ASSERT_TRUE(isClusterCenter(bb.roi)) << bb.roi;
+    }
+
+    // bbs at the 'ms' threshold (0) have no weight, so they are discarded:
+    const drishti::acf::Detector::DetectionVec zero = { { cv::Rect(0, 0, 40, 40), 0.0 } };
+    drishti::acf::Detector().bbNms(zero, pNms, modes);
+    ASSERT_TRUE(modes.empty());
+
+    pNms.type = { "type", std::string("cover") };
+    drishti::acf::Detector::DetectionVec cover;
+    drishti::acf::Detector().bbNms(bbs, pNms, cover);
+    ASSERT_EQ(cover.size(), 3);
+
+    double covered = 0.0; // each bb is covered exactly once
+    for (const auto& bb : cover)
+    {
+        ASSERT_TRUE(isClusterCenter(bb.roi)) << bb.roi;
+        covered += bb.score;
+    }
+    ASSERT_NEAR(covered, total, 1e-6);
+}
+
 #if defined(DRISHTI_DO_GPU_TESTING)
 TEST_F(ACFTest, ACFPyramidGPU10)
 {
@@ -508,4 +1039,47 @@ static cv::Mat draw(drishti::acf::Detector::Pyramid& pyramid)
     return canvas;
 }
 
+// Reference ACF cascade: a direct evaluation of the fids/thrs/hs tables (w/ the soft cascade
+// rejection trace, if any) for each window of the column major (transposed) float channels, in
+// the scan order of Detector::acfDetect1():
+static drishti::acf::Detector::DetectionVec detectReference(const drishti::acf::Detector::Classifier& clf, const drishti::acf::MatP& chns, int shrink, const cv::Size& modelDsPad, int stride, float cascThr)
+{
+    CV_Assert(chns.depth() == CV_32F);
+
+    // Windows are scanned w/ rows along the channel columns:
+    const int nx = modelDsPad.height / shrink, ny = modelDsPad.width / shrink;
+    const int width1 = int(std::ceil(float(chns.size().height * shrink - modelDsPad.height + 1) / stride));
+    const int height1 = int(std::ceil(float(chns.size().width * shrink - modelDsPad.width + 1) / stride));
+    const int nTrees = clf.fids.rows;
+
+    drishti::acf::Detector::DetectionVec objects;
+    for (int c = 0; c < width1; c++)
+    {
+        for (int r = 0; r < height1; r++)
+        {
+            float h = 0.f;
+            bool rejected = false;
+            for (int t = 0; (t < nTrees) && !rejected; t++)
+            {
+                int k = 0;
+                for (int i = 0; i < clf.treeDepth; i++)
+                {
+                    const int f = int(clf.fids.ptr<uint32_t>(t)[k]);
+                    const int z = f / (nx * ny), x = (f / ny) % nx, y = f % ny;
+                    const float ftr = chns[z].at<float>(c * stride / shrink + x, r * stride / shrink + y);
+                    k = (2 * k) + ((ftr < clf.thrs.ptr<float>(t)[k]) ? 1 : 2);
+                }
+                h += clf.hs.ptr<float>(t)[k];
+                rejected = (h <= ((int(clf.rejection.size()) == nTrees) ? clf.rejection[t] : cascThr));
+            }
+
+            if (!rejected && (h > cascThr))
+            {
+                objects.emplace_back(cv::Rect(r * stride, c * stride, modelDsPad.width, modelDsPad.height), h);
+            }
+        }
+    }
+    return objects;
+}
+
 END_EMPTY_NAMESPACE
@@ -0,0 +1,71 @@
+/*! -*-c++-*-
+  @file   test-nms-reference.h
+  @brief  Reference (pairwise) bounding box nms and random crowd detections for tests and benchmarks.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef test_nms_reference_h
+#define test_nms_reference_h 1
+
+#include "drishti/acf/ACF.h"
+#include "drishti/core/drishti_algorithm.h"
+
+#include <opencv2/core.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Detections over a crowd like range of positions and scales (w/ score ties):
+inline drishti::acf::Detector::DetectionVec randomDetections(int n, cv::RNG& rng)
+{
+    const double extent = std::sqrt(double(n)) * 40.0;
+    drishti::acf::Detector::DetectionVec bbs(n);
+    for (auto& bb : bbs)
+    {
+        const int size = cvRound(24.0 * std::pow(2.0, rng.uniform(0.0, 3.0)));
+        bb.roi = cv::Rect(rng.uniform(0, int(extent)), rng.uniform(0, int(extent)), size, size * 2);
+        bb.score = double(rng.uniform(0, 20));
+    }
+    return bbs;
+}
+
+// Reference (O(n^2)) 'max' and 'maxg' nms w/ the 'union' denominator:
+inline drishti::acf::Detector::DetectionVec nmsPairwise(const drishti::acf::Detector::DetectionVec& bbsIn, double overlap, bool greedy)
+{
+    typedef drishti::acf::Detector::Detection Detection;
+    const auto ord = drishti::core::ordered(bbsIn, [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+
+    drishti::acf::Detector::DetectionVec bbs;
+    std::vector<int> kp(ord.size(), 1);
+    for (std::size_t i = 0; i < ord.size(); i++)
+    {
+        if (greedy && !kp[i])
+        {
+            continue;
+        }
+        for (std::size_t j = i + 1; j < ord.size(); j++)
+        {
+            const cv::Rect &a = bbsIn[ord[i]].roi, &b = bbsIn[ord[j]].roi;
+            const double o = double((a & b).area());
+            if (kp[j] && (o > 0.0) && (o / (a.area() + b.area() - o) > overlap))
+            {
+                kp[j] = 0;
+            }
+        }
+    }
+    for (std::size_t i = 0; i < ord.size(); i++)
+    {
+        if (kp[i])
+        {
+            bbs.push_back(bbsIn[ord[i]]);
+        }
+    }
+    return bbs;
+}
+
+#endif // test_nms_reference_h
@@ -80,6 +80,7 @@ void EyeModel::clear()
     iris = {};
     irisEllipse = {};
     pupilEllipse = {};
+    eyelidsDispersion.clear();
 }
 
 void EyeModel::upsample(int eyelidFactor, int creaseFactor)
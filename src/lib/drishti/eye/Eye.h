@@ -147,6 +147,10 @@ struct EyeModel
     core::Field<cv::Point2f> irisCenter;
     core::Field<cv::Point2f> irisInner;
     core::Field<cv::Point2f> irisOuter;
+
+    // Spread of the eyelid hypotheses about their median, relative to the crop width
+    // (multi-hypothesis estimates only, see EyeModelEstimator::setEyelidInits()):
+    core::Field<float> eyelidsDispersion;
 };
 
 inline std::vector<std::vector<cv::Point2f>*> getEyeModelContours(EyeModel& dst)
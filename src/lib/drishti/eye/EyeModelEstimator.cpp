@@ -80,6 +80,19 @@ void EyeModelEstimator::Impl::setStreamLogger(std::shared_ptr<spdlog::logger>& l
     }
 }
 
+bool EyeModelEstimator::Impl::isReentrant() const
+{
+    for (const auto& estimator : { m_eyeEstimator.get(), m_irisEstimator.get(), m_pupilEstimator.get() })
+    {
+        auto cpr = dynamic_cast<const drishti::rcpr::CPR*>(estimator);
+        if (cpr && !cpr->isReentrant())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Input: grayscale for contour regression
 // Red channel is closest to NIR for iris
 // TODO: Need a lazy image conversion type
@@ -290,6 +303,11 @@ void EyeModelEstimator::setDoMask(bool flag)
     m_impl->setDoMask(flag);
 }
 
+bool EyeModelEstimator::isReentrant() const
+{
+    return m_impl->isReentrant();
+}
+
 bool EyeModelEstimator::getUseHierarchy() const
 {
     return m_impl->getUseHierarchy();
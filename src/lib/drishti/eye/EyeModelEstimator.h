@@ -47,6 +47,9 @@ public:
 
     virtual int operator()(const cv::Mat& crop, EyeModel& eye) const;
 
+    // The estimator may be shared across threads (all CPR stages have compiled forests):
+    bool isReentrant() const;
+
     void setOpennessThreshold(float threshold);
     float getOpennessThreshold() const;
 
@@ -66,6 +69,7 @@ public:
     void setIrisStagesHint(int stages);
     int getIrisStagesHint() const;
 
+    // Jittered eyelid hypotheses, regressed in one batch (see EyeModel::eyelidsDispersion):
     void setEyelidInits(int n);
     int getEyelidInits() const;
 
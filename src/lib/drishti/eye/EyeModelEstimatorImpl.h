@@ -110,9 +110,11 @@ public:
     // TODO: Need a lazy image conversion type
     int operator()(const cv::Mat& crop, EyeModel& eye) const;
 
+    bool isReentrant() const;
+
     void normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding = 0) const
     {
-        IrisNormalizer()(crop, eye, size, code, padding);
+        m_irisNormalizer(crop, eye, size, code, padding);
     }
 
     cv::Mat drawMeanShape(const cv::Size& size) const
@@ -219,6 +221,8 @@ protected:
     std::unique_ptr<ml::ShapeEstimator> m_irisEstimator;
     std::unique_ptr<ml::ShapeEstimator> m_pupilEstimator;
 
+    IrisNormalizer m_irisNormalizer; // caches remap tables across video frames
+
     std::shared_ptr<spdlog::logger> m_streamLogger;
 };
 
@@ -31,6 +31,7 @@ using PointVec = std::vector<cv::Point2f>;
 static void jitter(const EyeModel& eye, const geometry::UniformSimilarityParams& params, std::vector<EyeModel>& poses, int n);
 static void jitter(const cv::Rect& roi, const geometry::UniformSimilarityParams& params, std::vector<cv::Rect>& poses, int n);
 static PointVec getMedianOfPoses(const std::vector<PointVec>& poses);
+static float getDispersionOfPoses(const std::vector<PointVec>& poses, const PointVec& pose);
 
 #if DRISHTI_EYE_DEBUG_INITS
 static std::vector<cv::Point2f> operator*(const cv::Matx33f& H, const std::vector<cv::Point2f>& points);
@@ -49,13 +50,18 @@ void EyeModelEstimator::Impl::segmentEyelids(const cv::Mat& I, EyeModel& eye) co
         jitter(roi, m_jitterEyelidParams, rois, m_eyelidInits - 1);
     }
 
-    std::vector<PointVec> poses(rois.size(), mu);
+    std::vector<cv::Mat> crops(rois.size());
+    for (int i = 0; i < rois.size(); i++)
+    {
+        crops[i] = I(rois[i]);
+    }
 
-    // Get the basic shape:
-    std::vector<bool> mask; // occlusion mask
+    // Get the basic shape for all hypotheses in one batched pass:
+    std::vector<PointVec> poses(rois.size(), mu);
+    std::vector<std::vector<bool>> masks; // occlusion masks
+    (*m_eyeEstimator)(crops, poses, masks);
     for (int i = 0; i < rois.size(); i++)
     {
-        (*m_eyeEstimator)(I(rois[i]), poses[i], mask);
         cv::Point2f shift = rois[i].tl();
         for (auto& p : poses[i])
         {
@@ -63,9 +69,13 @@ void EyeModelEstimator::Impl::segmentEyelids(const cv::Mat& I, EyeModel& eye) co
         }
     }
 
-    // Get median of poses:
+    // Robust consensus (median of poses):
     PointVec pose = (poses.size() > 1) ? getMedianOfPoses(poses) : poses[0];
-    eye = shapeToEye(poses[0], m_eyeSpec);
+    eye = shapeToEye(pose, m_eyeSpec);
+    if (poses.size() > 1)
+    {
+        eye.eyelidsDispersion = getDispersionOfPoses(poses, pose) / float(I.cols);
+    }
 
 #if DRISHTI_EYE_DEBUG_INITS
     drawEyes(I, shapesToEyes(poses, m_eyeSpec, cv::Matx33f::eye()), "poses-out");
@@ -229,4 +239,21 @@ static PointVec getMedianOfPoses(const std::vector<PointVec>& poses)
     return pose;
 }
 
+// Median over hypotheses of the RMS point distance to the consensus pose:
+static float getDispersionOfPoses(const std::vector<PointVec>& poses, const PointVec& pose)
+{
+    std::vector<float> distances;
+    for (const auto& p : poses)
+    {
+        double ssd = 0.0;
+        for (int j = 0; j < p.size(); j++)
+        {
+            const cv::Point2f d = p[j] - pose[j];
+            ssd += d.dot(d);
+        }
+        distances.push_back(static_cast<float>(std::sqrt(ssd / std::max(std::size_t(1), p.size()))));
+    }
+    return median(distances);
+}
+
 DRISHTI_EYE_NAMESPACE_END
@@ -96,11 +96,20 @@ EyeModelEstimator::Impl::estimateCentralIris(const cv::Mat& I, const cv::Mat& M,
 #endif
     };
 
+#if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
     m_irisEstimator->setDoPreview(true);
+#endif
 
-    // XGBoost is not reentrant:
-    harness({ 0, int(irises.size()) });
-    //cv::parallel_for_({0, int(irises.size())}, harness, 2);
+    // Each hypothesis writes its own params column, so the median doesn't depend on the schedule:
+    auto cpr = dynamic_cast<const drishti::rcpr::CPR*>(m_irisEstimator.get());
+    if (!DRISHTI_CPR_DEBUG_PHI_ESTIMATE && cpr && cpr->isReentrant())
+    {
+        cv::parallel_for_({ 0, int(irises.size()) }, harness);
+    }
+    else
+    {
+        harness({ 0, int(irises.size()) });
+    }
 
 #if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
     drawIrisEstimates(I, estimates, "iris-out");
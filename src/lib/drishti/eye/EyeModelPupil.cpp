@@ -85,8 +85,15 @@ void EyeModelEstimator::Impl::segmentPupil(const cv::Mat& I, EyeModel& eye, int
     m_pupilEstimator->setDoPreview(true);
     harness({ 0, int(pupils.size()) });
 #else
-    m_pupilEstimator->setDoPreview(false);
-    cv::parallel_for_({ 0, int(pupils.size()) }, harness);
+    auto cpr = dynamic_cast<const drishti::rcpr::CPR*>(m_pupilEstimator.get());
+    if (cpr && cpr->isReentrant())
+    {
+        cv::parallel_for_({ 0, int(pupils.size()) }, harness);
+    }
+    else
+    {
+        harness({ 0, int(pupils.size()) }); // XGBooster prediction is not reentrant
+    }
 #endif
 
     // Find Mean
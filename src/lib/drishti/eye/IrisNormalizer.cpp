@@ -10,77 +10,150 @@
 
 #include "drishti/eye/IrisNormalizer.h"
 #include "drishti/geometry/Ellipse.h"
-#include "drishti/geometry/intersectConicLine.h"
+#include "drishti/geometry/ConicSection.h"
 
 #include <opencv2/imgproc.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 DRISHTI_EYE_NAMESPACE_BEGIN
 
-IrisNormalizer::IrisNormalizer()
+static const float kPixelStep = 0.125f; // cache key quantization
+static const float kDegreeStep = 0.5f;
+
+// Distance t along each unit ray c + t * v to its intersection w/ the conic Q on the -v side
+// (t <= 0 for c inside Q), which is the orientation of the normalized iris since its first
+// release.  The loop is branch free over a structure of arrays, so it can be vectorized.
+static void intersectRaysConic(const cv::Matx33f& Q, const cv::Point2f& c, const float* vx, const float* vy, float* t, int n)
+{
+    // Q is symmetric, [c 1] Q [c 1]' + 2t [v 0] Q [c 1]' + t^2 [v 0] Q [v 0]' = 0
+    const float qx = Q(0, 0) * c.x + Q(0, 1) * c.y + Q(0, 2);
+    const float qy = Q(1, 0) * c.x + Q(1, 1) * c.y + Q(1, 2);
+    const float d = c.x * qx + c.y * qy + (Q(2, 0) * c.x + Q(2, 1) * c.y + Q(2, 2));
+    const float A = Q(0, 0), B = Q(0, 1) * 2.f, C = Q(1, 1);
+
+    for (int i = 0; i < n; i++)
+    {
+        const float a = A * vx[i] * vx[i] + B * vx[i] * vy[i] + C * vy[i] * vy[i];
+        const float b = vx[i] * qx + vy[i] * qy;
+        const float s = std::sqrt(std::max(b * b - a * d, 0.f));
+        t[i] = -(std::copysign(s, a) + b) / a; // smaller root
+    }
+}
+
+static cv::RotatedRect quantize(const cv::RotatedRect& e)
+{
+    auto q = [](float value, float step) { return std::round(value / step) * step; };
+    return cv::RotatedRect(
+        { q(e.center.x, kPixelStep), q(e.center.y, kPixelStep) },
+        { q(e.size.width, kPixelStep), q(e.size.height, kPixelStep) },
+        q(e.angle, kDegreeStep));
+}
+
+IrisNormalizer::IrisNormalizer(int cacheSize)
+    : m_cacheSize(cacheSize)
 {
 }
 
 void IrisNormalizer::warpIris(const cv::Mat& crop, const cv::Mat1b& mask, const cv::Size& paddedSize, Rays& rayPixels, Rays& rayTexels, NormalizedIris& code, int padding) const
 {
-    code.getRoi() = cv::Rect({ padding, 0 }, paddedSize - cv::Size(2 * padding, 0));
-    code.getPaddedMask().create(paddedSize, CV_8UC1);
-    code.getPaddedImage().create(paddedSize, crop.type());
-    code.getPaddedImage() = cv::Scalar::all(0);
+    remap(crop, mask, *createRemap(rayPixels, paddedSize), code, padding);
+}
 
-    cv::Mat1f mapX(paddedSize), mapY(paddedSize);
+IrisNormalizer::RemapPtr IrisNormalizer::createRemap(const Rays& rayPixels, const cv::Size& paddedSize)
+{
+    CV_Assert(int(rayPixels.size()) == paddedSize.width);
 
-    for (int x = 0; x < paddedSize.width; x++)
+    cv::Mat1f mapX(paddedSize), mapY(paddedSize);
+    for (int y = 0; y < paddedSize.height; y++)
     {
-        for (int y = 0; y < paddedSize.height; y++)
+        const float alpha = (y + 1) / float(paddedSize.height), beta = (1.0 - alpha);
+        float* pX = mapX.ptr<float>(y);
+        float* pY = mapY.ptr<float>(y);
+        for (int x = 0; x < paddedSize.width; x++)
         {
-            const float alpha = (y + 1) / float(paddedSize.height), beta = (1.0 - alpha);
             const auto& pi = rayPixels[x][0];
             const auto& pp = rayPixels[x][1];
-            const cv::Point2f u = (pi * alpha) + (pp * beta);
-            mapX(y, x + padding) = u.x;
-            mapY(y, x + padding) = u.y;
+            pX[x] = (pi.x * alpha) + (pp.x * beta);
+            pY[x] = (pi.y * alpha) + (pp.y * beta);
         }
     }
 
-    cv::remap(crop, code.getPaddedImage(), mapX, mapY, cv::INTER_CUBIC);
-    cv::remap(mask, code.getPaddedMask(), mapX, mapY, cv::INTER_NEAREST);
+    auto table = std::make_shared<Remap>();
+    cv::convertMaps(mapX, mapY, table->map1, table->map2, CV_16SC2, false);
+    table->paddedSize = paddedSize;
+    return table;
+}
+
+void IrisNormalizer::remap(const cv::Mat& crop, const cv::Mat1b& mask, const Remap& table, NormalizedIris& code, int padding)
+{
+    const cv::Size& paddedSize = table.paddedSize;
+    code.getRoi() = cv::Rect({ padding, 0 }, paddedSize - cv::Size(2 * padding, 0));
+    code.getPaddedImage().create(paddedSize, crop.type());
+
+    cv::Mat mask_ = mask;
+    if (crop.depth() != CV_8U)
+    {
+        mask.convertTo(mask_, crop.depth());
+    }
+
+    const int cn = crop.channels();
+    if (cn >= 4)
+    {
+        cv::remap(crop, code.getPaddedImage(), table.map1, table.map2, cv::INTER_CUBIC);
+        cv::remap(mask_, code.getPaddedMask(), table.map1, table.map2, cv::INTER_NEAREST);
+        return;
+    }
+
+    // Append the mask as the last image channel, and split the result:
+    std::vector<int> fromTo;
+    for (int i = 0; i <= cn; i++)
+    {
+        fromTo.insert(fromTo.end(), { i, i });
+    }
+
+    const cv::Mat sources[] = { crop, mask_ };
+    cv::Mat fused(crop.size(), CV_MAKETYPE(crop.depth(), cn + 1)), warped;
+    cv::mixChannels(sources, 2, &fused, 1, fromTo.data(), cn + 1);
+    cv::remap(fused, warped, table.map1, table.map2, cv::INTER_CUBIC);
+
+    cv::Mat warpedMask(paddedSize, CV_MAKETYPE(crop.depth(), 1));
+    cv::Mat targets[] = { code.getPaddedImage(), warpedMask };
+    cv::mixChannels(&warped, 1, targets, 2, fromTo.data(), cn + 1);
+    cv::compare(warpedMask, 127.5, code.getPaddedMask(), cv::CMP_GT);
 }
 
 cv::Size IrisNormalizer::createRays(const EyeModel& eye, const cv::Size& size, Rays& rayPixels, Rays& rayTexels, int padding) const
 {
-    cv::Matx33f iris = drishti::geometry::ConicSection_<float>(eye.irisEllipse).getMatrix();
-    cv::Matx33f pupil = drishti::geometry::ConicSection_<float>(eye.pupilEllipse).getMatrix();
     cv::Size paddedSize = size + cv::Size(2 * padding, 0);
+    const int n = paddedSize.width;
 
-    rayPixels.reserve(paddedSize.width);
-    rayTexels.reserve(paddedSize.width);
+    rayPixels.reserve(rayPixels.size() + n);
+    rayTexels.reserve(rayTexels.size() + n);
 
-    /* int n = 0; */
-    cv::Vec3f P[2];
-    cv::Point2f p[2], pi, pp;
-    for (int x = -padding; x < (size.width + padding); x++)
+    // Ray directions from the pupil center:
+    std::vector<float> vx(n), vy(n), tIris(n), tPupil(n);
+    for (int i = 0; i < n; i++)
     {
+        const int x = i - padding;
         const float theta = float((x + size.width) % size.width) / size.width * float(2.0 * M_PI);
-        cv::Point3f v(std::cos(theta), std::sin(theta), 0);
-        cv::Point3f c(eye.pupilEllipse.center.x, eye.pupilEllipse.center.y, 1.f);
-        const cv::Point3f L = c.cross(c + v);
-
-        // TODO: should be able to avoid need for the dot product
-        /* n = */ drishti::geometry::intersectConicLine(iris, L, P);
-        p[0] = { P[0][0] / P[0][2], P[0][1] / P[0][2] };
-        p[1] = { P[1][0] / P[1][2], P[1][1] / P[1][2] };
-        pi = p[cv::Point2f(v.x, v.y).dot(p[0] - cv::Point2f(c.x, c.y)) > 0];
-
-        /* n = */ drishti::geometry::intersectConicLine(pupil, L, P);
-        p[0] = { P[0][0] / P[0][2], P[0][1] / P[0][2] };
-        p[1] = { P[1][0] / P[1][2], P[1][1] / P[1][2] };
-        pp = p[cv::Point2f(v.x, v.y).dot(p[0] - cv::Point2f(c.x, c.y)) > 0];
-        Ray rayPixel = { { pp, pi } };
+        vx[i] = std::cos(theta);
+        vy[i] = std::sin(theta);
+    }
+
+    const cv::Point2f c = eye.pupilEllipse.center;
+    intersectRaysConic(drishti::geometry::ConicSection_<float>(eye.irisEllipse).getMatrix(), c, vx.data(), vy.data(), tIris.data(), n);
+    intersectRaysConic(drishti::geometry::ConicSection_<float>(eye.pupilEllipse).getMatrix(), c, vx.data(), vy.data(), tPupil.data(), n);
+
+    for (int i = 0; i < n; i++)
+    {
+        const cv::Point2f v(vx[i], vy[i]);
+        Ray rayPixel = { { c + v * tPupil[i], c + v * tIris[i] } };
 
         // Add corresponding ray in normalized coordinates:
-        cv::Point2f tp(float(x + padding) / paddedSize.width, 0.0);
+        cv::Point2f tp(float(i) / paddedSize.width, 0.0);
         cv::Point2f ti(tp.x, 1.0);
         Ray rayTexel = { { tp, ti } };
 
@@ -91,13 +164,63 @@ cv::Size IrisNormalizer::createRays(const EyeModel& eye, const cv::Size& size, R
     return paddedSize;
 }
 
-void IrisNormalizer::operator()(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding) const
+IrisNormalizer::RemapPtr IrisNormalizer::getRemap(const EyeModel& eye, const cv::Size& size, int padding) const
 {
-    cv::Mat mask = eye.irisMask(crop.size());
+    EyeModel model;
+    model.irisEllipse = eye.irisEllipse;
+    model.pupilEllipse = eye.pupilEllipse;
+
+    Key key{};
+    if (m_cacheSize > 0)
+    {
+        model.irisEllipse = quantize(eye.irisEllipse);
+        model.pupilEllipse = quantize(eye.pupilEllipse);
+
+        int i = 0;
+        for (const auto& e : { model.pupilEllipse, model.irisEllipse })
+        {
+            key[i++] = int(std::round(e.center.x / kPixelStep));
+            key[i++] = int(std::round(e.center.y / kPixelStep));
+            key[i++] = int(std::round(e.size.width / kPixelStep));
+            key[i++] = int(std::round(e.size.height / kPixelStep));
+            key[i++] = int(std::round(e.angle / kDegreeStep));
+        }
+        key[i++] = size.width;
+        key[i++] = size.height;
+        key[i++] = padding;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto iter = std::find_if(m_cache.begin(), m_cache.end(), [&](const std::pair<Key, RemapPtr>& entry) {
+            return entry.first == key;
+        });
+        if (iter != m_cache.end())
+        {
+            std::rotate(m_cache.begin(), iter, iter + 1);
+            return m_cache.front().second;
+        }
+    }
 
     Rays rayPixels, rayTexels;
-    cv::Size paddedSize = createRays(eye, size, rayPixels, rayTexels, padding);
-    warpIris(crop, mask, paddedSize, rayPixels, rayTexels, code, padding);
+    cv::Size paddedSize = createRays(model, size, rayPixels, rayTexels, padding);
+    auto table = createRemap(rayPixels, paddedSize);
+
+    if (m_cacheSize > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache.emplace(m_cache.begin(), key, table);
+        if (int(m_cache.size()) > m_cacheSize)
+        {
+            m_cache.pop_back();
+        }
+    }
+
+    return table;
+}
+
+void IrisNormalizer::operator()(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding) const
+{
+    cv::Mat mask = eye.irisMask(crop.size());
+    remap(crop, mask, *getRemap(eye, size, padding), code, padding);
 }
 
 DRISHTI_EYE_NAMESPACE_END
@@ -18,6 +18,10 @@
 #include "drishti/eye/NormalizedIris.h"
 
 #include <array>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 DRISHTI_EYE_NAMESPACE_BEGIN
 
@@ -27,13 +31,38 @@ public:
     using Ray = std::array<cv::Point2f, 2>;
     using Rays = std::vector<Ray>;
 
-    IrisNormalizer();
+    // Fixed point ellipso-polar remap table (see cv::convertMaps):
+    struct Remap
+    {
+        cv::Mat map1; // CV_16SC2: integer source coordinates
+        cv::Mat map2; // CV_16UC1: interpolation table indices
+        cv::Size paddedSize;
+    };
+    using RemapPtr = std::shared_ptr<const Remap>;
+
+    // cacheSize: number of remap tables kept for recent (quantized) eye models, 0 disables the cache
+    explicit IrisNormalizer(int cacheSize = 16);
 
     cv::Size createRays(const EyeModel& eye, const cv::Size& size, Rays& rayPixels, Rays& rayTexels, int padding = 0) const;
     void warpIris(const cv::Mat& crop, const cv::Mat1b& mask, const cv::Size& paddedSize, Rays& rayPixels, Rays& rayTexels, NormalizedIris& code, int padding = 0) const;
     void operator()(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding = 0) const;
 
+    // Remap table for the pupil and iris ellipses of an eye, which are quantized to
+    // 1/8 pixel and 1/2 degree when the cache is enabled, so that tables are shared
+    // across video frames:
+    RemapPtr getRemap(const EyeModel& eye, const cv::Size& size, int padding = 0) const;
+
+    static RemapPtr createRemap(const Rays& rayPixels, const cv::Size& paddedSize);
+
+    // Warp the image and mask in a single (cubic) pass:
+    static void remap(const cv::Mat& crop, const cv::Mat1b& mask, const Remap& table, NormalizedIris& code, int padding = 0);
+
 protected:
+    using Key = std::array<int, 13>;
+
+    int m_cacheSize = 0;
+    mutable std::mutex m_mutex;
+    mutable std::vector<std::pair<Key, RemapPtr>> m_cache; // most recently used first
 };
 
 DRISHTI_EYE_NAMESPACE_END
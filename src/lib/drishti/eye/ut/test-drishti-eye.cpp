@@ -9,6 +9,9 @@
 */
 
 #include "drishti/eye/EyeModelEstimator.h"
+#include "drishti/eye/IrisNormalizer.h"
+#include "drishti/geometry/ConicSection.h"
+#include "drishti/geometry/intersectConicLine.h"
 #include "drishti/core/drishti_stdlib_string.h"
 #include "drishti/core/drishti_cereal_pba.h"
 #include "drishti/core/drishti_cv_cereal.h"
@@ -25,6 +28,7 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 
@@ -179,6 +183,112 @@ static bool isEqual(const drishti::eye::EyeModel& eyeA, const drishti::eye::EyeM
     return eyeA == eyeB;
 }
 
+/*
+ * Ellipso-polar iris normalization
+ */
+
+TEST(IrisNormalizer, CachedRemap)
+{
+    drishti::eye::EyeModel eye;
+    eye.irisEllipse = cv::RotatedRect({ 64.f, 48.f }, { 40.f, 40.f }, 0.f);
+    eye.pupilEllipse = cv::RotatedRect({ 64.f, 48.f }, { 12.f, 12.f }, 0.f);
+
+    const cv::Size size(256, 32);
+    const int padding = 8;
+    drishti::eye::IrisNormalizer normalizer(4);
+    const auto table = normalizer.getRemap(eye, size, padding);
+    ASSERT_EQ(table->paddedSize, cv::Size(size.width + 2 * padding, size.height));
+
+    // Small (tracking) perturbations reuse the table:
+    auto moved = eye;
+    moved.irisEllipse.center.x += 0.01f;
+    EXPECT_EQ(normalizer.getRemap(moved, size, padding), table);
+    moved.irisEllipse.center.x += 1.f;
+    EXPECT_NE(normalizer.getRemap(moved, size, padding), table);
+
+    // Dark pupil, uniform iris and bright sclera:
+    cv::Mat1b crop(96, 128, uint8_t(255));
+    cv::circle(crop, { 64, 48 }, 20, 128, -1);
+    cv::circle(crop, { 64, 48 }, 6, 0, -1);
+
+    drishti::eye::NormalizedIris code;
+    normalizer(crop, eye, size, code, padding);
+    ASSERT_EQ(code.getPaddedImage().size(), table->paddedSize);
+    ASSERT_EQ(code.getPaddedMask().size(), table->paddedSize);
+    ASSERT_EQ(code.getRoi(), cv::Rect({ padding, 0 }, size));
+
+    // The middle row samples the iris halfway between the pupil and limbus:
+    const cv::Mat1b image = code.getPaddedImage();
+    for (int x = 0; x < image.cols; x++)
+    {
+        EXPECT_NEAR(image(size.height / 2, x), 128, 2);
+    }
+}
+
+// Float map remap w/ the original ray construction, where each ray from the pupil center
+// intersects the ellipses on the -v side (see IrisNormalizer::createRays()):
+static cv::Mat1b remapReference(const cv::Mat1b& crop, const drishti::eye::EyeModel& eye, const cv::Size& size, int padding)
+{
+    const cv::Matx33f iris = drishti::geometry::ConicSection_<float>(eye.irisEllipse).getMatrix();
+    const cv::Matx33f pupil = drishti::geometry::ConicSection_<float>(eye.pupilEllipse).getMatrix();
+    const cv::Size paddedSize = size + cv::Size(2 * padding, 0);
+    const cv::Point2f c = eye.pupilEllipse.center;
+
+    auto intersect = [&](const cv::Matx33f& Q, const cv::Point2f& v) {
+        const cv::Vec3f L = cv::Vec3f(c.x, c.y, 1.f).cross(cv::Vec3f(c.x + v.x, c.y + v.y, 1.f));
+        cv::Vec3f P[2];
+        drishti::geometry::intersectConicLine(Q, L, P);
+        const cv::Point2f p[2] = { { P[0][0] / P[0][2], P[0][1] / P[0][2] }, { P[1][0] / P[1][2], P[1][1] / P[1][2] } };
+        return p[v.dot(p[0] - c) > 0];
+    };
+
+    cv::Mat1f mapX(paddedSize), mapY(paddedSize);
+    for (int x = -padding; x < (size.width + padding); x++)
+    {
+        const float theta = float((x + size.width) % size.width) / size.width * float(2.0 * M_PI);
+        const cv::Point2f v(std::cos(theta), std::sin(theta));
+        const cv::Point2f pi = intersect(iris, v), pp = intersect(pupil, v);
+        for (int y = 0; y < paddedSize.height; y++)
+        {
+            const float alpha = (y + 1) / float(paddedSize.height), beta = (1.0 - alpha);
+            const cv::Point2f u = (pi * alpha) + (pp * beta);
+            mapX(y, x + padding) = u.x;
+            mapY(y, x + padding) = u.y;
+        }
+    }
+
+    cv::Mat1b image;
+    cv::remap(crop, image, mapX, mapY, cv::INTER_CUBIC);
+    return image;
+}
+
+// The fixed point tables sample the same (asymmetric) iris texture as the original float maps:
+TEST(IrisNormalizer, MatchesFloatRemap)
+{
+    drishti::eye::EyeModel eye;
+    eye.irisEllipse = cv::RotatedRect({ 66.f, 47.f }, { 44.f, 38.f }, 20.f);
+    eye.pupilEllipse = cv::RotatedRect({ 63.5f, 49.25f }, { 14.f, 11.f }, -35.f);
+
+    cv::Mat1b crop(96, 128);
+    for (int y = 0; y < crop.rows; y++)
+    {
+        for (int x = 0; x < crop.cols; x++)
+        {
+            crop(y, x) = cv::saturate_cast<uint8_t>(128.0 + 60.0 * std::sin(x * 0.15) + 40.0 * std::cos(y * 0.11) + 0.3 * (x - y));
+        }
+    }
+
+    const cv::Size size(256, 32);
+    const int padding = 8;
+    drishti::eye::IrisNormalizer normalizer(0); // w/o quantization
+    drishti::eye::NormalizedIris code;
+    normalizer(crop, eye, size, code, padding);
+
+    const cv::Mat1b expected = remapReference(crop, eye, size, padding);
+    ASSERT_EQ(code.getPaddedImage().size(), expected.size());
+    EXPECT_LE(cv::norm(code.getPaddedImage(), expected, cv::NORM_INF), 2.0);
+}
+
 /*
  * Basic class construction
  */
@@ -300,6 +410,74 @@ TEST_F(EyeModelEstimatorTest, IsRepeatable)
     }
 }
 
+// Iris hypotheses run in parallel w/ compiled CPR forests, and must match a serial run:
+TEST_F(EyeModelEstimatorTest, IrisInitsAreRepeatable)
+{
+    if (!m_eye || !m_eyeSegmenter)
+    {
+        return;
+    }
+
+    ASSERT_TRUE(m_eyeSegmenter->isReentrant());
+
+    const int irisInits = m_eyeSegmenter->getIrisInits();
+    const bool useHierarchy = m_eyeSegmenter->getUseHierarchy();
+    m_eyeSegmenter->setIrisInits(12);
+    m_eyeSegmenter->setUseHierarchy(true);
+
+    const int nThreads = cv::getNumThreads();
+    for (int i = 128; i < m_images.size(); i += 16)
+    {
+        drishti::eye::EyeModel eyeA, eyeB, eyeSerial;
+        EXPECT_EQ((*m_eyeSegmenter)(m_images[i].image, eyeA), 0);
+        EXPECT_EQ((*m_eyeSegmenter)(m_images[i].image, eyeB), 0);
+
+        cv::setNumThreads(1);
+        EXPECT_EQ((*m_eyeSegmenter)(m_images[i].image, eyeSerial), 0);
+        cv::setNumThreads(nThreads);
+
+        eyeA.refine();
+        eyeB.refine();
+        eyeSerial.refine();
+        checkValid(eyeA, m_images[i].image.size());
+        EXPECT_EQ(isEqual(eyeA, eyeB), true);
+        EXPECT_EQ(isEqual(eyeA, eyeSerial), true);
+    }
+
+    m_eyeSegmenter->setIrisInits(irisInits);
+    m_eyeSegmenter->setUseHierarchy(useHierarchy);
+}
+
+// Batched eyelid hypotheses return the consensus pose and their dispersion:
+TEST_F(EyeModelEstimatorTest, EyelidInitsConsensus)
+{
+    if (!m_eye || !m_eyeSegmenter)
+    {
+        return;
+    }
+
+    const int eyelidInits = m_eyeSegmenter->getEyelidInits();
+    m_eyeSegmenter->setEyelidInits(8);
+
+    for (int i = 128; i < m_images.size(); i += 16)
+    {
+        drishti::eye::EyeModel eye;
+        EXPECT_EQ((*m_eyeSegmenter)(m_images[i].image, eye), 0);
+        eye.refine();
+        checkValid(eye, m_images[i].image.size());
+
+        ASSERT_TRUE(eye.eyelidsDispersion.has);
+        EXPECT_GE(*eye.eyelidsDispersion, 0.f);
+        EXPECT_LT(*eye.eyelidsDispersion, 0.25f);
+
+        const float scaleGroundTruthToCurrent = float(m_images[i].image.cols) / float(m_targetWidth);
+        const float score = detectionScore(*m_eye, eye, m_images[i].image.size(), scaleGroundTruthToCurrent);
+        EXPECT_GT(score, m_scoreThreshold);
+    }
+
+    m_eyeSegmenter->setEyelidInits(eyelidInits);
+}
+
 // Currently there is no internal quality check, but this is included for regression:
 TEST_F(EyeModelEstimatorTest, ImageIsBlack)
 {
@@ -112,104 +112,162 @@ public:
             std::transform(faces.begin(), faces.end(), shapes.begin(), [](const FaceModel& face) {
                 return dsdkc::Shape(face.roi);
             });
-            findLandmarks(Ib, shapes, H, isDetection);
+
+            // Tracked faces (video) are warm started from the landmarks of the previous frame:
+            std::vector<std::vector<cv::Point2f>> priors(faces.size());
+            if (!isDetection && (m_regressor->getWarmStartStagesHint() > 0))
+            {
+                for (int i = 0; i < faces.size(); i++)
+                {
+                    if (faces[i].points.has)
+                    {
+                        priors[i] = *faces[i].points;
+                    }
+                }
+            }
+
+            findLandmarks(Ib, shapes, H, isDetection, priors);
             shapesToFaces(shapes, faces);
         }
 
         if (m_eyeRegressor.size() && m_eyeRegressor[0] && m_eyeRegressor[1] && m_doEyeRefinement && faces.size())
         {
-            for(auto &f : faces)
+            segmentEyes(Ib.Ib, faces);
+        }
+    }
+
+    // One eye segmentation job per eye, for all faces in the frame:
+    struct EyeJob
+    {
+        int face;
+        int side; // 0: right, 1: left (flipped to the right eye coordinate system)
+        cv::Rect roi;
+        cv::Mat crop; // view of the shared crop buffer
+        DRISHTI_EYE::EyeModel eye;
+    };
+
+    static cv::Mat extractCrop(const cv::Mat& Ib, const cv::Rect& eye, const cv::Rect& bounds)
+    {
+        cv::Rect roi = eye & bounds;
+        if (roi == eye)
+        {
+            return Ib(roi); // shallow copy
+        }
+
+        // We use a crop preserving deep copy in rare case of clipping
+        cv::Mat crop(eye.size(), CV_8UC1, cv::Scalar::all(0));
+        Ib(roi).copyTo(crop(roi - eye.tl()));
+        return crop;
+    }
+
+    void segmentEyes(const cv::Mat1b& Ib, std::vector<FaceModel>& faces)
+    {
+        // clang-format off
+        drishti::core::ScopeTimeLogger scopeTimeLogger = [this](double elapsed)
+        {
+            if (m_eyeRegressionTimeLogger)
             {
-                DRISHTI_EYE::EyeModel eyeR, eyeL;
-                segmentEyes(Ib.Ib, f, eyeR, eyeL);
-                if (eyeR.eyelids.size())
-                {
-                    f.eyeFullR = eyeR;
-                    f.eyeRightCenter = core::centroid(eyeR.eyelids);
-                }
-                if (eyeL.eyelids.size())
+                m_eyeRegressionTimeLogger(elapsed);
+            }
+        };
+        // clang-format on
+
+        std::vector<EyeJob> jobs;
+        cv::Size extent; // max crop width x total crop height
+        for (int i = 0; i < faces.size(); i++)
+        {
+            cv::Rect2f roiR, roiL;
+            bool hasEyes = faces[i].getEyeRegions(roiR, roiL, 0.666);
+            if (hasEyes && roiR.area() && roiL.area())
+            {
+                cv::Point2f v = geometry::centroid<float, float>(roiR) - geometry::centroid<float, float>(roiL);
+                float theta = std::atan2(v.y, v.x);
+                for (int side = 0; side < 2; side++)
                 {
-                    f.eyeFullL = eyeL;
-                    f.eyeLeftCenter = core::centroid(eyeL.eyelids);
+                    jobs.push_back({ i, side, cv::Rect(side ? roiL : roiR) });
+                    jobs.back().eye.angle = side ? -theta : theta;
+                    extent.width = std::max(extent.width, jobs.back().roi.width);
+                    extent.height += jobs.back().roi.height;
                 }
             }
         }
-    }
 
-    using RectPair = std::array<cv::Rect,2>;
-    using MatPair = std::array<cv::Mat,2>;
-    static void extractCrops(const cv::Mat& Ib, const RectPair &eyes, const cv::Rect& bounds, MatPair &crops)
-    {
-        for (int i = 0; i < 2; i++)
+        if (jobs.empty())
+        {
+            return;
+        }
+
+        // Extract all crops up front into one contiguous buffer:
+        cv::Mat1b buffer(extent);
+        const cv::Rect bounds({ 0, 0 }, Ib.size());
+        int y = 0;
+        for (auto& job : jobs)
         {
-            cv::Rect roi = eyes[i] & bounds;
-            if (roi == eyes[i])
+            job.crop = buffer(cv::Rect(0, y, job.roi.width, job.roi.height));
+            y += job.roi.height;
+
+            cv::Mat crop = extractCrop(Ib, job.roi, bounds);
+            if (job.side)
             {
-                crops[i] = Ib(roi); // shallow copy
+                cv::flip(crop, job.crop, 1); // Flip left eye to right eye cs
             }
             else
             {
-                // We use a crop preserving deep copy in rare case of clipping
-                crops[i].create(eyes[i].size(), CV_8UC1);
-                crops[i].setTo(0);
-                Ib(roi).copyTo(crops[i](roi - eyes[i].tl()));
+                crop.copyTo(job.crop);
             }
-         }
-    }
+        }
 
-    void segmentEyes(const cv::Mat1b& Ib, FaceModel& face, DRISHTI_EYE::EyeModel& eyeR, DRISHTI_EYE::EyeModel& eyeL)
-    {
-        cv::Rect2f roiR, roiL;
-        bool hasEyes = face.getEyeRegions(roiR, roiL, 0.666);
-        if (hasEyes && roiR.area() && roiL.area())
+        for (auto& regressor : m_eyeRegressor)
         {
-            // clang-format off
-            drishti::core::ScopeTimeLogger scopeTimeLogger = [this](double elapsed)
-            {
-                if (m_eyeRegressionTimeLogger)
+            regressor->setDoIndependentIrisAndPupil(m_doIrisRefinement);
+            regressor->setEyelidInits(1);
+            regressor->setIrisInits(1);
+        }
+
+        if (m_eyeRegressor[0]->isReentrant())
+        {
+            // All eyes share one regressor on the thread pool:
+            drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+                (*m_eyeRegressor[0])(jobs[i].crop, jobs[i].eye);
+            };
+            cv::parallel_for_({ 0, int(jobs.size()) }, harness);
+        }
+        else
+        {
+            // One worker per regressor instance:
+            drishti::core::ParallelHomogeneousLambda harness = [&](int side) {
+                for (auto& job : jobs)
                 {
-                    m_eyeRegressionTimeLogger(elapsed);
+                    if (job.side == side)
+                    {
+                        (*m_eyeRegressor[side])(job.crop, job.eye);
+                    }
                 }
             };
-            // clang-format on
+            cv::parallel_for_({ 0, 2 }, harness, 2);
+        }
 
-            MatPair crops;
-            RectPair eyes = {{ roiR, roiL }};
-            extractCrops(Ib, eyes, { { 0, 0 }, Ib.size() }, crops);
-            
-            cv::Mat flipped;
-            cv::flip(crops[1], flipped, 1); // Flip left eye to right eye cs
-            crops[1] = flipped;
-
-            cv::Point2f v = geometry::centroid<float, float>(roiR) - geometry::centroid<float, float>(roiL);
-            float theta = std::atan2(v.y, v.x);
-            eyeR.angle = theta;
-            eyeL.angle = (-theta);
-            
-            std::array<DRISHTI_EYE::EyeModel*,2> results {{ &eyeR, &eyeL }};
-            for (int i = 0; i < 2; i++)
+        // Scatter the results back to the faces:
+        for (auto& job : jobs)
+        {
+            auto& eye = job.eye;
+            if (job.side)
             {
-                m_eyeRegressor[i]->setDoIndependentIrisAndPupil(m_doIrisRefinement);
-                m_eyeRegressor[i]->setEyelidInits(1);
-                m_eyeRegressor[i]->setIrisInits(1);
+                eye.flop(job.crop.cols);
             }
+            eye += job.roi.tl(); // shift features to image coordinate system
+            eye.roi = job.roi;
 
-            drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
-                (*m_eyeRegressor[i])(crops[i], *results[i]);
-            };
-
-            //harness({0, 2});
-            cv::parallel_for_({ 0, 2 }, harness, 2);
-
-            eyeL.flop(crops[1].cols);
-            eyeL += eyes[1].tl(); // shift features to image coordinate system
-            eyeR += eyes[0].tl();
-            eyeR.roi = eyes[0];
-            eyeL.roi = eyes[1];
+            if (eye.eyelids.size())
+            {
+                auto& face = faces[job.face];
+                (job.side ? face.eyeFullL : face.eyeFullR) = eye;
+                (job.side ? face.eyeLeftCenter : face.eyeRightCenter) = core::centroid(eye.eyelids);
+            }
         }
     }
-    
-    void findLandmarks(const PaddedImage& Ib, std::vector<dsdkc::Shape>& shapes, const cv::Matx33f& Hdr_, bool isDetection)
+
+    void findLandmarks(const PaddedImage& Ib, std::vector<dsdkc::Shape>& shapes, const cv::Matx33f& Hdr_, bool isDetection, const std::vector<std::vector<cv::Point2f>>& priors = {})
     {
         // Scope based eye segmentation timer:
 
@@ -229,6 +287,8 @@ public:
         const cv::Rect fullBounds({ 0, 0 }, Ib.Ib.size());
         const cv::Rect bounds = Ib.roi.area() ? Ib.roi : fullBounds;
 
+        std::vector<cv::Mat> crops(shapes.size());
+        std::vector<std::vector<cv::Point2f>> points(shapes.size());
         for (int i = 0; i < shapes.size(); i++)
         {
             // Detection rectangles may have a geometry (w.r.t. face features) that is incompatible with the
@@ -250,12 +310,26 @@ public:
             // a simple shallow copy/view, but in cases where the border is clipped, then we will effectively
             // perform border padding to achieve this goal.  This make our prediction ROI closest to the ROI
             // used during training and ensures our cascaded pose regression has the best chance of success.
-            cv::Mat crop = geometryPreservingCrop(shapes[i].roi, gray);
- 
-            std::vector<bool> mask;
-            std::vector<cv::Point2f> points;
-            (*m_regressor)(crop, points, mask);
-            for (const auto& p : points)
+            crops[i] = geometryPreservingCrop(shapes[i].roi, gray);
+
+            // Optional warm start: prior landmarks in the normalized crop coordinate system
+            if (i < priors.size())
+            {
+                const cv::Rect& r = shapes[i].roi;
+                for (const auto& p : priors[i])
+                {
+                    const cv::Point3f q = Hdr_ * p; // homogeneous
+                    points[i].emplace_back((q.x / q.z - r.x) / r.width, (q.y / q.z - r.y) / r.height);
+                }
+            }
+        }
+
+        // Regress all faces in a single batch (i.e., crowds):
+        std::vector<std::vector<bool>> masks;
+        (*m_regressor)(crops, points, masks);
+        for (int i = 0; i < shapes.size(); i++)
+        {
+            for (const auto& p : points[i])
             {
                 const cv::Point q = p + cv::Point2f(shapes[i].roi.tl());
                 shapes[i].contour.emplace_back(q.x, q.y, 0);
@@ -441,6 +515,13 @@ public:
             m_regressor->setStagesHint(stages);
         }
     }
+    void setFaceWarmStartStagesHint(int stages)
+    {
+        if (m_regressor)
+        {
+            m_regressor->setWarmStartStagesHint(stages);
+        }
+    }
     void setEyelidStagesHint(int stages)
     {
         for (auto& regressor : m_eyeRegressor)
@@ -628,6 +709,11 @@ void FaceDetector::setFaceStagesHint(int stages)
     m_impl->setFaceStagesHint(stages);
 }
 
+void FaceDetector::setFaceWarmStartStagesHint(int stages)
+{
+    m_impl->setFaceWarmStartStagesHint(stages);
+}
+
 void FaceDetector::setEyelidStagesHint(int stages)
 {
     m_impl->setEyelidStagesHint(stages);
@@ -98,6 +98,7 @@ public:
 
     void setFaceStagesHint(int stages);
     void setFace2StagesHint(int stages);
+    void setFaceWarmStartStagesHint(int stages); // video mode: tracked faces run only the last stages
     void setEyelidStagesHint(int stages);
     void setIrisStagesHint(int stages);
 
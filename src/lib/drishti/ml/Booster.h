@@ -235,6 +235,44 @@ public:
 #endif
     }
 
+    // Trees of a gbtree model w/ full precision split conditions and leaf values (DumpModel() prints
+    // 6 significant digits).  GBTree doesn't expose its trees, so they are read back from its binary
+    // model: [ModelParam][tree 0]...[tree n-1][tree_info x n]
+    inline std::vector<tree::RegTree> GetTrees(float* base_score)
+    {
+        std::vector<tree::RegTree> trees;
+
+        this->CheckInitModel();
+        if (dynamic_cast<gbm::GBTree*>(&(*gbm_)) == nullptr)
+        {
+            return trees;
+        }
+
+        std::string header, model;
+        {
+            utils::MemoryBufferStream fs(&header); // size of the (private) GBTree::ModelParam
+            gbm::GBTree().SaveModel(fs, false);
+        }
+        {
+            utils::MemoryBufferStream fs(&model);
+            gbm_->SaveModel(fs, false);
+        }
+
+        int num_trees = 0; // first field of GBTree::ModelParam
+        utils::MemoryFixSizeBuffer fi(&model[0], model.size());
+        utils::Check(fi.Read(&num_trees, sizeof(num_trees)) != 0, "GetTrees: invalid gbtree model");
+        fi.Seek(header.size());
+        while ((model.size() - fi.Tell()) > (sizeof(int) * trees.size()))
+        {
+            trees.emplace_back();
+            trees.back().LoadModel(fi);
+        }
+        utils::Check(trees.size() == std::size_t(num_trees), "GetTrees: tree count doesn't match the gbtree model");
+
+        *base_score = mparam.base_score; // margin (w/o the objective's transform)
+        return trees;
+    }
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
     {
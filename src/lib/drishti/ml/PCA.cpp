@@ -120,9 +120,31 @@ void StandardizedPCA::init()
     if (!m_pca->eigenvectors.empty())
     {
         m_eT = m_pca->eigenvectors.t();
+
+        // Cache the unstandardized basis for incremental back projection (single precision for the shape models):
+        m_eS.release();
+        if (!m_transform.sigma.empty())
+        {
+            cv::Mat1f E, sigma;
+            m_pca->eigenvectors.convertTo(E, CV_32F);
+            m_transform.sigma.reshape(1, 1).convertTo(sigma, CV_32F);
+            CV_Assert(sigma.cols == E.cols);
+            m_eS = E.mul(cv::repeat(sigma, E.rows, 1));
+        }
     }
 }
 
+void StandardizedPCA::init(const Standardizer& transform, const cv::Mat& mean, const cv::Mat& eigenvectors, const cv::Mat& eigenvalues)
+{
+    m_transform = transform;
+    m_pca = drishti::core::make_unique<cv::PCA>();
+    m_pca->mean = mean;
+    m_pca->eigenvectors = eigenvectors;
+    m_pca->eigenvalues = eigenvalues;
+
+    init();
+}
+
 cv::Mat StandardizedPCA::project(const cv::Mat& samples, int n) const
 {
     cv::Mat samples_ = m_transform.standardize(samples), projection;
@@ -45,6 +45,18 @@ public:
     void compute(const cv::Mat& data, cv::Mat& projection, int maxComponents);
     void init();
 
+    // Initialize from existing matrices (i.e., memory mapped storage), which are not copied:
+    void init(const Standardizer& transform, const cv::Mat& mean, const cv::Mat& eigenvectors, const cv::Mat& eigenvalues);
+
+    const Standardizer& getStandardizer() const
+    {
+        return m_transform;
+    }
+    const cv::PCA* getPCA() const
+    {
+        return m_pca.get();
+    }
+
     size_t getNumComponents() const;
 
     cv::Mat project(const cv::Mat& data, int n = 0) const;
@@ -54,6 +66,13 @@ public:
         return m_eT;
     }
 
+    // Eigenvectors w/ each column scaled by the standardization sigma (continuous, one row per component):
+    // changing coefficient i by d moves the (unstandardized) back projection by d * row i.
+    const cv::Mat& getScaledEigenvectors() const
+    {
+        return m_eS;
+    }
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version);
 
@@ -64,6 +83,7 @@ protected:
     std::unique_ptr<cv::PCA> m_pca;
 
     cv::Mat m_eT; // transposed eigenvectors
+    cv::Mat m_eS; // sigma scaled eigenvectors
 };
 
 DRISHTI_ML_NAMESPACE_END
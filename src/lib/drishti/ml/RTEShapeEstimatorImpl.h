@@ -14,6 +14,7 @@
 #include "drishti/core/make_unique.h"
 #include "drishti/ml/drishti_ml.h"
 #include "drishti/ml/shape_predictor_archive.h"
+#include "drishti/ml/shape_predictor_flat.h"
 
 #define _SHAPE_PREDICTOR drishti::ml::shape_predictor
 
@@ -31,7 +32,7 @@ public:
     {
         // Copy initial chunk of 2d points
         int pointLength = points.size() - (ellipseCount * 5);
-        memcpy(shape, &points[0].x, sizeof(float) * pointLength);
+        memcpy(shape, &points[0].x, sizeof(float) * pointLength * 2);
 
         // Next copy in the ellipses:
         for (int i = 0; i < ellipseCount; i++)
@@ -41,24 +42,94 @@ public:
         }
     }
 
-    int operator()(const cv::Mat& crop, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
+    // Model parameters shared by the shape_predictor and the flat (memory mapped) variant:
+    const fshape& getInitialShape() const
     {
-        CV_Assert(crop.type() == CV_8UC1);
+        return m_flat ? m_flat->getInitialShape() : m_predictor->initial_shape;
+    }
 
-        auto& sp = *m_predictor;
+    int getEllipseCount() const
+    {
+        return m_flat ? m_flat->getEllipseCount() : m_predictor->m_ellipse_count;
+    }
 
-        fshape initial_shape = sp.initial_shape;
+    int getStageCount() const
+    {
+        return m_flat ? int(m_flat->header().stages) : int(m_predictor->forests.size());
+    }
 
-        int paramCount = (points.size() * 2) - (m_predictor->m_ellipse_count * 5);
-        if (paramCount == initial_shape.size())
+    // Video mode: shapes that are warm started from a full input point set (i.e., the motion
+    // compensated landmarks of a tracked face) run only the last m_warmStartStages (fine) cascades.
+    // If that moves the landmarks by more than m_warmStartThreshold (mean displacement relative
+    // to the crop size), the warm start is rejected and the full cascade is run from the mean shape.
+    int getFirstStage(bool isWarm) const
+    {
+        return (isWarm && (m_warmStartStages > 0)) ? std::max(0, std::min(m_stagesHint, getStageCount()) - m_warmStartStages) : 0;
+    }
+
+    bool isWarmStartValid(const fshape& start, const dlib::full_object_detection& shape, const cv::Size& size) const
+    {
+        const int n = int(start.size() - (getEllipseCount() * 5)) / 2;
+        float error = 0.f;
+        for (int i = 0; i < n; i++)
         {
-            packPointsInShape(points, m_predictor->m_ellipse_count, &initial_shape(0, 0));
+            const cv::Point2f p(float(shape.part(i).x()) / size.width, float(shape.part(i).y()) / size.height);
+            error += cv::norm(p - cv::Point2f(start(i * 2 + 0), start(i * 2 + 1)));
+        }
+        return (n == 0) || ((error / float(n)) <= m_warmStartThreshold);
+    }
+
+    dlib::full_object_detection predict(const cv::Mat& crop, const fshape& shape, int first) const
+    {
+        dlib::rectangle roi(0, 0, crop.cols, crop.rows);
+        if (m_flat)
+        {
+            return (*m_flat)(crop, roi, shape, m_stagesHint, first);
         }
 
         // Zero copy cv::Mat wrapper:
         auto img = dlib::cv_image<uint8_t>(crop);
-        dlib::rectangle roi(0, 0, crop.cols, crop.rows);
-        dlib::full_object_detection shape = (*m_predictor)(img, roi, initial_shape, m_stagesHint);
+        return (*m_predictor)(img, roi, shape, m_stagesHint, first);
+    }
+
+    std::vector<dlib::full_object_detection> predict(const std::vector<cv::Mat>& crops, const std::vector<fshape>& shapes, int first) const
+    {
+        std::vector<dlib::rectangle> rois;
+        for (const auto& crop : crops)
+        {
+            rois.emplace_back(0, 0, crop.cols, crop.rows);
+        }
+
+        if (m_flat)
+        {
+            return (*m_flat)(crops, rois, shapes, m_stagesHint, first);
+        }
+
+        // Zero copy cv::Mat wrappers:
+        std::vector<dlib::cv_image<uint8_t>> imgs(crops.begin(), crops.end());
+        return (*m_predictor)(imgs, rois, shapes, m_stagesHint, first);
+    }
+
+    int operator()(const cv::Mat& crop, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
+    {
+        CV_Assert(crop.type() == CV_8UC1);
+
+        fshape initial_shape = getInitialShape();
+
+        bool isWarm = false;
+        int paramCount = (points.size() * 2) - (getEllipseCount() * 5);
+        if (paramCount == initial_shape.size())
+        {
+            packPointsInShape(points, getEllipseCount(), &initial_shape(0, 0));
+            isWarm = true;
+        }
+
+        const int first = getFirstStage(isWarm);
+        dlib::full_object_detection shape = predict(crop, initial_shape, first);
+        if (first && !isWarmStartValid(initial_shape, shape, crop.size()))
+        {
+            shape = predict(crop, getInitialShape(), 0);
+        }
 
         points.clear();
         points.reserve(initial_shape.size() / 2);
@@ -71,6 +142,79 @@ public:
         return int(points.size());
     }
 
+    // Batched version of the above, w/ all faces regressed in lockstep (see shape_predictor):
+    int operator()(const std::vector<cv::Mat>& crops, std::vector<std::vector<cv::Point2f>>& points, std::vector<std::vector<bool>>& masks) const
+    {
+        points.resize(crops.size());
+        masks.resize(crops.size());
+
+        std::vector<fshape> initial_shapes(crops.size(), getInitialShape());
+        std::vector<int> warm, cold; // warm started and full cascade faces
+        for (int i = 0; i < crops.size(); i++)
+        {
+            CV_Assert(crops[i].type() == CV_8UC1);
+
+            bool isWarm = false;
+            int paramCount = (points[i].size() * 2) - (getEllipseCount() * 5);
+            if (paramCount == initial_shapes[i].size())
+            {
+                packPointsInShape(points[i], getEllipseCount(), &initial_shapes[i](0, 0));
+                isWarm = true;
+            }
+
+            (getFirstStage(isWarm) ? warm : cold).push_back(i);
+        }
+
+        std::vector<dlib::full_object_detection> shapes(crops.size());
+        auto run = [&](const std::vector<int>& indices, int first) {
+            std::vector<cv::Mat> subset;
+            std::vector<fshape> starts;
+            for (auto i : indices)
+            {
+                subset.push_back(crops[i]);
+                starts.push_back(initial_shapes[i]);
+            }
+
+            auto results = predict(subset, starts, first);
+            for (int j = 0; j < indices.size(); j++)
+            {
+                shapes[indices[j]] = results[j];
+            }
+        };
+
+        if (warm.size())
+        {
+            run(warm, getFirstStage(true));
+            for (auto i : warm)
+            {
+                if (!isWarmStartValid(initial_shapes[i], shapes[i], crops[i].size()))
+                {
+                    initial_shapes[i] = getInitialShape();
+                    cold.push_back(i);
+                }
+            }
+        }
+
+        if (cold.size())
+        {
+            run(cold, 0);
+        }
+
+        for (int i = 0; i < crops.size(); i++)
+        {
+            points[i].clear();
+            points[i].reserve(shapes[i].num_parts());
+            masks[i].clear();
+            for (int j = 0; j < shapes[i].num_parts(); j++)
+            {
+                points[i].push_back(cv_point(shapes[i].part(j)));
+                masks[i].push_back(true);
+            }
+        }
+
+        return int(crops.size());
+    }
+
     void setStagesHint(int stages)
     {
         m_stagesHint = stages;
@@ -81,10 +225,34 @@ public:
         return m_stagesHint;
     }
 
+    void setWarmStartStagesHint(int stages)
+    {
+        m_warmStartStages = stages;
+    }
+
+    int getWarmStartStagesHint() const
+    {
+        return m_warmStartStages;
+    }
+
+    void setWarmStartThreshold(float threshold)
+    {
+        m_warmStartThreshold = threshold;
+    }
+
+    bool setDoQuickScorer(bool flag)
+    {
+        if (m_predictor) // flat models use tree traversal
+        {
+            return m_predictor->set_do_quick_scorer(flag);
+        }
+        return !flag;
+    }
+
     // {{p[0].x, p[0].y}, ..., {p[n].x,p[n.y}, {phi0[0],0}, {phi0[1],0} {phi0[2],0}, {phi0[3],0}, {phi0[4],0}}...
     std::vector<cv::Point2f> getMeanShape() const
     {
-        std::vector<fpoint> data = convert_shape_to_points<float>(m_predictor->initial_shape, m_predictor->m_ellipse_count);
+        std::vector<fpoint> data = convert_shape_to_points<float>(getInitialShape(), getEllipseCount());
         std::vector<cv::Point2f> points(data.size());
         std::transform(data.begin(), data.end(), points.begin(), [](const fpoint& p) {
             return cv::Point2f(p.x(), p.y());
@@ -94,6 +262,7 @@ public:
 
     void dump(std::vector<float>& values, bool pca)
     {
+        CV_Assert(m_predictor); // not supported for flat models
         return m_predictor->getShapeUpdates(values, pca);
     }
 
@@ -119,13 +288,16 @@ public:
 
     bool isPCA() const
     {
-        return bool(m_predictor->m_pca.get());
+        return m_flat ? m_flat->isPCA() : bool(m_predictor->m_pca.get());
     }
 
     int m_inits = 1;
     int m_stagesHint = std::numeric_limits<int>::max();
+    int m_warmStartStages = 0; // video mode is disabled by default
+    float m_warmStartThreshold = 0.05f;
 
     std::unique_ptr<_SHAPE_PREDICTOR> m_predictor;
+    std::unique_ptr<shape_predictor_flat> m_flat; // memory mapped alternative to m_predictor
 
     std::shared_ptr<spdlog::logger> m_streamLogger;
 };
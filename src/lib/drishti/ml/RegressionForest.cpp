@@ -0,0 +1,169 @@
+/*! -*-c++-*-
+  @file   RegressionForest.cpp
+  @author David Hirvonen
+  @brief  Internal implementation of a compact native forest for exported XGBoost regressors.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/ml/RegressionForest.h"
+#include "drishti/ml/XGBooster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+int RegressionForest::add(XGBooster& booster)
+{
+    std::vector<std::vector<Node>> trees;
+    const float bias = booster.getTrees(trees);
+
+    const auto nodes = m_nodes.size(), roots = m_roots.size();
+    const int features = m_features;
+
+    bool valid = true;
+    for (const auto& tree : trees)
+    {
+        valid = valid && addTree(tree);
+    }
+
+    const int output = static_cast<int>(m_bias.size());
+    m_outputs.push_back(m_roots.size());
+    m_bias.push_back(bias);
+
+    if (!valid || !matches(booster, output))
+    {
+        m_nodes.resize(nodes);
+        m_roots.resize(roots);
+        m_outputs.pop_back();
+        m_bias.pop_back();
+        m_features = features;
+        return -1;
+    }
+
+    return output;
+}
+
+bool RegressionForest::addTree(const std::vector<Node>& tree)
+{
+    const int32_t count = static_cast<int32_t>(tree.size());
+    if (count == 0)
+    {
+        return false;
+    }
+
+    const int32_t base = static_cast<int32_t>(m_nodes.size());
+    for (auto node : tree)
+    {
+        for (auto child : { node.yes, node.no, node.missing })
+        {
+            if ((child < 0) || (child >= count))
+            {
+                return false;
+            }
+        }
+        if (node.feature >= 0)
+        {
+            m_features = std::max(m_features, node.feature + 1);
+        }
+        node.yes += base;
+        node.no += base;
+        node.missing += base;
+        m_nodes.push_back(node);
+    }
+    m_roots.push_back(base);
+
+    return true;
+}
+
+bool RegressionForest::matches(XGBooster& booster, int output) const
+{
+    // Thresholds of each feature (sorted), from the trees of this output:
+    std::vector<std::vector<float>> thresholds(m_features);
+    const std::size_t first = (m_outputs[output] < m_roots.size()) ? m_roots[m_outputs[output]] : m_nodes.size();
+    for (std::size_t i = first; i < m_nodes.size(); i++)
+    {
+        if (m_nodes[i].feature >= 0)
+        {
+            thresholds[m_nodes[i].feature].push_back(m_nodes[i].value);
+        }
+    }
+
+    std::size_t probes = 1;
+    for (auto& values : thresholds)
+    {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        probes = std::max(probes, values.size());
+    }
+    probes = std::min(probes, std::size_t(32)); // a few XGBooster::operator() calls per output
+
+    // Every feature of probe j is (just below) its j-th threshold, so the routing near each
+    // threshold is exercised on all paths that the other features happen to take:
+    std::vector<float> x(std::max(m_features, 1), 0.f);
+    for (std::size_t j = 0; j < probes; j++)
+    {
+        for (int below = 0; below < 2; below++)
+        {
+            for (int f = 0; f < m_features; f++)
+            {
+                const auto& values = thresholds[f];
+                if (!values.empty())
+                {
+                    const float t = values[(j * values.size()) / probes];
+                    x[f] = below ? std::nextafter(t, -std::numeric_limits<float>::infinity()) : t;
+                }
+            }
+            if (below && m_features)
+            {
+                x[j % m_features] = NAN; // missing branch
+            }
+
+            const float expected = booster(x);
+            if (!(std::abs((*this)(x.data(), output) - expected) <= 1e-4f * (1.f + std::abs(expected))))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+float RegressionForest::leaf(int root, const float* features) const
+{
+    const Node* nodes = m_nodes.data();
+
+    int i = root;
+    while (nodes[i].feature >= 0)
+    {
+        const Node& node = nodes[i];
+        const float x = features[node.feature];
+        i = std::isnan(x) ? node.missing : ((x < node.value) ? node.yes : node.no);
+    }
+    return nodes[i].value;
+}
+
+float RegressionForest::operator()(const float* features, int output) const
+{
+    float sum = 0.f; // same order as XGBoost: trees, then the base score
+    for (std::size_t t = m_outputs[output]; t < m_outputs[output + 1]; t++)
+    {
+        sum += leaf(m_roots[t], features);
+    }
+    return sum + m_bias[output];
+}
+
+void RegressionForest::operator()(const float* features, float* outputs) const
+{
+    for (std::size_t i = 0; i < size(); i++)
+    {
+        outputs[i] = (*this)(features, static_cast<int>(i));
+    }
+}
+
+DRISHTI_ML_NAMESPACE_END
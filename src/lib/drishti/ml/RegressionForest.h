@@ -0,0 +1,74 @@
+/*! -*-c++-*-
+  @file   RegressionForest.h
+  @author David Hirvonen
+  @brief  Internal declaration of a compact native forest for exported XGBoost regressors.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  XGBooster::operator() builds a DMatrix for every prediction.  The trees of
+  one or more XGBooster regressors can instead be exported once (at load time)
+  to a flat node array, which evaluates all of the regressors w/ a single
+  pass over a feature vector and no allocation.
+
+*/
+
+#ifndef __drishti_ml_RegressionForest_h__
+#define __drishti_ml_RegressionForest_h__
+
+#include "drishti/ml/drishti_ml.h"
+
+#include <cstdint>
+#include <vector>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+class XGBooster;
+
+class RegressionForest
+{
+public:
+    struct Node
+    {
+        float value;     // split threshold, or leaf value
+        int32_t feature; // split feature index, or -1 for a leaf
+        int32_t yes;     // child for features[feature] < value
+        int32_t no;      // child for features[feature] >= value
+        int32_t missing; // child for NaN features (masked pixels)
+    };
+
+    // Append the trees of one (reg:linear) regressor as a new output, and return the output index.
+    // The forest is checked against the booster on probes at (and just below) the split thresholds;
+    // if it doesn't reproduce the booster's predictions nothing is added and -1 is returned, so the
+    // caller can fall back to XGBooster::operator().
+    int add(XGBooster& booster);
+
+    // outputs[i] = prediction of regressor i (no allocation):
+    void operator()(const float* features, float* outputs) const;
+
+    // Prediction of one regressor:
+    float operator()(const float* features, int output) const;
+
+    std::size_t size() const { return m_bias.size(); }
+    std::size_t trees() const { return m_roots.size(); }
+    int features() const { return m_features; } // required feature vector length
+
+protected:
+    // Append one tree (node indices relative to the tree, root 0), returns false for invalid links:
+    bool addTree(const std::vector<Node>& tree);
+
+    // Compare output i w/ the booster near the split thresholds:
+    bool matches(XGBooster& booster, int output) const;
+
+    float leaf(int root, const float* features) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<int32_t> m_roots;
+    std::vector<std::size_t> m_outputs = { 0 }; // trees of output i: [m_outputs[i], m_outputs[i + 1])
+    std::vector<float> m_bias;                  // base score
+    int m_features = 0;
+};
+
+DRISHTI_ML_NAMESPACE_END
+
+#endif // __drishti_ml_RegressionForest_h__
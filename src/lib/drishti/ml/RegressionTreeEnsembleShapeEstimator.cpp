@@ -26,14 +26,34 @@ DRISHTI_ML_NAMESPACE_BEGIN
 RTEShapeEstimator::Impl::Impl() = default;
 RTEShapeEstimator::Impl::~Impl() = default;
 
+// Flat models (see shape_predictor_flat) are identified by the ".spf" extension:
+static bool isFlat(const std::string& filename)
+{
+    return (filename.find(".spf") != std::string::npos);
+}
+
 RTEShapeEstimator::Impl::Impl(const std::string& filename)
 {
-    m_predictor = make_unique_cpb<_SHAPE_PREDICTOR>(filename);
+    if (isFlat(filename))
+    {
+        m_flat = shape_predictor_flat::load(filename);
+    }
+    else
+    {
+        m_predictor = make_unique_cpb<_SHAPE_PREDICTOR>(filename);
+    }
 }
 
-RTEShapeEstimator::Impl::Impl(std::istream& is, const std::string& /*hint*/)
+RTEShapeEstimator::Impl::Impl(std::istream& is, const std::string& hint)
 {
-    m_predictor = make_unique_cpb<_SHAPE_PREDICTOR>(is);
+    if (isFlat(hint))
+    {
+        m_flat = shape_predictor_flat::load(is);
+    }
+    else
+    {
+        m_predictor = make_unique_cpb<_SHAPE_PREDICTOR>(is);
+    }
 }
 
 // ############################################
@@ -72,11 +92,36 @@ int RTEShapeEstimator::getStagesHint() const
     return m_impl->getStagesHint();
 }
 
+void RTEShapeEstimator::setWarmStartStagesHint(int stages)
+{
+    m_impl->setWarmStartStagesHint(stages);
+}
+
+int RTEShapeEstimator::getWarmStartStagesHint() const
+{
+    return m_impl->getWarmStartStagesHint();
+}
+
+void RTEShapeEstimator::setWarmStartThreshold(float threshold)
+{
+    m_impl->setWarmStartThreshold(threshold);
+}
+
+bool RTEShapeEstimator::setDoQuickScorer(bool flag)
+{
+    return m_impl->setDoQuickScorer(flag);
+}
+
 int RTEShapeEstimator::operator()(const cv::Mat& gray, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
 {
     return (*m_impl)(gray, points, mask);
 }
 
+int RTEShapeEstimator::operator()(const std::vector<cv::Mat>& crops, std::vector<Point2fVec>& points, std::vector<BoolVec>& masks) const
+{
+    return (*m_impl)(crops, points, masks);
+}
+
 int RTEShapeEstimator::operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const
 {
     CV_Assert(false);
@@ -35,6 +35,7 @@ public:
     virtual void setStreamLogger(std::shared_ptr<spdlog::logger>& logger);
     virtual int operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const;
     virtual int operator()(const cv::Mat& I, Point2fVec& points, BoolVec& mask) const;
+    virtual int operator()(const std::vector<cv::Mat>& crops, std::vector<Point2fVec>& points, std::vector<BoolVec>& masks) const;
     virtual std::vector<cv::Point2f> getMeanShape() const;
     virtual void setDoPreview(bool flag) {}
     virtual bool isPCA() const;
@@ -42,6 +43,14 @@ public:
     virtual void setStagesHint(int stages);
     virtual int getStagesHint() const;
 
+    virtual void setWarmStartStagesHint(int stages);
+    virtual int getWarmStartStagesHint() const;
+    virtual void setWarmStartThreshold(float threshold);
+
+    // Branch free forest evaluation (see shape_predictor::set_do_quick_scorer()), select after loading,
+    // returns false if the model falls back to tree traversal:
+    bool setDoQuickScorer(bool flag);
+
     void dump(std::vector<float>& values, bool pca);
 
     template <class Archive>
@@ -49,4 +49,15 @@ int ShapeEstimator::operator()(const cv::Mat& image, const cv::Rect& roi, Point2
     return n;
 }
 
+int ShapeEstimator::operator()(const std::vector<cv::Mat>& crops, std::vector<Point2fVec>& points, std::vector<BoolVec>& masks) const
+{
+    points.resize(crops.size());
+    masks.resize(crops.size());
+    for (int i = 0; i < crops.size(); i++)
+    {
+        (*this)(crops[i], points[i], masks[i]);
+    }
+    return int(crops.size());
+}
+
 DRISHTI_ML_NAMESPACE_END
@@ -40,6 +40,9 @@ public:
     virtual int operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const = 0;
     virtual int operator()(const cv::Mat& crop, Point2fVec& points, BoolVec& mask) const = 0;
     virtual int operator()(const cv::Mat& image, const cv::Rect& roi, Point2fVec& points, BoolVec& mask) const;
+
+    // Batched estimation for several crops (i.e., all faces in a frame), the default calls the single crop estimator:
+    virtual int operator()(const std::vector<cv::Mat>& crops, std::vector<Point2fVec>& points, std::vector<BoolVec>& masks) const;
     virtual std::vector<cv::Point2f> getMeanShape() const
     {
         return std::vector<cv::Point2f>();
@@ -55,6 +58,14 @@ public:
         return 0;
     }
 
+    // Video mode: warm started estimates (full input point sets) run only the last stages:
+    virtual void setWarmStartStagesHint(int stages){};
+    virtual int getWarmStartStagesHint() const
+    {
+        return 0;
+    }
+    virtual void setWarmStartThreshold(float threshold){};
+
     virtual void dump(std::vector<float>& params, bool pca = false) {}
 
     template <class Archive>
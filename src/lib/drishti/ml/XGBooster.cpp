@@ -67,4 +67,9 @@ void XGBooster::write(const std::string& filename) const
 #endif
 }
 
+float XGBooster::getTrees(std::vector<std::vector<RegressionForest::Node>>& trees) const
+{
+    return m_impl->getTrees(trees);
+}
+
 DRISHTI_ML_NAMESPACE_END
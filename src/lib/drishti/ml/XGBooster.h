@@ -12,11 +12,14 @@
 #define __drishti_ml_XGBooster_h__
 
 #include "drishti/ml/drishti_ml.h"
+#include "drishti/ml/RegressionForest.h"
 #include "drishti/core/Logger.h"
 
 #include <opencv2/core.hpp>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 template <typename T>
 using MatrixType = std::vector<std::vector<T>>;
@@ -49,6 +52,9 @@ public:
     void read(const std::string& filename);
     void write(const std::string& filename) const;
 
+    // Full precision trees (one node array per tree, root 0), returns the base score, see RegressionForest:
+    float getTrees(std::vector<std::vector<RegressionForest::Node>>& trees) const;
+
     // Boost serialization:
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version);
@@ -124,6 +124,33 @@ public:
 #endif
     }
 
+    float getTrees(std::vector<std::vector<RegressionForest::Node>>& trees) const
+    {
+        float base_score = 0.f;
+        const auto regTrees = m_booster->GetTrees(&base_score);
+
+        trees.resize(regTrees.size());
+        for (std::size_t t = 0; t < regTrees.size(); t++)
+        {
+            const auto& tree = regTrees[t];
+            auto& nodes = trees[t];
+            nodes.resize(tree.param.num_nodes);
+            for (int i = 0; i < tree.param.num_nodes; i++)
+            {
+                const auto& node = tree[i];
+                if (node.is_leaf() || node.is_deleted()) // deleted (pruned) nodes are unreachable
+                {
+                    nodes[i] = { node.is_leaf() ? node.leaf_value() : 0.f, -1, i, i, i };
+                }
+                else
+                {
+                    nodes[i] = { node.split_cond(), int32_t(node.split_index()), node.cleft(), node.cright(), node.cdefault() };
+                }
+            }
+        }
+        return base_score;
+    }
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
     {
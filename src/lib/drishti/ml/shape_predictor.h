@@ -26,6 +26,7 @@
 
 #include <dlib/opencv.h>
 #include <dlib/opencv/cv_image.h>
+#include <dlib/array2d.h>
 #include <dlib/geometry/vector.h>
 #include <dlib/image_transforms/assign_image.h>
 #include <dlib/image_processing/full_object_detection.h>
@@ -34,8 +35,10 @@
 
 #include "drishti/ml/drishti_ml.h"
 #include "drishti/ml/PCA.h"
+#include "drishti/ml/shape_predictor_sampling.h"
 #include "drishti/geometry/Ellipse.h"
 #include "drishti/core/Logger.h"
+#include "drishti/core/ThrowAssert.h"
 
 // Check input preprocessor definitions for SIMD and FIXED_POINT behavior:
 //
@@ -44,11 +47,7 @@
 
 #define DRISHTI_BUILD_PARALLEL_BOOSTING 1
 
-// clang-format off
-#if DRISHTI_BUILD_PARALLEL_BOOSTING
-#  include "drishti/core/Parallel.h"
-#endif
-// clang-format on
+#include "drishti/core/Parallel.h"
 
 #define FIXED_PRECISION 10
 
@@ -70,7 +69,12 @@
 #include <opencv2/core/core.hpp>
 
 // STL
+#include <algorithm>
+#include <cstdint>
 #include <deque>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
 
 DRISHTI_ML_NAMESPACE_BEGIN
 
@@ -394,6 +398,36 @@ struct regression_tree
         }
     }
 
+    inline unsigned long leaf(
+        const float* feature_pixel_values,
+        unsigned long stride,
+        bool do_npd = false) const
+    /*!
+        requires
+            - feature_pixel_values[i * stride] is the i-th feature of a single sample, i.e., one
+              column of a [features x samples] structure of arrays w/ stride samples per row
+        ensures
+            - returns the index of the leaf we end up in (see operator() above).
+    !*/
+    {
+        unsigned long i = 0;
+        while (i < splits.size())
+        {
+            const auto& node = splits[i];
+            const float a = feature_pixel_values[node.idx1 * stride];
+            const float b = feature_pixel_values[node.idx2 * stride];
+            if ((do_npd ? compute_npd(a, b) : (a - b)) > node.thresh)
+            {
+                i = left_child(i);
+            }
+            else
+            {
+                i = right_child(i);
+            }
+        }
+        return i - splits.size();
+    }
+
     friend void serialize(const regression_tree& item, std::ostream& out)
     {
 #if !DRISHTI_BUILD_MIN_SIZE
@@ -412,6 +446,123 @@ struct regression_tree
 
 // ------------------------------------------------------------------------------------
 
+// Branch free evaluation of a forest of perfect trees (i.e., one cascade stage), after
+// QuickScorer (Lucchese et al., SIGIR 2015): each tree keeps a bitvector of its reachable
+// leaves, where bit k is the k-th leaf from the left.  A split node whose test is false
+// (go right) clears the leaves of its left subtree, so the exit leaf of a tree is the lowest
+// bit that survives all of its nodes, independent of the order in which they are applied.
+// The nodes of all trees are sorted by feature pair and threshold, so each pixel difference
+// is computed once, and the masks are applied in a linear pass w/ an unconditional AND.
+class quick_scorer
+{
+public:
+    quick_scorer() = default;
+
+    // Leaf bitvectors are 64 bits: perfect trees of depth <= 6
+    static bool is_supported(const std::vector<regression_tree>& forest)
+    {
+        return std::all_of(forest.begin(), forest.end(), [](const regression_tree& tree) {
+            const uint64_t leaves = tree.splits.size() + 1;
+            return (leaves <= 64) && ((leaves & (leaves - 1)) == 0);
+        });
+    }
+
+    explicit quick_scorer(const std::vector<regression_tree>& forest)
+    {
+        drishti_throw_assert(is_supported(forest), "quick_scorer requires perfect trees w/ at most 64 leaves");
+
+        struct Node
+        {
+            unsigned short idx1, idx2;
+            float thresh;
+            uint32_t tree;
+            uint64_t mask;
+        };
+
+        std::vector<Node> nodes;
+        m_bits.resize(forest.size());
+        for (std::size_t t = 0; t < forest.size(); t++)
+        {
+            const auto& splits = forest[t].splits;
+            const uint64_t leaves = splits.size() + 1;
+            m_bits[t] = (leaves == 64) ? ~uint64_t(0) : ((uint64_t(1) << leaves) - 1);
+            for (std::size_t i = 0, level = 0; i < splits.size(); i++)
+            {
+                level += ((i + 1) & i) == 0; // i + 1 is a power of 2 (first node of the next level)
+                const uint64_t span = leaves >> (level - 1), first = (i + 1 - (uint64_t(1) << (level - 1))) * span;
+                const uint64_t left = ((uint64_t(1) << (span / 2)) - 1) << first;
+                nodes.push_back({ splits[i].idx1, splits[i].idx2, splits[i].thresh, uint32_t(t), ~left });
+            }
+        }
+
+        std::sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b) {
+            return std::make_tuple(a.idx1, a.idx2, b.thresh) < std::make_tuple(b.idx1, b.idx2, a.thresh);
+        });
+
+        for (std::size_t i = 0; i < nodes.size(); i++)
+        {
+            const auto& node = nodes[i];
+            if (m_pairs.empty() || (m_pairs.back().idx1 != node.idx1) || (m_pairs.back().idx2 != node.idx2))
+            {
+                m_pairs.push_back({ node.idx1, node.idx2, uint32_t(i), uint32_t(i) });
+            }
+            m_pairs.back().end++;
+            m_thresholds.push_back(node.thresh);
+            m_trees.push_back(node.tree);
+            m_masks.push_back(node.mask);
+        }
+    }
+
+    // Leaf bitvectors for all trees: exit_leaf(bits[t]) == forest[t].leaf(feature_pixel_values, stride, do_npd)
+    void operator()(const float* feature_pixel_values, unsigned long stride, bool do_npd, std::vector<uint64_t>& bits) const
+    {
+        bits = m_bits;
+        for (const auto& pair : m_pairs)
+        {
+            const float a = feature_pixel_values[pair.idx1 * stride];
+            const float b = feature_pixel_values[pair.idx2 * stride];
+            const float value = do_npd ? compute_npd(a, b) : (a - b);
+            for (uint32_t i = pair.begin; i < pair.end; i++)
+            {
+                // The mask is only applied when the test is false:
+                bits[m_trees[i]] &= m_masks[i] | (uint64_t(0) - uint64_t(value > m_thresholds[i]));
+            }
+        }
+    }
+
+    static unsigned long exit_leaf(uint64_t bits)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned long>(__builtin_ctzll(bits));
+#else
+        unsigned long leaf = 0;
+        while (!(bits & 1))
+        {
+            bits >>= 1;
+            leaf++;
+        }
+        return leaf;
+#endif
+    }
+
+protected:
+    struct Pair
+    {
+        unsigned short idx1, idx2;
+        uint32_t begin, end; // node range
+    };
+
+    std::vector<uint64_t> m_bits; // initial bitvector per tree
+    std::vector<Pair> m_pairs;
+
+    // Nodes sorted by feature pair and descending threshold:
+    std::vector<float> m_thresholds;
+    std::vector<uint32_t> m_trees;
+    std::vector<uint64_t> m_masks;
+};
+
+// ------------------------------------------------------------------------------------
+
 inline dlib::vector<float, 2> location(
     const fshape& shape,
     unsigned long idx)
@@ -537,31 +688,52 @@ inline dlib::point_transform_affine unnormalizing_tform(
 
 // ------------------------------------------------------------------------------------
 
+// 8 bit grayscale cv::Mat view of a dlib image (w/ a converted copy for other pixel types):
+template <typename image_type>
+cv::Mat as_gray_mat(const image_type& img, std::true_type)
+{
+    void* data = const_cast<void*>(dlib::image_data(img));
+    return cv::Mat(int(dlib::num_rows(img)), int(dlib::num_columns(img)), CV_8UC1, data, std::size_t(dlib::width_step(img)));
+}
+
+template <typename image_type>
+cv::Mat as_gray_mat(const image_type& img, std::false_type)
+{
+    dlib::array2d<unsigned char> gray;
+    dlib::assign_image(gray, img);
+    return as_gray_mat(gray, std::true_type()).clone();
+}
+
+template <typename image_type>
+cv::Mat as_gray_mat(const image_type& img)
+{
+    using pixel_type = typename dlib::image_traits<image_type>::pixel_type;
+    return as_gray_mat(img, std::is_same<pixel_type, unsigned char>());
+}
+
+// ------------------------------------------------------------------------------------
+
 template <typename image_type>
 void extract_feature_pixel_values(
     const image_type& img_,
     const dlib::rectangle& rect,
     const fshape& current_shape,
     const std::vector<InterpolatedFeature>& interpolated_features,
-    std::vector<float>& feature_pixel_values)
+    std::vector<float>& feature_pixel_values,
+    bool do_bilinear = false)
 {
-    const dlib::point_transform_affine tform_to_img = unnormalizing_tform(rect);
-    const dlib::rectangle area = get_rect(img_);
-    dlib::const_image_view<image_type> img(img_);
-    feature_pixel_values.resize(interpolated_features.size());
-    for (unsigned long i = 0; i < feature_pixel_values.size(); ++i)
+    const std::size_t n = interpolated_features.size();
+    std::vector<float> x(n), y(n);
+    for (std::size_t i = 0; i < n; ++i)
     {
-        auto p = interpolate_feature_point(interpolated_features[i], current_shape);
-        dlib::point q = tform_to_img(p);
-        if (area.contains(q))
-        {
-            feature_pixel_values[i] = dlib::get_pixel_intensity(img[q.y()][q.x()]);
-        }
-        else
-        {
-            feature_pixel_values[i] = 0;
-        }
+        const auto p = interpolate_feature_point(interpolated_features[i], current_shape);
+        x[i] = p.x();
+        y[i] = p.y();
     }
+
+    feature_pixel_values.resize(n);
+    const feature_pixel_sampler sampler(as_gray_mat(img_), rect, do_bilinear);
+    sampler(int(n), x.data(), y.data(), nullptr, nullptr, nullptr, feature_pixel_values.data());
 }
 
 template <typename image_type>
@@ -574,7 +746,8 @@ void extract_feature_pixel_values(
     const PointVecf& reference_pixel_deltas,
     std::vector<float>& feature_pixel_values,
     int ellipse_count = 0,
-    bool do_affine = false)
+    bool do_affine = false,
+    bool do_bilinear = false)
 /*!
     requires
         - image_type == an image object that implements the interface defined in
@@ -593,42 +766,34 @@ void extract_feature_pixel_values(
 !*/
 {
     const dlib::matrix<float, 2, 2> tform = dlib::matrix_cast<float>(find_tform_between_shapes(reference_shape, current_shape, ellipse_count, do_affine).get_m());
-    const dlib::point_transform_affine tform_to_img = unnormalizing_tform(rect);
-
-    const dlib::rectangle area = get_rect(img_);
+    const float tform_[4] = { tform(0, 0), tform(0, 1), tform(1, 0), tform(1, 1) };
+
+    // Compute the point in the current shape corresponding to the i-th pixel, which is
+    // mapped from the normalized shape space into pixel space by the sampler:
+    // point p = tform_to_img(tform*reference_pixel_deltas[i] + location(current_shape, reference_pixel_anchor_idx[i]));
+    const std::size_t n = reference_pixel_deltas.size();
+    std::vector<float> x(n), y(n), dx(n), dy(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        x[i] = current_shape(reference_pixel_anchor_idx[i] * 2 + 0);
+        y[i] = current_shape(reference_pixel_anchor_idx[i] * 2 + 1);
+        dx[i] = reference_pixel_deltas[i].x();
+        dy[i] = reference_pixel_deltas[i].y();
+    }
 
-    dlib::const_image_view<image_type> img(img_);
-    feature_pixel_values.resize(reference_pixel_deltas.size());
+    feature_pixel_values.resize(n);
+    const feature_pixel_sampler sampler(as_gray_mat(img_), rect, do_bilinear);
+    sampler(int(n), x.data(), y.data(), dx.data(), dy.data(), tform_, feature_pixel_values.data());
 
 #if DRISHTI_DLIB_DO_VISUALIZE_FEATURE_POINTS
+    const dlib::point_transform_affine tform_to_img = unnormalizing_tform(rect);
     cv::Mat canvas;
     cv::cvtColor(dlib::toMat(const_cast<image_type&>(img_)), canvas, cv::COLOR_GRAY2BGR);
-//cv::Mat canvas(area.height(), area.width(), CV_8UC3, cv::Scalar::all(0));
-#endif
-
-    for (unsigned long i = 0; i < feature_pixel_values.size(); ++i)
+    for (std::size_t i = 0; i < n; ++i)
     {
-        // Compute the point in the current shape corresponding to the i-th pixel and
-        // then map it from the normalized shape space into pixel space.
-        // point p = tform_to_img(tform*reference_pixel_deltas[i] + location(current_shape, reference_pixel_anchor_idx[i]));
-
-        auto p0 = location(current_shape, reference_pixel_anchor_idx[i]);
-        auto p1 = tform * reference_pixel_deltas[i];
-        dlib::point p = tform_to_img(p0 + p1);
-        if (area.contains(p))
-        {
-            feature_pixel_values[i] = dlib::get_pixel_intensity(img[p.y()][p.x()]);
-#if DRISHTI_DLIB_DO_VISUALIZE_FEATURE_POINTS
-            cv::circle(canvas, cv::Point(p.x(), p.y()), 2, { 0, 255, 255 }, -1, 8);
-#endif
-        }
-        else
-        {
-            feature_pixel_values[i] = 0; // original behaviour (fastest)
-        }
+        dlib::point p = tform_to_img(location(current_shape, reference_pixel_anchor_idx[i]) + tform * reference_pixel_deltas[i]);
+        cv::circle(canvas, cv::Point(p.x(), p.y()), 2, { 0, 255, 255 }, -1, 8);
     }
-
-#if DRISHTI_DLIB_DO_VISUALIZE_FEATURE_POINTS
     for (int i = 0; i < current_shape.size() / 2; i++)
     {
         auto q = tform_to_img(location(current_shape, i));
@@ -685,13 +850,15 @@ public:
         StandardizedPCAPtr& pca,
         bool npd = false,
         bool do_affine = false,
-        int ellipse_count = 0)
+        int ellipse_count = 0,
+        bool do_bilinear = false)
         : initial_shape(initial_shape_)
         , forests(forests_)
         , m_pca(pca)
         , m_ellipse_count(ellipse_count)
         , m_npd(npd)
         , m_do_affine(do_affine)
+        , m_do_bilinear(do_bilinear)
         , interpolated_features(interpolated_features)
     /*!
          requires
@@ -765,13 +932,15 @@ public:
         StandardizedPCAPtr& pca,
         bool npd = false,
         bool do_affine = false,
-        int ellipse_count = 0)
+        int ellipse_count = 0,
+        bool do_bilinear = false)
         : initial_shape(initial_shape_)
         , forests(forests_)
         , m_pca(pca)
         , m_ellipse_count(ellipse_count)
         , m_npd(npd)
         , m_do_affine(do_affine)
+        , m_do_bilinear(do_bilinear)
     /*!
         requires
             - initial_shape.size()%2 == 0
@@ -797,6 +966,27 @@ public:
         m_num_workers = 4; //cv::getNumberOfCPUs();
     }
 
+    // Select the forest evaluation after loading: tree traversal (default) or the branch free
+    // impl::quick_scorer, which gives the same leaves for both the float and Fixed accumulators.
+    // Returns false (tree traversal) if a forest has trees deeper than impl::quick_scorer supports.
+    bool set_do_quick_scorer(bool flag)
+    {
+        m_quick_scorers.clear();
+        if (flag && std::all_of(forests.begin(), forests.end(), impl::quick_scorer::is_supported))
+        {
+            for (const auto& f : forests)
+            {
+                m_quick_scorers.emplace_back(f);
+            }
+        }
+        return get_do_quick_scorer() == flag;
+    }
+
+    bool get_do_quick_scorer() const
+    {
+        return !m_quick_scorers.empty();
+    }
+
     unsigned long num_parts() const
     {
         return initial_shape.size() / 2;
@@ -815,19 +1005,84 @@ public:
         memcpy(&dst(0), back_projection.ptr<float>(), sizeof(float) * back_projection.cols);
     }
 
+    // Incremental back projection: add scale * coefficients[0, end-begin) times the sigma scaled eigenvectors
+    // [begin, end) to dst, which is the cost of the changed coefficients only (see StandardizedPCA::getScaledEigenvectors())
+    static void back_project_delta(const drishti::ml::StandardizedPCA& pca, int begin, int end, const float* coefficients, float scale, fshape& dst)
+    {
+        using RowMajor = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+        const cv::Mat& basis = pca.getScaledEigenvectors();
+        CV_Assert((basis.type() == CV_32FC1) && basis.isContinuous() && (basis.cols == int(dst.size())) && (end <= basis.rows));
+        if (end > begin)
+        {
+            Eigen::Map<const RowMajor> B(basis.ptr<float>(begin), end - begin, basis.cols);
+            Eigen::Map<const Eigen::RowVectorXf> c(coefficients, end - begin);
+            Eigen::Map<Eigen::RowVectorXf> shape(&dst(0), dst.size());
+            shape.noalias() += (c * B) * scale;
+        }
+    }
+
+    // Move dst from back_project(pca, n, src, dst) to back_project(pca, m, src, dst) w/ the changed terms only,
+    // where n < 0 indicates that dst hasn't been back projected yet.  Note: the PCA mean of the standardized
+    // training shapes (~0) is only added by a full back projection.
+    static void back_project(drishti::ml::StandardizedPCA& pca, int n, int m, fshape& src, fshape& dst)
+    {
+        if (n < 0)
+        {
+            back_project(pca, m, src, dst);
+        }
+        else if (m > n)
+        {
+            back_project_delta(pca, n, m, &src(n), 1.f, dst);
+        }
+        else if (m < n)
+        {
+            back_project_delta(pca, m, n, &src(m), -1.f, dst);
+        }
+    }
+
+    // Per call diagnostics for the adaptive early exit (see m_early_exit_threshold):
+    struct prediction_stats
+    {
+        int stages = 0;             // cascade stages evaluated
+        bool converged = false;     // true if the cascade stopped before the last stage
+        std::vector<float> updates; // shape (or PCA coefficient) update norm of each stage
+    };
+
     template <typename image_type>
     dlib::full_object_detection operator()(
         const image_type& img,
         const dlib::rectangle& rect,
         fshape starter_shape,
-        int stages = std::numeric_limits<int>::max()) const // early temrination
+        int stages = std::numeric_limits<int>::max(), // early temrination
+        int first_stage = 0,                          // warm start (i.e., video)
+        prediction_stats* stats = nullptr) const
+    {
+        return predict(img, rect, starter_shape, stages, first_stage, m_early_exit_threshold, stats);
+    }
+
+    template <typename image_type>
+    dlib::full_object_detection predict(
+        const image_type& img,
+        const dlib::rectangle& rect,
+        fshape starter_shape,
+        int stages,
+        int first_stage,
+        float early_exit_threshold,
+        prediction_stats* stats) const
     {
         using namespace impl;
 
         bool do_pca = m_pca ? true : false;
+        bool do_update = stats || (early_exit_threshold > 0.f);
+        if (stats)
+        {
+            *stats = prediction_stats();
+        }
 
         cv::Mat1f cs;
         fshape current_shape = starter_shape, current_shape_full_; // for PCA mode
+        fshape previous_shape;                                    // for the update norm
 
         if (do_pca)
         {
@@ -835,32 +1090,39 @@ public:
         }
 
         std::vector<float> feature_pixel_values;
+        std::vector<uint64_t> leaf_bits; // see quick_scorer
+        int pca_dim = -1; // dimension of the (incrementally) back projected current_shape
         size_t forestCount = std::min(int(forests.size()), stages);
-        for (unsigned long iter = 0; iter < forestCount; ++iter)
+        for (unsigned long iter = first_stage; iter < forestCount; ++iter)
         {
             auto& cs_ = current_shape;
-            auto& is_ = initial_shape; // this is used to map pose indexed features to current shape
 
             // Previously had for loop
             if (do_pca)
             {
                 // Get euclidean model for current shape space estimate:
                 int current_pca_dim = int(forests[iter][0].leaf_values[0].size());
-                back_project(*m_pca, current_pca_dim, current_shape_full_, cs_);
+                back_project(*m_pca, pca_dim, current_pca_dim, current_shape_full_, cs_);
+                pca_dim = current_pca_dim;
             }
 
-            if (interpolated_features.size())
-            {
-                extract_feature_pixel_values(img, rect, cs_, interpolated_features[iter], feature_pixel_values);
-            }
-            else
+            extract_stage_features(img, rect, cs_, iter, feature_pixel_values);
+
+            if (do_update && !do_pca)
             {
-                extract_feature_pixel_values(img, rect, cs_, is_, anchor_idx[iter], deltas[iter], feature_pixel_values, m_ellipse_count, m_do_affine);
+                previous_shape = current_shape;
             }
 
             fshape current_shape_;
             auto& active_shape = do_pca ? current_shape_ : current_shape;
 
+            // Branch free forest evaluation (see set_do_quick_scorer()):
+            const quick_scorer* scorer = m_quick_scorers.empty() ? nullptr : &m_quick_scorers[iter];
+            if (scorer)
+            {
+                (*scorer)(feature_pixel_values.data(), 1, m_npd, leaf_bits);
+            }
+
 #if DRISHTI_BUILD_REGRESSION_FIXED_POINT
             // Fixed point is currently only working for PCA in most cases (check numerical overflow)
             DVec16s shape_accumulator;
@@ -877,7 +1139,8 @@ public:
                     for (unsigned long i = block_begin; i < block_end; ++i)
                     {
                         auto &f = forests[iter][i];
-                        add16sAnd16s(shape_accumulators[block], f(feature_pixel_values, Fixed(), m_npd), shape_accumulators[block]);
+                        const auto& leaf = scorer ? f.leaf_values_16[quick_scorer::exit_leaf(leaf_bits[i])] : f(feature_pixel_values, Fixed(), m_npd);
+                        add16sAnd16s(shape_accumulators[block], leaf, shape_accumulators[block]);
                     }
                 };
 
@@ -890,9 +1153,11 @@ public:
                 }
             }
 #else
-            for (auto& f : forests[iter])
+            for (std::size_t i = 0; i < forests[iter].size(); i++)
             {
-                add16sAnd16s(shape_accumulator, f(feature_pixel_values, Fixed(), m_npd), shape_accumulator);
+                const auto& f = forests[iter][i];
+                const auto& leaf = scorer ? f.leaf_values_16[quick_scorer::exit_leaf(leaf_bits[i])] : f(feature_pixel_values, Fixed(), m_npd);
+                add16sAnd16s(shape_accumulator, leaf, shape_accumulator);
             }
 #endif
             
@@ -904,15 +1169,37 @@ public:
             }
 
 #else  /* else don't DRISHTI_BUILD_REGRESSION_FIXED_POINT */
-            for (auto& f : forests[iter])
+            for (std::size_t i = 0; i < forests[iter].size(); i++)
             {
-                add32F(active_shape, f(feature_pixel_values, m_npd), active_shape);
+                const auto& f = forests[iter][i];
+                const auto& leaf = scorer ? f.leaf_values[quick_scorer::exit_leaf(leaf_bits[i])] : f(feature_pixel_values, m_npd);
+                add32F(active_shape, leaf, active_shape);
             }
 #endif /* DRISHTI_BUILD_REGRESSION_FIXED_POINT */
 
             if (do_pca)
             {
                 dlib::set_rowm(current_shape_full_, dlib::range(0, current_shape_.size() - 1)) += current_shape_;
+                back_project_delta(*m_pca, 0, int(current_shape_.size()), &current_shape_(0), 1.f, current_shape);
+            }
+
+            if (do_update)
+            {
+                // Adaptive early exit when the cascade has converged:
+                const float update = float(dlib::length(do_pca ? current_shape_ : fshape(current_shape - previous_shape)));
+                if (stats)
+                {
+                    stats->stages++;
+                    stats->updates.push_back(update);
+                }
+                if (update < early_exit_threshold)
+                {
+                    if (stats)
+                    {
+                        stats->converged = (iter + 1) < forestCount;
+                    }
+                    break;
+                }
             }
         }
 
@@ -920,21 +1207,76 @@ public:
         {
             // Convert the final model back to euclidean
             int current_pca_dim = int(forests.back()[0].leaf_values[0].size());
-            back_project(*m_pca, current_pca_dim, current_shape_full_, current_shape);
+            back_project(*m_pca, pca_dim, current_pca_dim, current_shape_full_, current_shape);
         }
 
         // convert the current_shape into a full_object_detection
+        std::vector<dlib::point> parts = get_parts(rect, current_shape, m_ellipse_count);
+
+#if DRISHTI_DLIB_DO_DEBUG_ELLIPSE
+        {
+            //  Convert image to opencv, then draw ellipse and shape:
+            cv::Mat image = dlib::toMat(const_cast<image_type&>(img));
+            cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+            int point_length = int((current_shape.size() - (m_ellipse_count * 5)) / 2);
+            for (int j = 0; j < point_length; j++)
+            {
+                cv::circle(image, cv::Point(parts[j].x(), parts[j].y()), 2, { 0, 255, 0 }, 1, 8);
+            }
+
+            for (int i = 0; i < ellipse_count; i++)
+            {
+                cv::RotatedRect e1;
+                e1.center.x = parts[point_length + 0].x();
+                e1.center.y = parts[point_length + 1].x();
+                e1.size.width = parts[point_length + 2].x();
+                e1.size.height = parts[point_length + 3].x();
+                e1.angle = parts[point_length + 4].x();
+
+                cv::ellipse(image, e1, { 0, 255, 0 }, 1, 8);
+            }
+            cv::imshow("image", image), cv::waitKey(0);
+        }
+#endif
+        return dlib::full_object_detection(rect, parts);
+    }
+
+    // Pose indexed features of cascade stage iter for the current shape estimate:
+    template <typename image_type>
+    void extract_stage_features(
+        const image_type& img,
+        const dlib::rectangle& rect,
+        const fshape& current_shape,
+        unsigned long iter,
+        std::vector<float>& feature_pixel_values) const
+    {
+        if (interpolated_features.size())
+        {
+            impl::extract_feature_pixel_values(img, rect, current_shape, interpolated_features[iter], feature_pixel_values, m_do_bilinear);
+        }
+        else
+        {
+            // The initial shape is used to map pose indexed features to the current shape:
+            impl::extract_feature_pixel_values(img, rect, current_shape, initial_shape, anchor_idx[iter], deltas[iter], feature_pixel_values, m_ellipse_count, m_do_affine, m_do_bilinear);
+        }
+    }
+
+    // Map a normalized shape to image coordinates (w/ trailing ellipses in standard form):
+    static std::vector<dlib::point> get_parts(const dlib::rectangle& rect, const fshape& current_shape, int ellipse_count)
+    {
+        using namespace impl;
+
         const dlib::point_transform_affine tform_to_img = unnormalizing_tform(rect);
 
-        int point_length = int((current_shape.size() - (m_ellipse_count * 5)) / 2);
-        std::vector<dlib::point> parts(point_length + (m_ellipse_count * 5));
+        int point_length = int((current_shape.size() - (ellipse_count * 5)) / 2);
+        std::vector<dlib::point> parts(point_length + (ellipse_count * 5));
         for (unsigned long i = 0; i < point_length; ++i)
         {
             parts[i] = tform_to_img(location(current_shape, i));
         }
 
         // Convert trailing ellipse back to standard form:
-        for (int i = 0; i < m_ellipse_count; i++)
+        for (int i = 0; i < ellipse_count; i++)
         {
             std::vector<float> phi(5, 0.f);
             for (int j = 0; j < 5; j++)
@@ -956,40 +1298,322 @@ public:
             parts[end + 4] = dlib::point(e2.angle, 0.f);
         }
 
-#if DRISHTI_DLIB_DO_DEBUG_ELLIPSE
+        return parts;
+    }
+
+    template <typename image_type>
+    dlib::full_object_detection operator()(
+        const image_type& img,
+        const dlib::rectangle& rect) const
+    {
+        fshape current_shape = initial_shape;
+        return (*this)(img, rect, current_shape);
+    }
+
+    // Batched prediction for many faces (i.e., crowds): output i matches (*this)(imgs[i], rects[i], starter_shapes[i]).
+    //
+    // Faces are split into blocks, which are distributed across threads.  Within a block every
+    // cascade stage runs in lockstep: the stage features are stored as a structure of arrays
+    // ([features x faces]), and each tree is traversed for all faces in the block while its
+    // splits and leaves are still in cache.
+    template <typename image_type>
+    std::vector<dlib::full_object_detection> operator()(
+        const std::vector<image_type>& imgs,
+        const std::vector<dlib::rectangle>& rects,
+        const std::vector<fshape>& starter_shapes,
+        int stages = std::numeric_limits<int>::max(),
+        int first_stage = 0,
+        std::vector<prediction_stats>* stats = nullptr) const
+    {
+        assert(imgs.size() == rects.size());
+        assert(imgs.size() == starter_shapes.size());
+
+        const int n = int(imgs.size());
+        if (stats)
         {
-            //  Convert image to opencv, then draw ellipse and shape:
-            cv::Mat image = dlib::toMat(const_cast<image_type&>(img));
-            cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
-            for (int j = 0; j < point_length; j++)
+            stats->assign(n, prediction_stats());
+        }
+
+        const int block_size = 16; // faces per block (upper bound)
+        const int blocks = std::max((n + block_size - 1) / block_size, std::min(n, cv::getNumThreads()));
+
+        std::vector<dlib::full_object_detection> detections(n);
+        drishti::core::ParallelLambdaRange harness = [&](const cv::Range& r) {
+            predict_lockstep(imgs, rects, starter_shapes, stages, first_stage, r, detections, stats);
+        };
+        cv::parallel_for_({ 0, n }, harness, blocks);
+
+        return detections;
+    }
+
+    template <typename image_type>
+    void predict_lockstep(
+        const std::vector<image_type>& imgs,
+        const std::vector<dlib::rectangle>& rects,
+        const std::vector<fshape>& starter_shapes,
+        int stages,
+        int first_stage,
+        const cv::Range& r,
+        std::vector<dlib::full_object_detection>& detections,
+        std::vector<prediction_stats>* stats = nullptr) const
+    {
+        using namespace impl;
+
+        bool do_pca = m_pca ? true : false;
+        bool do_update = stats || (m_early_exit_threshold > 0.f);
+
+        const int m = r.size();
+        std::vector<fshape> current_shapes(starter_shapes.begin() + r.start, starter_shapes.begin() + r.end);
+        std::vector<fshape> current_shapes_full(m), current_shapes_(m); // for PCA mode
+        if (do_pca)
+        {
+            for (int j = 0; j < m; j++)
             {
-                cv::circle(image, cv::Point(parts[j].x(), parts[j].y()), 2, { 0, 255, 0 }, 1, 8);
+                project(*m_pca, current_shapes[j], current_shapes_full[j]);
             }
+        }
 
-            for (int i = 0; i < ellipse_count; i++)
+        std::vector<float> feature_pixel_values, features; // [features x faces]
+#if DRISHTI_BUILD_REGRESSION_FIXED_POINT
+        std::vector<DVec16s> shape_accumulators(m);
+#endif
+        std::vector<fshape> previous_shapes(m); // for the update norm
+        std::vector<bool> running(m, true);     // faces w/ early exit are skipped
+        std::vector<int> pca_dims(m, -1);       // see predict()
+        std::vector<std::vector<uint64_t>> leaf_bits(m); // see quick_scorer
+        size_t forestCount = std::min(int(forests.size()), stages);
+        for (unsigned long iter = first_stage; iter < forestCount; ++iter)
+        {
+            for (int j = 0; j < m; j++)
             {
-                cv::RotatedRect e1;
-                e1.center.x = parts[point_length + 0].x();
-                e1.center.y = parts[point_length + 1].x();
-                e1.size.width = parts[point_length + 2].x();
-                e1.size.height = parts[point_length + 3].x();
-                e1.angle = parts[point_length + 4].x();
+                if (!running[j])
+                {
+                    continue;
+                }
 
-                cv::ellipse(image, e1, { 0, 255, 0 }, 1, 8);
+                if (do_pca)
+                {
+                    // Get euclidean model for current shape space estimate:
+                    int current_pca_dim = int(forests[iter][0].leaf_values[0].size());
+                    back_project(*m_pca, pca_dims[j], current_pca_dim, current_shapes_full[j], current_shapes[j]);
+                    pca_dims[j] = current_pca_dim;
+                }
+
+                extract_stage_features(imgs[r.start + j], rects[r.start + j], current_shapes[j], iter, feature_pixel_values);
+
+                if (do_update && !do_pca)
+                {
+                    previous_shapes[j] = current_shapes[j];
+                }
+
+                features.resize(feature_pixel_values.size() * m);
+                for (std::size_t k = 0; k < feature_pixel_values.size(); k++)
+                {
+                    features[k * m + j] = feature_pixel_values[k];
+                }
+            }
+
+            std::vector<fshape*> active_shapes(m);
+            for (int j = 0; j < m; j++)
+            {
+                current_shapes_[j] = fshape();
+                active_shapes[j] = do_pca ? &current_shapes_[j] : &current_shapes[j];
+            }
+
+            // Branch free forest evaluation (see set_do_quick_scorer()):
+            const quick_scorer* scorer = m_quick_scorers.empty() ? nullptr : &m_quick_scorers[iter];
+            for (int j = 0; scorer && (j < m); j++)
+            {
+                if (running[j])
+                {
+                    (*scorer)(&features[j], m, m_npd, leaf_bits[j]);
+                }
+            }
+
+            auto leaf = [&](std::size_t t, int j) {
+                return scorer ? quick_scorer::exit_leaf(leaf_bits[j][t]) : forests[iter][t].leaf(&features[j], m, m_npd);
+            };
+
+#if DRISHTI_BUILD_REGRESSION_FIXED_POINT
+            // Fixed point is currently only working for PCA in most cases (check numerical overflow)
+            for (auto& a : shape_accumulators)
+            {
+                a = DVec16s();
+            }
+            for (std::size_t t = 0; t < forests[iter].size(); t++)
+            {
+                const auto& f = forests[iter][t];
+                for (int j = 0; j < m; j++)
+                {
+                    if (running[j])
+                    {
+                        add16sAnd16s(shape_accumulators[j], f.leaf_values_16[leaf(t, j)], shape_accumulators[j]);
+                    }
+                }
+            }
+
+            // fixed -> float
+            for (int j = 0; j < m; j++)
+            {
+                if (!running[j])
+                {
+                    continue;
+                }
+
+                auto& active_shape = *active_shapes[j];
+                active_shape.set_size(shape_accumulators[j].size());
+                for (int i = 0; i < shape_accumulators[j].size(); i++)
+                {
+                    active_shape(i) = float(shape_accumulators[j](i)) / float(1 << FIXED_PRECISION);
+                }
+            }
+#else  /* else don't DRISHTI_BUILD_REGRESSION_FIXED_POINT */
+            for (std::size_t t = 0; t < forests[iter].size(); t++)
+            {
+                const auto& f = forests[iter][t];
+                for (int j = 0; j < m; j++)
+                {
+                    if (running[j])
+                    {
+                        add32F(*active_shapes[j], f.leaf_values[leaf(t, j)], *active_shapes[j]);
+                    }
+                }
+            }
+#endif /* DRISHTI_BUILD_REGRESSION_FIXED_POINT */
+
+            if (do_pca)
+            {
+                for (int j = 0; j < m; j++)
+                {
+                    if (running[j])
+                    {
+                        dlib::set_rowm(current_shapes_full[j], dlib::range(0, current_shapes_[j].size() - 1)) += current_shapes_[j];
+                        back_project_delta(*m_pca, 0, int(current_shapes_[j].size()), &current_shapes_[j](0), 1.f, current_shapes[j]);
+                    }
+                }
+            }
+
+            if (do_update)
+            {
+                // Adaptive early exit per face, the block stops when all faces have converged:
+                bool any = false;
+                for (int j = 0; j < m; j++)
+                {
+                    if (!running[j])
+                    {
+                        continue;
+                    }
+
+                    const float update = float(dlib::length(do_pca ? current_shapes_[j] : fshape(current_shapes[j] - previous_shapes[j])));
+                    if (stats)
+                    {
+                        (*stats)[r.start + j].stages++;
+                        (*stats)[r.start + j].updates.push_back(update);
+                    }
+                    if (update < m_early_exit_threshold)
+                    {
+                        running[j] = false;
+                        if (stats)
+                        {
+                            (*stats)[r.start + j].converged = (iter + 1) < forestCount;
+                        }
+                    }
+                    any = any || running[j];
+                }
+                if (!any)
+                {
+                    break;
+                }
             }
-            cv::imshow("image", image), cv::waitKey(0);
         }
-#endif
-        return dlib::full_object_detection(rect, parts);
+
+        for (int j = 0; j < m; j++)
+        {
+            if (do_pca)
+            {
+                // Convert the final model back to euclidean
+                int current_pca_dim = int(forests.back()[0].leaf_values[0].size());
+                back_project(*m_pca, pca_dims[j], current_pca_dim, current_shapes_full[j], current_shapes[j]);
+            }
+
+            detections[r.start + j] = dlib::full_object_detection(rects[r.start + j], get_parts(rects[r.start + j], current_shapes[j], m_ellipse_count));
+        }
     }
 
-    template <typename image_type>
-    dlib::full_object_detection operator()(
-        const image_type& img,
-        const dlib::rectangle& rect) const
+    // Learn m_early_exit_threshold on validation data (see dlib::test_shape_predictor() for the
+    // input format): this is the largest update norm threshold for which the mean landmark error
+    // (relative to the face width) w/ early exit is within (1 + tolerance) of the full cascade error.
+    template <typename image_array>
+    float learn_early_exit_threshold(
+        const image_array& images,
+        const std::vector<std::vector<dlib::full_object_detection>>& objects,
+        float tolerance = 0.01f) const
     {
-        fshape current_shape = initial_shape;
-        return (*this)(img, rect, current_shape);
+        std::vector<std::pair<unsigned long, unsigned long>> samples;
+        for (unsigned long i = 0; i < objects.size(); ++i)
+        {
+            for (unsigned long j = 0; j < objects[i].size(); ++j)
+            {
+                samples.emplace_back(i, j);
+            }
+        }
+
+        std::vector<float> errors(samples.size());
+        std::vector<std::vector<float>> updates(samples.size());
+        auto evaluate = [&](float threshold) {
+            drishti::core::ParallelHomogeneousLambda harness = [&](int k) {
+                const auto& target = objects[samples[k].first][samples[k].second];
+                const dlib::rectangle& rect = target.get_rect();
+
+                prediction_stats stats;
+                const auto shape = predict(images[samples[k].first], rect, initial_shape, std::numeric_limits<int>::max(), 0, threshold, &stats);
+                const unsigned long parts = target.num_parts() - (m_ellipse_count * 5);
+                float error = 0.f;
+                for (unsigned long i = 0; i < parts; ++i)
+                {
+                    error += float(dlib::length(shape.part(i) - target.part(i)));
+                }
+                errors[k] = error / float(std::max(1UL, parts) * std::max(1L, long(rect.width())));
+                updates[k] = stats.updates;
+            };
+            cv::parallel_for_({ 0, int(samples.size()) }, harness);
+            return std::accumulate(errors.begin(), errors.end(), 0.f) / float(std::max(std::size_t(1), samples.size()));
+        };
+
+        // The full cascade provides the reference error and the candidate thresholds (update quantiles):
+        const float full_error = evaluate(0.f);
+        std::vector<float> norms;
+        for (const auto& u : updates)
+        {
+            norms.insert(norms.end(), u.begin(), u.end());
+        }
+        std::sort(norms.begin(), norms.end());
+
+        const int quantiles = std::min(int(norms.size()), 32);
+        std::vector<float> candidates(quantiles);
+        for (int i = 0; i < quantiles; i++)
+        {
+            candidates[i] = norms[(norms.size() - 1) * (i + 1) / quantiles];
+        }
+
+        // Binary search for the largest acceptable threshold, the error grows w/ the threshold:
+        float best = 0.f;
+        int lo = 0, hi = quantiles - 1;
+        while (lo <= hi)
+        {
+            const int mid = (lo + hi) / 2;
+            if (evaluate(candidates[mid]) <= (full_error * (1.f + tolerance)))
+            {
+                best = candidates[mid];
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid - 1;
+            }
+        }
+
+        return best;
     }
 
     friend void serialize(const shape_predictor& item, std::ostream& out)
@@ -1036,8 +1660,15 @@ public:
     int m_ellipse_count = 0;
     bool m_npd = false;
     bool m_do_affine = false;
+    bool m_do_bilinear = false; // bilinear feature pixel sampling (must match training)
     unsigned long m_num_workers = 1;
 
+    // Adaptive early exit: the cascade stops after the first stage w/ an update norm below this (0 to disable)
+    float m_early_exit_threshold = 0.f;
+
+    // Optional branch free forest evaluation, one per stage (empty for tree traversal):
+    std::vector<impl::quick_scorer> m_quick_scorers;
+
     // Use interpolated "line indexed" features (stead of the relative encoding above):
     std::vector<std::vector<InterpolatedFeature>> interpolated_features;
 
@@ -121,7 +121,7 @@ void serialize(Archive& ar, drishti::ml::impl::regression_tree& g, const unsigne
 template <class Archive>
 void serialize(Archive& ar, drishti::ml::shape_predictor& sp, const unsigned int version)
 {
-    drishti_throw_assert(version == 4, "Incorrect shape_predictor archive format, please update models");
+    drishti_throw_assert(version >= 4 && version <= 6, "Incorrect shape_predictor archive format, please update models");
     
     drishti::ml::fshape& initial_shape = sp.initial_shape;
     std::vector<std::vector<RTType>>& forests = sp.forests;
@@ -154,11 +154,21 @@ void serialize(Archive& ar, drishti::ml::shape_predictor& sp, const unsigned int
     ar& sp.m_do_affine;
     ar& sp.m_ellipse_count;
     ar& sp.interpolated_features;
+
+    if (version >= 5)
+    {
+        ar& sp.m_early_exit_threshold;
+    }
+
+    if (version >= 6)
+    {
+        ar& sp.m_do_bilinear;
+    }
 }
 
 DRISHTI_END_NAMESPACE(cereal)
 
 #include <cereal/cereal.hpp>
-CEREAL_CLASS_VERSION(drishti::ml::shape_predictor, 4);
+CEREAL_CLASS_VERSION(drishti::ml::shape_predictor, 6);
 
 #endif /* shape_predictor_archive_h */
@@ -0,0 +1,518 @@
+/*! -*-c++-*-
+  @file   shape_predictor_flat.cpp
+  @author David Hirvonen
+  @brief  Internal implementation of a flat (memory mappable) shape_predictor model.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/ml/shape_predictor_flat.h"
+#include "drishti/core/ThrowAssert.h"
+#include "drishti/core/Parallel.h"
+#include "drishti/core/make_unique.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// clang-format off
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+// clang-format on
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+static const char kMagic[8] = { 'D', 'R', 'S', 'P', 'F', 'L', 'A', 'T' };
+
+static uint64_t align(uint64_t offset)
+{
+    const uint64_t a = shape_predictor_flat::kAlignment;
+    return (offset + a - 1) / a * a;
+}
+
+// Model storage: either a read only file mapping or an owned (aligned) buffer
+struct shape_predictor_flat::Storage
+{
+    ~Storage()
+    {
+#if !defined(_WIN32)
+        if (mapping)
+        {
+            munmap(mapping, size);
+        }
+#endif
+    }
+
+    void allocate(std::size_t n)
+    {
+        buffer.reset(new uint8_t[n + kAlignment]);
+        data = buffer.get() + (kAlignment - (reinterpret_cast<std::uintptr_t>(buffer.get()) % kAlignment)) % kAlignment;
+        size = n;
+    }
+
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    void* mapping = nullptr;
+    std::unique_ptr<uint8_t[]> buffer;
+};
+
+shape_predictor_flat::~shape_predictor_flat() = default;
+
+shape_predictor_flat::shape_predictor_flat(std::unique_ptr<Storage>& storage)
+    : m_storage(std::move(storage))
+{
+    m_data = m_storage->data;
+
+    // Validate the header, the section bounds and the indices that are used w/o range checks
+    // during prediction (split features, anchor points and the complete tree layout):
+    const uint64_t size = m_storage->size;
+    drishti_throw_assert(size >= sizeof(Header), "Invalid shape_predictor_flat model: truncated header");
+    m_header = get<Header>(0);
+    const Header& h = *m_header;
+    drishti_throw_assert(std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0, "Invalid shape_predictor_flat model: bad magic");
+    drishti_throw_assert(h.version == kVersion, "Incorrect shape_predictor_flat format, please update models");
+    drishti_throw_assert(h.endian == kEndian, "Invalid shape_predictor_flat model: byte order mismatch");
+    drishti_throw_assert(h.size == size, "Invalid shape_predictor_flat model: size mismatch");
+    drishti_throw_assert(h.shape_dim > 0 && (h.shape_dim >= h.ellipse_count * 5), "Invalid shape_predictor_flat model: shape dimension");
+
+    auto check = [&](uint64_t offset, uint64_t bytes) {
+        drishti_throw_assert((offset % 4) == 0 && offset <= size && bytes <= (size - offset), "Invalid shape_predictor_flat model: section out of bounds");
+    };
+
+    check(h.initial_shape, sizeof(float) * h.shape_dim);
+    check(h.stage_table, sizeof(Stage) * uint64_t(h.stages));
+    m_stages = get<Stage>(h.stage_table);
+
+    const bool interpolated = (h.flags & kInterpolated);
+    const uint64_t coefficients = h.pca_dim ? h.pca_dim : h.shape_dim;
+    for (uint32_t i = 0; i < h.stages; i++)
+    {
+        const Stage& s = m_stages[i];
+        drishti_throw_assert(s.trees > 0 && s.leaf_dim > 0 && s.leaf_dim <= coefficients, "Invalid shape_predictor_flat model: stage dimensions");
+        drishti_throw_assert(s.features > 0 && s.features <= 0xffff && s.shift >= -16 && s.shift <= 30, "Invalid shape_predictor_flat model: stage parameters");
+        drishti_throw_assert(s.splits < 0xffff && ((s.splits + 1) & s.splits) == 0, "Invalid shape_predictor_flat model: trees must be complete w/ depth < 16");
+        check(s.split_offset, sizeof(Split) * uint64_t(s.trees) * s.splits);
+        check(s.leaf_offset, sizeof(int16_t) * uint64_t(s.trees) * (s.splits + 1) * s.leaf_dim);
+
+        const Split* splits = get<Split>(s.split_offset);
+        for (uint64_t j = 0; j < uint64_t(s.trees) * s.splits; j++)
+        {
+            drishti_throw_assert(splits[j].idx1 < s.features && splits[j].idx2 < s.features, "Invalid shape_predictor_flat model: split feature out of range");
+        }
+
+        auto point = [&](uint64_t index) { return (2 * index + 1) < h.shape_dim; };
+        if (interpolated)
+        {
+            check(s.feature_offset, sizeof(InterpolatedFeature) * uint64_t(s.features));
+            const auto* features = get<InterpolatedFeature>(s.feature_offset);
+            for (uint32_t j = 0; j < s.features; j++)
+            {
+                drishti_throw_assert(point(features[j].f1) && point(features[j].f2), "Invalid shape_predictor_flat model: feature point out of range");
+            }
+        }
+        else
+        {
+            check(s.feature_offset, sizeof(uint16_t) * uint64_t(s.features));
+            check(s.delta_offset, sizeof(float) * 2 * uint64_t(s.features));
+            const auto* anchors = get<uint16_t>(s.feature_offset);
+            for (uint32_t j = 0; j < s.features; j++)
+            {
+                drishti_throw_assert(point(anchors[j]), "Invalid shape_predictor_flat model: anchor point out of range");
+            }
+        }
+    }
+
+    const float* initial_shape = get<float>(h.initial_shape);
+    m_initial_shape.set_size(h.shape_dim);
+    std::copy(initial_shape, initial_shape + h.shape_dim, &m_initial_shape(0));
+
+    if (h.pca_dim)
+    {
+        check(h.pca_mu, sizeof(float) * h.shape_dim);
+        check(h.pca_sigma, sizeof(float) * h.shape_dim);
+        check(h.pca_mean, sizeof(float) * h.shape_dim);
+        check(h.pca_eigenvalues, sizeof(float) * h.pca_dim);
+        check(h.pca_eigenvectors, sizeof(float) * uint64_t(h.pca_dim) * h.shape_dim);
+
+        // cv::Mat headers on the (read only) model storage:
+        auto mat = [&](uint64_t offset, int rows, int cols) {
+            return cv::Mat(rows, cols, CV_32FC1, const_cast<float*>(get<float>(offset)));
+        };
+
+        StandardizedPCA::Standardizer transform;
+        transform.mu = mat(h.pca_mu, 1, h.shape_dim);
+        transform.sigma = mat(h.pca_sigma, 1, h.shape_dim);
+
+        m_pca = drishti::core::make_unique<StandardizedPCA>();
+        m_pca->init(transform, mat(h.pca_mean, 1, h.shape_dim), mat(h.pca_eigenvectors, h.pca_dim, h.shape_dim), mat(h.pca_eigenvalues, h.pca_dim, 1));
+    }
+}
+
+std::unique_ptr<shape_predictor_flat> shape_predictor_flat::load(std::istream& is)
+{
+    std::vector<char> bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    auto storage = drishti::core::make_unique<Storage>();
+    storage->allocate(bytes.size());
+    std::copy(bytes.begin(), bytes.end(), const_cast<uint8_t*>(storage->data));
+    return std::unique_ptr<shape_predictor_flat>(new shape_predictor_flat(storage));
+}
+
+std::unique_ptr<shape_predictor_flat> shape_predictor_flat::load(const std::string& filename)
+{
+#if defined(_WIN32)
+    std::ifstream is(filename, std::ios::binary);
+    drishti_throw_assert(is, "Unable to open shape_predictor_flat model " << filename);
+    return load(is);
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    drishti_throw_assert(fd >= 0, "Unable to open shape_predictor_flat model " << filename);
+
+    struct stat sb;
+    void* mapping = MAP_FAILED;
+    if ((fstat(fd, &sb) == 0) && (sb.st_size > 0))
+    {
+        mapping = mmap(nullptr, std::size_t(sb.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd); // the mapping remains valid
+    drishti_throw_assert(mapping != MAP_FAILED, "Unable to map shape_predictor_flat model " << filename);
+
+    auto storage = drishti::core::make_unique<Storage>();
+    storage->mapping = mapping;
+    storage->data = static_cast<const uint8_t*>(mapping);
+    storage->size = std::size_t(sb.st_size);
+    return std::unique_ptr<shape_predictor_flat>(new shape_predictor_flat(storage));
+#endif
+}
+
+void shape_predictor_flat::save(const shape_predictor& sp, const std::string& filename)
+{
+    std::ofstream os(filename, std::ios::binary);
+    drishti_throw_assert(os, "Unable to open " << filename << " for writing");
+    save(sp, os);
+}
+
+void shape_predictor_flat::save(const shape_predictor& sp, std::ostream& os)
+{
+    const bool interpolated = !sp.interpolated_features.empty();
+    const std::size_t stages = sp.forests.size();
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.endian = kEndian;
+    h.stages = uint32_t(stages);
+    h.shape_dim = uint32_t(sp.initial_shape.size());
+    h.pca_dim = sp.m_pca ? uint32_t(sp.m_pca->getPCA()->eigenvectors.rows) : 0;
+    h.ellipse_count = uint32_t(sp.m_ellipse_count);
+    h.flags = (sp.m_npd ? kNPD : 0) | (sp.m_do_affine ? kAffine : 0) | (interpolated ? kInterpolated : 0) | (sp.m_do_bilinear ? kBilinear : 0);
+    h.early_exit_threshold = sp.m_early_exit_threshold;
+
+    // Layout pass: assign 64 byte aligned offsets to each section
+    uint64_t offset = align(sizeof(Header));
+    auto reserve = [&](uint64_t bytes) {
+        const uint64_t result = offset;
+        offset = align(offset + bytes);
+        return result;
+    };
+
+    h.initial_shape = reserve(sizeof(float) * h.shape_dim);
+    h.stage_table = reserve(sizeof(Stage) * stages);
+
+    std::vector<Stage> table(stages);
+    for (std::size_t i = 0; i < stages; i++)
+    {
+        const auto& forest = sp.forests[i];
+        drishti_throw_assert(!forest.empty() && !forest.front().leaf_values.empty(), "shape_predictor_flat: empty cascade stage");
+
+        Stage& s = table[i];
+        s.trees = uint32_t(forest.size());
+        s.splits = uint32_t(forest.front().splits.size());
+        s.leaf_dim = uint32_t(forest.front().leaf_values.front().size());
+        s.features = uint32_t(interpolated ? sp.interpolated_features[i].size() : sp.anchor_idx[i].size());
+
+        // Choose the largest leaf scale that fits in int16_t:
+        float max_leaf = 0.f;
+        for (const auto& tree : forest)
+        {
+            drishti_throw_assert(tree.splits.size() == s.splits && tree.leaf_values.size() == (s.splits + 1), "shape_predictor_flat: trees in a stage must have a uniform depth");
+            for (const auto& leaf : tree.leaf_values)
+            {
+                drishti_throw_assert(leaf.size() == s.leaf_dim, "shape_predictor_flat: leaf dimensions must be uniform in a stage");
+                max_leaf = std::max(max_leaf, float(dlib::max(dlib::abs(leaf))));
+            }
+        }
+        s.shift = 14;
+        while ((s.shift > -16) && (std::ldexp(max_leaf, s.shift) > 32767.f))
+        {
+            s.shift--;
+        }
+
+        s.split_offset = reserve(sizeof(Split) * s.trees * s.splits);
+        s.leaf_offset = reserve(sizeof(int16_t) * s.trees * (s.splits + 1) * s.leaf_dim);
+        s.feature_offset = reserve((interpolated ? sizeof(InterpolatedFeature) : sizeof(uint16_t)) * s.features);
+        s.delta_offset = interpolated ? 0 : reserve(sizeof(float) * 2 * s.features);
+    }
+
+    cv::Mat mu, sigma, mean, eigenvalues, eigenvectors;
+    if (sp.m_pca)
+    {
+        const auto& pca = *sp.m_pca->getPCA();
+        const auto& transform = sp.m_pca->getStandardizer();
+        transform.mu.convertTo(mu, CV_32F);
+        transform.sigma.convertTo(sigma, CV_32F);
+        pca.mean.convertTo(mean, CV_32F);
+        pca.eigenvalues.convertTo(eigenvalues, CV_32F);
+        pca.eigenvectors.convertTo(eigenvectors, CV_32F);
+        drishti_throw_assert(mu.total() == h.shape_dim && sigma.total() == h.shape_dim && mean.total() == h.shape_dim, "shape_predictor_flat: unexpected PCA dimensions");
+        drishti_throw_assert(eigenvalues.total() == h.pca_dim && eigenvectors.cols == int(h.shape_dim), "shape_predictor_flat: unexpected PCA dimensions");
+
+        h.pca_mu = reserve(sizeof(float) * h.shape_dim);
+        h.pca_sigma = reserve(sizeof(float) * h.shape_dim);
+        h.pca_mean = reserve(sizeof(float) * h.shape_dim);
+        h.pca_eigenvalues = reserve(sizeof(float) * h.pca_dim);
+        h.pca_eigenvectors = reserve(sizeof(float) * h.pca_dim * h.shape_dim);
+    }
+    h.size = offset;
+
+    // Fill pass:
+    std::vector<uint8_t> blob(h.size, 0);
+    auto at = [&](uint64_t offset) { return blob.data() + offset; };
+    auto put = [&](uint64_t offset, const void* src, std::size_t bytes) {
+        if (bytes)
+        {
+            std::memcpy(at(offset), src, bytes);
+        }
+    };
+
+    put(0, &h, sizeof(h));
+    put(h.initial_shape, &sp.initial_shape(0), sizeof(float) * h.shape_dim);
+    put(h.stage_table, table.data(), sizeof(Stage) * stages);
+
+    for (std::size_t i = 0; i < stages; i++)
+    {
+        const Stage& s = table[i];
+        auto* splits = reinterpret_cast<Split*>(at(s.split_offset));
+        auto* leaves = reinterpret_cast<int16_t*>(at(s.leaf_offset));
+        for (const auto& tree : sp.forests[i])
+        {
+            for (const auto& split : tree.splits)
+            {
+                *splits++ = { split.idx1, split.idx2, split.thresh };
+            }
+            for (const auto& leaf : tree.leaf_values)
+            {
+                for (long k = 0; k < leaf.size(); k++)
+                {
+                    const float value = std::round(std::ldexp(leaf(k), s.shift));
+                    *leaves++ = int16_t(std::max(-32768.f, std::min(32767.f, value)));
+                }
+            }
+        }
+
+        if (interpolated)
+        {
+            put(s.feature_offset, sp.interpolated_features[i].data(), sizeof(InterpolatedFeature) * s.features);
+        }
+        else
+        {
+            put(s.feature_offset, sp.anchor_idx[i].data(), sizeof(uint16_t) * s.features);
+            auto* deltas = reinterpret_cast<float*>(at(s.delta_offset));
+            for (const auto& d : sp.deltas[i])
+            {
+                *deltas++ = d.x();
+                *deltas++ = d.y();
+            }
+        }
+    }
+
+    if (sp.m_pca)
+    {
+        put(h.pca_mu, mu.ptr<float>(), sizeof(float) * h.shape_dim);
+        put(h.pca_sigma, sigma.ptr<float>(), sizeof(float) * h.shape_dim);
+        put(h.pca_mean, mean.ptr<float>(), sizeof(float) * h.shape_dim);
+        put(h.pca_eigenvalues, eigenvalues.ptr<float>(), sizeof(float) * h.pca_dim);
+        put(h.pca_eigenvectors, eigenvectors.ptr<float>(), sizeof(float) * h.pca_dim * h.shape_dim);
+    }
+
+    os.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+}
+
+// Same pixel sampling as impl::extract_feature_pixel_values(), from the flat tables
+void shape_predictor_flat::extract_stage_features(const cv::Mat& img, const dlib::rectangle& rect, const fshape& current_shape, const Stage& stage, std::vector<float>& values) const
+{
+    const impl::feature_pixel_sampler sampler(img, rect, m_header->flags & kBilinear);
+
+    const int n = int(stage.features);
+    std::vector<float> x(n), y(n);
+    values.resize(n);
+    if (m_header->flags & kInterpolated)
+    {
+        const auto* features = get<InterpolatedFeature>(stage.feature_offset);
+        for (int i = 0; i < n; i++)
+        {
+            const fpoint p = impl::interpolate_feature_point(features[i], current_shape);
+            x[i] = p.x();
+            y[i] = p.y();
+        }
+        sampler(n, x.data(), y.data(), nullptr, nullptr, nullptr, values.data());
+    }
+    else
+    {
+        const auto* anchors = get<uint16_t>(stage.feature_offset);
+        const auto* deltas = get<float>(stage.delta_offset);
+        const dlib::matrix<float, 2, 2> tform = dlib::matrix_cast<float>(impl::find_tform_between_shapes(m_initial_shape, current_shape, getEllipseCount(), m_header->flags & kAffine).get_m());
+        const float tform_[4] = { tform(0, 0), tform(0, 1), tform(1, 0), tform(1, 1) };
+
+        std::vector<float> dx(n), dy(n);
+        for (int i = 0; i < n; i++)
+        {
+            x[i] = current_shape(anchors[i] * 2 + 0);
+            y[i] = current_shape(anchors[i] * 2 + 1);
+            dx[i] = deltas[i * 2 + 0];
+            dy[i] = deltas[i * 2 + 1];
+        }
+        sampler(n, x.data(), y.data(), dx.data(), dy.data(), tform_, values.data());
+    }
+}
+
+dlib::full_object_detection shape_predictor_flat::operator()(
+    const cv::Mat& img,
+    const dlib::rectangle& rect,
+    const fshape& starter_shape,
+    int stages,
+    int first_stage,
+    shape_predictor::prediction_stats* stats) const
+{
+    CV_Assert(img.type() == CV_8UC1);
+
+    const bool do_pca = bool(m_pca);
+    const bool do_npd = (m_header->flags & kNPD);
+    const float early_exit_threshold = m_header->early_exit_threshold;
+    if (stats)
+    {
+        *stats = shape_predictor::prediction_stats();
+    }
+
+    fshape current_shape = starter_shape, current_shape_full; // for PCA mode
+    if (do_pca)
+    {
+        shape_predictor::project(*m_pca, current_shape, current_shape_full);
+    }
+
+    std::vector<float> values, deltas;
+    std::vector<int32_t> accumulator;
+    int pca_dim = -1; // dimension of the (incrementally) back projected current_shape
+    const uint32_t stageCount = uint32_t(std::max(0, std::min(int(m_header->stages), stages)));
+    for (uint32_t iter = uint32_t(std::max(0, first_stage)); iter < stageCount; iter++)
+    {
+        const Stage& s = m_stages[iter];
+        if (do_pca)
+        {
+            // Get euclidean model for current shape space estimate:
+            shape_predictor::back_project(*m_pca, pca_dim, int(s.leaf_dim), current_shape_full, current_shape);
+            pca_dim = int(s.leaf_dim);
+        }
+
+        extract_stage_features(img, rect, current_shape, s, values);
+
+        accumulator.assign(s.leaf_dim, 0);
+        const Split* splits = get<Split>(s.split_offset);
+        const int16_t* leaves = get<int16_t>(s.leaf_offset);
+        for (uint32_t t = 0; t < s.trees; t++, splits += s.splits, leaves += (s.splits + 1) * s.leaf_dim)
+        {
+            uint32_t i = 0;
+            while (i < s.splits)
+            {
+                const Split& node = splits[i];
+                const float a = values[node.idx1], b = values[node.idx2];
+                i = ((do_npd ? compute_npd(a, b) : (a - b)) > node.thresh) ? impl::left_child(i) : impl::right_child(i);
+            }
+
+            const int16_t* leaf = leaves + (i - s.splits) * s.leaf_dim;
+#if DRISHTI_BUILD_REGRESSION_SIMD
+            drishti::core::add16sAnd32s(accumulator.data(), leaf, accumulator.data(), int(s.leaf_dim));
+#else
+            for (uint32_t k = 0; k < s.leaf_dim; k++)
+            {
+                accumulator[k] += leaf[k];
+            }
+#endif
+        }
+
+        // Add the stage update to the shape (or leading PCA coefficients):
+        auto& target = do_pca ? current_shape_full : current_shape;
+        const float scale = std::ldexp(1.f, -s.shift);
+        float update = 0.f;
+        deltas.resize(s.leaf_dim);
+        for (uint32_t k = 0; k < s.leaf_dim; k++)
+        {
+            deltas[k] = float(accumulator[k]) * scale;
+            target(k) += deltas[k];
+            update += deltas[k] * deltas[k];
+        }
+        if (do_pca)
+        {
+            shape_predictor::back_project_delta(*m_pca, 0, int(s.leaf_dim), deltas.data(), 1.f, current_shape);
+        }
+
+        // Adaptive early exit when the cascade has converged:
+        update = std::sqrt(update);
+        if (stats)
+        {
+            stats->stages++;
+            stats->updates.push_back(update);
+        }
+        if (update < early_exit_threshold)
+        {
+            if (stats)
+            {
+                stats->converged = (iter + 1) < stageCount;
+            }
+            break;
+        }
+    }
+
+    if (do_pca && m_header->stages)
+    {
+        // Convert the final model back to euclidean
+        shape_predictor::back_project(*m_pca, pca_dim, int(m_stages[m_header->stages - 1].leaf_dim), current_shape_full, current_shape);
+    }
+
+    return dlib::full_object_detection(rect, shape_predictor::get_parts(rect, current_shape, getEllipseCount()));
+}
+
+std::vector<dlib::full_object_detection> shape_predictor_flat::operator()(
+    const std::vector<cv::Mat>& imgs,
+    const std::vector<dlib::rectangle>& rects,
+    const std::vector<fshape>& starter_shapes,
+    int stages,
+    int first_stage,
+    std::vector<shape_predictor::prediction_stats>* stats) const
+{
+    assert(imgs.size() == rects.size());
+    assert(imgs.size() == starter_shapes.size());
+
+    if (stats)
+    {
+        stats->resize(imgs.size());
+    }
+
+    std::vector<dlib::full_object_detection> detections(imgs.size());
+    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+        detections[i] = (*this)(imgs[i], rects[i], starter_shapes[i], stages, first_stage, stats ? &(*stats)[i] : nullptr);
+    };
+    cv::parallel_for_({ 0, int(imgs.size()) }, harness);
+
+    return detections;
+}
+
+DRISHTI_ML_NAMESPACE_END
@@ -0,0 +1,169 @@
+/*! -*-c++-*-
+  @file   shape_predictor_flat.h
+  @author David Hirvonen
+  @brief  Internal declaration of a flat (memory mappable) shape_predictor model.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  The shape_predictor stores each tree as a few small heap allocated vectors
+  (splits + dlib leaf matrices), which are deserialized from an archive at
+  startup.  The shape_predictor_flat type stores the same model in a single
+  versioned blob of 64 byte aligned flat arrays, which is used in place: a
+  model file can be mapped with mmap() w/ no parsing, and processes on the
+  same host share one physical copy of the model.
+
+  Leaves are stored as int16_t w/ a per stage binary scale (see Stage::shift),
+  and the tree outputs of a stage are accumulated in int32_t.
+
+*/
+
+#ifndef __drishti_ml_shape_predictor_flat_h__
+#define __drishti_ml_shape_predictor_flat_h__
+
+#include "drishti/ml/drishti_ml.h"
+#include "drishti/ml/shape_predictor.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+class shape_predictor_flat
+{
+public:
+    static const uint32_t kVersion = 1;
+    static const uint32_t kEndian = 0x01020304;
+    static const uint64_t kAlignment = 64;
+
+    enum Flags
+    {
+        kNPD = 1,
+        kAffine = 2,
+        kInterpolated = 4,
+        kBilinear = 8
+    };
+
+    // All offsets are in bytes from the start of the blob:
+    struct Header
+    {
+        char magic[8]; // "DRSPFLAT"
+        uint32_t version;
+        uint32_t endian;
+        uint64_t size; // total blob size
+        uint32_t stages;
+        uint32_t shape_dim;
+        uint32_t pca_dim; // 0 if no PCA
+        uint32_t ellipse_count;
+        uint32_t flags;
+        float early_exit_threshold; // see shape_predictor::m_early_exit_threshold
+        uint64_t initial_shape;    // float[shape_dim]
+        uint64_t stage_table;      // Stage[stages]
+        uint64_t pca_mu;           // float[shape_dim]
+        uint64_t pca_sigma;        // float[shape_dim]
+        uint64_t pca_mean;         // float[shape_dim]
+        uint64_t pca_eigenvalues;  // float[pca_dim]
+        uint64_t pca_eigenvectors; // float[pca_dim x shape_dim]
+    };
+
+    // A cascade stage w/ trees of uniform depth (leaves == splits + 1):
+    struct Stage
+    {
+        uint32_t trees;
+        uint32_t splits;   // per tree
+        uint32_t leaf_dim; // leaf vector length (PCA coefficients or shape_dim)
+        uint32_t features;
+        int32_t shift; // leaf = int16_t * 2^-shift
+        uint32_t reserved;
+        uint64_t split_offset;   // Split[trees x splits]
+        uint64_t leaf_offset;    // int16_t[trees x (splits + 1) x leaf_dim]
+        uint64_t feature_offset; // uint16_t[features] anchors or InterpolatedFeature[features]
+        uint64_t delta_offset;   // float[features x 2] (anchor mode only)
+    };
+
+    struct Split
+    {
+        uint16_t idx1;
+        uint16_t idx2;
+        float thresh;
+    };
+
+    ~shape_predictor_flat();
+
+    // Map the model file (zero copy):
+    static std::unique_ptr<shape_predictor_flat> load(const std::string& filename);
+
+    // Read the model into a single aligned buffer:
+    static std::unique_ptr<shape_predictor_flat> load(std::istream& is);
+
+    static void save(const shape_predictor& sp, std::ostream& os);
+    static void save(const shape_predictor& sp, const std::string& filename);
+
+    // Input image must be CV_8UC1, see shape_predictor::operator()
+    dlib::full_object_detection operator()(
+        const cv::Mat& img,
+        const dlib::rectangle& rect,
+        const fshape& starter_shape,
+        int stages = std::numeric_limits<int>::max(),
+        int first_stage = 0,
+        shape_predictor::prediction_stats* stats = nullptr) const;
+
+    // Batched prediction for many faces (i.e., crowds), which are distributed across threads:
+    std::vector<dlib::full_object_detection> operator()(
+        const std::vector<cv::Mat>& imgs,
+        const std::vector<dlib::rectangle>& rects,
+        const std::vector<fshape>& starter_shapes,
+        int stages = std::numeric_limits<int>::max(),
+        int first_stage = 0,
+        std::vector<shape_predictor::prediction_stats>* stats = nullptr) const;
+
+    const Header& header() const
+    {
+        return *m_header;
+    }
+    const Stage& stage(int i) const
+    {
+        return m_stages[i];
+    }
+    const fshape& getInitialShape() const
+    {
+        return m_initial_shape;
+    }
+    int getEllipseCount() const
+    {
+        return int(m_header->ellipse_count);
+    }
+    bool isPCA() const
+    {
+        return bool(m_pca);
+    }
+
+protected:
+    struct Storage;
+
+    shape_predictor_flat(std::unique_ptr<Storage>& storage);
+
+    template <typename T>
+    const T* get(uint64_t offset) const
+    {
+        return reinterpret_cast<const T*>(m_data + offset);
+    }
+
+    void extract_stage_features(const cv::Mat& img, const dlib::rectangle& rect, const fshape& current_shape, const Stage& stage, std::vector<float>& values) const;
+
+    std::unique_ptr<Storage> m_storage;
+    const uint8_t* m_data = nullptr;
+    const Header* m_header = nullptr;
+    const Stage* m_stages = nullptr;
+
+    fshape m_initial_shape; // small copy for the dlib transform utilities
+    std::unique_ptr<StandardizedPCA> m_pca;
+};
+
+DRISHTI_ML_NAMESPACE_END
+
+#endif // __drishti_ml_shape_predictor_flat_h__
@@ -0,0 +1,212 @@
+/*! -*-c++-*-
+  @file   shape_predictor_sampling.cpp
+  @author David Hirvonen
+  @brief  Internal implementation of batched feature pixel sampling for the shape_predictor.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/ml/shape_predictor_sampling.h"
+#include "drishti/ml/shape_predictor.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+DRISHTI_BEGIN_NAMESPACE(impl)
+
+feature_pixel_sampler::feature_pixel_sampler(const cv::Mat& img, const dlib::rectangle& rect, bool bilinear)
+    : m_img(img)
+    , m_bilinear(bilinear)
+{
+    CV_Assert(img.type() == CV_8UC1);
+
+    const dlib::point_transform_affine tform_to_img = unnormalizing_tform(rect);
+    const auto& m = tform_to_img.get_m();
+    const auto& b = tform_to_img.get_b();
+    m_tform[0] = m(0, 0);
+    m_tform[1] = m(0, 1);
+    m_tform[2] = b(0);
+    m_tform[3] = m(1, 0);
+    m_tform[4] = m(1, 1);
+    m_tform[5] = b(1);
+}
+
+bool feature_pixel_sampler::has_simd()
+{
+#if CV_SIMD128
+    return true;
+#else
+    return false;
+#endif
+}
+
+void feature_pixel_sampler::operator()(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const
+{
+#if DRISHTI_BUILD_REGRESSION_SIMD
+    sample_simd(n, x, y, dx, dy, tform, values);
+#else
+    sample_scalar(n, x, y, dx, dy, tform, values);
+#endif
+}
+
+void feature_pixel_sampler::sample_scalar(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const
+{
+    const int cols = m_img.cols, rows = m_img.rows;
+    auto pixel = [&](long qx, long qy) {
+        return (0 <= qx && qx < cols && 0 <= qy && qy < rows) ? float(m_img.at<uint8_t>(int(qy), int(qx))) : 0.f;
+    };
+
+    for (int i = 0; i < n; i++)
+    {
+        float px = x[i], py = y[i];
+        if (dx)
+        {
+            px += tform[0] * dx[i] + tform[1] * dy[i];
+            py += tform[2] * dx[i] + tform[3] * dy[i];
+        }
+
+        const double u = m_tform[0] * px + m_tform[1] * py + m_tform[2];
+        const double v = m_tform[3] * px + m_tform[4] * py + m_tform[5];
+        if (m_bilinear)
+        {
+            const double x0 = std::floor(u), y0 = std::floor(v), fx = u - x0, fy = v - y0;
+            const long qx = long(x0), qy = long(y0);
+            const double top = (1.0 - fx) * pixel(qx, qy) + fx * pixel(qx + 1, qy);
+            const double bottom = (1.0 - fx) * pixel(qx, qy + 1) + fx * pixel(qx + 1, qy + 1);
+            values[i] = float((1.0 - fy) * top + fy * bottom);
+        }
+        else
+        {
+            // Round as in the dlib::point conversion:
+            values[i] = pixel(long(std::floor(u + 0.5)), long(std::floor(v + 0.5)));
+        }
+    }
+}
+
+#if CV_SIMD128
+void feature_pixel_sampler::sample_simd(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const
+{
+    using namespace cv;
+
+    if (m_img.empty())
+    {
+        std::fill(values, values + n, 0.f); // every sample is outside of the image
+        return;
+    }
+
+    const v_float32x4 a = v_setall_f32(float(m_tform[0])), b = v_setall_f32(float(m_tform[1])), c = v_setall_f32(float(m_tform[2]));
+    const v_float32x4 d = v_setall_f32(float(m_tform[3])), e = v_setall_f32(float(m_tform[4])), f = v_setall_f32(float(m_tform[5]));
+    const v_float32x4 t0 = v_setall_f32(dx ? tform[0] : 0.f), t1 = v_setall_f32(dx ? tform[1] : 0.f);
+    const v_float32x4 t2 = v_setall_f32(dx ? tform[2] : 0.f), t3 = v_setall_f32(dx ? tform[3] : 0.f);
+    const v_float32x4 half = v_setall_f32(0.5f), unit = v_setall_f32(1.f);
+    const v_int32x4 zero = v_setall_s32(0), one = v_setall_s32(1);
+    const v_int32x4 xmax = v_setall_s32(m_img.cols - 1), ymax = v_setall_s32(m_img.rows - 1);
+
+    const uint8_t* data = m_img.ptr<uint8_t>();
+    const std::size_t step = m_img.step;
+
+    // Clamped indices keep all loads inside the image, and the masks zero the samples (or taps) outside of it:
+    auto inside = [&](const v_int32x4& q, const v_int32x4& qmax) { return (q >= zero) & (q <= qmax); };
+    auto clamp = [&](const v_int32x4& q, const v_int32x4& qmax) { return v_min(v_max(q, zero), qmax); };
+
+    auto block = [&](const float* px, const float* py, const float* pdx, const float* pdy, float* out) {
+        v_float32x4 vx = v_load(px), vy = v_load(py);
+        if (pdx)
+        {
+            const v_float32x4 vdx = v_load(pdx), vdy = v_load(pdy);
+            vx = vx + (t0 * vdx + t1 * vdy);
+            vy = vy + (t2 * vdx + t3 * vdy);
+        }
+
+        const v_float32x4 u = a * vx + b * vy + c;
+        const v_float32x4 v = d * vx + e * vy + f;
+
+        int ix0[4], iy0[4];
+        if (m_bilinear)
+        {
+            const v_int32x4 x0 = v_floor(u), y0 = v_floor(v), x1 = x0 + one, y1 = y0 + one;
+            const v_float32x4 fx = u - v_cvt_f32(x0), fy = v - v_cvt_f32(y0);
+            const v_float32x4 wx0 = (unit - fx) & v_reinterpret_as_f32(inside(x0, xmax));
+            const v_float32x4 wx1 = fx & v_reinterpret_as_f32(inside(x1, xmax));
+            const v_float32x4 wy0 = (unit - fy) & v_reinterpret_as_f32(inside(y0, ymax));
+            const v_float32x4 wy1 = fy & v_reinterpret_as_f32(inside(y1, ymax));
+
+            int ix1[4], iy1[4];
+            v_store(ix0, clamp(x0, xmax));
+            v_store(ix1, clamp(x1, xmax));
+            v_store(iy0, clamp(y0, ymax));
+            v_store(iy1, clamp(y1, ymax));
+
+            float p00[4], p01[4], p10[4], p11[4];
+            for (int k = 0; k < 4; k++)
+            {
+                const uint8_t* r0 = data + iy0[k] * step;
+                const uint8_t* r1 = data + iy1[k] * step;
+                p00[k] = r0[ix0[k]];
+                p01[k] = r0[ix1[k]];
+                p10[k] = r1[ix0[k]];
+                p11[k] = r1[ix1[k]];
+            }
+
+            const v_float32x4 top = wx0 * v_load(p00) + wx1 * v_load(p01);
+            const v_float32x4 bottom = wx0 * v_load(p10) + wx1 * v_load(p11);
+            v_store(out, wy0 * top + wy1 * bottom);
+        }
+        else
+        {
+            const v_int32x4 qx = v_floor(u + half), qy = v_floor(v + half);
+            const v_int32x4 mask = inside(qx, xmax) & inside(qy, ymax);
+            v_store(ix0, clamp(qx, xmax));
+            v_store(iy0, clamp(qy, ymax));
+
+            float p[4];
+            for (int k = 0; k < 4; k++)
+            {
+                p[k] = data[iy0[k] * step + ix0[k]];
+            }
+            v_store(out, v_load(p) & v_reinterpret_as_f32(mask));
+        }
+    };
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        block(x + i, y + i, dx ? dx + i : nullptr, dy ? dy + i : nullptr, values + i);
+    }
+
+    if (i < n)
+    {
+        // Zero padded tail:
+        float px[4] = { 0.f }, py[4] = { 0.f }, pdx[4] = { 0.f }, pdy[4] = { 0.f }, out[4];
+        for (int k = 0; k < (n - i); k++)
+        {
+            px[k] = x[i + k];
+            py[k] = y[i + k];
+            if (dx)
+            {
+                pdx[k] = dx[i + k];
+                pdy[k] = dy[i + k];
+            }
+        }
+        block(px, py, dx ? pdx : nullptr, dy ? pdy : nullptr, out);
+        for (int k = 0; k < (n - i); k++)
+        {
+            values[i + k] = out[k];
+        }
+    }
+}
+#else
+void feature_pixel_sampler::sample_simd(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const
+{
+    sample_scalar(n, x, y, dx, dy, tform, values);
+}
+#endif
+
+DRISHTI_END_NAMESPACE(impl)
+DRISHTI_ML_NAMESPACE_END
@@ -0,0 +1,62 @@
+/*! -*-c++-*-
+  @file   shape_predictor_sampling.h
+  @author David Hirvonen
+  @brief  Internal declaration of batched feature pixel sampling for the shape_predictor.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  The pose indexed features of a cascade stage are sampled in one batch:
+  the feature points are passed as a structure of arrays, so the mapping
+  from the normalized shape space to the image, the rounding and the bounds
+  checks run 4 points at a time w/ the OpenCV universal intrinsics (SSE2 or
+  NEON).  Only the pixel loads themselves are scalar.
+
+*/
+
+#ifndef __drishti_ml_shape_predictor_sampling_h__
+#define __drishti_ml_shape_predictor_sampling_h__
+
+#include "drishti/ml/drishti_ml.h"
+#include "drishti/core/drishti_core.h"
+
+#include <dlib/geometry/rectangle.h>
+
+#include <opencv2/core/core.hpp>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+DRISHTI_BEGIN_NAMESPACE(impl)
+
+class feature_pixel_sampler
+{
+public:
+    // img: CV_8UC1 image, rect: region corresponding to the unit square of the normalized shape space
+    feature_pixel_sampler(const cv::Mat& img, const dlib::rectangle& rect, bool bilinear = false);
+
+    /*
+     * values[i] = img(tform_to_img(p[i])) where p[i] = (x[i], y[i]) + tform * (dx[i], dy[i]),
+     * tform is a row major 2x2 matrix, and the delta term is skipped when dx == nullptr.
+     *
+     * nearest: value of the rounded pixel, or 0 outside of the image (see extract_feature_pixel_values)
+     * bilinear: 2x2 interpolation, where pixels outside of the image are 0
+     */
+    void operator()(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const;
+
+    // Reference implementation (double precision image transform, as in the dlib point transforms):
+    void sample_scalar(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const;
+
+    // Vectorized implementation (single precision), which falls back to sample_scalar() w/o CV_SIMD128:
+    void sample_simd(int n, const float* x, const float* y, const float* dx, const float* dy, const float* tform, float* values) const;
+
+    static bool has_simd();
+
+protected:
+    cv::Mat m_img;
+    double m_tform[6]; // [ a b c; d e f ], see unnormalizing_tform()
+    bool m_bilinear = false;
+};
+
+DRISHTI_END_NAMESPACE(impl)
+DRISHTI_ML_NAMESPACE_END
+
+#endif // __drishti_ml_shape_predictor_sampling_h__
@@ -0,0 +1,275 @@
+/*! -*-c++-*-
+  @file   shape_predictor_shards.cpp
+  @author David Hirvonen
+  @brief  Internal implementation of sharded on-disk training data for the shape_predictor_trainer.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/ml/shape_predictor_shards.h"
+#include "drishti/core/ThrowAssert.h"
+
+#include <numeric>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+// Native byte order, since the shards are scratch data for training on one machine:
+template <typename T>
+static void write_pod(std::ostream& os, const T& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static T read_pod(std::istream& is)
+{
+    T value{};
+    is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+static const uint32_t kIndexMagic = 0x53505349; // "ISPS"
+
+// ### sharded_image_store::writer ###
+
+sharded_image_store::writer::writer(const std::string& prefix, std::size_t images_per_shard)
+    : m_prefix(prefix)
+    , m_images_per_shard(images_per_shard)
+{
+    drishti_throw_assert(images_per_shard > 0, "sharded_image_store::writer: images_per_shard must be positive");
+}
+
+sharded_image_store::writer::~writer()
+{
+    // Don't throw from the destructor (call close() to handle I/O errors):
+    if (!m_closed)
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception& e)
+        {
+            auto logger = m_streamLogger ? m_streamLogger : drishti::core::Logger::create("drishti");
+            logger->error("sharded_image_store::writer: {}", e.what());
+        }
+    }
+}
+
+void sharded_image_store::writer::add(const cv::Mat& image, const ObjectVec& objects)
+{
+    drishti_throw_assert(!m_closed, "sharded_image_store::writer: store is closed");
+    drishti_throw_assert(image.type() == CV_8UC1, "sharded_image_store::writer: expected CV_8UC1 image");
+
+    if (m_counts.empty() || (m_counts.back() == m_images_per_shard))
+    {
+        m_stream.close();
+        m_stream.open(shard_name(m_prefix, m_counts.size()), std::ios::binary);
+        drishti_throw_assert(m_stream, "Unable to open " << shard_name(m_prefix, m_counts.size()) << " for writing");
+        m_counts.push_back(0);
+    }
+
+    write_pod(m_stream, uint32_t(objects.size()));
+    for (const auto& object : objects)
+    {
+        const auto& rect = object.get_rect();
+        write_pod(m_stream, int32_t(rect.left()));
+        write_pod(m_stream, int32_t(rect.top()));
+        write_pod(m_stream, int32_t(rect.right()));
+        write_pod(m_stream, int32_t(rect.bottom()));
+        write_pod(m_stream, uint32_t(object.num_parts()));
+        for (unsigned long i = 0; i < object.num_parts(); i++)
+        {
+            write_pod(m_stream, int32_t(object.part(i).x()));
+            write_pod(m_stream, int32_t(object.part(i).y()));
+        }
+    }
+
+    write_pod(m_stream, int32_t(image.rows));
+    write_pod(m_stream, int32_t(image.cols));
+    for (int y = 0; y < image.rows; y++)
+    {
+        m_stream.write(image.ptr<char>(y), image.cols);
+    }
+    drishti_throw_assert(m_stream, "sharded_image_store::writer: write failed");
+
+    m_counts.back()++;
+}
+
+void sharded_image_store::writer::close()
+{
+    m_stream.close();
+
+    std::ofstream os(index_name(m_prefix), std::ios::binary);
+    drishti_throw_assert(os, "Unable to open " << index_name(m_prefix) << " for writing");
+    write_pod(os, kIndexMagic);
+    write_pod(os, uint32_t(m_counts.size()));
+    for (const auto& count : m_counts)
+    {
+        write_pod(os, count);
+    }
+    m_closed = true;
+}
+
+// ### sharded_image_store ###
+
+sharded_image_store::sharded_image_store(const std::string& prefix)
+    : m_prefix(prefix)
+{
+    std::ifstream is(index_name(prefix), std::ios::binary);
+    drishti_throw_assert(is, "Unable to open sharded_image_store " << index_name(prefix));
+    drishti_throw_assert(read_pod<uint32_t>(is) == kIndexMagic, "Invalid sharded_image_store index: bad magic");
+    m_counts.resize(read_pod<uint32_t>(is));
+    for (auto& count : m_counts)
+    {
+        count = read_pod<uint32_t>(is);
+    }
+    drishti_throw_assert(is, "Invalid sharded_image_store index: truncated");
+}
+
+std::size_t sharded_image_store::size() const
+{
+    return std::accumulate(m_counts.begin(), m_counts.end(), std::size_t(0));
+}
+
+std::string sharded_image_store::index_name(const std::string& prefix)
+{
+    return prefix + ".index";
+}
+
+std::string sharded_image_store::shard_name(const std::string& prefix, std::size_t shard)
+{
+    return prefix + "." + std::to_string(shard) + ".images";
+}
+
+void sharded_image_store::load(std::size_t shard, std::vector<ObjectVec>& objects) const
+{
+    load(shard, nullptr, objects);
+}
+
+void sharded_image_store::load(std::size_t shard, std::vector<cv::Mat>& images, std::vector<ObjectVec>& objects) const
+{
+    load(shard, &images, objects);
+}
+
+void sharded_image_store::load(std::size_t shard, std::vector<cv::Mat>* images, std::vector<ObjectVec>& objects) const
+{
+    drishti_throw_assert(shard < m_counts.size(), "sharded_image_store: shard " << shard << " out of range");
+
+    std::ifstream is(shard_name(m_prefix, shard), std::ios::binary);
+    drishti_throw_assert(is, "Unable to open " << shard_name(m_prefix, shard));
+
+    objects.resize(m_counts[shard]);
+    if (images)
+    {
+        images->resize(m_counts[shard]);
+    }
+
+    std::vector<dlib::point> parts;
+    for (uint32_t i = 0; i < m_counts[shard]; i++)
+    {
+        objects[i].resize(read_pod<uint32_t>(is));
+        for (auto& object : objects[i])
+        {
+            const long l = read_pod<int32_t>(is), t = read_pod<int32_t>(is);
+            const long r = read_pod<int32_t>(is), b = read_pod<int32_t>(is);
+            parts.resize(read_pod<uint32_t>(is));
+            for (auto& p : parts)
+            {
+                p.x() = read_pod<int32_t>(is);
+                p.y() = read_pod<int32_t>(is);
+            }
+            object = dlib::full_object_detection(dlib::rectangle(l, t, r, b), parts);
+        }
+
+        const int rows = read_pod<int32_t>(is), cols = read_pod<int32_t>(is);
+        drishti_throw_assert(is && rows >= 0 && cols >= 0, "Invalid sharded_image_store shard " << shard_name(m_prefix, shard));
+        if (images)
+        {
+            cv::Mat1b image(rows, cols);
+            is.read(reinterpret_cast<char*>(image.data), std::streamsize(image.total()));
+            (*images)[i] = image;
+        }
+        else
+        {
+            is.seekg(std::streamoff(rows) * cols, std::ios::cur);
+        }
+    }
+
+    drishti_throw_assert(is, "Invalid sharded_image_store shard " << shard_name(m_prefix, shard) << ": truncated");
+}
+
+DRISHTI_BEGIN_NAMESPACE(impl)
+
+// ### sample_shard ###
+
+std::string sample_shard::name(const std::string& scratch, std::size_t shard)
+{
+    return scratch + "." + std::to_string(shard) + ".samples";
+}
+
+void sample_shard::save(const std::string& filename) const
+{
+    CV_Assert(rects.size() == size() && target.rows == int(size()) && current.rows == int(size()) && target.cols == current.cols);
+    CV_Assert(features.empty() || features.rows == int(size()));
+
+    auto is_continuous = [](const cv::Mat& m) { return m.empty() || m.isContinuous(); };
+    CV_Assert(is_continuous(target) && is_continuous(current) && is_continuous(features));
+
+    std::ofstream os(filename, std::ios::binary);
+    drishti_throw_assert(os, "Unable to open " << filename << " for writing");
+
+    write_pod(os, uint32_t(size()));
+    write_pod(os, uint32_t(target.cols));
+    write_pod(os, uint32_t(features.cols));
+    for (std::size_t i = 0; i < size(); i++)
+    {
+        write_pod(os, image[i]);
+        write_pod(os, int32_t(rects[i].left()));
+        write_pod(os, int32_t(rects[i].top()));
+        write_pod(os, int32_t(rects[i].right()));
+        write_pod(os, int32_t(rects[i].bottom()));
+    }
+    os.write(reinterpret_cast<const char*>(target.data), std::streamsize(target.total() * sizeof(float)));
+    os.write(reinterpret_cast<const char*>(current.data), std::streamsize(current.total() * sizeof(float)));
+    os.write(reinterpret_cast<const char*>(features.data), std::streamsize(features.total()));
+    drishti_throw_assert(os, "sample_shard: write failed " << filename);
+}
+
+void sample_shard::load(const std::string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    drishti_throw_assert(is, "Unable to open " << filename);
+
+    const int n = read_pod<uint32_t>(is), dim = read_pod<uint32_t>(is), pool = read_pod<uint32_t>(is);
+    image.resize(n);
+    rects.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        image[i] = read_pod<uint32_t>(is);
+        const long l = read_pod<int32_t>(is), t = read_pod<int32_t>(is);
+        const long r = read_pod<int32_t>(is), b = read_pod<int32_t>(is);
+        rects[i] = dlib::rectangle(l, t, r, b);
+    }
+
+    target.create(n, dim);
+    current.create(n, dim);
+    is.read(reinterpret_cast<char*>(target.data), std::streamsize(target.total() * sizeof(float)));
+    is.read(reinterpret_cast<char*>(current.data), std::streamsize(current.total() * sizeof(float)));
+    if (pool > 0)
+    {
+        features.create(n, pool);
+        is.read(reinterpret_cast<char*>(features.data), std::streamsize(features.total()));
+    }
+    else
+    {
+        features.release();
+    }
+    drishti_throw_assert(is, "Invalid sample_shard " << filename << ": truncated");
+}
+
+DRISHTI_END_NAMESPACE(impl)
+
+DRISHTI_ML_NAMESPACE_END
@@ -0,0 +1,123 @@
+/*! -*-c++-*-
+  @file   shape_predictor_shards.h
+  @author David Hirvonen
+  @brief  Internal declaration of sharded on-disk training data for the shape_predictor_trainer.
+
+  \copyright Copyright 2017 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Out-of-core training (see shape_predictor_trainer::train(const sharded_image_store&, ...))
+  keeps one shard per worker thread in memory at a time:
+
+  - sharded_image_store: 8 bit images and their annotations, grouped in shard
+    files <prefix>.<k>.images, which are read on demand
+  - impl::sample_shard: the augmented training samples of one image shard
+    (regression targets, current estimates and uint8 feature pool values),
+    stored in <scratch>.<k>.samples
+
+*/
+
+#ifndef __drishti_ml_shape_predictor_shards_h__
+#define __drishti_ml_shape_predictor_shards_h__
+
+#include "drishti/ml/drishti_ml.h"
+#include "drishti/core/drishti_core.h"
+#include "drishti/core/Logger.h"
+
+#include <dlib/image_processing/full_object_detection.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+class sharded_image_store
+{
+public:
+    using ObjectVec = std::vector<dlib::full_object_detection>;
+
+    // Incremental writer, so that a store can be created w/o loading the whole data set:
+    class writer
+    {
+    public:
+        writer(const std::string& prefix, std::size_t images_per_shard);
+        ~writer();
+
+        // image: CV_8UC1
+        void add(const cv::Mat& image, const ObjectVec& objects);
+
+        // Write the index, throws on I/O errors (the destructor calls it if needed, but
+        // can only log the errors):
+        void close();
+
+        void setStreamLogger(std::shared_ptr<spdlog::logger>& logger)
+        {
+            m_streamLogger = logger;
+        }
+
+    protected:
+        std::string m_prefix;
+        std::size_t m_images_per_shard = 0;
+        std::vector<uint32_t> m_counts;
+        std::ofstream m_stream;
+        bool m_closed = false;
+
+        std::shared_ptr<spdlog::logger> m_streamLogger;
+    };
+
+    explicit sharded_image_store(const std::string& prefix);
+
+    std::size_t shards() const { return m_counts.size(); }
+    std::size_t size(std::size_t shard) const { return m_counts[shard]; }
+    std::size_t size() const; // total number of images
+
+    // Annotations of one shard (the pixels are skipped):
+    void load(std::size_t shard, std::vector<ObjectVec>& objects) const;
+
+    // Images (CV_8UC1) and annotations of one shard:
+    void load(std::size_t shard, std::vector<cv::Mat>& images, std::vector<ObjectVec>& objects) const;
+
+    static std::string index_name(const std::string& prefix);
+    static std::string shard_name(const std::string& prefix, std::size_t shard);
+
+protected:
+    void load(std::size_t shard, std::vector<cv::Mat>* images, std::vector<ObjectVec>& objects) const;
+
+    std::string m_prefix;
+    std::vector<uint32_t> m_counts;
+};
+
+DRISHTI_BEGIN_NAMESPACE(impl)
+
+/*
+ * Fixed size training sample records of one image shard, where
+ * target.row(i) and current.row(i) are coded in the regression space
+ * (PCA coefficients or normalized shape coordinates), and
+ * features.row(i) holds the feature pool values quantized to uint8
+ * (exact for nearest neighbor sampling of 8 bit images).
+ */
+struct sample_shard
+{
+    std::vector<uint32_t> image; // image index in the image shard
+    std::vector<dlib::rectangle> rects;
+    cv::Mat1f target;
+    cv::Mat1f current;
+    cv::Mat1b features;
+
+    std::size_t size() const { return image.size(); }
+
+    void save(const std::string& filename) const;
+    void load(const std::string& filename);
+
+    static std::string name(const std::string& scratch, std::size_t shard);
+};
+
+DRISHTI_END_NAMESPACE(impl)
+
+DRISHTI_ML_NAMESPACE_END
+
+#endif // __drishti_ml_shape_predictor_shards_h__
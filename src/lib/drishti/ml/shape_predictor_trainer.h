@@ -5,12 +5,14 @@
 #define __drishti_ml_shape_predictor_trainer_h__
 
 #include "drishti/ml/shape_predictor.h"
+#include "drishti/ml/shape_predictor_shards.h"
 
 // clang-format off
 #if !DRISHTI_BUILD_MIN_SIZE
 #  include <dlib/serialize.h>
 #  include <dlib/console_progress_indicator.h>
 #  include <dlib/threads.h>
+#  include <functional>
 #endif
 // clang-format on
 
@@ -172,6 +174,35 @@ public:
         _num_test_splits = num;
     }
 
+    // Histogram split search: the feature values of each candidate split are binned, and the best
+    // of the (bins - 1) thresholds is selected for it instead of a random threshold (0: disabled).
+    unsigned long get_num_histogram_bins() const
+    {
+        return _num_histogram_bins;
+    }
+    void set_num_histogram_bins(
+        unsigned long bins)
+    {
+        DLIB_CASSERT(bins != 1 && bins <= 256,
+            "\t void shape_predictor_trainer::set_num_histogram_bins()"
+                << "\n\t Invalid inputs were given to this function. "
+                << "\n\t bins: " << bins);
+
+        _num_histogram_bins = bins;
+    }
+
+    // Random pixel pairs tested per split node w/ the histogram split search, where each of them
+    // tests all of its bin thresholds, so fewer are needed (0: get_num_test_splits()):
+    unsigned long get_num_histogram_test_splits() const
+    {
+        return _num_histogram_test_splits;
+    }
+    void set_num_histogram_test_splits(
+        unsigned long num)
+    {
+        _num_histogram_test_splits = num;
+    }
+
     double get_feature_pool_region_padding() const
     {
         return _feature_pool_region_padding;
@@ -214,6 +245,9 @@ public:
     void set_do_affine(bool do_affine) { _do_affine = do_affine; }
     bool get_do_affine() const { return _do_affine; }
 
+    void set_do_bilinear(bool do_bilinear) { _do_bilinear = do_bilinear; }
+    bool get_do_bilinear() const { return _do_bilinear; }
+
     void set_do_line_indexed(bool do_line_indexed) { _do_line_indexed = do_line_indexed; }
     bool get_do_line_indexed() const { return _do_line_indexed; }
 
@@ -350,11 +384,11 @@ public:
                 }
                 else if (_do_line_indexed)
                 {
-                    extract_feature_pixel_values(image, s.rect, cs, interpolated_features[cascade], s.feature_pixel_values);
+                    extract_feature_pixel_values(image, s.rect, cs, interpolated_features[cascade], s.feature_pixel_values, _do_bilinear);
                 }
                 else
                 {
-                    extract_feature_pixel_values(image, s.rect, cs, is, anchor_idx, deltas, s.feature_pixel_values, _ellipse_count, _do_affine);
+                    extract_feature_pixel_values(image, s.rect, cs, is, anchor_idx, deltas, s.feature_pixel_values, _ellipse_count, _do_affine, _do_bilinear);
                 }
             },
                 1);
@@ -383,11 +417,303 @@ public:
 
         if (interpolated_features.size())
         {
-            return shape_predictor(initial_shape, forests, interpolated_features, pca, _do_npd, _do_affine, _ellipse_count);
+            return shape_predictor(initial_shape, forests, interpolated_features, pca, _do_npd, _do_affine, _ellipse_count, _do_bilinear);
         }
         else
         {
-            return shape_predictor(initial_shape, forests, pixel_coordinates, pca, _do_npd, _do_affine, _ellipse_count);
+            return shape_predictor(initial_shape, forests, pixel_coordinates, pca, _do_npd, _do_affine, _ellipse_count, _do_bilinear);
+        }
+    }
+
+    /*
+     * Out-of-core training w/ the images of a sharded_image_store (see shape_predictor_shards.h).
+     * The augmented training samples of each image shard are stored in <scratch>.<k>.samples
+     * w/ uint8 feature pool values, and each worker thread keeps only one shard in memory at a
+     * time.  The trees are grown level by level w/ one pass over the shards per level, in which
+     * the split statistics of all nodes in the level are accumulated shard by shard.
+     *
+     * Differences from train(images, objects):
+     * - the random initial shapes are convex combinations of target shapes in the same shard
+     * - the PCA shape space (if any) is fit to a random subset of the target and initial shapes
+     * - bilinear sampling is not supported, since its fractional pixel values would be rounded
+     */
+    shape_predictor train(
+        const sharded_image_store& store,
+        const std::string& scratch) const
+    {
+        using namespace impl;
+        DLIB_CASSERT(store.shards() > 0,
+            "\t shape_predictor shape_predictor_trainer::train()"
+                << "\n\t The sharded_image_store is empty.");
+        DLIB_CASSERT(get_tree_depth() <= 15,
+            "\t shape_predictor shape_predictor_trainer::train()"
+                << "\n\t Out-of-core training supports trees w/ up to 15 levels"
+                << "\n\t get_tree_depth(): " << get_tree_depth());
+        DLIB_CASSERT(!_do_bilinear,
+            "\t shape_predictor shape_predictor_trainer::train()"
+                << "\n\t Out-of-core training stores uint8 feature values, which don't support bilinear sampling");
+
+        rnd.set_seed(get_random_seed());
+
+        dlib::thread_pool tp(_num_threads > 1 ? _num_threads : 0);
+
+        const std::size_t shards = store.shards();
+        std::vector<std::vector<dlib::full_object_detection>> objects;
+
+        // Make sure the objects agree on the number of parts, and compute the mean shape:
+        unsigned long num_parts = 0;
+        fshape mean_shape;
+        long count = 0;
+        for (std::size_t k = 0; k < shards; k++)
+        {
+            store.load(k, objects);
+            for (const auto& image_objects : objects)
+            {
+                for (const auto& object : image_objects)
+                {
+                    if (num_parts == 0)
+                    {
+                        num_parts = object.num_parts();
+                    }
+                    DLIB_CASSERT(object.num_parts() != 0 && object.num_parts() == num_parts,
+                        "\t shape_predictor shape_predictor_trainer::train()"
+                            << "\n\t All the objects must agree on the number of parts. "
+                            << "\n\t shard: " << k
+                            << "\n\t num_parts(): " << object.num_parts()
+                            << "\n\t num_parts:  " << num_parts);
+                    mean_shape += object_to_shape(object, _ellipse_count);
+                    ++count;
+                }
+            }
+        }
+        DLIB_CASSERT(count > 0,
+            "\t shape_predictor shape_predictor_trainer::train()"
+                << "\n\t You must give at least one full_object_detection if you want to train a shape model and it must have parts.");
+
+        DLIB_CASSERT(!(_ellipse_count % 2), "\t currently limited to ellipse pairs"); // point representation limitations
+        DLIB_CASSERT((_ellipse_count * 5) != (num_parts * 2), "\t ellipse only models are not supported");
+
+        mean_shape /= count;
+        const fshape initial_shape = mean_shape;
+        const int num_dim = int(initial_shape.size());
+
+        std::vector<PointVecf> pixel_coordinates;
+        std::vector<std::vector<InterpolatedFeature>> interpolated_features;
+        if (_do_line_indexed)
+        {
+            randomly_sample_pixel_coordinates_between_features(interpolated_features, pixel_coordinates, initial_shape, _ellipse_count, _roi);
+        }
+        else
+        {
+            pixel_coordinates = randomly_sample_pixel_coordinates(initial_shape, _ellipse_count, _roi);
+        }
+
+        // Create the training samples of each shard, and a reservoir sample of the shapes for the PCA:
+        const bool do_pca = _dimensions.size() > 0;
+        const unsigned long max_pca_samples = 100000;
+        cv::Mat1f pca_samples;
+        unsigned long pca_candidates = 0;
+        auto add_pca_sample = [&](const float* shape) {
+            if (pca_candidates < max_pca_samples)
+            {
+                pca_samples.push_back(cv::Mat1f(1, num_dim, const_cast<float*>(shape)));
+            }
+            else
+            {
+                const unsigned long j = rnd.get_random_32bit_number() % (pca_candidates + 1);
+                if (j < max_pca_samples)
+                {
+                    std::copy(shape, shape + num_dim, pca_samples.ptr<float>(int(j)));
+                }
+            }
+            pca_candidates++;
+        };
+
+        std::vector<std::vector<uint16_t>> nodes(shards); // tree node of each sample, see make_regression_tree()
+        unsigned long num_samples = 0;
+        for (std::size_t k = 0; k < shards; k++)
+        {
+            store.load(k, objects);
+
+            sample_shard s;
+            std::vector<fshape> targets;
+            for (uint32_t i = 0; i < objects.size(); i++)
+            {
+                for (const auto& object : objects[i])
+                {
+                    targets.push_back(object_to_shape(object, _ellipse_count));
+                    for (unsigned long itr = 0; itr < get_oversampling_amount(); ++itr)
+                    {
+                        s.image.push_back(i);
+                        s.rects.push_back(object.get_rect());
+                    }
+                }
+            }
+
+            const int n = int(s.size());
+            s.target.create(n, num_dim);
+            s.current.create(n, num_dim);
+            for (int i = 0; i < n; i++)
+            {
+                const fshape& target = targets[i / get_oversampling_amount()];
+                fshape current = mean_shape;
+                if ((i % get_oversampling_amount()) != 0)
+                {
+                    const unsigned long rand_idx1 = rnd.get_random_32bit_number() % targets.size();
+                    const unsigned long rand_idx2 = rnd.get_random_32bit_number() % targets.size();
+                    const double alpha = rnd.get_random_double();
+                    current = alpha * targets[rand_idx1] + (1.0 - alpha) * targets[rand_idx2];
+                }
+
+                std::copy(&target(0), &target(0) + num_dim, s.target.ptr<float>(i));
+                std::copy(&current(0), &current(0) + num_dim, s.current.ptr<float>(i));
+                if (do_pca)
+                {
+                    add_pca_sample(s.target.ptr<float>(i));
+                    add_pca_sample(s.current.ptr<float>(i));
+                }
+            }
+
+            s.save(sample_shard::name(scratch, k));
+            num_samples += n;
+        }
+
+        // PCA for shape space regression, w/ the samples coded as coefficients:
+        StandardizedPCAPtr pca;
+        int max_pca_dim = num_dim;
+        if (do_pca)
+        {
+            CV_Assert(int(_dimensions.size()) == get_cascade_depth());
+            max_pca_dim = *std::max_element(_dimensions.begin(), _dimensions.end());
+
+            pca = std::make_shared<StandardizedPCA>();
+            cv::Mat projection;
+            pca->compute(pca_samples, projection, max_pca_dim);
+
+            for_each_shard(tp, shards, [&](unsigned long block, std::size_t k) {
+                sample_shard s;
+                s.load(sample_shard::name(scratch, k));
+                if (s.size())
+                {
+                    s.target = pca->project(s.target);
+                    s.current = pca->project(s.current);
+                }
+                s.save(sample_shard::name(scratch, k));
+            });
+        }
+
+        unsigned long trees_fit_so_far = 0;
+        dlib::console_progress_indicator pbar(get_cascade_depth() * get_num_trees_per_cascade_level());
+        if (_verbose)
+        {
+            std::cout << "Fitting trees..." << std::endl;
+        }
+
+        std::vector<std::vector<impl::regression_tree>> forests(get_cascade_depth());
+        for (unsigned long cascade = 0, prev_pca_dim = 0; cascade < get_cascade_depth(); ++cascade)
+        {
+            const int current_pca_dim = do_pca ? _dimensions[cascade] : num_dim;
+
+            std::vector<unsigned short> anchor_idx;
+            PointVecf deltas;
+            if (!_do_line_indexed)
+            {
+                create_shape_relative_encoding(initial_shape, pixel_coordinates[cascade], anchor_idx, deltas, _ellipse_count);
+            }
+
+            // Extract the (quantized) feature pixel values of each sample, and sum the residuals:
+            const unsigned long num_workers = std::max(1UL, tp.num_threads_in_pool());
+            std::vector<std::vector<double>> block_sums(num_workers, std::vector<double>(current_pca_dim, 0.0));
+            for_each_shard(tp, shards, [&](unsigned long block, std::size_t k) {
+                sample_shard s;
+                s.load(sample_shard::name(scratch, k));
+
+                std::vector<cv::Mat> images;
+                std::vector<std::vector<dlib::full_object_detection>> unused;
+                store.load(k, images, unused);
+
+                s.features.create(int(s.size()), int(get_feature_pool_size()));
+
+                fshape coefficients(max_pca_dim), shape(num_dim);
+                std::vector<float> feature_pixel_values;
+                for (int i = 0; i < int(s.size()); i++)
+                {
+                    float* current = s.current.ptr<float>(i);
+                    const float* target = s.target.ptr<float>(i);
+                    if (do_pca)
+                    {
+                        if (cascade > 0)
+                        {
+                            // See update_shape_space_models():
+                            std::fill(current + prev_pca_dim, current + max_pca_dim, 0.f);
+                        }
+                        std::copy(current, current + max_pca_dim, &coefficients(0));
+                        shape_predictor::back_project(*pca, current_pca_dim, coefficients, shape);
+                    }
+                    else
+                    {
+                        std::copy(current, current + num_dim, &shape(0));
+                    }
+
+                    const dlib::cv_image<unsigned char> image(images[s.image[i]]);
+                    if (_do_line_indexed)
+                    {
+                        extract_feature_pixel_values(image, s.rects[i], shape, interpolated_features[cascade], feature_pixel_values, _do_bilinear);
+                    }
+                    else
+                    {
+                        extract_feature_pixel_values(image, s.rects[i], shape, initial_shape, anchor_idx, deltas, feature_pixel_values, _ellipse_count, _do_affine, _do_bilinear);
+                    }
+
+                    uint8_t* features = s.features.ptr<uint8_t>(i);
+                    for (std::size_t j = 0; j < feature_pixel_values.size(); j++)
+                    {
+                        features[j] = cv::saturate_cast<uint8_t>(feature_pixel_values[j]);
+                    }
+
+                    for (int j = 0; j < current_pca_dim; j++)
+                    {
+                        block_sums[block][j] += target[j] - current[j];
+                    }
+                }
+
+                s.save(sample_shard::name(scratch, k));
+            });
+
+            std::vector<double> sum(current_pca_dim, 0.0);
+            for (const auto& block_sum : block_sums)
+            {
+                for (int j = 0; j < current_pca_dim; j++)
+                {
+                    sum[j] += block_sum[j];
+                }
+            }
+
+            for (unsigned long i = 0; i < get_num_trees_per_cascade_level(); ++i)
+            {
+                forests[cascade].push_back(make_regression_tree(tp, scratch, nodes, pixel_coordinates[cascade], current_pca_dim, sum, num_samples, _do_npd));
+                if (_verbose)
+                {
+                    ++trees_fit_so_far;
+                    pbar.print_status(trees_fit_so_far);
+                }
+            }
+
+            prev_pca_dim = current_pca_dim;
+        }
+
+        if (_verbose)
+        {
+            std::cout << "Training complete                          " << std::endl;
+        }
+
+        if (interpolated_features.size())
+        {
+            return shape_predictor(initial_shape, forests, interpolated_features, pca, _do_npd, _do_affine, _ellipse_count, _do_bilinear);
+        }
+        else
+        {
+            return shape_predictor(initial_shape, forests, pixel_coordinates, pca, _do_npd, _do_affine, _ellipse_count, _do_bilinear);
         }
     }
 
@@ -744,7 +1070,7 @@ private:
     {
         // generate a bunch of random splits and test them and return the best one.
 
-        const unsigned long num_test_splits = get_num_test_splits();
+        const unsigned long num_test_splits = num_split_candidates();
 
         // sample the random features we test in this function
         std::vector<impl::split_feature> feats;
@@ -754,6 +1080,11 @@ private:
             feats.push_back(randomly_generate_split_feature(pixel_coordinates, do_npd));
         }
 
+        if (get_num_histogram_bins() > 0)
+        {
+            return generate_histogram_split(tp, samples, begin, end, feats, sum, left_sum, right_sum, do_npd);
+        }
+
         std::vector<fshape> left_sums(num_test_splits);
         std::vector<unsigned long> left_cnt(num_test_splits);
 
@@ -826,6 +1157,194 @@ private:
         return feats[best_feat];
     }
 
+    // Random pixel pairs tested per split node, see set_num_histogram_test_splits():
+    unsigned long num_split_candidates() const
+    {
+        return ((get_num_histogram_bins() > 0) && (get_num_histogram_test_splits() > 0)) ? get_num_histogram_test_splits() : get_num_test_splits();
+    }
+
+    // Uniform bins of the pixel difference (or NPD) feature values for the histogram split search, where
+    // bin b holds the values in (edges[b - 1], edges[b]], so that "value > edges[b - 1]" <=> "bin >= b":
+    struct histogram_binning
+    {
+        histogram_binning(unsigned long bins, bool do_npd)
+            : edges(bins - 1)
+            , lo(do_npd ? -1.f : -256.f)
+            , scale(float(bins) / (2.f * -lo))
+        {
+            for (unsigned long i = 0; i < edges.size(); i++)
+            {
+                edges[i] = lo + (-2.f * lo) * float(i + 1) / float(bins);
+            }
+        }
+
+        unsigned long bins() const { return edges.size() + 1; }
+
+        // The bin is computed arithmetically, and then moved by at most one bin where rounding puts a
+        // value next to an edge on the wrong side of it (bin membership must match partition_samples()):
+        uint8_t operator()(float value) const
+        {
+            const float x = std::ceil((value - lo) * scale) - 1.f;
+            const long last = long(edges.size());
+            long b = (x > 0.f) ? std::min(long(x), last) : 0L;
+            if (b > 0 && !(value > edges[b - 1]))
+            {
+                b--;
+            }
+            else if (b < last && value > edges[b])
+            {
+                b++;
+            }
+            return uint8_t(b);
+        }
+
+        std::vector<float> edges;
+        float lo, scale;
+    };
+
+    /*
+     * Scan the residual histogram of one candidate split (hist: bins x dim sums, cnt: bins counts)
+     * for the threshold w/ the best score, moving one bin at a time from the right to the left child.
+     * Returns the best score, or -1 if no threshold separates the samples.
+     */
+    static double scan_histogram(
+        const double* hist,
+        const unsigned long* cnt,
+        const std::vector<float>& edges,
+        int dim,
+        const double* sum,
+        unsigned long count,
+        float& thresh,
+        std::vector<double>& left_sum,
+        unsigned long& left_cnt)
+    {
+        std::vector<double> left(dim, 0.0);
+        unsigned long lc = 0;
+        double best_score = -1;
+        for (unsigned long b = edges.size(); b > 0; b--)
+        {
+            for (int j = 0; j < dim; j++)
+            {
+                left[j] += hist[b * dim + j];
+            }
+            lc += cnt[b];
+
+            const unsigned long rc = count - lc;
+            if (cnt[b] != 0 && lc != 0 && rc != 0)
+            {
+                double left_dot = 0.0, right_dot = 0.0;
+                for (int j = 0; j < dim; j++)
+                {
+                    const double right = sum[j] - left[j];
+                    left_dot += left[j] * left[j];
+                    right_dot += right * right;
+                }
+
+                const double score = left_dot / lc + right_dot / rc;
+                if (score > best_score)
+                {
+                    best_score = score;
+                    thresh = edges[b - 1];
+                    left_sum = left;
+                    left_cnt = lc;
+                }
+            }
+        }
+        return best_score;
+    }
+
+    // generate_split() w/ the best histogram threshold for each of the random split features:
+    impl::split_feature generate_histogram_split(
+        dlib::thread_pool& tp,
+        const std::vector<training_sample>& samples,
+        unsigned long begin,
+        unsigned long end,
+        std::vector<impl::split_feature>& feats,
+        const fshape& sum,
+        fshape& left_sum,
+        fshape& right_sum,
+        bool do_npd = false) const
+    {
+        const histogram_binning binning(get_num_histogram_bins(), do_npd);
+        const unsigned long num_test_splits = feats.size();
+        const unsigned long bins = binning.bins();
+        const int dim = int(sum.size());
+
+        // One residual histogram (bins x dim sums) per candidate, where each worker fills the
+        // histograms of its own block of candidates:
+        std::vector<double> hist(num_test_splits * bins * dim, 0.0);
+        std::vector<unsigned long> cnt(num_test_splits * bins, 0);
+
+        const unsigned long num_workers = std::max(1UL, tp.num_threads_in_pool());
+        const unsigned long block_size = std::max(1UL, (num_test_splits + num_workers - 1) / num_workers);
+
+        parallel_for(tp, 0, num_workers, [&](unsigned long block) {
+            const unsigned long block_begin = block * block_size;
+            const unsigned long block_end = std::min(block_begin + block_size, num_test_splits);
+
+            std::vector<uint8_t> bin(end - begin);
+            for (unsigned long i = block_begin; i < block_end; ++i)
+            {
+                // bin the feature of each sample once, then accumulate the residuals per bin
+                for (unsigned long j = begin; j < end; ++j)
+                {
+                    const float a = samples[j].feature_pixel_values[feats[i].idx1], b = samples[j].feature_pixel_values[feats[i].idx2];
+                    bin[j - begin] = binning(do_npd ? compute_npd(a, b) : (a - b));
+                }
+
+                double* h = &hist[i * bins * dim];
+                unsigned long* c = &cnt[i * bins];
+                for (unsigned long j = begin; j < end; ++j)
+                {
+                    const auto& diff = samples[j].diff_shape;
+                    double* cell = &h[bin[j - begin] * dim];
+                    for (int k = 0; k < dim; k++)
+                    {
+                        cell[k] += diff(k);
+                    }
+                    ++c[bin[j - begin]];
+                }
+            }
+        },
+            1);
+
+        // now figure out which feature is the best
+        std::vector<double> total(dim), best_left(dim, 0.0), left;
+        for (int k = 0; k < dim; k++)
+        {
+            total[k] = sum(k);
+        }
+
+        double best_score = -1;
+        unsigned long best_feat = 0, left_cnt = 0;
+        for (unsigned long i = 0; i < num_test_splits; ++i)
+        {
+            float thresh = 0.f;
+            const double score = scan_histogram(&hist[i * bins * dim], &cnt[i * bins], binning.edges, dim, total.data(), end - begin, thresh, left, left_cnt);
+            if (score > best_score)
+            {
+                best_score = score;
+                best_feat = i;
+                best_left = left;
+                feats[i].thresh = thresh;
+            }
+        }
+
+        if (best_score < 0)
+        {
+            // No feature separates the samples: all of them go right
+            feats[best_feat].thresh = std::numeric_limits<float>::max();
+        }
+
+        left_sum.set_size(dim);
+        for (int k = 0; k < dim; k++)
+        {
+            left_sum(k) = float(best_left[k]);
+        }
+        right_sum = sum - left_sum;
+        return feats[best_feat];
+    }
+
     unsigned long partition_samples(
         const impl::split_feature& split,
         std::vector<training_sample>& samples,
@@ -864,6 +1383,301 @@ private:
         return i;
     }
 
+    // ================ out-of-core training =====================
+
+    // Runs f(block, shard) for all shards, where each worker block visits a fixed range of consecutive
+    // shards, so that per block accumulators are reduced in the same order for a given thread count:
+    void for_each_shard(
+        dlib::thread_pool& tp,
+        std::size_t shards,
+        const std::function<void(unsigned long, std::size_t)>& f) const
+    {
+        const unsigned long num_workers = std::max(1UL, tp.num_threads_in_pool());
+        const std::size_t shards_per_block = (shards + num_workers - 1) / num_workers;
+        parallel_for(tp, 0, num_workers, [&](unsigned long block) {
+            const std::size_t end = std::min(shards, (block + 1) * shards_per_block);
+            for (std::size_t k = block * shards_per_block; k < end; k++)
+            {
+                f(block, k);
+            }
+        },
+            1);
+    }
+
+    /*
+     * Streaming version of make_regression_tree(), for the sample shards <scratch>.<k>.samples.
+     * The samples are not partitioned; instead nodes[k][i] tracks the node of sample i in shard k,
+     * which is moved down one level per pass.
+     *
+     * sum: sum of the residuals (target - current) in the first dim coefficients, which is updated
+     * w/ the new current shapes.  The sums are double precision for millions of samples.  The
+     * histogram split search (see set_num_histogram_bins()) accumulates the residuals per bin, in
+     * one histogram per node and candidate that is shared by all workers.
+     */
+    impl::regression_tree make_regression_tree(
+        dlib::thread_pool& tp,
+        const std::string& scratch,
+        std::vector<std::vector<uint16_t>>& nodes,
+        const PointVecf& pixel_coordinates,
+        int dim,
+        std::vector<double>& sum,
+        unsigned long num_samples,
+        bool do_npd = false) const
+    {
+        using namespace impl;
+        const std::size_t shards = nodes.size();
+        const unsigned long num_workers = std::max(1UL, tp.num_threads_in_pool());
+        const unsigned long num_split_nodes = (1UL << get_tree_depth()) - 1;
+        const unsigned long num_test_splits = num_split_candidates();
+
+        impl::regression_tree tree;
+        tree.splits.resize(num_split_nodes);
+
+        std::vector<std::vector<double>> sums(num_split_nodes * 2 + 1, std::vector<double>(dim, 0.0));
+        std::vector<unsigned long> counts(sums.size(), 0);
+        sums[0] = sum;
+        counts[0] = num_samples;
+
+        auto feature_value = [&](const impl::split_feature& split, const uint8_t* values) {
+            const float a = values[split.idx1], b = values[split.idx2];
+            return do_npd ? compute_npd(a, b) : (a - b);
+        };
+        auto goes_left = [&](const impl::split_feature& split, const uint8_t* values) {
+            return feature_value(split, values) > split.thresh;
+        };
+
+        const bool do_histogram = get_num_histogram_bins() > 0;
+        const histogram_binning binning(std::max(2UL, get_num_histogram_bins()), do_npd);
+
+        // Residual sums per candidate split feature, in one cell per histogram bin, or in a single cell
+        // for the residuals that go left of a random threshold:
+        const unsigned long cells = do_histogram ? binning.bins() : 1;
+
+        // The samples of one shard w/ their nodes, residuals, and the cell of each candidate of their node:
+        struct binned_shard
+        {
+            std::vector<uint16_t> node;
+            std::vector<float> diff;   // dim per sample
+            std::vector<uint8_t> cell; // num_test_splits per sample (random thresholds: 1 for left)
+        };
+        std::vector<binned_shard> binned_shards(num_workers);
+        const unsigned long block_size = std::max(1UL, (num_test_splits + num_workers - 1) / num_workers);
+
+        for (unsigned long level = 0; level < get_tree_depth(); level++)
+        {
+            const unsigned long width = 1UL << level, first = width - 1;
+
+            // Random candidate splits for each node in this level, see generate_split():
+            std::vector<impl::split_feature> feats(width * num_test_splits);
+            for (auto& feat : feats)
+            {
+                feat = randomly_generate_split_feature(pixel_coordinates, do_npd);
+            }
+
+            // One shared histogram per node and candidate:
+            std::vector<double> hist(feats.size() * cells * dim, 0.0);
+            std::vector<unsigned long> cnt(feats.size() * cells, 0);
+
+            // The shards are processed in rounds of num_workers shards.  Each worker loads one shard,
+            // moves its samples down one level and bins them, then each worker adds the binned samples
+            // of the round to the histograms of its own block of candidates.  So the state per worker
+            // is one binned shard, and the sums are in shard order for any number of threads.
+            for (std::size_t round = 0; round < shards; round += num_workers)
+            {
+                parallel_for(tp, 0, num_workers, [&](unsigned long block) {
+                    const std::size_t k = round + block;
+                    binned_shard& binned = binned_shards[block];
+                    binned.node.clear();
+                    if (k >= shards)
+                    {
+                        return;
+                    }
+
+                    sample_shard s;
+                    s.load(sample_shard::name(scratch, k));
+
+                    auto& node_of = nodes[k];
+                    if (level == 0)
+                    {
+                        node_of.assign(s.size(), 0);
+                    }
+
+                    binned.node.resize(s.size());
+                    binned.diff.resize(s.size() * dim);
+                    binned.cell.resize(s.size() * num_test_splits);
+                    for (int i = 0; i < int(s.size()); i++)
+                    {
+                        const uint8_t* values = s.features.ptr<uint8_t>(i);
+                        if (level > 0)
+                        {
+                            const unsigned long parent = node_of[i];
+                            node_of[i] = uint16_t(goes_left(tree.splits[parent], values) ? left_child(parent) : right_child(parent));
+                        }
+                        binned.node[i] = node_of[i];
+
+                        const float* target = s.target.ptr<float>(i);
+                        const float* current = s.current.ptr<float>(i);
+                        for (int j = 0; j < dim; j++)
+                        {
+                            binned.diff[i * dim + j] = target[j] - current[j];
+                        }
+
+                        const impl::split_feature* candidates = &feats[(node_of[i] - first) * num_test_splits];
+                        uint8_t* cell = &binned.cell[i * num_test_splits];
+                        for (unsigned long c = 0; c < num_test_splits; c++)
+                        {
+                            cell[c] = do_histogram ? binning(feature_value(candidates[c], values)) : uint8_t(goes_left(candidates[c], values));
+                        }
+                    }
+                },
+                    1);
+
+                parallel_for(tp, 0, num_workers, [&](unsigned long block) {
+                    const unsigned long block_begin = block * block_size;
+                    const unsigned long block_end = std::min(block_begin + block_size, num_test_splits);
+                    for (const auto& binned : binned_shards)
+                    {
+                        for (std::size_t i = 0; i < binned.node.size(); i++)
+                        {
+                            const unsigned long f = (binned.node[i] - first) * num_test_splits;
+                            const float* diff = &binned.diff[i * dim];
+                            const uint8_t* bin = &binned.cell[i * num_test_splits];
+                            for (unsigned long c = block_begin; c < block_end; c++)
+                            {
+                                if (!do_histogram && !bin[c])
+                                {
+                                    continue; // goes right
+                                }
+
+                                const unsigned long cell = (f + c) * cells + (do_histogram ? bin[c] : 0);
+                                double* cell_sum = &hist[cell * dim];
+                                for (int j = 0; j < dim; j++)
+                                {
+                                    cell_sum[j] += diff[j];
+                                }
+                                ++cnt[cell];
+                            }
+                        }
+                    }
+                },
+                    1);
+            }
+
+            // now figure out which feature is the best for each node
+            for (unsigned long n = 0; n < width; n++)
+            {
+                const unsigned long node = first + n;
+                double best_score = -1;
+                unsigned long best_feat = n * num_test_splits, best_cnt = 0;
+                std::vector<double> best_sum(dim, 0.0), left_sum;
+                for (unsigned long f = n * num_test_splits; f < (n + 1) * num_test_splits; f++)
+                {
+                    if (do_histogram)
+                    {
+                        float thresh = 0.f;
+                        unsigned long left_cnt = 0;
+                        const double score = scan_histogram(&hist[f * cells * dim], &cnt[f * cells], binning.edges, dim, sums[node].data(), counts[node], thresh, left_sum, left_cnt);
+                        if (score > best_score)
+                        {
+                            best_score = score;
+                            best_feat = f;
+                            best_sum = left_sum;
+                            best_cnt = left_cnt;
+                            feats[f].thresh = thresh;
+                        }
+                        continue;
+                    }
+
+                    const unsigned long right_cnt = counts[node] - cnt[f];
+                    if (cnt[f] != 0 && right_cnt != 0)
+                    {
+                        double left_dot = 0.0, right_dot = 0.0;
+                        for (int j = 0; j < dim; j++)
+                        {
+                            const double left = hist[f * dim + j], right = sums[node][j] - left;
+                            left_dot += left * left;
+                            right_dot += right * right;
+                        }
+
+                        const double score = left_dot / cnt[f] + right_dot / right_cnt;
+                        if (score > best_score)
+                        {
+                            best_score = score;
+                            best_feat = f;
+                        }
+                    }
+                }
+
+                if (!do_histogram)
+                {
+                    best_sum.assign(&hist[best_feat * dim], &hist[best_feat * dim] + dim);
+                    best_cnt = cnt[best_feat];
+                }
+                else if (best_score < 0)
+                {
+                    // No feature separates the samples: all of them go right
+                    feats[best_feat].thresh = std::numeric_limits<float>::max();
+                }
+
+                tree.splits[node] = feats[best_feat];
+                for (int j = 0; j < dim; j++)
+                {
+                    sums[left_child(node)][j] = best_sum[j];
+                    sums[right_child(node)][j] = sums[node][j] - best_sum[j];
+                }
+                counts[left_child(node)] = best_cnt;
+                counts[right_child(node)] = counts[node] - best_cnt;
+            }
+        }
+
+        tree.leaf_values.resize(num_split_nodes + 1);
+        for (unsigned long i = 0; i < tree.leaf_values.size(); ++i)
+        {
+            const unsigned long count = counts[num_split_nodes + i];
+            tree.leaf_values[i].set_size(dim);
+            for (int j = 0; j < dim; j++)
+            {
+                tree.leaf_values[i](j) = count ? float(sums[num_split_nodes + i][j] * get_nu() / count) : 0.f;
+            }
+        }
+
+        // Now adjust the current shapes based on these predictions, and sum the new residuals:
+        std::vector<std::vector<double>> block_sums(num_workers, std::vector<double>(dim, 0.0));
+        for_each_shard(tp, shards, [&](unsigned long block, std::size_t k) {
+            sample_shard s;
+            s.load(sample_shard::name(scratch, k));
+
+            const auto& node_of = nodes[k];
+            for (int i = 0; i < int(s.size()); i++)
+            {
+                const unsigned long parent = node_of[i];
+                const unsigned long leaf = goes_left(tree.splits[parent], s.features.ptr<uint8_t>(i)) ? left_child(parent) : right_child(parent);
+                const auto& leaf_value = tree.leaf_values[leaf - num_split_nodes];
+
+                float* current = s.current.ptr<float>(i);
+                const float* target = s.target.ptr<float>(i);
+                for (int j = 0; j < dim; j++)
+                {
+                    current[j] += leaf_value(j);
+                    block_sums[block][j] += target[j] - current[j];
+                }
+            }
+
+            s.save(sample_shard::name(scratch, k));
+        });
+
+        std::fill(sum.begin(), sum.end(), 0.0);
+        for (const auto& block_sum : block_sums)
+        {
+            for (int j = 0; j < dim; j++)
+            {
+                sum[j] += block_sum[j];
+            }
+        }
+
+        return tree;
+    }
+
     fshape populate_training_sample_shapes(
         const std::vector<std::vector<dlib::full_object_detection>>& objects,
         std::vector<training_sample>& samples,
@@ -1035,6 +1849,8 @@ private:
     unsigned long _feature_pool_size;
     double _lambda;
     unsigned long _num_test_splits;
+    unsigned long _num_histogram_bins = 0;
+    unsigned long _num_histogram_test_splits = 0;
     double _feature_pool_region_padding;
     bool _verbose;
     unsigned long _num_threads;
@@ -1044,6 +1860,7 @@ private:
     int _ellipse_count = 0; /* trailing N * 5 params represent ellipses and need different normalization */
     bool _do_npd = false;
     bool _do_affine = false;
+    bool _do_bilinear = false;
     bool _do_line_indexed = false;
     dlib::drectangle _roi = { 0.f, 0.f, 0.f, 0.f };
 
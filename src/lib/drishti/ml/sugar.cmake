@@ -16,10 +16,13 @@ sugar_files(DRISHTI_ML_SRCS
   PCA.cpp
   PCAArchiveCereal.cpp
   RTEShapeEstimatorArchiveCereal.cpp  
+  RegressionForest.cpp
   RegressionTreeEnsembleShapeEstimator.cpp
   ShapeEstimator.cpp
   XGBooster.cpp
   XGBoosterIOArchiveCereal.cpp
+  shape_predictor_flat.cpp
+  shape_predictor_sampling.cpp
   )
 
 sugar_files(DRISHTI_ML_HDRS_PUBLIC
@@ -28,6 +31,7 @@ sugar_files(DRISHTI_ML_HDRS_PUBLIC
   PCA.h
   PCAImpl.h
   RTEShapeEstimatorImpl.h
+  RegressionForest.h
   RegressionTreeEnsembleShapeEstimator.h
   ShapeEstimator.h
   XGBooster.h
@@ -35,6 +39,8 @@ sugar_files(DRISHTI_ML_HDRS_PUBLIC
   drishti_ml.h
   shape_predictor.h
   shape_predictor_archive.h
+  shape_predictor_flat.h
+  shape_predictor_sampling.h
   )
 
 sugar_files(DRISHTI_ML_UT
@@ -42,7 +48,8 @@ sugar_files(DRISHTI_ML_UT
   )
 
 if(NOT DRISHTI_BUILD_MIN_SIZE)
-  sugar_files(DRISHTI_ML_HDRS_PUBLIC shape_predictor_trainer.h)
+  sugar_files(DRISHTI_ML_HDRS_PUBLIC shape_predictor_trainer.h shape_predictor_shards.h)
+  sugar_files(DRISHTI_ML_SRCS shape_predictor_shards.cpp)
 endif()
 
 if(DRISHTI_BUILD_DEST)
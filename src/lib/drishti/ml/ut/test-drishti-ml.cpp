@@ -10,10 +10,25 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+
 #include "drishti/ml/RegressionTreeEnsembleShapeEstimator.h"
 #include "drishti/ml/XGBooster.h"
+#include "drishti/ml/RegressionForest.h"
 #include "drishti/ml/PCA.h"
+#include "drishti/ml/shape_predictor.h"
+#include "drishti/ml/shape_predictor_flat.h"
+#if !DRISHTI_BUILD_MIN_SIZE
+#include "drishti/ml/shape_predictor_trainer.h"
+#endif
 
+#include "drishti/core/ThrowAssert.h"
 #include "drishti/core/drishti_stdlib_string.h"
 #include "drishti/core/drishti_cereal_pba.h"
 #include "drishti/core/drishti_cv_cereal.h"
@@ -25,6 +40,94 @@ TEST(XGBooster, XGBoosterInit)
     ASSERT_EQ(true, true);
 }
 
+#if !DRISHTI_BUILD_MIN_SIZE
+TEST(RegressionForest, MatchesXGBooster)
+{
+    const int samples = 256, features = 16;
+
+    cv::RNG rng(0);
+
+    // CPR like features: normalized pixel differences (f1-f2)/255 and NPD (f1-f2)/(f1+f2) in [-1,1]:
+    auto randomFeatures = [&](std::vector<float>& x) {
+        for (int j = 0; j < features; j++)
+        {
+            const float f1 = rng.uniform(1.f, 255.f), f2 = rng.uniform(1.f, 255.f);
+            x[j] = (j % 2) ? (f1 - f2) / (f1 + f2) : std::round(f1 - f2) / 255.f;
+        }
+    };
+
+    MatrixType<float> X(samples, std::vector<float>(features));
+    std::vector<float> y0(samples), y1(samples);
+    for (int i = 0; i < samples; i++)
+    {
+        randomFeatures(X[i]);
+        y0[i] = (X[i][0] - X[i][1]) + rng.uniform(-0.1f, 0.1f);
+        y1[i] = (X[i][2] > 0.f) ? 1.f : -1.f;
+    }
+
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 32;
+    recipe.maxDepth = 4;
+    recipe.featureSubsample = 0.5;
+
+    drishti::ml::XGBooster booster0(recipe), booster1(recipe);
+    booster0.train(X, y0);
+    booster1.train(X, y1);
+
+    drishti::ml::RegressionForest forest;
+    ASSERT_EQ(forest.add(booster0), 0);
+    ASSERT_EQ(forest.add(booster1), 1);
+    ASSERT_EQ(forest.size(), 2);
+    ASSERT_EQ(forest.trees(), 2 * recipe.numberOfTrees);
+    ASSERT_LE(forest.features(), features);
+
+    std::vector<float> x(features);
+    float outputs[2];
+    for (int i = 0; i < 64; i++)
+    {
+        randomFeatures(x);
+        if (i % 4 == 0)
+        {
+            x[rng.uniform(0, 3)] = NAN; // masked feature => missing branch
+        }
+
+        forest(x.data(), outputs);
+        EXPECT_NEAR(outputs[0], booster0(x), 1e-5f);
+        EXPECT_NEAR(outputs[1], booster1(x), 1e-5f);
+        EXPECT_EQ(outputs[1], forest(x.data(), 1));
+    }
+
+    // Features at and just below the split thresholds, which aren't exact w/ the 6 digit text dump:
+    std::vector<std::vector<drishti::ml::RegressionForest::Node>> trees;
+    booster0.getTrees(trees);
+    ASSERT_EQ(trees.size(), std::size_t(recipe.numberOfTrees));
+
+    int rounded = 0;
+    for (const auto& tree : trees)
+    {
+        for (const auto& node : tree)
+        {
+            if (node.feature < 0)
+            {
+                continue;
+            }
+
+            char text[32];
+            std::snprintf(text, sizeof(text), "%g", node.value);
+            rounded += (std::strtof(text, nullptr) != node.value);
+
+            randomFeatures(x);
+            for (auto value : { node.value, std::nextafter(node.value, -1.f) })
+            {
+                x[node.feature] = value;
+                EXPECT_NEAR(forest(x.data(), 0), booster0(x), 1e-5f);
+            }
+        }
+    }
+    EXPECT_GT(rounded, 0);
+}
+#endif
+
 TEST(StandardizedPCA, gemm_transpose_continuous)
 {
     cv::Mat A, Bt, C;
@@ -79,3 +182,610 @@ TEST(StandardizedPCA, gemm_transpose_non_continuous)
         }
     }
 }
+
+// Random depth 2 forests w/ pose indexed features, so the batched and single face
+// predictions can be compared without a trained model.  With dyadic == true all
+// leaves and the initial shape are multiples of 2^-10, which are exact in fixed point.
+static drishti::ml::shape_predictor createRandomShapePredictor(cv::RNG& rng, int stages, int trees, int features, bool dyadic = false)
+{
+    auto quantize = [&](float value) {
+        return dyadic ? std::round(value * 1024.f) / 1024.f : value;
+    };
+
+    using drishti::ml::fshape;
+    using drishti::ml::PointVecf;
+
+    const int points = 5;
+    fshape initial_shape(points * 2);
+    for (int i = 0; i < initial_shape.size(); i++)
+    {
+        initial_shape(i) = quantize(rng.uniform(0.2f, 0.8f));
+    }
+
+    std::vector<PointVecf> pixel_coordinates(stages);
+    std::vector<std::vector<drishti::ml::impl::regression_tree>> forests(stages);
+    for (int i = 0; i < stages; i++)
+    {
+        for (int j = 0; j < features; j++)
+        {
+            pixel_coordinates[i].emplace_back(rng.uniform(0.f, 1.f), rng.uniform(0.f, 1.f));
+        }
+
+        forests[i].resize(trees);
+        for (auto& tree : forests[i])
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                const auto idx1 = static_cast<unsigned short>(rng.uniform(0, features));
+                const auto idx2 = static_cast<unsigned short>(rng.uniform(0, features));
+                tree.splits.emplace_back(idx1, idx2, rng.uniform(-32.f, 32.f));
+            }
+            tree.leaf_values.resize(4);
+            for (auto& leaf : tree.leaf_values)
+            {
+                leaf.set_size(points * 2);
+                for (int k = 0; k < leaf.size(); k++)
+                {
+                    leaf(k) = quantize(rng.uniform(-0.01f, 0.01f));
+                }
+            }
+        }
+    }
+
+    drishti::ml::StandardizedPCAPtr pca;
+    drishti::ml::shape_predictor predictor(initial_shape, forests, pixel_coordinates, pca);
+    predictor.populate_f16();
+    return predictor;
+}
+
+TEST(shape_predictor, BatchMatchesSingle)
+{
+    cv::RNG rng(1);
+    const auto predictor = createRandomShapePredictor(rng, 4, 16, 32);
+
+    std::vector<cv::Mat1b> crops(21);
+    std::vector<dlib::cv_image<uint8_t>> imgs;
+    std::vector<dlib::rectangle> rects;
+    for (auto& crop : crops)
+    {
+        crop.create(rng.uniform(32, 96), rng.uniform(32, 96));
+        rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+        imgs.emplace_back(crop);
+        rects.emplace_back(0, 0, crop.cols, crop.rows);
+    }
+
+    const std::vector<drishti::ml::fshape> shapes(crops.size(), predictor.initial_shape);
+    const auto batch = predictor(imgs, rects, shapes);
+    ASSERT_EQ(batch.size(), crops.size());
+
+    for (int i = 0; i < crops.size(); i++)
+    {
+        const auto single = predictor(imgs[i], rects[i], predictor.initial_shape);
+        ASSERT_EQ(single.num_parts(), batch[i].num_parts());
+        for (int j = 0; j < single.num_parts(); j++)
+        {
+            ASSERT_EQ(single.part(j), batch[i].part(j));
+        }
+    }
+}
+
+// Video mode runs only the last cascade stages from a warm start:
+TEST(shape_predictor, WarmStartStages)
+{
+    cv::RNG rng(3);
+    const auto predictor = createRandomShapePredictor(rng, 4, 16, 32);
+    const int stages = int(predictor.forests.size());
+
+    std::vector<cv::Mat1b> crops(5);
+    std::vector<dlib::cv_image<uint8_t>> imgs;
+    std::vector<dlib::rectangle> rects;
+    for (auto& crop : crops)
+    {
+        crop.create(64, 64);
+        rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+        imgs.emplace_back(crop);
+        rects.emplace_back(0, 0, crop.cols, crop.rows);
+    }
+
+    const std::vector<drishti::ml::fshape> shapes(crops.size(), predictor.initial_shape);
+    const auto batch = predictor(imgs, rects, shapes, stages, stages - 2);
+    for (int i = 0; i < crops.size(); i++)
+    {
+        // No stages: the starter shape is returned
+        const auto parts = drishti::ml::shape_predictor::get_parts(rects[i], predictor.initial_shape, 0);
+        const auto none = predictor(imgs[i], rects[i], predictor.initial_shape, stages, stages);
+        const auto last = predictor(imgs[i], rects[i], predictor.initial_shape, stages, stages - 2);
+        ASSERT_EQ(none.num_parts(), parts.size());
+        ASSERT_EQ(last.num_parts(), batch[i].num_parts());
+        for (int j = 0; j < none.num_parts(); j++)
+        {
+            ASSERT_EQ(none.part(j), parts[j]);
+            ASSERT_EQ(last.part(j), batch[i].part(j));
+        }
+    }
+}
+
+TEST(shape_predictor, EarlyExit)
+{
+    cv::RNG rng(4);
+    auto predictor = createRandomShapePredictor(rng, 4, 16, 32);
+    const int stages = int(predictor.forests.size());
+
+    cv::Mat1b crop(64, 64);
+    rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+    const dlib::cv_image<uint8_t> img(crop);
+    const dlib::rectangle rect(0, 0, crop.cols, crop.rows);
+
+    // Disabled: all stages are evaluated
+    drishti::ml::shape_predictor::prediction_stats stats;
+    predictor(img, rect, predictor.initial_shape, stages, 0, &stats);
+    ASSERT_EQ(stats.stages, stages);
+    ASSERT_EQ(stats.updates.size(), std::size_t(stages));
+    ASSERT_FALSE(stats.converged);
+
+    // Any update is below the threshold: the cascade stops after the first stage
+    predictor.m_early_exit_threshold = std::numeric_limits<float>::max();
+    const auto first = predictor(img, rect, predictor.initial_shape, stages, 0, &stats);
+    ASSERT_EQ(stats.stages, 1);
+    ASSERT_TRUE(stats.converged);
+
+    std::vector<drishti::ml::shape_predictor::prediction_stats> batchStats;
+    const std::vector<dlib::cv_image<uint8_t>> imgs(2, img);
+    const std::vector<dlib::rectangle> rects(2, rect);
+    const std::vector<drishti::ml::fshape> shapes(2, predictor.initial_shape);
+    const auto batch = predictor(imgs, rects, shapes, stages, 0, &batchStats);
+    ASSERT_EQ(batchStats.size(), 2u);
+    for (int i = 0; i < 2; i++)
+    {
+        ASSERT_EQ(batchStats[i].stages, 1);
+        ASSERT_TRUE(batchStats[i].converged);
+        for (int j = 0; j < first.num_parts(); j++)
+        {
+            ASSERT_EQ(first.part(j), batch[i].part(j));
+        }
+    }
+}
+
+TEST(shape_predictor_flat, MatchesShapePredictor)
+{
+    cv::RNG rng(2);
+    const auto predictor = createRandomShapePredictor(rng, 4, 16, 32, true);
+
+    std::stringstream ss;
+    drishti::ml::shape_predictor_flat::save(predictor, ss);
+    const auto flat = drishti::ml::shape_predictor_flat::load(ss);
+    ASSERT_NE(flat, nullptr);
+
+    const auto& header = flat->header();
+    ASSERT_EQ(header.stages, predictor.forests.size());
+    ASSERT_EQ(header.shape_dim, predictor.initial_shape.size());
+    ASSERT_EQ(header.pca_dim, 0u);
+    for (uint32_t i = 0; i < header.stages; i++)
+    {
+        const auto& stage = flat->stage(i);
+        ASSERT_EQ(stage.trees, 16u);
+        ASSERT_EQ(stage.splits, 3u);
+        ASSERT_EQ(stage.features, 32u);
+        ASSERT_EQ(stage.leaf_offset % drishti::ml::shape_predictor_flat::kAlignment, 0);
+    }
+
+    std::vector<cv::Mat> crops(8);
+    std::vector<dlib::rectangle> rects;
+    for (auto& crop : crops)
+    {
+        crop.create(rng.uniform(32, 96), rng.uniform(32, 96), CV_8UC1);
+        rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+        rects.emplace_back(0, 0, crop.cols, crop.rows);
+    }
+
+    const std::vector<drishti::ml::fshape> shapes(crops.size(), flat->getInitialShape());
+    const auto batch = (*flat)(crops, rects, shapes);
+    ASSERT_EQ(batch.size(), crops.size());
+
+    for (int i = 0; i < crops.size(); i++)
+    {
+        const auto single = (*flat)(crops[i], rects[i], flat->getInitialShape());
+        ASSERT_EQ(single.num_parts(), batch[i].num_parts());
+
+#if !DRISHTI_BUILD_REGRESSION_FIXED_POINT
+        // Integer leaf accumulation is exact for the dyadic model:
+        const auto expected = predictor(dlib::cv_image<uint8_t>(crops[i]), rects[i], predictor.initial_shape);
+        ASSERT_EQ(single.num_parts(), expected.num_parts());
+#endif
+        for (int j = 0; j < single.num_parts(); j++)
+        {
+            ASSERT_EQ(single.part(j), batch[i].part(j));
+#if !DRISHTI_BUILD_REGRESSION_FIXED_POINT
+            ASSERT_EQ(single.part(j), expected.part(j));
+#endif
+        }
+    }
+}
+
+// Corrupt indices inside valid section bounds are rejected when loading:
+TEST(shape_predictor_flat, RejectsInvalidIndices)
+{
+    using drishti::ml::shape_predictor_flat;
+
+    cv::RNG rng(3);
+    const auto predictor = createRandomShapePredictor(rng, 2, 4, 32);
+
+    std::stringstream ss;
+    shape_predictor_flat::save(predictor, ss);
+    const std::string blob = ss.str();
+    const auto flat = shape_predictor_flat::load(ss);
+    const auto& stage = flat->stage(1);
+
+    auto load = [&](uint64_t offset, const void* value, std::size_t bytes) {
+        std::string corrupt = blob;
+        std::memcpy(&corrupt[offset], value, bytes);
+        std::stringstream is(corrupt);
+        return shape_predictor_flat::load(is);
+    };
+
+    const uint16_t feature = uint16_t(stage.features);
+    EXPECT_THROW(load(stage.split_offset + sizeof(shape_predictor_flat::Split) * 5 + offsetof(shape_predictor_flat::Split, idx2), &feature, sizeof(feature)), drishti::core::AssertionFailureException);
+
+    const uint16_t anchor = uint16_t(predictor.initial_shape.size() / 2);
+    EXPECT_THROW(load(stage.feature_offset + sizeof(uint16_t) * 7, &anchor, sizeof(anchor)), drishti::core::AssertionFailureException);
+
+    const uint32_t splits = 2; // 3 leaves
+    const uint64_t table = flat->header().stage_table + sizeof(shape_predictor_flat::Stage);
+    EXPECT_THROW(load(table + offsetof(shape_predictor_flat::Stage, splits), &splits, sizeof(splits)), drishti::core::AssertionFailureException);
+
+    const uint16_t valid = uint16_t(stage.features - 1);
+    EXPECT_NE(load(stage.split_offset + offsetof(shape_predictor_flat::Split, idx1), &valid, sizeof(valid)), nullptr);
+}
+
+TEST(shape_predictor, FeaturePixelSampler)
+{
+    cv::RNG rng(7);
+
+    cv::Mat1b crop(41, 37);
+    rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+    const dlib::rectangle rect(2, 3, 33, 38);
+
+    // Odd count for the vector tail, w/ points outside of the image:
+    const int n = 203;
+    std::vector<float> x(n), y(n), dx(n), dy(n);
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = rng.uniform(-0.3f, 1.3f);
+        y[i] = rng.uniform(-0.3f, 1.3f);
+        dx[i] = rng.uniform(-0.1f, 0.1f);
+        dy[i] = rng.uniform(-0.1f, 0.1f);
+    }
+    const float tform[4] = { 0.9f, -0.2f, 0.2f, 0.9f };
+
+    for (const bool bilinear : { false, true })
+    {
+        const drishti::ml::impl::feature_pixel_sampler sampler(crop, rect, bilinear);
+
+        std::vector<float> scalar(n), simd(n);
+        sampler.sample_scalar(n, x.data(), y.data(), dx.data(), dy.data(), tform, scalar.data());
+        sampler.sample_simd(n, x.data(), y.data(), dx.data(), dy.data(), tform, simd.data());
+
+        // Single precision in the vectorized path can only change rounding ties (nearest) or the last bits (bilinear):
+        int mismatches = 0;
+        for (int i = 0; i < n; i++)
+        {
+            mismatches += (std::abs(scalar[i] - simd[i]) > (bilinear ? 0.05f : 0.f));
+        }
+        ASSERT_LE(mismatches, n / 100);
+    }
+
+    // Empty and 1x1 images (the scalar path returns zeros outside of the image):
+    for (const auto& image : { cv::Mat1b(), cv::Mat1b(1, 1, uint8_t(200)) })
+    {
+        for (const bool bilinear : { false, true })
+        {
+            const drishti::ml::impl::feature_pixel_sampler sampler(image, rect, bilinear);
+
+            std::vector<float> scalar(n), simd(n, -1.f);
+            sampler.sample_scalar(n, x.data(), y.data(), dx.data(), dy.data(), tform, scalar.data());
+            sampler.sample_simd(n, x.data(), y.data(), dx.data(), dy.data(), tform, simd.data());
+
+            int mismatches = 0;
+            for (int i = 0; i < n; i++)
+            {
+                if (image.empty())
+                {
+                    ASSERT_EQ(scalar[i], 0.f);
+                    ASSERT_EQ(simd[i], 0.f);
+                }
+                mismatches += (std::abs(scalar[i] - simd[i]) > (bilinear ? 0.05f : 0.f));
+            }
+            ASSERT_LE(mismatches, n / 100);
+        }
+    }
+
+    // The sampling mode is stored in the flat model:
+    auto predictor = createRandomShapePredictor(rng, 2, 8, 32);
+    predictor.m_do_bilinear = true;
+
+    std::stringstream ss;
+    drishti::ml::shape_predictor_flat::save(predictor, ss);
+    const auto flat = drishti::ml::shape_predictor_flat::load(ss);
+    ASSERT_NE(flat, nullptr);
+    ASSERT_TRUE(flat->header().flags & drishti::ml::shape_predictor_flat::kBilinear);
+}
+
+TEST(shape_predictor, IncrementalBackProjection)
+{
+    cv::RNG rng(11);
+
+    const int dims = 10;
+    cv::Mat1f data(64, dims), projection;
+    rng.fill(data, cv::RNG::NORMAL, 0.f, 1.f);
+    data.col(0) = data.col(0) * 4.f + 1.f; // non unit standardization
+    drishti::ml::StandardizedPCA pca;
+    pca.compute(data, projection, 8);
+
+    drishti::ml::fshape coefficients(8), shape(dims), expected(dims);
+    for (int i = 0; i < coefficients.size(); i++)
+    {
+        coefficients(i) = rng.uniform(-1.f, 1.f);
+    }
+
+    // Stage dimensions may grow and shrink, followed by a stage update of the leading coefficients:
+    int pca_dim = -1;
+    for (const int stage_dim : { 3, 5, 5, 2, 8, 6 })
+    {
+        drishti::ml::shape_predictor::back_project(pca, pca_dim, stage_dim, coefficients, shape);
+        pca_dim = stage_dim;
+
+        drishti::ml::shape_predictor::back_project(pca, stage_dim, coefficients, expected);
+        for (int i = 0; i < dims; i++)
+        {
+            ASSERT_NEAR(shape(i), expected(i), 1e-4f);
+        }
+
+        std::vector<float> delta(stage_dim);
+        for (int i = 0; i < stage_dim; i++)
+        {
+            delta[i] = rng.uniform(-0.1f, 0.1f);
+            coefficients(i) += delta[i];
+        }
+        drishti::ml::shape_predictor::back_project_delta(pca, 0, stage_dim, delta.data(), 1.f, shape);
+    }
+
+    // Models w/ double precision matrices also cache a single precision scaled basis:
+    drishti::ml::StandardizedPCA::Standardizer transform;
+    pca.getStandardizer().mu.convertTo(transform.mu, CV_64F);
+    pca.getStandardizer().sigma.convertTo(transform.sigma, CV_64F);
+    cv::Mat mean64, eigenvectors64, eigenvalues64;
+    pca.getPCA()->mean.convertTo(mean64, CV_64F);
+    pca.getPCA()->eigenvectors.convertTo(eigenvectors64, CV_64F);
+    pca.getPCA()->eigenvalues.convertTo(eigenvalues64, CV_64F);
+
+    drishti::ml::StandardizedPCA pca64;
+    pca64.init(transform, mean64, eigenvectors64, eigenvalues64);
+    ASSERT_EQ(pca64.getScaledEigenvectors().type(), CV_32FC1);
+    EXPECT_LE(cv::norm(pca64.getScaledEigenvectors(), pca.getScaledEigenvectors(), cv::NORM_INF), 1e-5);
+}
+
+TEST(shape_predictor, QuickScorer)
+{
+    cv::RNG rng(13);
+
+    // Few features, so many nodes share a feature pair:
+    const int features = 8;
+    for (int depth = 1; depth <= 6; depth++)
+    {
+        std::vector<drishti::ml::impl::regression_tree> forest(20);
+        for (auto& tree : forest)
+        {
+            for (int k = 0; k < (1 << depth) - 1; k++)
+            {
+                const auto idx1 = static_cast<unsigned short>(rng.uniform(0, features));
+                const auto idx2 = static_cast<unsigned short>(rng.uniform(0, features));
+                tree.splits.emplace_back(idx1, idx2, std::round(rng.uniform(-4.f, 4.f))); // w/ ties
+            }
+        }
+
+        const drishti::ml::impl::quick_scorer scorer(forest);
+        std::vector<uint64_t> bits;
+        for (int i = 0; i < 32; i++)
+        {
+            std::vector<float> values(features);
+            for (auto& value : values)
+            {
+                value = std::round(rng.uniform(0.f, 8.f));
+            }
+
+            for (const bool do_npd : { false, true })
+            {
+                scorer(values.data(), 1, do_npd, bits);
+                ASSERT_EQ(bits.size(), forest.size());
+                for (std::size_t t = 0; t < forest.size(); t++)
+                {
+                    ASSERT_EQ(drishti::ml::impl::quick_scorer::exit_leaf(bits[t]), forest[t].leaf(values.data(), 1, do_npd));
+                }
+            }
+        }
+    }
+
+    // Same landmarks as tree traversal:
+    const auto predictor = createRandomShapePredictor(rng, 4, 16, 32);
+    auto scored = predictor;
+    ASSERT_TRUE(scored.set_do_quick_scorer(true));
+    ASSERT_TRUE(scored.get_do_quick_scorer());
+
+    std::vector<cv::Mat> crops(4);
+    std::vector<dlib::cv_image<uint8_t>> imgs;
+    std::vector<dlib::rectangle> rects;
+    for (auto& crop : crops)
+    {
+        crop.create(64, 64, CV_8UC1);
+        rng.fill(crop, cv::RNG::UNIFORM, 0, 256);
+        imgs.emplace_back(crop);
+        rects.emplace_back(0, 0, crop.cols, crop.rows);
+    }
+
+    const std::vector<drishti::ml::fshape> shapes(crops.size(), predictor.initial_shape);
+    const auto expected = predictor(imgs, rects, shapes);
+    const auto batch = scored(imgs, rects, shapes);
+    for (std::size_t i = 0; i < imgs.size(); i++)
+    {
+        const auto single = scored(imgs[i], rects[i], predictor.initial_shape);
+        for (unsigned long j = 0; j < expected[i].num_parts(); j++)
+        {
+            ASSERT_EQ(single.part(j), expected[i].part(j));
+            ASSERT_EQ(batch[i].part(j), expected[i].part(j));
+        }
+    }
+
+    // Trees w/ more than 64 leaves fall back to tree traversal:
+    auto deep = predictor;
+    deep.forests.back().front().splits.resize(127, deep.forests.back().front().splits.front());
+    deep.forests.back().front().leaf_values.resize(128, deep.forests.back().front().leaf_values.front());
+    EXPECT_FALSE(drishti::ml::impl::quick_scorer::is_supported(deep.forests.back()));
+    EXPECT_THROW(drishti::ml::impl::quick_scorer(deep.forests.back()), drishti::core::AssertionFailureException);
+    EXPECT_FALSE(deep.set_do_quick_scorer(true));
+    EXPECT_FALSE(deep.get_do_quick_scorer());
+}
+
+#if !DRISHTI_BUILD_MIN_SIZE
+// Noise w/ 4 bright landmarks at a random offset:
+static void createLandmarkImages(cv::RNG& rng, std::vector<cv::Mat1b>& crops, std::vector<std::vector<dlib::full_object_detection>>& objects)
+{
+    objects.resize(crops.size());
+    for (std::size_t i = 0; i < crops.size(); i++)
+    {
+        crops[i].create(64, 64);
+        rng.fill(crops[i], cv::RNG::UNIFORM, 0, 64);
+
+        const long x = rng.uniform(8, 24), y = rng.uniform(8, 24);
+        const std::vector<dlib::point> parts = { { x + 8, y + 8 }, { x + 24, y + 8 }, { x + 8, y + 24 }, { x + 24, y + 24 } };
+        for (const auto& p : parts)
+        {
+            crops[i](cv::Rect(int(p.x()) - 2, int(p.y()) - 2, 5, 5)).setTo(255);
+        }
+        objects[i].assign(1, dlib::full_object_detection(dlib::rectangle(0, 0, 63, 63), parts));
+    }
+}
+
+// Mean landmark error w/ the cascade stages [begin, end):
+static double landmarkError(const drishti::ml::shape_predictor& predictor, const std::vector<cv::Mat1b>& crops, const std::vector<std::vector<dlib::full_object_detection>>& objects, int end, int begin = 0)
+{
+    double error = 0.0;
+    int count = 0;
+    for (std::size_t i = 0; i < crops.size(); i++)
+    {
+        const dlib::cv_image<uint8_t> img(crops[i]);
+        const auto& truth = objects[i][0];
+        const auto shape = predictor(img, truth.get_rect(), predictor.initial_shape, end, begin);
+        for (unsigned long j = 0; j < truth.num_parts(); j++, count++)
+        {
+            error += dlib::length(shape.part(j) - truth.part(j));
+        }
+    }
+    return error / count;
+}
+
+TEST(shape_predictor_trainer, ShardedTraining)
+{
+    cv::RNG rng(17);
+
+    // Unique prefix in the temp directory, w/ cleanup on exit:
+    const std::string prefix = cv::tempfile("_shards");
+    const std::size_t shards = 3; // 12 images in shards of 5
+    struct Cleanup
+    {
+        std::function<void()> f;
+        ~Cleanup() { f(); }
+    } cleanup{ [&]() {
+        std::remove(prefix.c_str());
+        std::remove(drishti::ml::sharded_image_store::index_name(prefix).c_str());
+        for (std::size_t k = 0; k < shards; k++)
+        {
+            std::remove(drishti::ml::sharded_image_store::shard_name(prefix, k).c_str());
+            std::remove(drishti::ml::impl::sample_shard::name(prefix, k).c_str());
+        }
+    } };
+
+    std::vector<cv::Mat1b> crops(12);
+    std::vector<std::vector<dlib::full_object_detection>> objects;
+    createLandmarkImages(rng, crops, objects);
+    {
+        drishti::ml::sharded_image_store::writer writer(prefix, 5);
+        for (std::size_t i = 0; i < crops.size(); i++)
+        {
+            writer.add(crops[i], objects[i]);
+        }
+        writer.close();
+    }
+
+    const drishti::ml::sharded_image_store store(prefix);
+    ASSERT_EQ(store.shards(), shards);
+    ASSERT_EQ(store.size(), crops.size());
+
+    std::vector<cv::Mat> images;
+    std::vector<std::vector<dlib::full_object_detection>> loaded;
+    store.load(1, images, loaded);
+    ASSERT_EQ(images.size(), 5u);
+    for (int i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(cv::norm(images[i], crops[5 + i], cv::NORM_INF), 0.0);
+        ASSERT_EQ(loaded[i][0].get_rect(), objects[5 + i][0].get_rect());
+        for (unsigned long j = 0; j < loaded[i][0].num_parts(); j++)
+        {
+            ASSERT_EQ(loaded[i][0].part(j), objects[5 + i][0].part(j));
+        }
+    }
+
+    drishti::ml::shape_predictor_trainer trainer;
+    trainer.set_cascade_depth(3);
+    trainer.set_num_trees_per_cascade_level(10);
+    trainer.set_tree_depth(2);
+    trainer.set_oversampling_amount(5);
+    trainer.set_feature_pool_size(50);
+    trainer.set_num_threads(2);
+    const auto predictor = trainer.train(store, prefix);
+    ASSERT_EQ(predictor.forests.size(), 3u);
+    const int stages = int(predictor.forests.size());
+
+    // The cascade improves on the mean shape for the training images:
+    EXPECT_LT(landmarkError(predictor, crops, objects, stages), landmarkError(predictor, crops, objects, stages, stages));
+
+    // Also w/ the histogram split search (shared histograms of the streamed shards):
+    trainer.set_num_histogram_bins(64);
+    const auto histogram = trainer.train(store, prefix);
+    ASSERT_EQ(histogram.forests.size(), 3u);
+    EXPECT_LT(landmarkError(histogram, crops, objects, stages), landmarkError(histogram, crops, objects, stages, stages));
+}
+
+// The histogram split search fits the training set at least as well as the random thresholds:
+TEST(shape_predictor_trainer, HistogramSplits)
+{
+    cv::RNG rng(19);
+    std::vector<cv::Mat1b> crops(16);
+    std::vector<std::vector<dlib::full_object_detection>> objects;
+    createLandmarkImages(rng, crops, objects);
+    const std::vector<dlib::cv_image<uint8_t>> imgs(crops.begin(), crops.end());
+
+    // Separate trainers w/ the same (default) seed, which draw the same random pixel pairs for each
+    // node, so the histogram search only changes the thresholds (the best of 255 per pair):
+    auto train = [&](unsigned long bins) {
+        drishti::ml::shape_predictor_trainer trainer;
+        trainer.set_cascade_depth(3);
+        trainer.set_num_trees_per_cascade_level(10);
+        trainer.set_tree_depth(2);
+        trainer.set_oversampling_amount(5);
+        trainer.set_feature_pool_size(50);
+        trainer.set_num_histogram_bins(bins);
+        return trainer.train(imgs, objects);
+    };
+
+    const auto random = train(0);
+    const auto histogram = train(256);
+    ASSERT_EQ(histogram.forests.size(), random.forests.size());
+
+    const int stages = int(random.forests.size());
+    const double initial_error = landmarkError(random, crops, objects, stages, stages);
+    const double random_error = landmarkError(random, crops, objects, stages);
+    const double histogram_error = landmarkError(histogram, crops, objects, stages);
+    EXPECT_LT(random_error, initial_error);
+    EXPECT_LE(histogram_error, random_error);
+}
+#endif
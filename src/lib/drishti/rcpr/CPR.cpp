@@ -57,6 +57,23 @@ bool CPR::usesMask() const
     return flag;
 }
 
+bool CPR::isReentrant() const
+{
+    if (m_isMat)
+    {
+        return false;
+    }
+
+    for (const auto& reg : *(regModel->regs))
+    {
+        if (!reg->forest || (reg->forest->size() != reg->xgbdt.size()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 void CPR::setDoPreview(bool flag)
 {
     m_doPreview = flag;
@@ -75,6 +92,19 @@ cv::RotatedRect CPR::getPStar() const
     return phiToEllipse(mu);
 }
 
+void CPR::RegModel::Regs::compile()
+{
+    forest = std::make_shared<ml::RegressionForest>();
+    for (auto& t : xgbdt)
+    {
+        if (forest->add(*t.second) < 0)
+        {
+            forest.reset(); // doesn't match the booster: predict w/ xgbdt
+            return;
+        }
+    }
+}
+
 void CPR::CprPrm::FtrPrm::merge(const CPR::CprPrm::FtrPrm& opts, int checkExtra)
 {
     type.merge(opts.type, checkExtra);
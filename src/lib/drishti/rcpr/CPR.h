@@ -39,6 +39,7 @@
 #include "drishti/rcpr/Recipe.h"
 #include "drishti/ml/ShapeEstimator.h"
 #include "drishti/ml/XGBooster.h"
+#include "drishti/ml/RegressionForest.h"
 
 #include <memory>
 
@@ -204,6 +205,12 @@ public:
             // std::shared_ptr<> is preferred here w/ std::vector<> to avoid need for copyable ml::XGBooster
             std::vector<std::pair<int, std::shared_ptr<ml::XGBooster>>> xgbdt;
 
+            // Native copy of the xgbdt trees for allocation free evaluation (not serialized):
+            std::shared_ptr<ml::RegressionForest> forest;
+
+            // Rebuild the forest from xgbdt (after loading or training):
+            void compile();
+
             template <class Archive>
             void serialize(Archive& ar, const unsigned int version);
         };
@@ -216,6 +223,10 @@ public:
 
     bool usesMask() const;
 
+    // Prediction may be called concurrently when every stage has a compiled
+    // forest (XGBooster prediction is not reentrant):
+    bool isReentrant() const;
+
     struct CPROpts
     {
         core::Field<Vector1d> pInit; // initial pose
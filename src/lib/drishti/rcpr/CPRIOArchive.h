@@ -107,6 +107,11 @@ void CPR::RegModel::Regs::serialize(Archive& ar, const unsigned int version)
     ar& ftrData;
     ar& r;
     ar& xgbdt;
+
+    if (Archive::is_loading::value)
+    {
+        compile();
+    }
 }
 
 template <class Archive>
@@ -15,6 +15,8 @@
 
 #include "drishti/geometry/Ellipse.h"
 
+#include <type_traits>
+
 #define DRISHTI_CPR_DO_DEBUG 0
 
 // clang-format off
@@ -65,6 +67,9 @@ int CPR::cprApplyTree(const ImageMaskPair& IsIn, const RegModel& regModel, const
         stage.push_back(i);
     }
 
+    static_assert(std::is_same<Vector1d::value_type, float>::value, "RegressionForest requires float features");
+    std::vector<float> deltas; // reused across stages
+
     for (const auto& t : stage)
     {
         auto& reg = *(*(regModel.regs))[t];
@@ -74,12 +79,24 @@ int CPR::cprApplyTree(const ImageMaskPair& IsIn, const RegModel& regModel, const
 
         auto pDel = identity(model);
 
-        cv::Mat features;
-        cv::Mat(ftrResult.ftrs).reshape(1, 1).copyTo(features);
-        features.convertTo(features, CV_32F);
-
+        if (reg.forest && (reg.forest->size() == reg.xgbdt.size()))
+        {
+            // All regressors of the stage in one pass over the features:
+            CV_Assert(int(ftrResult.ftrs.size()) >= reg.forest->features());
+            deltas.resize(reg.forest->size());
+            (*reg.forest)(ftrResult.ftrs.data(), deltas.data());
+            for (std::size_t i = 0; i < reg.xgbdt.size(); i++)
+            {
+                pDel[reg.xgbdt[i].first] = deltas[i];
+            }
+        }
+        else
         {
             // XGBOOST
+            cv::Mat features;
+            cv::Mat(ftrResult.ftrs).reshape(1, 1).copyTo(features);
+            features.convertTo(features, CV_32F);
+
             std::vector<std::vector<float>> data(features.rows);
             for (int i = 0; i < features.rows; i++)
             {
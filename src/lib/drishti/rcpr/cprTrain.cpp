@@ -360,6 +360,7 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
         {
             reg.xgbdt.emplace_back(phiSets[best][i], xgbdt[i]);
         }
+        reg.compile();
 
         regs.emplace_back(reg);
     }